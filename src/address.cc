@@ -0,0 +1,770 @@
+#include "address.h"
+#include "endian.h"
+#include "config.h"
+#include "log.h"
+
+#include <sstream>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <ifaddrs.h>
+#include <stddef.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_dns_cache_ttl =
+        sltj::Config::Lookup("dns.cache_ttl", (uint32_t)60 * 1000, "dns lookup cache ttl(ms), 0 to disable");
+
+    static const size_t s_dns_cache_max_size = 1024;
+
+    // 进程内DNS缓存 key: host|family|type|protocol
+    class DnsCache
+    {
+    public:
+        using MutexType = RWMutex;
+
+        bool get(const std::string &key, std::vector<Address::ptr> &result)
+        {
+            uint64_t now = GetCurrentMS();
+            MutexType::ReadMutex lock(m_mutex);
+            auto it = m_datas.find(key);
+            if (it == m_datas.end() || it->second.first < now)
+            {
+                return false;
+            }
+            // 返回副本, 调用方可以随意setPort
+            for (auto &i : it->second.second)
+            {
+                result.push_back(Address::Create(i->getAddr(), i->getAddrLen()));
+            }
+            return true;
+        }
+
+        void set(const std::string &key, const std::vector<Address::ptr> &addrs, uint32_t ttl)
+        {
+            uint64_t now = GetCurrentMS();
+            std::vector<Address::ptr> copy;
+            for (auto &i : addrs)
+            {
+                copy.push_back(Address::Create(i->getAddr(), i->getAddrLen()));
+            }
+            MutexType::WriteMutex lock(m_mutex);
+            if (m_datas.size() >= s_dns_cache_max_size)
+            {
+                for (auto it = m_datas.begin(); it != m_datas.end();)
+                {
+                    if (it->second.first < now)
+                    {
+                        m_datas.erase(it++);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+                if (m_datas.size() >= s_dns_cache_max_size)
+                {
+                    m_datas.clear();
+                }
+            }
+            m_datas[key] = std::make_pair(now + ttl, copy);
+        }
+
+        void clear()
+        {
+            MutexType::WriteMutex lock(m_mutex);
+            m_datas.clear();
+        }
+
+    private:
+        MutexType m_mutex;
+        std::map<std::string, std::pair<uint64_t, std::vector<Address::ptr>>> m_datas; // <过期时间, 地址>
+    };
+
+    using DnsCacheMgr = sltj::Singleton<DnsCache>;
+
+    // 主机位全为1的掩码, 如bits=24时为0x000000FF
+    template <class T>
+    static T CreateMask(uint32_t bits)
+    {
+        if (bits >= sizeof(T) * 8)
+        {
+            return 0;
+        }
+        return (T)((T)(~(T)0) >> bits);
+    }
+
+    template <class T>
+    static uint32_t CountBytes(T value)
+    {
+        uint32_t result = 0;
+        for (; value; ++result)
+        {
+            value &= value - 1;
+        }
+        return result;
+    }
+
+    Address::ptr Address::LookupAny(const std::string &host, int family, int type, int protocol)
+    {
+        std::vector<Address::ptr> result;
+        if (Lookup(result, host, family, type, protocol))
+        {
+            return result[0];
+        }
+        return nullptr;
+    }
+
+    IPAddress::ptr Address::LookupAnyIPAddress(const std::string &host, int family, int type, int protocol)
+    {
+        std::vector<Address::ptr> result;
+        if (Lookup(result, host, family, type, protocol))
+        {
+            for (auto &i : result)
+            {
+                IPAddress::ptr v = std::dynamic_pointer_cast<IPAddress>(i);
+                if (v)
+                {
+                    return v;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    bool Address::Lookup(std::vector<Address::ptr> &result, const std::string &host,
+                         int family, int type, int protocol)
+    {
+        uint32_t ttl = g_dns_cache_ttl->getValue();
+        std::string key;
+        if (ttl)
+        {
+            std::stringstream ss;
+            ss << host << '|' << family << '|' << type << '|' << protocol;
+            key = ss.str();
+            if (DnsCacheMgr::GetInstance()->get(key, result))
+            {
+                return true;
+            }
+        }
+
+        addrinfo hints, *results, *next;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = family;
+        hints.ai_socktype = type;
+        hints.ai_protocol = protocol;
+
+        std::string node;
+        const char *service = nullptr;
+
+        // [ipv6]:port
+        if (!host.empty() && host[0] == '[')
+        {
+            const char *endipv6 = (const char *)memchr(host.c_str() + 1, ']', host.size() - 1);
+            if (endipv6)
+            {
+                if (*(endipv6 + 1) == ':')
+                {
+                    service = endipv6 + 2;
+                }
+                node = host.substr(1, endipv6 - host.c_str() - 1);
+            }
+        }
+
+        // host:port, 只有一个':'时才视为端口
+        if (node.empty())
+        {
+            service = (const char *)memchr(host.c_str(), ':', host.size());
+            if (service)
+            {
+                if (!memchr(service + 1, ':', host.c_str() + host.size() - service - 1))
+                {
+                    node = host.substr(0, service - host.c_str());
+                    ++service;
+                }
+                else
+                {
+                    service = nullptr;
+                }
+            }
+        }
+
+        if (node.empty())
+        {
+            node = host;
+        }
+
+        int error = getaddrinfo(node.c_str(), service, &hints, &results);
+        if (error)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Address::Lookup getaddress(" << host << ", "
+                                     << family << ", " << type << ") err=" << error << " errstr="
+                                     << gai_strerror(error);
+            return false;
+        }
+
+        size_t old_size = result.size();
+        next = results;
+        while (next)
+        {
+            Address::ptr addr = Create(next->ai_addr, (socklen_t)next->ai_addrlen);
+            if (addr)
+            {
+                result.push_back(addr);
+            }
+            next = next->ai_next;
+        }
+
+        freeaddrinfo(results);
+        if (result.size() == old_size)
+        {
+            return false;
+        }
+        if (ttl)
+        {
+            std::vector<Address::ptr> addrs(result.begin() + old_size, result.end());
+            DnsCacheMgr::GetInstance()->set(key, addrs, ttl);
+        }
+        return true;
+    }
+
+    void Address::ClearLookupCache()
+    {
+        DnsCacheMgr::GetInstance()->clear();
+    }
+
+    bool Address::GetInterfaceAddresses(std::multimap<std::string, std::pair<Address::ptr, uint32_t>> &result,
+                                        int family)
+    {
+        struct ifaddrs *next, *results;
+        if (getifaddrs(&results) != 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Address::GetInterfaceAddresses getifaddrs "
+                                     << " err=" << errno << " errstr=" << strerror(errno);
+            return false;
+        }
+
+        try
+        {
+            for (next = results; next; next = next->ifa_next)
+            {
+                Address::ptr addr;
+                uint32_t prefix_len = ~0u;
+                if (!next->ifa_addr)
+                {
+                    continue;
+                }
+                if (family != AF_UNSPEC && family != next->ifa_addr->sa_family)
+                {
+                    continue;
+                }
+                switch (next->ifa_addr->sa_family)
+                {
+                case AF_INET:
+                {
+                    addr = Create(next->ifa_addr, sizeof(sockaddr_in));
+                    if (next->ifa_netmask)
+                    {
+                        uint32_t netmask = ((sockaddr_in *)next->ifa_netmask)->sin_addr.s_addr;
+                        prefix_len = CountBytes(netmask);
+                    }
+                }
+                break;
+                case AF_INET6:
+                {
+                    addr = Create(next->ifa_addr, sizeof(sockaddr_in6));
+                    if (next->ifa_netmask)
+                    {
+                        in6_addr &netmask = ((sockaddr_in6 *)next->ifa_netmask)->sin6_addr;
+                        prefix_len = 0;
+                        for (int i = 0; i < 16; ++i)
+                        {
+                            prefix_len += CountBytes(netmask.s6_addr[i]);
+                        }
+                    }
+                }
+                break;
+                default:
+                    break;
+                }
+
+                if (addr)
+                {
+                    result.insert(std::make_pair(next->ifa_name, std::make_pair(addr, prefix_len)));
+                }
+            }
+        }
+        catch (...)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Address::GetInterfaceAddresses exception";
+            freeifaddrs(results);
+            return false;
+        }
+        freeifaddrs(results);
+        return !result.empty();
+    }
+
+    bool Address::GetInterfaceAddresses(std::vector<std::pair<Address::ptr, uint32_t>> &result,
+                                        const std::string &iface, int family)
+    {
+        if (iface.empty() || iface == "*")
+        {
+            if (family == AF_INET || family == AF_UNSPEC)
+            {
+                result.push_back(std::make_pair(Address::ptr(new IPv4Address()), 0u));
+            }
+            if (family == AF_INET6 || family == AF_UNSPEC)
+            {
+                result.push_back(std::make_pair(Address::ptr(new IPv6Address()), 0u));
+            }
+            return true;
+        }
+
+        std::multimap<std::string, std::pair<Address::ptr, uint32_t>> results;
+        if (!GetInterfaceAddresses(results, family))
+        {
+            return false;
+        }
+
+        auto its = results.equal_range(iface);
+        for (; its.first != its.second; ++its.first)
+        {
+            result.push_back(its.first->second);
+        }
+        return !result.empty();
+    }
+
+    int Address::getFamily() const
+    {
+        return getAddr()->sa_family;
+    }
+
+    std::string Address::toString() const
+    {
+        std::stringstream ss;
+        insert(ss);
+        return ss.str();
+    }
+
+    Address::ptr Address::Create(const sockaddr *addr, socklen_t addrlen)
+    {
+        if (addr == nullptr)
+        {
+            return nullptr;
+        }
+
+        Address::ptr result;
+        switch (addr->sa_family)
+        {
+        case AF_INET:
+            result.reset(new IPv4Address(*(const sockaddr_in *)addr));
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address(*(const sockaddr_in6 *)addr));
+            break;
+        case AF_UNIX:
+        {
+            UnixAddress::ptr unix_addr(new UnixAddress());
+            memcpy(unix_addr->getAddr(), addr, std::min<size_t>(addrlen, sizeof(sockaddr_un)));
+            unix_addr->setAddrLen(std::min<size_t>(addrlen, sizeof(sockaddr_un)));
+            result = unix_addr;
+        }
+        break;
+        default:
+            result.reset(new UnknownAddress(*addr));
+            break;
+        }
+        return result;
+    }
+
+    bool Address::operator<(const Address &rhs) const
+    {
+        socklen_t minlen = std::min(getAddrLen(), rhs.getAddrLen());
+        int result = memcmp(getAddr(), rhs.getAddr(), minlen);
+        if (result < 0)
+        {
+            return true;
+        }
+        else if (result > 0)
+        {
+            return false;
+        }
+        return getAddrLen() < rhs.getAddrLen();
+    }
+
+    bool Address::operator==(const Address &rhs) const
+    {
+        return getAddrLen() == rhs.getAddrLen() && memcmp(getAddr(), rhs.getAddr(), getAddrLen()) == 0;
+    }
+
+    bool Address::operator!=(const Address &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    IPAddress::ptr IPAddress::Create(const char *address, uint16_t port)
+    {
+        addrinfo hints, *results;
+        memset(&hints, 0, sizeof(addrinfo));
+
+        hints.ai_flags = AI_NUMERICHOST;
+        hints.ai_family = AF_UNSPEC;
+
+        int error = getaddrinfo(address, NULL, &hints, &results);
+        if (error)
+        {
+            SLTJ_LOG_DEBUG(g_logger) << "IPAddress::Create(" << address
+                                     << ", " << port << ") error=" << error
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+
+        IPAddress::ptr result = std::dynamic_pointer_cast<IPAddress>(
+            Address::Create(results->ai_addr, (socklen_t)results->ai_addrlen));
+        if (result)
+        {
+            result->setPort(port);
+        }
+        freeaddrinfo(results);
+        return result;
+    }
+
+    // IPv4 ============================================
+    IPv4Address::ptr IPv4Address::Create(const char *address, uint16_t port)
+    {
+        IPv4Address::ptr rt(new IPv4Address);
+        rt->m_addr.sin_port = byteswapOnLittleEndian(port);
+        int result = inet_pton(AF_INET, address, &rt->m_addr.sin_addr);
+        if (result <= 0)
+        {
+            SLTJ_LOG_DEBUG(g_logger) << "IPv4Address::Create(" << address << ", "
+                                     << port << ") rt=" << result << " errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+        return rt;
+    }
+
+    IPv4Address::IPv4Address(const sockaddr_in &address)
+    {
+        m_addr = address;
+    }
+
+    IPv4Address::IPv4Address(uint32_t address, uint16_t port)
+    {
+        memset(&m_addr, 0, sizeof(m_addr));
+        m_addr.sin_family = AF_INET;
+        m_addr.sin_port = byteswapOnLittleEndian(port);
+        m_addr.sin_addr.s_addr = byteswapOnLittleEndian(address);
+    }
+
+    sockaddr *IPv4Address::getAddr()
+    {
+        return (sockaddr *)&m_addr;
+    }
+
+    const sockaddr *IPv4Address::getAddr() const
+    {
+        return (const sockaddr *)&m_addr;
+    }
+
+    socklen_t IPv4Address::getAddrLen() const
+    {
+        return sizeof(m_addr);
+    }
+
+    std::ostream &IPv4Address::insert(std::ostream &os) const
+    {
+        uint32_t addr = byteswapOnLittleEndian(m_addr.sin_addr.s_addr);
+        os << ((addr >> 24) & 0xff) << "."
+           << ((addr >> 16) & 0xff) << "."
+           << ((addr >> 8) & 0xff) << "."
+           << (addr & 0xff);
+        os << ":" << byteswapOnLittleEndian(m_addr.sin_port);
+        return os;
+    }
+
+    IPAddress::ptr IPv4Address::broadcastAddress(uint32_t prefix_len)
+    {
+        if (prefix_len > 32)
+        {
+            return nullptr;
+        }
+
+        sockaddr_in baddr(m_addr);
+        baddr.sin_addr.s_addr |= byteswapOnLittleEndian(CreateMask<uint32_t>(prefix_len));
+        return IPv4Address::ptr(new IPv4Address(baddr));
+    }
+
+    IPAddress::ptr IPv4Address::networkAddress(uint32_t prefix_len)
+    {
+        if (prefix_len > 32)
+        {
+            return nullptr;
+        }
+
+        sockaddr_in baddr(m_addr);
+        baddr.sin_addr.s_addr &= ~byteswapOnLittleEndian(CreateMask<uint32_t>(prefix_len));
+        return IPv4Address::ptr(new IPv4Address(baddr));
+    }
+
+    IPAddress::ptr IPv4Address::subnetMask(uint32_t prefix_len)
+    {
+        if (prefix_len > 32)
+        {
+            return nullptr;
+        }
+
+        sockaddr_in subnet;
+        memset(&subnet, 0, sizeof(subnet));
+        subnet.sin_family = AF_INET;
+        subnet.sin_addr.s_addr = ~byteswapOnLittleEndian(CreateMask<uint32_t>(prefix_len));
+        return IPv4Address::ptr(new IPv4Address(subnet));
+    }
+
+    uint16_t IPv4Address::getPort() const
+    {
+        return byteswapOnLittleEndian(m_addr.sin_port);
+    }
+
+    void IPv4Address::setPort(uint16_t v)
+    {
+        m_addr.sin_port = byteswapOnLittleEndian(v);
+    }
+
+    // IPv6 ============================================
+    IPv6Address::ptr IPv6Address::Create(const char *address, uint16_t port)
+    {
+        IPv6Address::ptr rt(new IPv6Address);
+        rt->m_addr.sin6_port = byteswapOnLittleEndian(port);
+        int result = inet_pton(AF_INET6, address, &rt->m_addr.sin6_addr);
+        if (result <= 0)
+        {
+            SLTJ_LOG_DEBUG(g_logger) << "IPv6Address::Create(" << address << ", "
+                                     << port << ") rt=" << result << " errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+        return rt;
+    }
+
+    IPv6Address::IPv6Address()
+    {
+        memset(&m_addr, 0, sizeof(m_addr));
+        m_addr.sin6_family = AF_INET6;
+    }
+
+    IPv6Address::IPv6Address(const sockaddr_in6 &address)
+    {
+        m_addr = address;
+    }
+
+    IPv6Address::IPv6Address(const uint8_t address[16], uint16_t port)
+    {
+        memset(&m_addr, 0, sizeof(m_addr));
+        m_addr.sin6_family = AF_INET6;
+        m_addr.sin6_port = byteswapOnLittleEndian(port);
+        memcpy(&m_addr.sin6_addr.s6_addr, address, 16);
+    }
+
+    sockaddr *IPv6Address::getAddr()
+    {
+        return (sockaddr *)&m_addr;
+    }
+
+    const sockaddr *IPv6Address::getAddr() const
+    {
+        return (const sockaddr *)&m_addr;
+    }
+
+    socklen_t IPv6Address::getAddrLen() const
+    {
+        return sizeof(m_addr);
+    }
+
+    std::ostream &IPv6Address::insert(std::ostream &os) const
+    {
+        char buf[INET6_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET6, &m_addr.sin6_addr, buf, sizeof(buf));
+        os << "[" << buf << "]:" << byteswapOnLittleEndian(m_addr.sin6_port);
+        return os;
+    }
+
+    IPAddress::ptr IPv6Address::broadcastAddress(uint32_t prefix_len)
+    {
+        if (prefix_len > 128)
+        {
+            return nullptr;
+        }
+
+        sockaddr_in6 baddr(m_addr);
+        if (prefix_len < 128)
+        {
+            baddr.sin6_addr.s6_addr[prefix_len / 8] |= CreateMask<uint8_t>(prefix_len % 8);
+            for (int i = prefix_len / 8 + 1; i < 16; ++i)
+            {
+                baddr.sin6_addr.s6_addr[i] = 0xff;
+            }
+        }
+        return IPv6Address::ptr(new IPv6Address(baddr));
+    }
+
+    IPAddress::ptr IPv6Address::networkAddress(uint32_t prefix_len)
+    {
+        if (prefix_len > 128)
+        {
+            return nullptr;
+        }
+
+        sockaddr_in6 baddr(m_addr);
+        if (prefix_len < 128)
+        {
+            baddr.sin6_addr.s6_addr[prefix_len / 8] &= ~CreateMask<uint8_t>(prefix_len % 8);
+            for (int i = prefix_len / 8 + 1; i < 16; ++i)
+            {
+                baddr.sin6_addr.s6_addr[i] = 0x00;
+            }
+        }
+        return IPv6Address::ptr(new IPv6Address(baddr));
+    }
+
+    IPAddress::ptr IPv6Address::subnetMask(uint32_t prefix_len)
+    {
+        if (prefix_len > 128)
+        {
+            return nullptr;
+        }
+
+        sockaddr_in6 subnet;
+        memset(&subnet, 0, sizeof(subnet));
+        subnet.sin6_family = AF_INET6;
+        for (uint32_t i = 0; i < prefix_len / 8; ++i)
+        {
+            subnet.sin6_addr.s6_addr[i] = 0xff;
+        }
+        if (prefix_len < 128)
+        {
+            subnet.sin6_addr.s6_addr[prefix_len / 8] = ~CreateMask<uint8_t>(prefix_len % 8);
+        }
+        return IPv6Address::ptr(new IPv6Address(subnet));
+    }
+
+    uint16_t IPv6Address::getPort() const
+    {
+        return byteswapOnLittleEndian(m_addr.sin6_port);
+    }
+
+    void IPv6Address::setPort(uint16_t v)
+    {
+        m_addr.sin6_port = byteswapOnLittleEndian(v);
+    }
+
+    // Unix ============================================
+    static const size_t MAX_PATH_LEN = sizeof(((sockaddr_un *)0)->sun_path) - 1;
+
+    UnixAddress::UnixAddress()
+    {
+        memset(&m_addr, 0, sizeof(m_addr));
+        m_addr.sun_family = AF_UNIX;
+        m_length = offsetof(sockaddr_un, sun_path) + MAX_PATH_LEN;
+    }
+
+    UnixAddress::UnixAddress(const std::string &path)
+    {
+        memset(&m_addr, 0, sizeof(m_addr));
+        m_addr.sun_family = AF_UNIX;
+        m_length = path.size() + 1;
+
+        if (!path.empty() && path[0] == '\0')
+        {
+            --m_length;
+        }
+
+        if (m_length > sizeof(m_addr.sun_path))
+        {
+            throw std::logic_error("path too long");
+        }
+        memcpy(m_addr.sun_path, path.c_str(), m_length);
+        m_length += offsetof(sockaddr_un, sun_path);
+    }
+
+    void UnixAddress::setAddrLen(uint32_t v)
+    {
+        m_length = v;
+    }
+
+    sockaddr *UnixAddress::getAddr()
+    {
+        return (sockaddr *)&m_addr;
+    }
+
+    const sockaddr *UnixAddress::getAddr() const
+    {
+        return (const sockaddr *)&m_addr;
+    }
+
+    socklen_t UnixAddress::getAddrLen() const
+    {
+        return m_length;
+    }
+
+    std::string UnixAddress::getPath() const
+    {
+        std::stringstream ss;
+        if (m_length > offsetof(sockaddr_un, sun_path) && m_addr.sun_path[0] == '\0')
+        {
+            ss << "\\0" << std::string(m_addr.sun_path + 1, m_length - offsetof(sockaddr_un, sun_path) - 1);
+        }
+        else
+        {
+            ss << m_addr.sun_path;
+        }
+        return ss.str();
+    }
+
+    std::ostream &UnixAddress::insert(std::ostream &os) const
+    {
+        return os << getPath();
+    }
+
+    // Unknown =========================================
+    UnknownAddress::UnknownAddress(int family)
+    {
+        memset(&m_addr, 0, sizeof(m_addr));
+        m_addr.sa_family = family;
+    }
+
+    UnknownAddress::UnknownAddress(const sockaddr &addr)
+    {
+        m_addr = addr;
+    }
+
+    sockaddr *UnknownAddress::getAddr()
+    {
+        return (sockaddr *)&m_addr;
+    }
+
+    const sockaddr *UnknownAddress::getAddr() const
+    {
+        return &m_addr;
+    }
+
+    socklen_t UnknownAddress::getAddrLen() const
+    {
+        return sizeof(m_addr);
+    }
+
+    std::ostream &UnknownAddress::insert(std::ostream &os) const
+    {
+        os << "[UnknownAddress family=" << m_addr.sa_family << "]";
+        return os;
+    }
+
+    std::ostream &operator<<(std::ostream &os, const Address &addr)
+    {
+        return addr.insert(os);
+    }
+
+} // namespace sltj
@@ -0,0 +1,105 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <new>
+
+namespace sltj
+{
+    Arena::Arena(size_t block_size)
+        : m_blockSize(block_size)
+    {
+    }
+
+    Arena::~Arena()
+    {
+        for (auto &b : m_blocks)
+        {
+            free(b.data);
+        }
+    }
+
+    void *Arena::allocate(size_t size, size_t align)
+    {
+        uintptr_t p = ((uintptr_t)m_ptr + align - 1) & ~(uintptr_t)(align - 1);
+        if (m_ptr && p + size <= (uintptr_t)m_end)
+        {
+            m_ptr = (char *)(p + size);
+            m_used += size;
+            return (void *)p;
+        }
+        return allocateFallback(size, align);
+    }
+
+    void *Arena::allocateFallback(size_t size, size_t align)
+    {
+        size_t need = size + align;
+        // 大对象单独一块, 不浪费当前块的剩余空间
+        if (need > m_blockSize / 4)
+        {
+            char *data = (char *)malloc(need);
+            if (!data)
+            {
+                throw std::bad_alloc();
+            }
+            m_blocks.push_back(Block{data, need});
+            m_reserved += need;
+            m_used += size;
+            return (void *)(((uintptr_t)data + align - 1) & ~(uintptr_t)(align - 1));
+        }
+
+        char *data = (char *)malloc(m_blockSize);
+        if (!data)
+        {
+            throw std::bad_alloc();
+        }
+        m_blocks.push_back(Block{data, m_blockSize});
+        m_reserved += m_blockSize;
+        m_ptr = data;
+        m_end = data + m_blockSize;
+        return allocate(size, align);
+    }
+
+    void Arena::reset()
+    {
+        // 保留第一个普通大小的块
+        size_t keep = m_blocks.size();
+        for (size_t i = 0; i < m_blocks.size(); ++i)
+        {
+            if (m_blocks[i].size == m_blockSize)
+            {
+                keep = i;
+                break;
+            }
+        }
+        for (size_t i = 0; i < m_blocks.size(); ++i)
+        {
+            if (i != keep)
+            {
+                free(m_blocks[i].data);
+            }
+        }
+        if (keep < m_blocks.size())
+        {
+            Block b = m_blocks[keep];
+            m_blocks.clear();
+            m_blocks.push_back(b);
+            m_ptr = b.data;
+            m_end = b.data + b.size;
+            m_reserved = b.size;
+        }
+        else
+        {
+            m_blocks.clear();
+            m_ptr = m_end = nullptr;
+            m_reserved = 0;
+        }
+        m_used = 0;
+    }
+
+    Arena *Arena::GetThis()
+    {
+        static thread_local Arena t_arena;
+        return &t_arena;
+    }
+
+} // namespace sltj
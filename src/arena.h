@@ -0,0 +1,106 @@
+#ifndef __SLTJ_ARENA_H__
+#define __SLTJ_ARENA_H__
+
+#include <memory>
+#include <vector>
+#include <new>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sltj
+{
+    // 线性(bump)分配器: 从大块内存中顺序切分, 不支持单独释放, reset后整体复用.
+    // 适合一个请求/一批日志内生命周期相同的小对象. 非线程安全.
+    class Arena
+    {
+    public:
+        using ptr = std::shared_ptr<Arena>;
+
+        Arena(size_t block_size = 4096);
+        ~Arena();
+
+        // align须为2的幂
+        void *allocate(size_t size, size_t align = alignof(max_align_t));
+
+        // 在arena上构造对象; 析构函数不会被调用, 只用于平凡析构或自行析构的对象
+        template <class T, class... Args>
+        T *create(Args &&...args)
+        {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // 丢弃所有分配, 保留第一个块, 其余块释放
+        void reset();
+
+        // 已分配给调用方的字节数
+        size_t getBytesUsed() const { return m_used; }
+        // 向系统申请的字节数
+        size_t getBytesReserved() const { return m_reserved; }
+
+        // 当前线程的arena; 协程中使用时不要跨Yield持有其中的内存
+        static Arena *GetThis();
+
+    private:
+        void *allocateFallback(size_t size, size_t align);
+
+    private:
+        struct Block
+        {
+            char *data;
+            size_t size;
+        };
+
+        size_t m_blockSize;
+        char *m_ptr = nullptr;    // 当前块中的空闲位置
+        char *m_end = nullptr;
+        size_t m_used = 0;
+        size_t m_reserved = 0;
+        std::vector<Block> m_blocks;
+
+    private:
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+    };
+
+    // 从Arena分配的std::allocator适配器, deallocate为空操作
+    template <class T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        template <class U>
+        struct rebind
+        {
+            using other = ArenaAllocator<U>;
+        };
+
+        ArenaAllocator(Arena *arena) noexcept : m_arena(arena) {}
+        template <class U>
+        ArenaAllocator(const ArenaAllocator<U> &other) noexcept : m_arena(other.getArena()) {}
+
+        T *allocate(size_t n) { return (T *)m_arena->allocate(n * sizeof(T), alignof(T)); }
+        void deallocate(T *, size_t) noexcept {}
+
+        Arena *getArena() const { return m_arena; }
+
+    private:
+        Arena *m_arena;
+    };
+
+    template <class T, class U>
+    bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+    {
+        return a.getArena() == b.getArena();
+    }
+
+    template <class T, class U>
+    bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+    {
+        return !(a == b);
+    }
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,493 @@
+#include "buffer_pool.h"
+#include "config.h"
+#include "metrics.h"
+#include "thread.h"
+
+#include <algorithm>
+#include <deque>
+#include <new>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace sltj
+{
+    static sltj::ConfigVar<uint32_t>::ptr g_buffer_pool_thread_cache_pages =
+        sltj::Config::Lookup<uint32_t>("buffer_pool.thread_cache_pages", 16, "free io buffer pages cached per thread");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_buffer_pool_max_free_pages =
+        sltj::Config::Lookup<uint32_t>("buffer_pool.max_free_pages", 256, "resident free io buffer pages kept by the global pool, the rest are madvised away");
+
+    // 线程缓存的上限在每次归还时检查, 不经过配置项的锁
+    static std::atomic<uint32_t> s_thread_cache_pages{16};
+
+    namespace
+    {
+        struct BufferPoolIniter
+        {
+            BufferPoolIniter()
+            {
+                s_thread_cache_pages = g_buffer_pool_thread_cache_pages->getValue();
+                g_buffer_pool_thread_cache_pages->addListener([](const uint32_t &old_value, const uint32_t &new_value) {
+                    s_thread_cache_pages = new_value;
+                });
+            }
+        };
+
+        static BufferPoolIniter s_initer;
+
+        struct BufferPoolMetrics
+        {
+            Gauge::ptr inUse = Metrics::Lookup<Gauge>("buffer_pool.pages_in_use", "io buffer pages held by buffers or slices");
+            Gauge::ptr large = Metrics::Lookup<Gauge>("buffer_pool.large_blocks", "io buffer blocks larger than a page");
+            Counter::ptr released = Metrics::Lookup<Counter>("buffer_pool.pages_released", "free io buffer pages returned to the system with madvise");
+        };
+
+        static BufferPoolMetrics *GetBufferPoolMetrics()
+        {
+            static BufferPoolMetrics *s_metrics = new BufferPoolMetrics;
+            return s_metrics;
+        }
+
+        // 全局空闲表: resident按归还顺序排列, 尾部最近归还(最热), 头部最久未用, 先还给系统
+        struct Central
+        {
+            Mutex mutex;
+            std::deque<BufferBlock *> resident;
+            std::vector<BufferBlock *> released;
+            uint64_t pages = 0;
+
+            // 取最多n个空闲页串成链表, 不够时映射新的一组, 返回实际个数
+            size_t fetch(size_t n, BufferBlock *&head)
+            {
+                Mutex::Lock lock(mutex);
+                if (resident.empty() && released.empty())
+                {
+                    map();
+                }
+                size_t got = 0;
+                head = nullptr;
+                while (got < n && (!resident.empty() || !released.empty()))
+                {
+                    BufferBlock *b;
+                    if (!resident.empty())
+                    {
+                        b = resident.back();
+                        resident.pop_back();
+                    }
+                    else
+                    {
+                        b = released.back();
+                        released.pop_back();
+                        b->released = false;
+                    }
+                    b->next = head;
+                    head = b;
+                    ++got;
+                }
+                return got;
+            }
+
+            void release(BufferBlock *head)
+            {
+                Mutex::Lock lock(mutex);
+                while (head)
+                {
+                    BufferBlock *next = head->next;
+                    head->next = nullptr;
+                    resident.push_back(head);
+                    head = next;
+                }
+                shrink(g_buffer_pool_max_free_pages->getValue());
+            }
+
+            // 调用方持有mutex
+            size_t shrink(size_t keep)
+            {
+                size_t n = 0;
+                while (resident.size() > keep)
+                {
+                    BufferBlock *b = resident.front();
+                    resident.pop_front();
+                    madvise(b->data, b->capacity, MADV_DONTNEED);
+                    b->released = true;
+                    released.push_back(b);
+                    ++n;
+                }
+                if (n)
+                {
+                    GetBufferPoolMetrics()->released->inc(n);
+                }
+                return n;
+            }
+
+            // 映射一组页, 调用方持有mutex; 页头单独分配, madvise不影响引用计数
+            void map()
+            {
+                size_t len = BufferPool::PAGE_SIZE * BufferPool::CHUNK_PAGES;
+                void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED)
+                {
+                    throw std::bad_alloc();
+                }
+                BufferBlock *blocks = new BufferBlock[BufferPool::CHUNK_PAGES];
+                for (size_t i = 0; i < BufferPool::CHUNK_PAGES; ++i)
+                {
+                    blocks[i].pooled = true;
+                    blocks[i].data = (char *)p + i * BufferPool::PAGE_SIZE;
+                    blocks[i].capacity = BufferPool::PAGE_SIZE;
+                    resident.push_back(&blocks[i]);
+                }
+                pages += BufferPool::CHUNK_PAGES;
+            }
+        };
+
+        // 进程生命周期内不析构, 线程退出时的归还总是安全的
+        static Central *GetCentral()
+        {
+            static Central *s_central = new Central;
+            return s_central;
+        }
+
+        struct ThreadCache
+        {
+            BufferBlock *head = nullptr;
+            size_t count = 0;
+
+            ~ThreadCache() { flush(); }
+
+            void flush()
+            {
+                if (head)
+                {
+                    GetCentral()->release(head);
+                    head = nullptr;
+                    count = 0;
+                }
+            }
+
+            BufferBlock *allocate()
+            {
+                if (!head)
+                {
+                    count = GetCentral()->fetch(std::max<size_t>(1, s_thread_cache_pages / 2), head);
+                }
+                BufferBlock *b = head;
+                head = b->next;
+                b->next = nullptr;
+                --count;
+                return b;
+            }
+
+            void deallocate(BufferBlock *b)
+            {
+                b->next = head;
+                head = b;
+                ++count;
+                size_t limit = s_thread_cache_pages;
+                if (count > limit)
+                {
+                    // 超出时保留最近归还的一半, 其余归还到全局空闲表
+                    size_t keep = limit / 2;
+                    BufferBlock *tail = head;
+                    for (size_t i = 1; i < keep; ++i)
+                    {
+                        tail = tail->next;
+                    }
+                    BufferBlock *rest = keep ? tail->next : head;
+                    if (keep)
+                    {
+                        tail->next = nullptr;
+                    }
+                    else
+                    {
+                        head = nullptr;
+                    }
+                    count = keep;
+                    GetCentral()->release(rest);
+                }
+            }
+        };
+
+        // 线程缓存在线程退出时析构; 析构之后(其他thread_local对象析构中)的借还直接走全局空闲表
+        static thread_local ThreadCache *t_cache = nullptr;
+        static thread_local bool t_cache_dead = false;
+
+        struct ThreadCacheHolder
+        {
+            ThreadCacheHolder() { t_cache = &cache; }
+            ~ThreadCacheHolder()
+            {
+                t_cache = nullptr;
+                t_cache_dead = true;
+            }
+            ThreadCache cache;
+        };
+
+        static ThreadCache *GetThreadCache()
+        {
+            if (t_cache)
+            {
+                return t_cache;
+            }
+            if (t_cache_dead)
+            {
+                return nullptr;
+            }
+            static thread_local ThreadCacheHolder t_holder;
+            return t_cache;
+        }
+    } // namespace
+
+    BufferBlock *BufferPool::Allocate(size_t size)
+    {
+        BufferBlock *b;
+        if (size <= PAGE_SIZE)
+        {
+            ThreadCache *cache = GetThreadCache();
+            if (cache)
+            {
+                b = cache->allocate();
+            }
+            else
+            {
+                GetCentral()->fetch(1, b);
+            }
+            GetBufferPoolMetrics()->inUse->inc();
+        }
+        else
+        {
+            // 大块与页头一次申请, 按页对齐到整数倍
+            size_t cap = (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+            void *p = malloc(sizeof(BufferBlock) + cap);
+            if (!p)
+            {
+                throw std::bad_alloc();
+            }
+            b = new (p) BufferBlock;
+            b->data = (char *)p + sizeof(BufferBlock);
+            b->capacity = cap;
+            GetBufferPoolMetrics()->large->inc();
+        }
+        b->refs.store(1, std::memory_order_relaxed);
+        return b;
+    }
+
+    void BufferPool::Release(BufferBlock *block)
+    {
+        if (!block || block->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        {
+            return;
+        }
+        if (!block->pooled)
+        {
+            GetBufferPoolMetrics()->large->dec();
+            block->~BufferBlock();
+            free(block);
+            return;
+        }
+        GetBufferPoolMetrics()->inUse->dec();
+        ThreadCache *cache = GetThreadCache();
+        if (cache)
+        {
+            cache->deallocate(block);
+        }
+        else
+        {
+            GetCentral()->release(block);
+        }
+    }
+
+    void BufferPool::FlushThreadCache()
+    {
+        ThreadCache *cache = GetThreadCache();
+        if (cache)
+        {
+            cache->flush();
+        }
+    }
+
+    size_t BufferPool::Shrink(size_t keep)
+    {
+        Central *c = GetCentral();
+        Mutex::Lock lock(c->mutex);
+        return c->shrink(keep);
+    }
+
+    BufferPool::Stats BufferPool::GetStats()
+    {
+        Stats s;
+        {
+            Central *c = GetCentral();
+            Mutex::Lock lock(c->mutex);
+            s.pages = c->pages;
+            s.pagesFree = c->resident.size() + c->released.size();
+            s.pagesReleased = c->released.size();
+        }
+        BufferPoolMetrics *m = GetBufferPoolMetrics();
+        s.pagesInUse = m->inUse->getValue();
+        s.largeBlocks = m->large->getValue();
+        return s;
+    }
+
+    BufferSlice::BufferSlice(BufferBlock *block, const char *data, size_t len)
+        : m_block(block), m_data(data), m_len(len)
+    {
+        if (m_block)
+        {
+            m_block->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    BufferSlice::BufferSlice(const BufferSlice &o)
+        : BufferSlice(o.m_block, o.m_data, o.m_len)
+    {
+    }
+
+    BufferSlice::BufferSlice(BufferSlice &&o) noexcept
+        : m_block(o.m_block), m_data(o.m_data), m_len(o.m_len)
+    {
+        o.m_block = nullptr;
+        o.m_data = nullptr;
+        o.m_len = 0;
+    }
+
+    BufferSlice &BufferSlice::operator=(BufferSlice o) noexcept
+    {
+        swap(o);
+        return *this;
+    }
+
+    BufferSlice::~BufferSlice()
+    {
+        BufferPool::Release(m_block);
+    }
+
+    BufferSlice BufferSlice::sub(size_t off, size_t len) const
+    {
+        if (off > m_len)
+        {
+            off = m_len;
+        }
+        if (len > m_len - off)
+        {
+            len = m_len - off;
+        }
+        return BufferSlice(m_block, m_data + off, len);
+    }
+
+    void BufferSlice::swap(BufferSlice &o) noexcept
+    {
+        std::swap(m_block, o.m_block);
+        std::swap(m_data, o.m_data);
+        std::swap(m_len, o.m_len);
+    }
+
+    std::ostream &operator<<(std::ostream &os, const BufferSlice &slice)
+    {
+        return os.write(slice.data(), slice.size());
+    }
+
+    IOBuffer::IOBuffer(IOBuffer &&o) noexcept
+        : m_block(o.m_block), m_begin(o.m_begin), m_end(o.m_end)
+    {
+        o.m_block = nullptr;
+        o.m_begin = o.m_end = 0;
+    }
+
+    IOBuffer &IOBuffer::operator=(IOBuffer &&o) noexcept
+    {
+        if (this != &o)
+        {
+            release();
+            m_block = o.m_block;
+            m_begin = o.m_begin;
+            m_end = o.m_end;
+            o.m_block = nullptr;
+            o.m_begin = o.m_end = 0;
+        }
+        return *this;
+    }
+
+    IOBuffer::~IOBuffer()
+    {
+        release();
+    }
+
+    char *IOBuffer::prepare(size_t n)
+    {
+        if (!m_block)
+        {
+            m_block = BufferPool::Allocate(n);
+            m_begin = m_end = 0;
+        }
+        if (m_block->capacity - m_end >= n)
+        {
+            return m_block->data + m_end;
+        }
+        size_t len = size();
+        // 没有切片引用时把数据搬到开头; 有切片时开头的内存不能改写, 换一块
+        if (m_block->refs.load(std::memory_order_acquire) == 1 && len + n <= m_block->capacity)
+        {
+            memmove(m_block->data, m_block->data + m_begin, len);
+        }
+        else
+        {
+            // 需要扩大时至少翻倍, 避免逐次增长反复拷贝
+            size_t want = len + n > m_block->capacity ? std::max(len + n, m_block->capacity * 2) : len + n;
+            BufferBlock *b = BufferPool::Allocate(want);
+            memcpy(b->data, m_block->data + m_begin, len);
+            BufferPool::Release(m_block);
+            m_block = b;
+        }
+        m_begin = 0;
+        m_end = len;
+        return m_block->data + m_end;
+    }
+
+    void IOBuffer::append(const void *data, size_t len)
+    {
+        if (!len)
+        {
+            return;
+        }
+        memcpy(prepare(len), data, len);
+        commit(len);
+    }
+
+    void IOBuffer::consume(size_t n)
+    {
+        m_begin += std::min(n, size());
+        if (m_begin == m_end)
+        {
+            release();
+        }
+    }
+
+    void IOBuffer::clear()
+    {
+        release();
+    }
+
+    BufferSlice IOBuffer::slice(size_t off, size_t len) const
+    {
+        if (off > size())
+        {
+            off = size();
+        }
+        if (len > size() - off)
+        {
+            len = size() - off;
+        }
+        return BufferSlice(m_block, data() + off, len);
+    }
+
+    void IOBuffer::release()
+    {
+        BufferPool::Release(m_block);
+        m_block = nullptr;
+        m_begin = m_end = 0;
+    }
+
+} // namespace sltj
@@ -0,0 +1,127 @@
+#ifndef __SLTJ_BUFFER_POOL_H__
+#define __SLTJ_BUFFER_POOL_H__
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sltj
+{
+    // 引用计数的一块缓冲内存: 池中的页, 或超过页大小时单独申请的大块
+    struct BufferBlock
+    {
+        std::atomic<uint32_t> refs{0};
+        bool pooled = false;   // 属于BufferPool的页
+        bool released = false; // 空闲时已madvise还给系统, 再次使用时由缺页重新分配
+        char *data = nullptr;
+        size_t capacity = 0;
+        BufferBlock *next = nullptr; // 线程缓存中的空闲链表
+    };
+
+    // 全局的I/O缓冲页池, 页大小固定为PAGE_SIZE, 页按CHUNK_PAGES个一组mmap
+    // 每个线程缓存最多buffer_pool.thread_cache_pages个空闲页, 借还不加锁; 超出时成批归还到全局空闲表,
+    // 全局空闲表中常驻内存的页超过buffer_pool.max_free_pages时, 最久未用的页madvise(MADV_DONTNEED)还给系统.
+    // 页的地址空间不会释放, 统计与Shrink只针对全局空闲表
+    class BufferPool
+    {
+    public:
+        static const size_t PAGE_SIZE = 16 * 1024;
+        static const size_t CHUNK_PAGES = 64;
+
+        struct Stats
+        {
+            uint64_t pages = 0;         // 已映射的页数
+            uint64_t pagesInUse = 0;    // 被缓冲区/切片持有的页数
+            uint64_t pagesFree = 0;     // 全局空闲表中的页数(不含线程缓存)
+            uint64_t pagesReleased = 0; // 全局空闲表中已还给系统的页数
+            uint64_t largeBlocks = 0;   // 超过页大小单独申请、尚未释放的块数
+        };
+
+        // 借用至少size字节的块, 引用计数为1; size不超过PAGE_SIZE时取池中的页
+        static BufferBlock *Allocate(size_t size);
+        // 引用计数减到0时归还
+        static void Release(BufferBlock *block);
+
+        // 把当前线程缓存的空闲页归还到全局空闲表
+        static void FlushThreadCache();
+        // 全局空闲表中只保留keep个常驻页, 其余madvise还给系统, 返回本次还回的页数
+        static size_t Shrink(size_t keep = 0);
+        static Stats GetStats();
+    };
+
+    // 缓冲区中一段数据的只读引用, 拷贝只增加引用计数, 不拷贝数据
+    // 可以交给解析器、日志等在缓冲区之外继续持有; 最后一个引用释放时页回到池中
+    class BufferSlice
+    {
+    public:
+        BufferSlice() = default;
+        BufferSlice(BufferBlock *block, const char *data, size_t len);
+        BufferSlice(const BufferSlice &o);
+        BufferSlice(BufferSlice &&o) noexcept;
+        BufferSlice &operator=(BufferSlice o) noexcept;
+        ~BufferSlice();
+
+        const char *data() const { return m_data; }
+        size_t size() const { return m_len; }
+        bool empty() const { return m_len == 0; }
+        // 切片中[off, off + len)的一段, 共享同一块
+        BufferSlice sub(size_t off, size_t len) const;
+        std::string toString() const { return std::string(m_data, m_len); }
+        void swap(BufferSlice &o) noexcept;
+
+    private:
+        BufferBlock *m_block = nullptr;
+        const char *m_data = nullptr;
+        size_t m_len = 0;
+    };
+
+    std::ostream &operator<<(std::ostream &os, const BufferSlice &slice);
+
+    // 连续的读写缓冲区, 存储在写入时才从BufferPool借用, 数据全部消费后立即归还,
+    // 空闲的连接不占用缓冲页. [data(), data() + size())为有效数据, 写入先prepare再commit.
+    // 取出的切片仍在使用时, 缓冲区不会改写切片覆盖的内存(需要搬移时换一块新的)
+    class IOBuffer
+    {
+    public:
+        IOBuffer() = default;
+        IOBuffer(IOBuffer &&o) noexcept;
+        IOBuffer &operator=(IOBuffer &&o) noexcept;
+        IOBuffer(const IOBuffer &) = delete;
+        IOBuffer &operator=(const IOBuffer &) = delete;
+        ~IOBuffer();
+
+        char *data() { return m_block ? m_block->data + m_begin : nullptr; }
+        const char *data() const { return m_block ? m_block->data + m_begin : nullptr; }
+        size_t size() const { return m_end - m_begin; }
+        bool empty() const { return m_end == m_begin; }
+        // 持有的存储大小, 没有借用时为0
+        size_t capacity() const { return m_block ? m_block->capacity : 0; }
+        // 末尾可直接写入的字节数
+        size_t writable() const { return m_block ? m_block->capacity - m_end : 0; }
+
+        // 保证末尾至少有n字节可写, 返回写入位置; 可能搬移已有数据, 之前取得的data()失效
+        char *prepare(size_t n);
+        // 提交prepare之后写入的n字节
+        void commit(size_t n) { m_end += n; }
+        void append(const void *data, size_t len);
+        // 丢弃开头的n字节, 全部消费后归还存储
+        void consume(size_t n);
+        void clear();
+
+        // 有效数据中[off, off + len)的切片, 不拷贝
+        BufferSlice slice(size_t off, size_t len) const;
+
+    private:
+        void release();
+
+    private:
+        BufferBlock *m_block = nullptr;
+        size_t m_begin = 0;
+        size_t m_end = 0;
+    };
+
+} // namespace sltj
+
+#endif
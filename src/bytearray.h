@@ -0,0 +1,137 @@
+#ifndef __SLTJ_BYTEARRAY_H__
+#define __SLTJ_BYTEARRAY_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace sltj
+{
+    // 序列化缓冲区: 由固定大小的内存块链表组成, 读写共用一个位置m_position
+    // 写入后需setPosition(0)再读取
+    class ByteArray
+    {
+    public:
+        using ptr = std::shared_ptr<ByteArray>;
+
+        // 内存块
+        struct Node
+        {
+            Node(size_t s);
+            Node();
+            ~Node();
+
+            char *ptr;
+            Node *next;
+            size_t size;
+        };
+
+        ByteArray(size_t base_size = 4096);
+        ~ByteArray();
+
+        // 固定长度, 按当前字节序写入
+        void writeFint8(int8_t value);
+        void writeFuint8(uint8_t value);
+        void writeFint16(int16_t value);
+        void writeFuint16(uint16_t value);
+        void writeFint32(int32_t value);
+        void writeFuint32(uint32_t value);
+        void writeFint64(int64_t value);
+        void writeFuint64(uint64_t value);
+
+        // 变长varint, 有符号数先做zigzag编码
+        void writeInt32(int32_t value);
+        void writeUint32(uint32_t value);
+        void writeInt64(int64_t value);
+        void writeUint64(uint64_t value);
+
+        void writeFloat(float value);
+        void writeDouble(double value);
+
+        // 带长度前缀的字符串, 长度分别为uint16/uint32/uint64/varint
+        void writeStringF16(const std::string &value);
+        void writeStringF32(const std::string &value);
+        void writeStringF64(const std::string &value);
+        void writeStringVint(const std::string &value);
+        void writeStringWithoutLength(const std::string &value);
+
+        // 读取, 可读数据不足时抛出std::out_of_range
+        int8_t readFint8();
+        uint8_t readFuint8();
+        int16_t readFint16();
+        uint16_t readFuint16();
+        int32_t readFint32();
+        uint32_t readFuint32();
+        int64_t readFint64();
+        uint64_t readFuint64();
+
+        int32_t readInt32();
+        uint32_t readUint32();
+        int64_t readInt64();
+        uint64_t readUint64();
+
+        float readFloat();
+        double readDouble();
+
+        std::string readStringF16();
+        std::string readStringF32();
+        std::string readStringF64();
+        std::string readStringVint();
+
+        // 清空数据, 只保留第一个内存块
+        void clear();
+
+        void write(const void *buf, size_t size);
+        void read(void *buf, size_t size);
+        // 从position处读取, 不改变当前位置
+        void read(void *buf, size_t size, size_t position) const;
+
+        size_t getPosition() const { return m_position; }
+        // 越过当前数据末尾时同时扩大数据大小(配合getWriteBuffers使用)
+        void setPosition(size_t v);
+
+        // 把[m_position, m_size)写入文件 / 从文件读取数据追加到当前位置
+        bool writeToFile(const std::string &name) const;
+        bool readFromFile(const std::string &name);
+
+        size_t getBaseSize() const { return m_baseSize; }
+        size_t getReadSize() const { return m_size - m_position; }
+        size_t getSize() const { return m_size; }
+
+        bool isLittleEndian() const;
+        void setIsLittleEndian(bool val);
+
+        // 可读数据转成字符串 / 十六进制视图, 不改变当前位置
+        std::string toString() const;
+        std::string toHexString() const;
+
+        // 以iovec形式返回可读数据, 供writev零拷贝发送, 不改变当前位置
+        uint64_t getReadBuffers(std::vector<iovec> &buffers, uint64_t len = ~0ull) const;
+        uint64_t getReadBuffers(std::vector<iovec> &buffers, uint64_t len, uint64_t position) const;
+        // 预留len字节并以iovec返回, 供readv零拷贝接收, 收到n字节后调用setPosition(getPosition() + n)
+        uint64_t getWriteBuffers(std::vector<iovec> &buffers, uint64_t len);
+
+    private:
+        void addCapacity(size_t size);
+        size_t getCapacity() const { return m_capacity - m_position; }
+
+    private:
+        ByteArray(const ByteArray &) = delete;
+        ByteArray &operator=(const ByteArray &) = delete;
+
+    private:
+        size_t m_baseSize;  // 每个内存块大小
+        size_t m_position;  // 当前操作位置
+        size_t m_capacity;  // 总容量
+        size_t m_size;      // 数据大小
+        int8_t m_endian;    // 字节序, 默认大端
+        Node *m_root;       // 第一个内存块
+        Node *m_cur;        // 当前位置所在内存块, 恰好位于容量末尾时为nullptr
+    };
+
+} // namespace sltj
+
+#endif
@@ -1,5 +1,4 @@
 #include "config.h"
 
 namespace sltj {
-    Config::ConfigVarMap Config::m_datas;
-}
\ No newline at end of file
+}
@@ -3,6 +3,8 @@
 
 #include <memory>
 #include <sstream>
+#include <functional>
+#include <map>
 #include <boost/lexical_cast.hpp>
 #include "log.h"
 
@@ -31,6 +33,7 @@ namespace sltj
     {
     public:
         using ptr = std::shared_ptr<ConfigVar>;
+        using on_change_cb = std::function<void(const T &old_value, const T &new_value)>;
         ConfigVar(const std::string &name, const std::string &description, const T &default_val)
             : ConfigVarBase(name, description), m_val(default_val) {}
 
@@ -50,7 +53,8 @@ namespace sltj
         {
             try
             {
-                m_val = boost::lexical_cast<T>(m_val);
+                // 经setValue赋值, 监听回调同样会被触发
+                setValue(boost::lexical_cast<T>(val));
                 return true;
             }
             catch (std::exception &err)
@@ -60,9 +64,34 @@ namespace sltj
             return false;
         }
         const T getValue() const { return m_val; }
-        void setValue(const T& val) { m_val = val; }
+        // 值变化时依次调用监听回调
+        void setValue(const T &val)
+        {
+            if (val == m_val)
+            {
+                return;
+            }
+            T old_value = m_val;
+            m_val = val;
+            for (auto &i : m_cbs)
+            {
+                i.second(old_value, m_val);
+            }
+        }
+
+        // 返回监听id, 用于delListener
+        uint64_t addListener(on_change_cb cb)
+        {
+            static uint64_t s_fun_id = 0;
+            m_cbs[++s_fun_id] = cb;
+            return s_fun_id;
+        }
+        void delListener(uint64_t key) { m_cbs.erase(key); }
+        void clearListener() { m_cbs.clear(); }
+
     private:
         T m_val;
+        std::map<uint64_t, on_change_cb> m_cbs;
     };
 
     class Config
@@ -88,20 +117,25 @@ namespace sltj
             }
 
             typename ConfigVar<T>::ptr v(new ConfigVar<T>(name, description, default_val));
-            m_datas[name] = v;
+            GetDatas()[name] = v;
             return v;
         }
 
         template <class T>
         static typename ConfigVar<T>::ptr Lookup(const std::string &name)
         {
-            auto i = m_datas.find(name);
+            auto i = GetDatas().find(name);
             // 找到后,把父类指针强转成子类指针
-            return i == m_datas.end() ? nullptr : std::dynamic_pointer_cast<ConfigVar<T>>(i->second);
+            return i == GetDatas().end() ? nullptr : std::dynamic_pointer_cast<ConfigVar<T>>(i->second);
         }
 
     private:
-        static ConfigVarMap m_datas;
+        // 函数内静态变量, 保证库内其他编译单元在静态初始化阶段Lookup时已构造
+        static ConfigVarMap &GetDatas()
+        {
+            static ConfigVarMap s_datas;
+            return s_datas;
+        }
     };
     
 }
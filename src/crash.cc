@@ -0,0 +1,253 @@
+#include "crash.h"
+#include "log.h"
+#include "util.h"
+
+#include <atomic>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    namespace
+    {
+        static const size_t ALT_STACK_SIZE = 64 * 1024;
+        static const int MAX_FRAMES = 64;
+        static const int s_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+        // 尽力而为部分(落盘日志)的最长时间, 超时后由SIGALRM结束进程
+        static const unsigned WATCHDOG_SECONDS = 3;
+
+        static std::atomic<bool> s_installed{false};
+        // 正在处理崩溃的线程, 多个线程同时崩溃时只有第一个输出
+        static std::atomic<pid_t> s_crash_tid{0};
+        static volatile sig_atomic_t s_crash_sig = 0;
+
+        // 信号处理中使用的预分配缓冲区, 只由s_crash_tid线程使用
+        static char s_record[512];
+        static void *s_frames[MAX_FRAMES];
+
+        // 每个线程的备用信号栈, 线程退出时释放
+        struct AltStack
+        {
+            AltStack()
+            {
+                mem = (char *)malloc(ALT_STACK_SIZE);
+                stack_t ss;
+                ss.ss_sp = mem;
+                ss.ss_size = ALT_STACK_SIZE;
+                ss.ss_flags = 0;
+                if (!mem || sigaltstack(&ss, nullptr))
+                {
+                    SLTJ_LOG_ERROR(g_logger) << "sigaltstack fail errno=" << errno << " " << strerror(errno);
+                    free(mem);
+                    mem = nullptr;
+                }
+            }
+            ~AltStack()
+            {
+                if (mem)
+                {
+                    stack_t ss;
+                    memset(&ss, 0, sizeof(ss));
+                    ss.ss_flags = SS_DISABLE;
+                    sigaltstack(&ss, nullptr);
+                    free(mem);
+                }
+            }
+            char *mem;
+        };
+
+        // 信号安全的字符串拼接
+        struct SafeWriter
+        {
+            char *buf;
+            size_t cap;
+            size_t len = 0;
+
+            SafeWriter(char *b, size_t c) : buf(b), cap(c) {}
+
+            SafeWriter &str(const char *s)
+            {
+                while (*s && len < cap)
+                {
+                    buf[len++] = *s++;
+                }
+                return *this;
+            }
+
+            SafeWriter &num(uint64_t v, int base = 10)
+            {
+                char tmp[24];
+                int n = 0;
+                do
+                {
+                    tmp[n++] = "0123456789abcdef"[v % base];
+                    v /= base;
+                } while (v);
+                if (base == 16)
+                {
+                    str("0x");
+                }
+                while (n && len < cap)
+                {
+                    buf[len++] = tmp[--n];
+                }
+                return *this;
+            }
+        };
+
+        static const char *SignalName(int sig)
+        {
+            switch (sig)
+            {
+#define XX(name) \
+    case name:   \
+        return #name;
+
+                XX(SIGSEGV)
+                XX(SIGBUS)
+                XX(SIGFPE)
+                XX(SIGILL)
+                XX(SIGABRT)
+#undef XX
+            default:
+                return "UNKNOW";
+            }
+        }
+
+        static void WriteAll(int fd, const char *buf, size_t len)
+        {
+            while (len)
+            {
+                ssize_t n = write(fd, buf, len);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return;
+                }
+                buf += n;
+                len -= n;
+            }
+        }
+
+        // 恢复默认处理并重新发出信号, 保留core与退出状态
+        static void Die(int sig)
+        {
+            signal(sig, SIG_DFL);
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, sig);
+            pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+            raise(sig);
+            _exit(128 + sig);
+        }
+
+        // 尽力而为部分卡住(如堆损坏时在malloc的锁上死锁)
+        static void WatchdogHandler(int)
+        {
+            static const char s_msg[] = "*** crash handler timed out ***\n";
+            WriteAll(STDERR_FILENO, s_msg, sizeof(s_msg) - 1);
+            Die(s_crash_sig);
+        }
+
+        static void CrashHandler(int sig, siginfo_t *info, void *context)
+        {
+            pid_t tid = syscall(SYS_gettid);
+            pid_t expected = 0;
+            if (!s_crash_tid.compare_exchange_strong(expected, tid))
+            {
+                // 处理过程中本线程再次出错(如落盘时abort), 直接结束
+                if (expected == tid)
+                {
+                    Die(sig);
+                }
+                // 其他线程正在输出, 等它结束进程
+                for (;;)
+                {
+                    pause();
+                }
+            }
+            s_crash_sig = sig;
+
+            // FATAL记录在静态缓冲区中拼好直接write, 不申请内存也不取锁
+            char name[17] = {0};
+            prctl(PR_GET_NAME, name, 0, 0, 0);
+            SafeWriter w(s_record, sizeof(s_record));
+            w.str("*** ").str(SignalName(sig)).str(" received, addr=").num((uintptr_t)info->si_addr, 16)
+                .str(" tid=").num(tid)
+                .str(" thread=").str(name)
+                .str(" fiber=").num(GetFiberId())
+                .str(" ***\n[FATAL] time=").num(time(nullptr))
+                .str(" backtrace:\n");
+            WriteAll(STDERR_FILENO, s_record, w.len);
+            // backtrace_symbols_fd不申请内存; 前两帧为本函数与信号返回跳板
+            int n = backtrace(s_frames, MAX_FRAMES);
+            backtrace_symbols_fd(s_frames + 2, n > 2 ? n - 2 : 0, STDERR_FILENO);
+
+            // 以下不保证信号安全, 由看门狗限时
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = &WatchdogHandler;
+            sigemptyset(&sa.sa_mask);
+            sigaction(SIGALRM, &sa, nullptr);
+            alarm(WATCHDOG_SECONDS);
+            // 异步日志缓冲正被其他线程持有时跳过, 只刷新输出器
+            LoggerMgr::GetInstance()->tryFlush();
+
+            Die(sig);
+        }
+    } // namespace
+
+    void SetupCrashAltStack()
+    {
+        if (s_installed)
+        {
+            static thread_local AltStack t_alt_stack;
+        }
+    }
+
+    void InstallCrashHandler()
+    {
+        bool expected = false;
+        if (!s_installed.compare_exchange_strong(expected, true))
+        {
+            return;
+        }
+        // 预先调用一次, 让libgcc在信号处理之前加载
+        backtrace(s_frames, 1);
+        SetupCrashAltStack();
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = &CrashHandler;
+        sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        // 处理期间屏蔽其余崩溃信号, 本线程再次出错时由内核或Die直接结束进程
+        sigemptyset(&sa.sa_mask);
+        for (int sig : s_signals)
+        {
+            sigaddset(&sa.sa_mask, sig);
+        }
+        for (int sig : s_signals)
+        {
+            if (sigaction(sig, &sa, nullptr))
+            {
+                SLTJ_LOG_ERROR(g_logger) << "InstallCrashHandler sigaction " << SignalName(sig)
+                                         << " errno=" << errno << " " << strerror(errno);
+            }
+        }
+    }
+
+} // namespace sltj
@@ -0,0 +1,18 @@
+#ifndef __SLTJ_CRASH_H__
+#define __SLTJ_CRASH_H__
+
+namespace sltj
+{
+    // 为SIGSEGV/SIGBUS/SIGFPE/SIGILL/SIGABRT安装崩溃处理, 在备用信号栈上运行(栈溢出时也能执行).
+    // 处理顺序: 先在静态缓冲区中拼好FATAL记录, 与backtrace_symbols_fd的调用栈一起write到stderr(不申请内存),
+    // 再在看门狗alarm的限时内尽力把日志落盘(LogManager::tryFlush),
+    // 最后恢复默认处理并重新发出信号, 保留core与退出状态. 处理中本线程再次出错时直接以该信号结束.
+    // 调用线程与之后由sltj::Thread创建的线程会装上备用信号栈.
+    void InstallCrashHandler();
+
+    // 为当前线程装备用信号栈, 未调用过InstallCrashHandler时不做任何事
+    void SetupCrashAltStack();
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __SLTJ_ENDIAN_H__
+#define __SLTJ_ENDIAN_H__
+
+#include <byteswap.h>
+#include <endian.h>
+#include <stdint.h>
+#include <type_traits>
+
+#define SLTJ_LITTLE_ENDIAN 1
+#define SLTJ_BIG_ENDIAN 2
+
+#if BYTE_ORDER == BIG_ENDIAN
+#define SLTJ_BYTE_ORDER SLTJ_BIG_ENDIAN
+#else
+#define SLTJ_BYTE_ORDER SLTJ_LITTLE_ENDIAN
+#endif
+
+namespace sltj
+{
+    // 字节序翻转
+    template <class T>
+    typename std::enable_if<sizeof(T) == sizeof(uint64_t), T>::type
+    byteswap(T value)
+    {
+        return (T)bswap_64((uint64_t)value);
+    }
+
+    template <class T>
+    typename std::enable_if<sizeof(T) == sizeof(uint32_t), T>::type
+    byteswap(T value)
+    {
+        return (T)bswap_32((uint32_t)value);
+    }
+
+    template <class T>
+    typename std::enable_if<sizeof(T) == sizeof(uint16_t), T>::type
+    byteswap(T value)
+    {
+        return (T)bswap_16((uint16_t)value);
+    }
+
+    template <class T>
+    typename std::enable_if<sizeof(T) == sizeof(uint8_t), T>::type
+    byteswap(T value)
+    {
+        return value;
+    }
+
+#if SLTJ_BYTE_ORDER == SLTJ_BIG_ENDIAN
+    // 本机为大端时无需转换
+    template <class T>
+    T byteswapOnLittleEndian(T t)
+    {
+        return t;
+    }
+
+    template <class T>
+    T byteswapOnBigEndian(T t)
+    {
+        return byteswap(t);
+    }
+#else
+    // 本机为小端时转为网络字节序(大端)
+    template <class T>
+    T byteswapOnLittleEndian(T t)
+    {
+        return byteswap(t);
+    }
+
+    template <class T>
+    T byteswapOnBigEndian(T t)
+    {
+        return t;
+    }
+#endif
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,226 @@
+#include "fiber.h"
+#include "config.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <stdexcept>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static std::atomic<uint64_t> s_fiber_id{0};
+    static std::atomic<uint64_t> s_fiber_count{0};
+    static std::atomic<size_t> s_local_slots{0};
+
+    static thread_local Fiber *t_fiber = nullptr;          // 当前执行的协程
+    static thread_local Fiber::ptr t_thread_fiber = nullptr; // 线程主协程
+
+    static sltj::ConfigVar<uint32_t>::ptr g_fiber_stack_size =
+        sltj::Config::Lookup<uint32_t>("fiber.stack_size", 128 * 1024, "fiber stack size");
+
+    class MallocStackAllocator
+    {
+    public:
+        static void *Alloc(size_t size)
+        {
+            return malloc(size);
+        }
+
+        static void Dealloc(void *vp, size_t size)
+        {
+            free(vp);
+        }
+    };
+
+    using StackAllocator = MallocStackAllocator;
+
+    uint64_t Fiber::GetFiberId()
+    {
+        if (t_fiber)
+        {
+            return t_fiber->getId();
+        }
+        return 0;
+    }
+
+    Fiber::Fiber()
+    {
+        m_state = EXEC;
+        SetThis(this);
+
+        if (getcontext(&m_ctx))
+        {
+            throw std::logic_error("getcontext error");
+        }
+
+        ++s_fiber_count;
+    }
+
+    Fiber::Fiber(std::function<void()> cb, size_t stacksize)
+        : m_id(++s_fiber_id), m_cb(cb)
+    {
+        ++s_fiber_count;
+        m_stacksize = stacksize ? stacksize : g_fiber_stack_size->getValue();
+
+        m_stack = StackAllocator::Alloc(m_stacksize);
+        if (getcontext(&m_ctx))
+        {
+            throw std::logic_error("getcontext error");
+        }
+        m_ctx.uc_link = nullptr;
+        m_ctx.uc_stack.ss_sp = m_stack;
+        m_ctx.uc_stack.ss_size = m_stacksize;
+
+        makecontext(&m_ctx, &Fiber::MainFunc, 0);
+    }
+
+    Fiber::~Fiber()
+    {
+        --s_fiber_count;
+        if (m_stack)
+        {
+            if (m_state != TERM && m_state != EXCEPT && m_state != INIT)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "~Fiber id=" << m_id << " destroyed in state " << (int)m_state;
+            }
+            StackAllocator::Dealloc(m_stack, m_stacksize);
+        }
+        else
+        {
+            // 主协程
+            if (t_fiber == this)
+            {
+                SetThis(nullptr);
+            }
+        }
+    }
+
+    void Fiber::reset(std::function<void()> cb)
+    {
+        if (!m_stack || (m_state != TERM && m_state != EXCEPT && m_state != INIT))
+        {
+            throw std::logic_error("Fiber::reset on running fiber");
+        }
+        m_cb = cb;
+        // 下一个回调不继承上一个的局部存储
+        m_locals.clear();
+        if (getcontext(&m_ctx))
+        {
+            throw std::logic_error("getcontext error");
+        }
+
+        m_ctx.uc_link = nullptr;
+        m_ctx.uc_stack.ss_sp = m_stack;
+        m_ctx.uc_stack.ss_size = m_stacksize;
+
+        makecontext(&m_ctx, &Fiber::MainFunc, 0);
+        m_state = INIT;
+    }
+
+    void Fiber::swapIn()
+    {
+        GetThis();
+        SetThis(this);
+        m_state = EXEC;
+        if (swapcontext(&t_thread_fiber->m_ctx, &m_ctx))
+        {
+            throw std::logic_error("swapcontext error");
+        }
+    }
+
+    void Fiber::swapOut()
+    {
+        SetThis(t_thread_fiber.get());
+        if (swapcontext(&m_ctx, &t_thread_fiber->m_ctx))
+        {
+            throw std::logic_error("swapcontext error");
+        }
+    }
+
+    void Fiber::SetThis(Fiber *f)
+    {
+        t_fiber = f;
+    }
+
+    Fiber::ptr Fiber::GetThis()
+    {
+        if (t_fiber)
+        {
+            return t_fiber->shared_from_this();
+        }
+        Fiber::ptr main_fiber(new Fiber);
+        t_thread_fiber = main_fiber;
+        return t_fiber->shared_from_this();
+    }
+
+    void Fiber::YieldToReady()
+    {
+        Fiber::ptr cur = GetThis();
+        cur->m_state = READY;
+        Fiber *raw = cur.get();
+        cur.reset();
+        raw->swapOut();
+    }
+
+    // 状态保持EXEC, 由调度器在切换完成后置为HOLD,
+    // 避免其他线程在本协程尚未完全切出时就把它换入
+    void Fiber::YieldToHold()
+    {
+        Fiber::ptr cur = GetThis();
+        Fiber *raw = cur.get();
+        cur.reset();
+        raw->swapOut();
+    }
+
+    size_t Fiber::AllocLocalSlot()
+    {
+        return s_local_slots++;
+    }
+
+    std::shared_ptr<void> &Fiber::GetLocal(size_t index)
+    {
+        Fiber *f = t_fiber ? t_fiber : GetThis().get();
+        if (index >= f->m_locals.size())
+        {
+            f->m_locals.resize(s_local_slots > index ? s_local_slots.load() : index + 1);
+        }
+        return f->m_locals[index];
+    }
+
+    uint64_t Fiber::TotalFibers()
+    {
+        return s_fiber_count;
+    }
+
+    void Fiber::MainFunc()
+    {
+        Fiber::ptr cur = GetThis();
+        try
+        {
+            cur->m_cb();
+            cur->m_cb = nullptr;
+            cur->m_state = TERM;
+        }
+        catch (std::exception &ex)
+        {
+            cur->m_state = EXCEPT;
+            SLTJ_LOG_ERROR(g_logger) << "Fiber Except: " << ex.what()
+                                     << " fiber_id=" << cur->getId();
+        }
+        catch (...)
+        {
+            cur->m_state = EXCEPT;
+            SLTJ_LOG_ERROR(g_logger) << "Fiber Except"
+                                     << " fiber_id=" << cur->getId();
+        }
+
+        // 释放引用后再切出, 协程函数不会再返回
+        Fiber *raw = cur.get();
+        cur.reset();
+        raw->swapOut();
+
+        SLTJ_LOG_FATAL(g_logger) << "never reach fiber_id=" << raw->getId();
+    }
+
+} // namespace sltj
@@ -0,0 +1,103 @@
+#ifndef __SLTJ_FIBER_H__
+#define __SLTJ_FIBER_H__
+
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <ucontext.h>
+#include <stdint.h>
+#include <vector>
+
+namespace sltj
+{
+    class Scheduler;
+
+    // 协程, 基于ucontext的非对称协程: 只能在线程主协程与子协程之间切换
+    // 协程挂起后可能在其他工作线程上恢复, 协程函数中不要跨Yield缓存thread_local变量的引用
+    class Fiber : public std::enable_shared_from_this<Fiber>
+    {
+        friend class Scheduler;
+
+    public:
+        using ptr = std::shared_ptr<Fiber>;
+
+        enum State
+        {
+            INIT,   // 初始化
+            HOLD,   // 挂起
+            EXEC,   // 执行中
+            TERM,   // 结束
+            READY,  // 可执行
+            EXCEPT  // 异常
+        };
+
+    private:
+        // 线程主协程
+        Fiber();
+
+    public:
+        // stacksize为0时使用配置项fiber.stack_size
+        Fiber(std::function<void()> cb, size_t stacksize = 0);
+        ~Fiber();
+
+        // 重置协程函数, 复用栈空间(INIT, TERM, EXCEPT状态可用)
+        void reset(std::function<void()> cb);
+        // 从线程主协程切换到当前协程执行
+        void swapIn();
+        // 切换回线程主协程
+        // 协程可能在另一个线程上被恢复, 禁止内联, 避免编译器在调用方复用切换前算出的thread_local地址
+        void swapOut() __attribute__((noinline));
+
+        uint64_t getId() const { return m_id; }
+        State getState() const { return m_state; }
+
+    public:
+        // 设置/获取当前执行的协程, 线程第一次调用GetThis时创建主协程
+        static void SetThis(Fiber *f) __attribute__((noinline));
+        static Fiber::ptr GetThis() __attribute__((noinline));
+        // 让出执行权, 并标记为READY(调度器会重新放回队列)/HOLD(等待事件唤醒)
+        static void YieldToReady();
+        static void YieldToHold();
+        static uint64_t TotalFibers();
+        // 当前协程id, 线程主协程或不在协程中时为0
+        static uint64_t GetFiberId();
+
+        static void MainFunc();
+
+        // 分配一个协程局部存储槽位, 供FiberLocal使用
+        static size_t AllocLocalSlot();
+        // 当前协程index槽位的引用, 不在子协程中时取线程主协程的槽位
+        static std::shared_ptr<void> &GetLocal(size_t index) __attribute__((noinline));
+
+    private:
+        uint64_t m_id = 0;
+        uint32_t m_stacksize = 0;
+        std::atomic<State> m_state{INIT}; // 跨线程读取(调度器判断是否仍在执行)
+        ucontext_t m_ctx;
+        void *m_stack = nullptr;
+        std::function<void()> m_cb;
+        std::vector<std::shared_ptr<void>> m_locals; // 协程局部存储, 按槽位下标, 随协程在线程间迁移
+    };
+
+    // 协程局部变量: 每个协程一份, 存放在协程对象的槽位数组中, 协程在哪个工作线程上恢复都取到同一份;
+    // 协程reset(调度器复用)时释放. 槽位不回收, FiberLocal对象应长期存在(如静态变量)
+    template <class T>
+    class FiberLocal
+    {
+    public:
+        FiberLocal() : m_index(Fiber::AllocLocalSlot()) {}
+
+        // 当前协程的值, 未设置时为nullptr
+        T *get() const { return static_cast<T *>(Fiber::GetLocal(m_index).get()); }
+        std::shared_ptr<T> getShared() const { return std::static_pointer_cast<T>(Fiber::GetLocal(m_index)); }
+        void set(std::shared_ptr<T> v) { Fiber::GetLocal(m_index) = std::move(v); }
+        void reset() { Fiber::GetLocal(m_index).reset(); }
+        size_t getIndex() const { return m_index; }
+
+    private:
+        size_t m_index;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,121 @@
+#include "format.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace sltj
+{
+    static const char s_digits[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    // 每次处理两位
+    char *FormatUInt(uint64_t v, char *end)
+    {
+        char *p = end;
+        while (v >= 100)
+        {
+            unsigned idx = (v % 100) * 2;
+            v /= 100;
+            *--p = s_digits[idx + 1];
+            *--p = s_digits[idx];
+        }
+        if (v >= 10)
+        {
+            unsigned idx = v * 2;
+            *--p = s_digits[idx + 1];
+            *--p = s_digits[idx];
+        }
+        else
+        {
+            *--p = '0' + v;
+        }
+        return p;
+    }
+
+    void FormatInt(std::ostream &os, int64_t v)
+    {
+        char buf[24];
+        char *end = buf + sizeof(buf);
+        // 取负在无符号上做, INT64_MIN不溢出
+        uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+        char *p = FormatUInt(u, end);
+        if (v < 0)
+        {
+            *--p = '-';
+        }
+        os.write(p, end - p);
+    }
+
+    void FormatUnsigned(std::ostream &os, uint64_t v)
+    {
+        char buf[24];
+        char *end = buf + sizeof(buf);
+        char *p = FormatUInt(v, end);
+        os.write(p, end - p);
+    }
+
+    void FormatDouble(std::ostream &os, double v)
+    {
+        char buf[32];
+        int len = snprintf(buf, sizeof(buf), "%g", v);
+        if (len > 0)
+        {
+            os.write(buf, len < (int)sizeof(buf) ? len : (int)sizeof(buf) - 1);
+        }
+    }
+
+    void FormatPointer(std::ostream &os, const void *p)
+    {
+        static const char s_hex[] = "0123456789abcdef";
+        char buf[24];
+        char *end = buf + sizeof(buf);
+        char *cur = end;
+        uintptr_t v = (uintptr_t)p;
+        do
+        {
+            *--cur = s_hex[v & 0xf];
+            v >>= 4;
+        } while (v);
+        *--cur = 'x';
+        *--cur = '0';
+        os.write(cur, end - cur);
+    }
+
+    const char *FormatLiteral(std::ostream &os, const char *fmt)
+    {
+        const char *begin = fmt;
+        for (;;)
+        {
+            const char *p = strpbrk(fmt, "{}");
+            if (!p)
+            {
+                os.write(begin, strlen(begin));
+                return nullptr;
+            }
+            if (p[0] == '{' && p[1] == '}')
+            {
+                os.write(begin, p - begin);
+                return p + 2;
+            }
+            if (p[1] == p[0])
+            {
+                // 转义的括号, 输出一个
+                os.write(begin, p + 1 - begin);
+                begin = fmt = p + 2;
+                continue;
+            }
+            // 不成对的括号按原样输出
+            fmt = p + 1;
+        }
+    }
+
+} // namespace sltj
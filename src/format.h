@@ -0,0 +1,145 @@
+#ifndef __SLTJ_FORMAT_H__
+#define __SLTJ_FORMAT_H__
+
+// "{}"占位符格式化: 参数按类型写出, 不经过varargs, 整数/浮点数先写入栈上缓冲再整体写入流
+// "{{"与"}}"输出字面的括号. 占位符与参数个数不符时输出<<missing arg>>/<<extra args>>
+
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <stdint.h>
+
+namespace sltj
+{
+    constexpr bool FormatPlain(char c) { return c != 0 && c != '{' && c != '}'; }
+
+    // 编译期统计占位符个数, 括号不成对时返回-1.
+    // 递归深度受-fconstexpr-depth(默认512)限制, 连续的普通字符每层跳过8个, 约4000字符以内可检查
+    constexpr int FormatPlaceholders(const char *s, int n = 0)
+    {
+        return *s == 0                         ? n
+               : (FormatPlain(s[0]) && FormatPlain(s[1]) && FormatPlain(s[2]) && FormatPlain(s[3]) &&
+                  FormatPlain(s[4]) && FormatPlain(s[5]) && FormatPlain(s[6]) && FormatPlain(s[7]))
+                   ? FormatPlaceholders(s + 8, n)
+               : (s[0] == '{' && s[1] == '{')  ? FormatPlaceholders(s + 2, n)
+               : (s[0] == '}' && s[1] == '}')  ? FormatPlaceholders(s + 2, n)
+               : (s[0] == '{' && s[1] == '}')  ? FormatPlaceholders(s + 2, n + 1)
+               : (s[0] == '{' || s[0] == '}') ? -1
+                                               : FormatPlaceholders(s + 1, n);
+    }
+
+    // 只用于sizeof, 得到参数个数加一
+    template <class... Args>
+    char (&FormatArgCount(const Args &...))[sizeof...(Args) + 1];
+
+    template <int Placeholders, int Args>
+    struct FormatCheck
+    {
+        static_assert(Placeholders >= 0, "unbalanced '{' or '}' in format string");
+        static_assert(Placeholders < 0 || Placeholders == Args, "format placeholders and argument count differ");
+        enum
+        {
+            value = 1
+        };
+    };
+
+#define SLTJ_FORMAT_ARGS(...) ((int)sizeof(sltj::FormatArgCount(__VA_ARGS__)) - 1)
+
+// 编译期检查格式串与参数个数, 可放在逗号表达式中. 只检查编译期能求值的格式串(字面量);
+// 运行期的格式串或超出递归深度时不检查, 由FormatTo输出<<missing arg>>/<<extra args>>
+#if defined __GNUC__ || defined __llvm__
+#define SLTJ_FORMAT_PLACEHOLDERS(fmt, ...)                                                  \
+    (__builtin_constant_p(sltj::FormatPlaceholders(fmt)) ? sltj::FormatPlaceholders(fmt) \
+                                                         : SLTJ_FORMAT_ARGS(__VA_ARGS__))
+#define SLTJ_FORMAT_CHECK(fmt, ...) \
+    (void)sltj::FormatCheck<SLTJ_FORMAT_PLACEHOLDERS(fmt, __VA_ARGS__), SLTJ_FORMAT_ARGS(__VA_ARGS__)>::value
+#else
+#define SLTJ_FORMAT_CHECK(fmt, ...) (void)0
+#endif
+
+    // 从end向前写十进制数字, 返回首字符位置; end前至少留20字节
+    char *FormatUInt(uint64_t v, char *end);
+
+    void FormatInt(std::ostream &os, int64_t v);
+    void FormatUnsigned(std::ostream &os, uint64_t v);
+    // 与ostream默认输出一致(%g, 6位有效数字)
+    void FormatDouble(std::ostream &os, double v);
+    void FormatPointer(std::ostream &os, const void *p);
+
+    // 写出fmt中下一个占位符之前的字面内容, 返回占位符之后的位置, 没有占位符时返回nullptr
+    const char *FormatLiteral(std::ostream &os, const char *fmt);
+
+    namespace detail
+    {
+        template <class T>
+        struct FormatKind
+        {
+            enum
+            {
+                value = std::is_same<T, bool>::value                                          ? 1
+                        : std::is_same<T, char>::value                                        ? 2
+                        : std::is_integral<T>::value && std::is_signed<T>::value              ? 3
+                        : std::is_integral<T>::value                                          ? 4
+                        : std::is_floating_point<T>::value                                    ? 5
+                        : std::is_pointer<T>::value &&
+                                  !std::is_same<typename std::decay<T>::type, char *>::value &&
+                                  !std::is_same<typename std::decay<T>::type, const char *>::value ? 6
+                                                                                              : 0
+            };
+        };
+
+        template <int Kind>
+        using FormatTag = std::integral_constant<int, Kind>;
+
+        // 其他类型走operator<<
+        template <class T>
+        void FormatValue(std::ostream &os, const T &v, FormatTag<0>) { os << v; }
+        template <class T>
+        void FormatValue(std::ostream &os, const T &v, FormatTag<1>) { os << (v ? "true" : "false"); }
+        template <class T>
+        void FormatValue(std::ostream &os, const T &v, FormatTag<2>) { os.put(v); }
+        template <class T>
+        void FormatValue(std::ostream &os, const T &v, FormatTag<3>) { FormatInt(os, v); }
+        template <class T>
+        void FormatValue(std::ostream &os, const T &v, FormatTag<4>) { FormatUnsigned(os, v); }
+        template <class T>
+        void FormatValue(std::ostream &os, const T &v, FormatTag<5>) { FormatDouble(os, v); }
+        template <class T>
+        void FormatValue(std::ostream &os, const T &v, FormatTag<6>) { FormatPointer(os, (const void *)v); }
+
+        inline void FormatArgs(std::ostream &os, const char *fmt)
+        {
+            while (fmt && *fmt)
+            {
+                fmt = FormatLiteral(os, fmt);
+                if (fmt)
+                {
+                    os << "<<missing arg>>";
+                }
+            }
+        }
+
+        template <class T, class... Rest>
+        void FormatArgs(std::ostream &os, const char *fmt, const T &first, const Rest &...rest)
+        {
+            fmt = fmt ? FormatLiteral(os, fmt) : nullptr;
+            if (!fmt)
+            {
+                os << "<<extra args>>";
+                return;
+            }
+            FormatValue(os, first, FormatTag<FormatKind<typename std::decay<T>::type>::value>());
+            FormatArgs(os, fmt, rest...);
+        }
+    } // namespace detail
+
+    // 运行期格式化, 不检查格式串; 字面量格式串可先用SLTJ_FORMAT_CHECK检查
+    template <class... Args>
+    void FormatTo(std::ostream &os, const char *fmt, const Args &...args)
+    {
+        detail::FormatArgs(os, fmt, args...);
+    }
+
+} // namespace sltj
+
+#endif
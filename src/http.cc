@@ -0,0 +1,306 @@
+#include "http.h"
+
+#include <sstream>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace sltj
+{
+    static const char *s_method_string[] = {
+#define XX(num, name, string) #string,
+        HTTP_METHOD_MAP(XX)
+#undef XX
+    };
+
+    HttpMethod StringToHttpMethod(const std::string &m)
+    {
+        return CharsToHttpMethod(m.c_str(), m.size());
+    }
+
+    HttpMethod CharsToHttpMethod(const char *m, size_t len)
+    {
+#define XX(num, name, string)                                              \
+    if (len == sizeof(#string) - 1 && strncmp(#string, m, len) == 0) \
+    {                                                                      \
+        return HttpMethod::name;                                           \
+    }
+        HTTP_METHOD_MAP(XX);
+#undef XX
+        return HttpMethod::INVALID_METHOD;
+    }
+
+    const char *HttpMethodToString(const HttpMethod &m)
+    {
+        uint32_t idx = (uint32_t)m;
+        if (idx >= (sizeof(s_method_string) / sizeof(s_method_string[0])))
+        {
+            return "<unknown>";
+        }
+        return s_method_string[idx];
+    }
+
+    const char *HttpStatusToString(const HttpStatus &s)
+    {
+        switch (s)
+        {
+#define XX(code, name, msg) \
+    case HttpStatus::name:  \
+        return #msg;
+            HTTP_STATUS_MAP(XX);
+#undef XX
+        default:
+            return "<unknown>";
+        }
+    }
+
+    template <class MapType>
+    static std::string GetFromMap(const MapType &m, const std::string &key, const std::string &def)
+    {
+        auto it = m.find(key);
+        return it == m.end() ? def : it->second;
+    }
+
+    template <class MapType>
+    static bool HasInMap(const MapType &m, const std::string &key, std::string *val)
+    {
+        auto it = m.find(key);
+        if (it == m.end())
+        {
+            return false;
+        }
+        if (val)
+        {
+            *val = it->second;
+        }
+        return true;
+    }
+
+    HttpRequest::HttpRequest(uint8_t version, bool close)
+        : m_method(HttpMethod::GET), m_version(version), m_close(close), m_path("/")
+    {
+    }
+
+    const std::string &HttpRequest::getBody() const
+    {
+        if (m_body.empty() && !m_bodySlice.empty())
+        {
+            m_body = m_bodySlice.toString();
+        }
+        return m_body;
+    }
+
+    std::string HttpRequest::getHeader(const std::string &key, const std::string &def) const
+    {
+        return GetFromMap(m_headers, key, def);
+    }
+
+    bool HttpRequest::hasHeader(const std::string &key, std::string *val) const
+    {
+        return HasInMap(m_headers, key, val);
+    }
+
+    void HttpRequest::setHeader(const std::string &key, const std::string &val)
+    {
+        m_headers[key] = val;
+    }
+
+    void HttpRequest::delHeader(const std::string &key)
+    {
+        m_headers.erase(key);
+    }
+
+    std::string HttpRequest::getParam(const std::string &key, const std::string &def)
+    {
+        initQueryParam();
+        return GetFromMap(m_params, key, def);
+    }
+
+    void HttpRequest::initQueryParam()
+    {
+        if (m_parsedParam)
+        {
+            return;
+        }
+        m_parsedParam = true;
+
+        size_t pos = 0;
+        while (pos < m_query.size())
+        {
+            size_t end = m_query.find('&', pos);
+            if (end == std::string::npos)
+            {
+                end = m_query.size();
+            }
+            size_t eq = m_query.find('=', pos);
+            if (eq != std::string::npos && eq < end)
+            {
+                m_params.insert(std::make_pair(m_query.substr(pos, eq - pos),
+                                               m_query.substr(eq + 1, end - eq - 1)));
+            }
+            else if (end > pos)
+            {
+                m_params.insert(std::make_pair(m_query.substr(pos, end - pos), std::string()));
+            }
+            pos = end + 1;
+        }
+    }
+
+    std::ostream &HttpRequest::dump(std::ostream &os) const
+    {
+        // GET /uri HTTP/1.1
+        os << HttpMethodToString(m_method) << " "
+           << m_path
+           << (m_query.empty() ? "" : "?")
+           << m_query
+           << (m_fragment.empty() ? "" : "#")
+           << m_fragment
+           << " HTTP/"
+           << ((uint32_t)(m_version >> 4))
+           << "."
+           << ((uint32_t)(m_version & 0x0F))
+           << "\r\n";
+        os << "connection: " << (m_close ? "close" : "keep-alive") << "\r\n";
+        for (auto &i : m_headers)
+        {
+            if (strcasecmp(i.first.c_str(), "connection") == 0 ||
+                strcasecmp(i.first.c_str(), "content-length") == 0)
+            {
+                continue;
+            }
+            os << i.first << ": " << i.second << "\r\n";
+        }
+
+        if (getBodySize())
+        {
+            os << "content-length: " << getBodySize() << "\r\n\r\n";
+            if (m_bodySlice.empty())
+            {
+                os << m_body;
+            }
+            else
+            {
+                os << m_bodySlice;
+            }
+        }
+        else
+        {
+            os << "\r\n";
+        }
+        return os;
+    }
+
+    std::string HttpRequest::toString() const
+    {
+        std::stringstream ss;
+        dump(ss);
+        return ss.str();
+    }
+
+    HttpFileBody::~HttpFileBody()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    HttpFileBody::ptr HttpFileBody::Open(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        return std::make_shared<HttpFileBody>(fd, 0, st.st_size);
+    }
+
+    HttpResponse::HttpResponse(uint8_t version, bool close)
+        : m_status(HttpStatus::OK), m_version(version), m_close(close)
+    {
+    }
+
+    std::string HttpResponse::getHeader(const std::string &key, const std::string &def) const
+    {
+        return GetFromMap(m_headers, key, def);
+    }
+
+    bool HttpResponse::hasHeader(const std::string &key, std::string *val) const
+    {
+        return HasInMap(m_headers, key, val);
+    }
+
+    void HttpResponse::setHeader(const std::string &key, const std::string &val)
+    {
+        m_headers[key] = val;
+    }
+
+    void HttpResponse::delHeader(const std::string &key)
+    {
+        m_headers.erase(key);
+    }
+
+    std::ostream &HttpResponse::dumpHead(std::ostream &os) const
+    {
+        os << "HTTP/"
+           << ((uint32_t)(m_version >> 4))
+           << "."
+           << ((uint32_t)(m_version & 0x0F))
+           << " "
+           << (uint32_t)m_status
+           << " "
+           << (m_reason.empty() ? HttpStatusToString(m_status) : m_reason)
+           << "\r\n";
+
+        for (auto &i : m_headers)
+        {
+            if (strcasecmp(i.first.c_str(), "connection") == 0)
+            {
+                continue;
+            }
+            os << i.first << ": " << i.second << "\r\n";
+        }
+        os << "connection: " << (m_close ? "close" : "keep-alive") << "\r\n";
+        if (!hasHeader("content-length") && !hasHeader("transfer-encoding"))
+        {
+            os << "content-length: " << (m_fileBody ? m_fileBody->length : m_body.size()) << "\r\n";
+        }
+        os << "\r\n";
+        return os;
+    }
+
+    std::ostream &HttpResponse::dump(std::ostream &os) const
+    {
+        dumpHead(os);
+        if (!m_fileBody)
+        {
+            os << m_body;
+        }
+        return os;
+    }
+
+    std::string HttpResponse::toString() const
+    {
+        std::stringstream ss;
+        dump(ss);
+        return ss.str();
+    }
+
+    std::ostream &operator<<(std::ostream &os, const HttpRequest &req)
+    {
+        return req.dump(os);
+    }
+
+    std::ostream &operator<<(std::ostream &os, const HttpResponse &rsp)
+    {
+        return rsp.dump(os);
+    }
+
+} // namespace sltj
@@ -0,0 +1,231 @@
+#ifndef __SLTJ_HTTP_H__
+#define __SLTJ_HTTP_H__
+
+#include <memory>
+#include <string>
+#include <map>
+#include <ostream>
+#include <stdint.h>
+#include <strings.h>
+#include "buffer_pool.h"
+
+namespace sltj
+{
+    /* Request Methods */
+#define HTTP_METHOD_MAP(XX) \
+    XX(0, DELETE, DELETE)   \
+    XX(1, GET, GET)         \
+    XX(2, HEAD, HEAD)       \
+    XX(3, POST, POST)       \
+    XX(4, PUT, PUT)         \
+    XX(5, CONNECT, CONNECT) \
+    XX(6, OPTIONS, OPTIONS) \
+    XX(7, TRACE, TRACE)     \
+    XX(8, PATCH, PATCH)
+
+    /* Status Codes */
+#define HTTP_STATUS_MAP(XX)                                                 \
+    XX(100, CONTINUE, Continue)                                             \
+    XX(101, SWITCHING_PROTOCOLS, Switching Protocols)                       \
+    XX(200, OK, OK)                                                         \
+    XX(201, CREATED, Created)                                               \
+    XX(202, ACCEPTED, Accepted)                                             \
+    XX(204, NO_CONTENT, No Content)                                         \
+    XX(206, PARTIAL_CONTENT, Partial Content)                               \
+    XX(301, MOVED_PERMANENTLY, Moved Permanently)                           \
+    XX(302, FOUND, Found)                                                   \
+    XX(304, NOT_MODIFIED, Not Modified)                                     \
+    XX(400, BAD_REQUEST, Bad Request)                                       \
+    XX(401, UNAUTHORIZED, Unauthorized)                                     \
+    XX(403, FORBIDDEN, Forbidden)                                           \
+    XX(404, NOT_FOUND, Not Found)                                           \
+    XX(405, METHOD_NOT_ALLOWED, Method Not Allowed)                         \
+    XX(408, REQUEST_TIMEOUT, Request Timeout)                               \
+    XX(411, LENGTH_REQUIRED, Length Required)                               \
+    XX(413, PAYLOAD_TOO_LARGE, Payload Too Large)                           \
+    XX(414, URI_TOO_LONG, URI Too Long)                                     \
+    XX(431, REQUEST_HEADER_FIELDS_TOO_LARGE, Request Header Fields Too Large) \
+    XX(500, INTERNAL_SERVER_ERROR, Internal Server Error)                   \
+    XX(501, NOT_IMPLEMENTED, Not Implemented)                               \
+    XX(502, BAD_GATEWAY, Bad Gateway)                                       \
+    XX(503, SERVICE_UNAVAILABLE, Service Unavailable)                       \
+    XX(504, GATEWAY_TIMEOUT, Gateway Timeout)                               \
+    XX(505, HTTP_VERSION_NOT_SUPPORTED, HTTP Version Not Supported)
+
+    enum class HttpMethod
+    {
+#define XX(num, name, string) name = num,
+        HTTP_METHOD_MAP(XX)
+#undef XX
+        INVALID_METHOD
+    };
+
+    enum class HttpStatus
+    {
+#define XX(code, name, desc) name = code,
+        HTTP_STATUS_MAP(XX)
+#undef XX
+    };
+
+    HttpMethod StringToHttpMethod(const std::string &m);
+    // 按长度匹配, 用于解析器直接在缓冲区上比较
+    HttpMethod CharsToHttpMethod(const char *m, size_t len);
+    const char *HttpMethodToString(const HttpMethod &m);
+    const char *HttpStatusToString(const HttpStatus &s);
+
+    // 头部字段名大小写不敏感
+    struct CaseInsensitiveLess
+    {
+        bool operator()(const std::string &lhs, const std::string &rhs) const
+        {
+            return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+        }
+    };
+
+    // HTTP请求
+    class HttpRequest
+    {
+    public:
+        using ptr = std::shared_ptr<HttpRequest>;
+        using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
+
+        // version: 0x11表示HTTP/1.1
+        HttpRequest(uint8_t version = 0x11, bool close = true);
+
+        HttpMethod getMethod() const { return m_method; }
+        uint8_t getVersion() const { return m_version; }
+        const std::string &getPath() const { return m_path; }
+        const std::string &getQuery() const { return m_query; }
+        const std::string &getFragment() const { return m_fragment; }
+        // body以切片引用接收缓冲区时, 第一次调用才拷贝成string
+        const std::string &getBody() const;
+        // 由HttpSession解析的请求, body是接收缓冲区中的切片, 可直接交给解析/日志而不拷贝
+        const BufferSlice &getBodySlice() const { return m_bodySlice; }
+        size_t getBodySize() const { return m_bodySlice.empty() ? m_body.size() : m_bodySlice.size(); }
+        const MapType &getHeaders() const { return m_headers; }
+        bool isClose() const { return m_close; }
+
+        void setMethod(HttpMethod v) { m_method = v; }
+        void setVersion(uint8_t v) { m_version = v; }
+        void setPath(const std::string &v) { m_path = v; }
+        void setQuery(const std::string &v) { m_query = v; }
+        void setFragment(const std::string &v) { m_fragment = v; }
+        void setBody(const std::string &v)
+        {
+            m_body = v;
+            m_bodySlice = BufferSlice();
+        }
+        // 交换body, 避免大body拷贝
+        void swapBody(std::string &v)
+        {
+            m_body.swap(v);
+            m_bodySlice = BufferSlice();
+        }
+        void setBodySlice(const BufferSlice &v)
+        {
+            m_body.clear();
+            m_bodySlice = v;
+        }
+        void setClose(bool v) { m_close = v; }
+        void setHeaders(const MapType &v) { m_headers = v; }
+
+        std::string getHeader(const std::string &key, const std::string &def = "") const;
+        bool hasHeader(const std::string &key, std::string *val = nullptr) const;
+        void setHeader(const std::string &key, const std::string &val);
+        void delHeader(const std::string &key);
+
+        // query中的参数, 首次访问时解析
+        std::string getParam(const std::string &key, const std::string &def = "");
+
+        std::ostream &dump(std::ostream &os) const;
+        std::string toString() const;
+
+    private:
+        void initQueryParam();
+
+    private:
+        HttpMethod m_method;
+        uint8_t m_version;
+        bool m_close;
+        bool m_parsedParam = false;
+        std::string m_path;
+        std::string m_query;
+        std::string m_fragment;
+        mutable std::string m_body;
+        BufferSlice m_bodySlice;
+        MapType m_headers;
+        MapType m_params;
+    };
+
+    // 以文件片段作为响应body, 发送时走sendfile, 不读入内存; 析构时关闭fd
+    struct HttpFileBody
+    {
+        using ptr = std::shared_ptr<HttpFileBody>;
+
+        HttpFileBody(int _fd, uint64_t _offset, uint64_t _length)
+            : fd(_fd), offset(_offset), length(_length)
+        {
+        }
+        ~HttpFileBody();
+
+        // 打开普通文件, 失败返回nullptr
+        static ptr Open(const std::string &path);
+
+        int fd;
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    // HTTP响应
+    class HttpResponse
+    {
+    public:
+        using ptr = std::shared_ptr<HttpResponse>;
+        using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
+
+        HttpResponse(uint8_t version = 0x11, bool close = true);
+
+        HttpStatus getStatus() const { return m_status; }
+        uint8_t getVersion() const { return m_version; }
+        const std::string &getBody() const { return m_body; }
+        const std::string &getReason() const { return m_reason; }
+        const MapType &getHeaders() const { return m_headers; }
+        bool isClose() const { return m_close; }
+
+        void setStatus(HttpStatus v) { m_status = v; }
+        void setVersion(uint8_t v) { m_version = v; }
+        void setBody(const std::string &v) { m_body = v; }
+        void swapBody(std::string &v) { m_body.swap(v); }
+        void setReason(const std::string &v) { m_reason = v; }
+        void setClose(bool v) { m_close = v; }
+        void setHeaders(const MapType &v) { m_headers = v; }
+        // 设置后忽略字符串body, content-length取文件片段长度
+        void setFileBody(HttpFileBody::ptr v) { m_fileBody = v; }
+        HttpFileBody::ptr getFileBody() const { return m_fileBody; }
+
+        std::string getHeader(const std::string &key, const std::string &def = "") const;
+        bool hasHeader(const std::string &key, std::string *val = nullptr) const;
+        void setHeader(const std::string &key, const std::string &val);
+        void delHeader(const std::string &key);
+
+        // 只输出状态行和头部(含content-length), 不含body; dump不输出文件body的内容
+        std::ostream &dumpHead(std::ostream &os) const;
+        std::ostream &dump(std::ostream &os) const;
+        std::string toString() const;
+
+    private:
+        HttpStatus m_status;
+        uint8_t m_version;
+        bool m_close;
+        std::string m_body;
+        std::string m_reason;
+        MapType m_headers;
+        HttpFileBody::ptr m_fileBody;
+    };
+
+    std::ostream &operator<<(std::ostream &os, const HttpRequest &req);
+    std::ostream &operator<<(std::ostream &os, const HttpResponse &rsp);
+
+} // namespace sltj
+
+#endif
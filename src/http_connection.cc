@@ -0,0 +1,485 @@
+#include "http_connection.h"
+#include "config.h"
+#include "log.h"
+
+#include <sstream>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static sltj::ConfigVar<uint64_t>::ptr g_http_pool_reap_interval =
+        sltj::Config::Lookup<uint64_t>("http.pool.reap_interval", (uint64_t)5000,
+                                       "http connection pool idle reap interval(ms)");
+
+    std::string HttpResult::toString() const
+    {
+        std::stringstream ss;
+        ss << "[HttpResult result=" << (int)result
+           << " error=" << error
+           << " response=" << (response ? response->toString() : "nullptr")
+           << "]";
+        return ss.str();
+    }
+
+    HttpConnection::HttpConnection(Socket::ptr sock)
+        : m_sock(sock), m_parser(HttpParser::RESPONSE), m_createTime(TimerManager::GetNowMS())
+    {
+    }
+
+    HttpConnection::~HttpConnection()
+    {
+        m_sock->close();
+    }
+
+    int HttpConnection::sendRequest(HttpRequest::ptr req)
+    {
+        std::string data = req->toString();
+        size_t off = 0;
+        while (off < data.size())
+        {
+            int rt = m_sock->send(data.data() + off, data.size() - off);
+            if (rt <= 0)
+            {
+                return rt;
+            }
+            off += rt;
+        }
+        return data.size();
+    }
+
+    HttpResponse::ptr HttpConnection::recvResponse(bool head)
+    {
+        m_parser.reset();
+        m_parser.setSkipBody(head);
+        for (;;)
+        {
+            if (!m_buf.empty())
+            {
+                m_parser.execute(&m_buf[0], m_buf.size());
+                if (m_parser.hasError())
+                {
+                    return nullptr;
+                }
+                if (m_parser.isFinished())
+                {
+                    break;
+                }
+            }
+            char tmp[4096];
+            int rt = m_sock->recv(tmp, sizeof(tmp));
+            if (rt == 0 && m_parser.needEof())
+            {
+                m_parser.finishEof();
+                break;
+            }
+            if (rt <= 0)
+            {
+                return nullptr;
+            }
+            m_buf.append(tmp, rt);
+        }
+        HttpResponse::ptr rsp = m_parser.toResponse(m_buf.data());
+        m_buf.erase(0, m_parser.getNread());
+        return rsp;
+    }
+
+    bool HttpConnection::isAlive() const
+    {
+        if (!m_sock->isConnected() || !m_buf.empty())
+        {
+            return false;
+        }
+        // 空闲连接上不应有数据, 可读即对端已关闭(0)或协议错乱
+        char c;
+        int rt = ::recv(m_sock->getSocket(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return rt == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    HttpConnectionPool::HttpConnectionPool(const std::string &host, const std::string &vhost, uint32_t port,
+                                           uint32_t max_size, uint32_t max_alive_time, uint32_t max_request,
+                                           IOManager *iom)
+        : m_host(host), m_vhost(vhost), m_port(port), m_maxSize(max_size),
+          m_maxAliveTime(max_alive_time), m_maxRequest(max_request), m_iom(iom)
+    {
+        if (!m_iom)
+        {
+            m_iom = IOManager::GetThis();
+        }
+    }
+
+    HttpConnectionPool::~HttpConnectionPool()
+    {
+        if (m_reapTimer)
+        {
+            m_reapTimer->cancel();
+        }
+        for (auto conn : m_conns)
+        {
+            delete conn;
+        }
+        m_conns.clear();
+    }
+
+    bool HttpConnectionPool::isExpired(HttpConnection *conn, uint64_t now) const
+    {
+        return (m_maxAliveTime && conn->m_createTime + m_maxAliveTime <= now) ||
+               (m_maxRequest && conn->m_request >= m_maxRequest);
+    }
+
+    void HttpConnectionPool::startReapTimer()
+    {
+        if (!m_iom)
+        {
+            return;
+        }
+        std::weak_ptr<HttpConnectionPool> weak;
+        try
+        {
+            weak = shared_from_this();
+        }
+        catch (std::bad_weak_ptr &)
+        {
+            // 不是由shared_ptr持有, 只在借出时清理
+            return;
+        }
+        m_reapTimer = m_iom->addConditionTimer(g_http_pool_reap_interval->getValue(), [weak]() {
+            HttpConnectionPool::ptr pool = weak.lock();
+            if (pool)
+            {
+                pool->reap();
+            }
+        }, weak, true);
+    }
+
+    HttpConnection *HttpConnectionPool::createConnection(uint64_t timeout_ms)
+    {
+        IPAddress::ptr addr = Address::LookupAnyIPAddress(m_host);
+        if (!addr)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "HttpConnectionPool get addr fail: " << m_host;
+            return nullptr;
+        }
+        addr->setPort(m_port);
+        Socket::ptr sock = Socket::CreateTCP(addr);
+        if (!sock->connect(addr, timeout_ms))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "HttpConnectionPool connect fail: " << *addr
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+        sock->setTcpNoDelay(true);
+        return new HttpConnection(sock);
+    }
+
+    void HttpConnectionPool::wakeOneNoLock()
+    {
+        while (!m_waiters.empty())
+        {
+            Waiter::ptr w = m_waiters.front();
+            m_waiters.pop_front();
+            // 已被超时定时器唤醒的跳过
+            if (!w->woken.exchange(true))
+            {
+                w->scheduler->schedule(w->fiber);
+                return;
+            }
+        }
+    }
+
+    HttpConnection::ptr HttpConnectionPool::getConnection(uint64_t timeout_ms)
+    {
+        uint64_t deadline = TimerManager::GetNowMS() + timeout_ms;
+        std::vector<HttpConnection *> invalid;
+        HttpConnection *conn = nullptr;
+
+        MutexType::Lock lock(m_mutex);
+        if (!m_reapStarted)
+        {
+            m_reapStarted = true;
+            startReapTimer();
+        }
+        for (;;)
+        {
+            uint64_t now = TimerManager::GetNowMS();
+            while (!m_conns.empty())
+            {
+                HttpConnection *c = m_conns.back();
+                m_conns.pop_back();
+                if (!c->isAlive() || isExpired(c, now))
+                {
+                    invalid.push_back(c);
+                    --m_total;
+                    ++m_reaped;
+                    continue;
+                }
+                conn = c;
+                break;
+            }
+            if (conn)
+            {
+                ++m_hit;
+                break;
+            }
+            if (m_total < m_maxSize)
+            {
+                ++m_total;
+                ++m_miss;
+                lock.unlock();
+                for (auto i : invalid)
+                {
+                    delete i;
+                }
+                invalid.clear();
+                conn = createConnection(deadline > now ? deadline - now : 0);
+                if (!conn)
+                {
+                    lock.lock();
+                    --m_total;
+                    wakeOneNoLock();
+                    return nullptr;
+                }
+                return wrapConnection(conn);
+            }
+
+            // 连接池已满, 在协程中挂起等待归还, 非协程环境直接失败
+            IOManager *iom = IOManager::GetThis();
+            if (now >= deadline || !iom || Fiber::GetFiberId() == 0)
+            {
+                ++m_timeout;
+                break;
+            }
+            ++m_wait;
+            Waiter::ptr w(new Waiter);
+            w->fiber = Fiber::GetThis();
+            w->scheduler = iom;
+            m_waiters.push_back(w);
+            lock.unlock();
+
+            std::weak_ptr<Waiter> ww(w);
+            Timer::ptr timer = iom->addConditionTimer(deadline - now, [ww]() {
+                Waiter::ptr w = ww.lock();
+                if (w && !w->woken.exchange(true))
+                {
+                    w->scheduler->schedule(w->fiber);
+                }
+            }, ww);
+            Fiber::YieldToHold();
+            timer->cancel();
+
+            lock.lock();
+            m_waiters.remove(w);
+        }
+        lock.unlock();
+
+        for (auto i : invalid)
+        {
+            delete i;
+        }
+        if (!conn)
+        {
+            return nullptr;
+        }
+        return wrapConnection(conn);
+    }
+
+    HttpConnection::ptr HttpConnectionPool::wrapConnection(HttpConnection *conn)
+    {
+        std::weak_ptr<HttpConnectionPool> weak;
+        try
+        {
+            weak = shared_from_this();
+        }
+        catch (std::bad_weak_ptr &)
+        {
+            // 不是由shared_ptr持有, 由调用方保证连接先于池释放
+            return HttpConnection::ptr(conn, std::bind(&HttpConnectionPool::ReleasePtr,
+                                                       std::placeholders::_1, this));
+        }
+        // 池已析构时直接关闭连接
+        return HttpConnection::ptr(conn, [weak](HttpConnection *conn) {
+            HttpConnectionPool::ptr pool = weak.lock();
+            if (pool)
+            {
+                ReleasePtr(conn, pool.get());
+            }
+            else
+            {
+                delete conn;
+            }
+        });
+    }
+
+    void HttpConnectionPool::ReleasePtr(HttpConnection *conn, HttpConnectionPool *pool)
+    {
+        ++conn->m_request;
+        bool drop = !conn->m_reusable || !conn->m_sock->isConnected() ||
+                    pool->isExpired(conn, TimerManager::GetNowMS());
+        {
+            MutexType::Lock lock(pool->m_mutex);
+            if (drop)
+            {
+                --pool->m_total;
+            }
+            else
+            {
+                pool->m_conns.push_back(conn);
+            }
+            pool->wakeOneNoLock();
+        }
+        if (drop)
+        {
+            delete conn;
+        }
+    }
+
+    void HttpConnectionPool::reap()
+    {
+        std::vector<HttpConnection *> invalid;
+        uint64_t now = TimerManager::GetNowMS();
+        {
+            MutexType::Lock lock(m_mutex);
+            for (auto it = m_conns.begin(); it != m_conns.end();)
+            {
+                if (!(*it)->isAlive() || isExpired(*it, now))
+                {
+                    invalid.push_back(*it);
+                    it = m_conns.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            m_total -= invalid.size();
+        }
+        m_reaped += invalid.size();
+        for (auto i : invalid)
+        {
+            delete i;
+        }
+        SLTJ_LOG_DEBUG(g_logger) << "HttpConnectionPool " << m_host << ":" << m_port
+                                 << " reaped=" << invalid.size() << " " << statsToString();
+    }
+
+    HttpConnectionPool::Stats HttpConnectionPool::getStats()
+    {
+        Stats s;
+        s.hit = m_hit;
+        s.miss = m_miss;
+        s.wait = m_wait;
+        s.timeout = m_timeout;
+        s.reaped = m_reaped;
+        MutexType::Lock lock(m_mutex);
+        s.total = m_total;
+        s.idle = m_conns.size();
+        return s;
+    }
+
+    std::string HttpConnectionPool::statsToString()
+    {
+        Stats s = getStats();
+        std::stringstream ss;
+        ss << "hit=" << s.hit << " miss=" << s.miss << " wait=" << s.wait
+           << " timeout=" << s.timeout << " reaped=" << s.reaped
+           << " total=" << s.total << " idle=" << s.idle;
+        return ss.str();
+    }
+
+    HttpResult::ptr HttpConnectionPool::doGet(const std::string &path, uint64_t timeout_ms,
+                                              const Headers &headers, const std::string &body)
+    {
+        return doRequest(HttpMethod::GET, path, timeout_ms, headers, body);
+    }
+
+    HttpResult::ptr HttpConnectionPool::doPost(const std::string &path, uint64_t timeout_ms,
+                                               const Headers &headers, const std::string &body)
+    {
+        return doRequest(HttpMethod::POST, path, timeout_ms, headers, body);
+    }
+
+    HttpResult::ptr HttpConnectionPool::doRequest(HttpMethod method, const std::string &path, uint64_t timeout_ms,
+                                                  const Headers &headers, const std::string &body)
+    {
+        HttpRequest::ptr req(new HttpRequest(0x11, false));
+        req->setMethod(method);
+
+        std::string p = path;
+        size_t pos = p.find('#');
+        if (pos != std::string::npos)
+        {
+            req->setFragment(p.substr(pos + 1));
+            p.resize(pos);
+        }
+        pos = p.find('?');
+        if (pos != std::string::npos)
+        {
+            req->setQuery(p.substr(pos + 1));
+            p.resize(pos);
+        }
+        req->setPath(p.empty() ? "/" : p);
+
+        for (auto &i : headers)
+        {
+            if (strcasecmp(i.first.c_str(), "connection") == 0)
+            {
+                if (strcasecmp(i.second.c_str(), "close") == 0)
+                {
+                    req->setClose(true);
+                }
+                continue;
+            }
+            req->setHeader(i.first, i.second);
+        }
+        req->setBody(body);
+        return doRequest(req, timeout_ms);
+    }
+
+    HttpResult::ptr HttpConnectionPool::doRequest(HttpRequest::ptr req, uint64_t timeout_ms)
+    {
+        uint64_t deadline = TimerManager::GetNowMS() + timeout_ms;
+        if (!req->hasHeader("Host"))
+        {
+            req->setHeader("Host", m_vhost.empty() ? m_host : m_vhost);
+        }
+
+        HttpConnection::ptr conn = getConnection(timeout_ms);
+        if (!conn)
+        {
+            return std::make_shared<HttpResult>(HttpResult::Error::POOL_GET_CONNECTION, nullptr,
+                                                "pool host:" + m_host + " port:" + std::to_string(m_port));
+        }
+
+        uint64_t now = TimerManager::GetNowMS();
+        if (now >= deadline)
+        {
+            return std::make_shared<HttpResult>(HttpResult::Error::TIMEOUT, nullptr,
+                                                "timeout before send, timeout_ms:" + std::to_string(timeout_ms));
+        }
+        Socket::ptr sock = conn->getSocket();
+        sock->setSendTimeout(deadline - now);
+        sock->setRecvTimeout(deadline - now);
+
+        // 出错的连接归还时丢弃
+        conn->m_reusable = false;
+        if (conn->sendRequest(req) <= 0)
+        {
+            return std::make_shared<HttpResult>(errno == ETIMEDOUT ? HttpResult::Error::TIMEOUT
+                                                                   : HttpResult::Error::SEND_FAIL,
+                                                nullptr, "send request fail, errno:" + std::to_string(errno));
+        }
+        HttpResponse::ptr rsp = conn->recvResponse(req->getMethod() == HttpMethod::HEAD);
+        if (!rsp)
+        {
+            return std::make_shared<HttpResult>(errno == ETIMEDOUT ? HttpResult::Error::TIMEOUT
+                                                                   : HttpResult::Error::RECV_FAIL,
+                                                nullptr, "recv response fail, errno:" + std::to_string(errno));
+        }
+        conn->m_reusable = !rsp->isClose() && !req->isClose();
+        return std::make_shared<HttpResult>(HttpResult::Error::OK, rsp, "ok");
+    }
+
+} // namespace sltj
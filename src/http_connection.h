@@ -0,0 +1,167 @@
+#ifndef __SLTJ_HTTP_CONNECTION_H__
+#define __SLTJ_HTTP_CONNECTION_H__
+
+#include <memory>
+#include <string>
+#include <list>
+#include <map>
+#include <atomic>
+#include "http.h"
+#include "http_parser.h"
+#include "socket.h"
+#include "iomanager.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // 一次HTTP调用的结果
+    struct HttpResult
+    {
+        using ptr = std::shared_ptr<HttpResult>;
+
+        enum class Error
+        {
+            OK = 0,
+            // 连接池已满且等待超时, 或建立新连接失败
+            POOL_GET_CONNECTION,
+            SEND_FAIL,
+            RECV_FAIL,
+            TIMEOUT,
+        };
+
+        HttpResult(Error _result, HttpResponse::ptr _response, const std::string &_error)
+            : result(_result), response(_response), error(_error)
+        {
+        }
+
+        std::string toString() const;
+
+        Error result;
+        HttpResponse::ptr response;
+        std::string error;
+    };
+
+    class HttpConnectionPool;
+
+    // 客户端HTTP连接, socket的读写在IOManager协程中只挂起当前协程
+    class HttpConnection
+    {
+        friend class HttpConnectionPool;
+
+    public:
+        using ptr = std::shared_ptr<HttpConnection>;
+
+        HttpConnection(Socket::ptr sock);
+        ~HttpConnection();
+
+        // 成功返回发送的字节数
+        int sendRequest(HttpRequest::ptr req);
+        // head为true时响应没有body
+        HttpResponse::ptr recvResponse(bool head = false);
+
+        // 连接未被对端关闭且没有多余的未读数据
+        bool isAlive() const;
+        Socket::ptr getSocket() const { return m_sock; }
+        uint64_t getCreateTime() const { return m_createTime; }
+        uint64_t getRequestCount() const { return m_request; }
+
+    private:
+        Socket::ptr m_sock;
+        HttpParser m_parser;
+        std::string m_buf;
+        uint64_t m_createTime;   // 单调时钟毫秒
+        uint64_t m_request = 0;
+        // 出错或响应要求关闭时置false, 归还时直接丢弃
+        bool m_reusable = true;
+    };
+
+    // 单个host:port的连接池
+    // 空闲连接后进先出复用; 超过max_alive_time(ms)或已处理max_request个请求的连接不再复用.
+    // 连接数达到max_size时, 协程挂起等待其他调用归还连接, 直到超时.
+    // 空闲连接由IOManager上的循环定时器定期回收(需由shared_ptr持有); 定时器在池析构时取消,
+    // 在此之前IOManager::stop不会返回. 由shared_ptr持有时借出的连接可晚于池释放(直接关闭),
+    // 否则要在池析构前释放.
+    class HttpConnectionPool : public std::enable_shared_from_this<HttpConnectionPool>
+    {
+    public:
+        using ptr = std::shared_ptr<HttpConnectionPool>;
+        using MutexType = Mutex;
+        using Headers = std::map<std::string, std::string>;
+
+        struct Stats
+        {
+            uint64_t hit = 0;       // 复用空闲连接
+            uint64_t miss = 0;      // 新建连接
+            uint64_t wait = 0;      // 因连接池已满而等待
+            uint64_t timeout = 0;   // 等待超时
+            uint64_t reaped = 0;    // 回收的失效/过期连接
+            uint32_t total = 0;     // 当前连接数(含借出)
+            uint32_t idle = 0;      // 当前空闲连接数
+        };
+
+        // iom为空时取当前线程的IOManager, 都没有则不启用定时回收
+        HttpConnectionPool(const std::string &host, const std::string &vhost, uint32_t port,
+                           uint32_t max_size, uint32_t max_alive_time, uint32_t max_request,
+                           IOManager *iom = nullptr);
+        ~HttpConnectionPool();
+
+        // 借出连接, 释放shared_ptr即归还; 失败返回nullptr
+        HttpConnection::ptr getConnection(uint64_t timeout_ms);
+
+        // path可带query/fragment; 超时包含等待连接和收发的时间
+        HttpResult::ptr doGet(const std::string &path, uint64_t timeout_ms,
+                              const Headers &headers = Headers(), const std::string &body = "");
+        HttpResult::ptr doPost(const std::string &path, uint64_t timeout_ms,
+                               const Headers &headers = Headers(), const std::string &body = "");
+        HttpResult::ptr doRequest(HttpMethod method, const std::string &path, uint64_t timeout_ms,
+                                  const Headers &headers = Headers(), const std::string &body = "");
+        HttpResult::ptr doRequest(HttpRequest::ptr req, uint64_t timeout_ms);
+
+        // 关闭空闲连接中已失效或过期的
+        void reap();
+        Stats getStats();
+        std::string statsToString();
+
+    private:
+        // 等待归还连接的协程
+        struct Waiter
+        {
+            using ptr = std::shared_ptr<Waiter>;
+            Fiber::ptr fiber;
+            Scheduler *scheduler;
+            std::atomic<bool> woken{false};
+        };
+
+        static void ReleasePtr(HttpConnection *conn, HttpConnectionPool *pool);
+        HttpConnection::ptr wrapConnection(HttpConnection *conn);
+        bool isExpired(HttpConnection *conn, uint64_t now) const;
+        HttpConnection *createConnection(uint64_t timeout_ms);
+        void wakeOneNoLock();
+        void startReapTimer();
+
+    private:
+        std::string m_host;
+        std::string m_vhost;
+        uint32_t m_port;
+        uint32_t m_maxSize;
+        uint32_t m_maxAliveTime;
+        uint32_t m_maxRequest;
+        IOManager *m_iom;
+
+        MutexType m_mutex;
+        std::list<HttpConnection *> m_conns;   // 空闲连接, 尾部为最近归还
+        std::list<Waiter::ptr> m_waiters;
+        uint32_t m_total = 0;
+        Timer::ptr m_reapTimer;
+        bool m_reapStarted = false;
+
+        std::atomic<uint64_t> m_hit{0};
+        std::atomic<uint64_t> m_miss{0};
+        std::atomic<uint64_t> m_wait{0};
+        std::atomic<uint64_t> m_timeout{0};
+        std::atomic<uint64_t> m_reaped{0};
+    };
+
+} // namespace sltj
+
+#endif
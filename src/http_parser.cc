@@ -0,0 +1,866 @@
+#include "http_parser.h"
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace sltj
+{
+    static sltj::ConfigVar<uint64_t>::ptr g_http_max_header_size =
+        sltj::Config::Lookup<uint64_t>("http.parser.max_header_size", (uint64_t)(8 * 1024),
+                                       "http max size of start line and headers");
+
+    static sltj::ConfigVar<uint64_t>::ptr g_http_max_body_size =
+        sltj::Config::Lookup<uint64_t>("http.parser.max_body_size", (uint64_t)(64 * 1024 * 1024),
+                                       "http max body size");
+
+    // RFC 7230 tchar
+    static inline bool IsTokenChar(char c)
+    {
+        static const char *s_extra = "!#$%&'*+-.^_`|~";
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               (c != '\0' && strchr(s_extra, c) != nullptr);
+    }
+
+    static inline int HexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    // 取逗号分隔列表中从i开始的下一项[b, e), 没有时返回false
+    static bool NextToken(const char *p, size_t len, size_t &i, size_t &b, size_t &e)
+    {
+        while (i < len && (p[i] == ' ' || p[i] == '\t' || p[i] == ','))
+        {
+            ++i;
+        }
+        if (i >= len)
+        {
+            return false;
+        }
+        b = i;
+        while (i < len && p[i] != ',')
+        {
+            ++i;
+        }
+        e = i;
+        while (e > b && (p[e - 1] == ' ' || p[e - 1] == '\t'))
+        {
+            --e;
+        }
+        return true;
+    }
+
+    // 逗号分隔的列表中是否含有token(大小写不敏感)
+    static bool ListHasToken(const char *p, size_t len, const char *token)
+    {
+        size_t tlen = strlen(token);
+        size_t i = 0, b, e;
+        while (NextToken(p, len, i, b, e))
+        {
+            if (e - b == tlen && strncasecmp(p + b, token, tlen) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool HttpSlice::equalsIgnoreCase(const char *base, const char *s) const
+    {
+        return strlen(s) == len && strncasecmp(base + off, s, len) == 0;
+    }
+
+    HttpParser::HttpParser(Type type)
+        : m_type(type)
+    {
+        m_maxHeaderSize = g_http_max_header_size->getValue();
+        m_maxBodySize = g_http_max_body_size->getValue();
+        reset();
+    }
+
+    void HttpParser::reset()
+    {
+        m_state = s_start;
+        m_error = NONE;
+        m_nread = 0;
+        m_mark = 0;
+        m_headerStart = 0;
+        m_headerFinished = false;
+        m_chunked = false;
+        m_transferEncoding = false;
+        m_connClose = false;
+        m_connKeepAlive = false;
+        m_method = HttpMethod::INVALID_METHOD;
+        m_status = 0;
+        m_statusDigits = 0;
+        m_version = 0;
+        m_contentLength = -1;
+        m_bodyLeft = 0;
+        m_chunkSize = 0;
+        m_chunkDigits = 0;
+        m_bodyStart = 0;
+        m_bodyEnd = 0;
+        m_trailerStart = 0;
+        m_uri = HttpSlice();
+        m_path = HttpSlice();
+        m_query = HttpSlice();
+        m_fragment = HttpSlice();
+        m_reason = HttpSlice();
+        m_body = HttpSlice();
+        m_curField = HttpSlice();
+        m_headers.clear();
+    }
+
+    void HttpParser::setError(Error err)
+    {
+        m_error = err;
+        m_state = s_error;
+    }
+
+    // HTTP/x.y
+    bool HttpParser::parseVersion(const char *p, size_t len)
+    {
+        if (len != 8 || strncmp(p, "HTTP/", 5) != 0 || p[6] != '.' ||
+            p[5] < '0' || p[5] > '9' || p[7] < '0' || p[7] > '9')
+        {
+            return false;
+        }
+        m_version = ((p[5] - '0') << 4) | (p[7] - '0');
+        return m_version == 0x11 || m_version == 0x10;
+    }
+
+    void HttpParser::splitUri(const char *data)
+    {
+        size_t b = m_uri.off;
+        size_t e = m_uri.off + m_uri.len;
+
+        // absolute-form: http://host/path
+        if (data[b] != '/' && data[b] != '*')
+        {
+            const char *scheme = (const char *)memmem(data + b, e - b, "://", 3);
+            if (scheme)
+            {
+                const char *slash = (const char *)memchr(scheme + 3, '/', data + e - scheme - 3);
+                b = slash ? slash - data : e;
+            }
+        }
+
+        const char *hash = (const char *)memchr(data + b, '#', e - b);
+        size_t end = e;
+        if (hash)
+        {
+            end = hash - data;
+            m_fragment = HttpSlice(end + 1, e - end - 1);
+        }
+        const char *q = (const char *)memchr(data + b, '?', end - b);
+        if (q)
+        {
+            m_query = HttpSlice(q - data + 1, end - (q - data) - 1);
+            end = q - data;
+        }
+        m_path = HttpSlice(b, end - b);
+    }
+
+    void HttpParser::onHeader(const char *data)
+    {
+        Header h;
+        h.name = m_curField;
+        size_t b = m_mark;
+        size_t e = m_nread;
+        while (e > b && (data[e - 1] == ' ' || data[e - 1] == '\t'))
+        {
+            --e;
+        }
+        h.value = HttpSlice(b, e - b);
+        m_headers.push_back(h);
+
+        const char *v = data + h.value.off;
+        if (h.name.equalsIgnoreCase(data, "content-length"))
+        {
+            if (h.value.len == 0)
+            {
+                setError(INVALID_CONTENT_LENGTH);
+                return;
+            }
+            int64_t cl = 0;
+            for (size_t i = 0; i < h.value.len; ++i)
+            {
+                if (v[i] < '0' || v[i] > '9')
+                {
+                    setError(INVALID_CONTENT_LENGTH);
+                    return;
+                }
+                // 溢出成负数会被当成没有body, 剩下的字节被当作下一个请求解析
+                int d = v[i] - '0';
+                if (cl > (INT64_MAX - d) / 10)
+                {
+                    setError(INVALID_CONTENT_LENGTH);
+                    return;
+                }
+                cl = cl * 10 + d;
+            }
+            if ((uint64_t)cl > m_maxBodySize)
+            {
+                setError(BODY_TOO_LARGE);
+                return;
+            }
+            // 重复且不一致的content-length可能导致请求走私
+            if (m_contentLength >= 0 && m_contentLength != cl)
+            {
+                setError(INVALID_CONTENT_LENGTH);
+                return;
+            }
+            m_contentLength = cl;
+        }
+        else if (h.name.equalsIgnoreCase(data, "transfer-encoding"))
+        {
+            // 多个transfer-encoding头按顺序合并成一个列表, chunked只能是最后一项
+            m_transferEncoding = true;
+            size_t i = 0, b, e;
+            while (NextToken(v, h.value.len, i, b, e))
+            {
+                if (m_chunked)
+                {
+                    setError(INVALID_TRANSFER_ENCODING);
+                    return;
+                }
+                m_chunked = e - b == 7 && strncasecmp(v + b, "chunked", 7) == 0;
+            }
+        }
+        else if (h.name.equalsIgnoreCase(data, "connection"))
+        {
+            m_connClose = m_connClose || ListHasToken(v, h.value.len, "close");
+            m_connKeepAlive = m_connKeepAlive || ListHasToken(v, h.value.len, "keep-alive");
+        }
+    }
+
+    void HttpParser::onHeadersComplete(size_t pos)
+    {
+        m_headerFinished = true;
+        // RFC 7230 3.3.3: 请求的长度必须无歧义, 否则可能被前后两端解析成不同的请求(走私)
+        if (m_type == REQUEST && m_transferEncoding && (!m_chunked || m_contentLength >= 0))
+        {
+            setError(INVALID_TRANSFER_ENCODING);
+            return;
+        }
+        m_bodyStart = pos;
+        m_bodyEnd = pos;
+        m_body = HttpSlice(pos, 0);
+
+        bool no_body = m_skipBody;
+        if (m_type == RESPONSE && (m_status / 100 == 1 || m_status == 204 || m_status == 304))
+        {
+            no_body = true;
+        }
+
+        if (no_body)
+        {
+            m_state = s_done;
+        }
+        else if (m_chunked)
+        {
+            m_chunkSize = 0;
+            m_chunkDigits = 0;
+            m_state = s_chunk_size;
+        }
+        else if (m_contentLength >= 0)
+        {
+            if ((uint64_t)m_contentLength > m_maxBodySize)
+            {
+                setError(BODY_TOO_LARGE);
+            }
+            else if (m_contentLength == 0)
+            {
+                m_state = s_done;
+            }
+            else
+            {
+                m_bodyLeft = m_contentLength;
+                m_state = s_body_identity;
+            }
+        }
+        else if (m_type == REQUEST)
+        {
+            m_state = s_done;
+        }
+        else
+        {
+            m_state = s_body_eof;
+        }
+    }
+
+    size_t HttpParser::execute(char *data, size_t len)
+    {
+        size_t p = m_nread;
+        while (p < len && m_state != s_done && m_state != s_error)
+        {
+            char c = data[p];
+            switch (m_state)
+            {
+            case s_start:
+                // 容忍消息之间多余的空行
+                if (c == '\r' || c == '\n')
+                {
+                    ++p;
+                    break;
+                }
+                m_headerStart = p;
+                m_mark = p;
+                m_state = m_type == REQUEST ? s_method : s_res_version;
+                break;
+
+            case s_method:
+                if (c == ' ')
+                {
+                    m_method = CharsToHttpMethod(data + m_mark, p - m_mark);
+                    if (m_method == HttpMethod::INVALID_METHOD)
+                    {
+                        setError(INVALID_METHOD);
+                        break;
+                    }
+                    ++p;
+                    m_mark = p;
+                    m_state = s_uri;
+                    break;
+                }
+                if (c < 'A' || c > 'Z')
+                {
+                    setError(INVALID_METHOD);
+                    break;
+                }
+                ++p;
+                break;
+
+            case s_uri:
+                if (c == ' ')
+                {
+                    if (p == m_mark)
+                    {
+                        setError(INVALID_START_LINE);
+                        break;
+                    }
+                    m_uri = HttpSlice(m_mark, p - m_mark);
+                    splitUri(data);
+                    ++p;
+                    m_mark = p;
+                    m_state = s_req_version;
+                    break;
+                }
+                if ((unsigned char)c <= 0x20 || c == 0x7f)
+                {
+                    setError(INVALID_START_LINE);
+                    break;
+                }
+                ++p;
+                break;
+
+            case s_req_version:
+                if (c == '\r')
+                {
+                    if (!parseVersion(data + m_mark, p - m_mark))
+                    {
+                        setError(INVALID_VERSION);
+                        break;
+                    }
+                    ++p;
+                    m_state = s_line_lf;
+                    break;
+                }
+                if (p - m_mark >= 8)
+                {
+                    setError(INVALID_VERSION);
+                    break;
+                }
+                ++p;
+                break;
+
+            case s_res_version:
+                if (c == ' ')
+                {
+                    if (!parseVersion(data + m_mark, p - m_mark))
+                    {
+                        setError(INVALID_VERSION);
+                        break;
+                    }
+                    ++p;
+                    m_state = s_res_status;
+                    break;
+                }
+                if (p - m_mark >= 8)
+                {
+                    setError(INVALID_VERSION);
+                    break;
+                }
+                ++p;
+                break;
+
+            case s_res_status:
+                if (c >= '0' && c <= '9' && m_statusDigits < 3)
+                {
+                    m_status = m_status * 10 + (c - '0');
+                    ++m_statusDigits;
+                    ++p;
+                    break;
+                }
+                if (m_statusDigits != 3 || (c != ' ' && c != '\r'))
+                {
+                    setError(INVALID_STATUS);
+                    break;
+                }
+                if (c == ' ')
+                {
+                    ++p;
+                    m_mark = p;
+                    m_state = s_res_reason;
+                }
+                else
+                {
+                    ++p;
+                    m_state = s_line_lf;
+                }
+                break;
+
+            case s_res_reason:
+            {
+                const char *cr = (const char *)memchr(data + p, '\r', len - p);
+                if (!cr)
+                {
+                    p = len;
+                    break;
+                }
+                p = cr - data;
+                m_reason = HttpSlice(m_mark, p - m_mark);
+                ++p;
+                m_state = s_line_lf;
+                break;
+            }
+
+            case s_line_lf:
+                if (c != '\n')
+                {
+                    setError(INVALID_START_LINE);
+                    break;
+                }
+                ++p;
+                m_state = s_header_start;
+                break;
+
+            case s_header_start:
+                if (c == '\r')
+                {
+                    ++p;
+                    m_state = s_headers_lf;
+                    break;
+                }
+                // 不支持obs-fold
+                if (c == ' ' || c == '\t')
+                {
+                    setError(INVALID_HEADER);
+                    break;
+                }
+                m_mark = p;
+                m_state = s_header_field;
+                break;
+
+            case s_header_field:
+                if (c == ':')
+                {
+                    if (p == m_mark)
+                    {
+                        setError(INVALID_HEADER);
+                        break;
+                    }
+                    m_curField = HttpSlice(m_mark, p - m_mark);
+                    ++p;
+                    m_state = s_header_value_start;
+                    break;
+                }
+                if (!IsTokenChar(c))
+                {
+                    setError(INVALID_HEADER);
+                    break;
+                }
+                ++p;
+                break;
+
+            case s_header_value_start:
+                if (c == ' ' || c == '\t')
+                {
+                    ++p;
+                    break;
+                }
+                m_mark = p;
+                m_state = s_header_value;
+                break;
+
+            case s_header_value:
+            {
+                // 值中的字节不需要逐个检查, 直接找行尾
+                const char *cr = (const char *)memchr(data + p, '\r', len - p);
+                const char *lf = (const char *)memchr(data + p, '\n', (cr ? cr - data : len) - p);
+                if (lf)
+                {
+                    setError(INVALID_HEADER);
+                    break;
+                }
+                if (!cr)
+                {
+                    p = len;
+                    break;
+                }
+                p = cr - data;
+                m_nread = p;
+                onHeader(data);
+                if (m_state == s_error)
+                {
+                    break;
+                }
+                ++p;
+                m_state = s_header_lf;
+                break;
+            }
+
+            case s_header_lf:
+                if (c != '\n')
+                {
+                    setError(INVALID_HEADER);
+                    break;
+                }
+                ++p;
+                m_state = s_header_start;
+                break;
+
+            case s_headers_lf:
+                if (c != '\n')
+                {
+                    setError(INVALID_HEADER);
+                    break;
+                }
+                ++p;
+                if (p - m_headerStart > m_maxHeaderSize)
+                {
+                    setError(HEADER_TOO_LARGE);
+                    break;
+                }
+                onHeadersComplete(p);
+                break;
+
+            case s_body_identity:
+            {
+                uint64_t n = len - p;
+                if (n > m_bodyLeft)
+                {
+                    n = m_bodyLeft;
+                }
+                p += n;
+                m_bodyLeft -= n;
+                if (m_bodyLeft == 0)
+                {
+                    m_body = HttpSlice(m_bodyStart, m_contentLength);
+                    m_state = s_done;
+                }
+                break;
+            }
+
+            case s_body_eof:
+                p = len;
+                if (p - m_bodyStart > m_maxBodySize)
+                {
+                    setError(BODY_TOO_LARGE);
+                    break;
+                }
+                m_body = HttpSlice(m_bodyStart, p - m_bodyStart);
+                break;
+
+            case s_chunk_size:
+            {
+                int v = HexValue(c);
+                if (v >= 0)
+                {
+                    m_chunkSize = m_chunkSize * 16 + v;
+                    ++m_chunkDigits;
+                    if (m_chunkSize > m_maxBodySize)
+                    {
+                        setError(BODY_TOO_LARGE);
+                        break;
+                    }
+                    ++p;
+                    break;
+                }
+                if (m_chunkDigits == 0)
+                {
+                    setError(INVALID_CHUNK);
+                    break;
+                }
+                if (c == '\r')
+                {
+                    ++p;
+                    m_state = s_chunk_size_lf;
+                }
+                else if (c == ';' || c == ' ' || c == '\t')
+                {
+                    ++p;
+                    m_state = s_chunk_ext;
+                }
+                else
+                {
+                    setError(INVALID_CHUNK);
+                }
+                break;
+            }
+
+            case s_chunk_ext:
+                if (c == '\r')
+                {
+                    m_state = s_chunk_size_lf;
+                }
+                else if (c == '\n')
+                {
+                    setError(INVALID_CHUNK);
+                    break;
+                }
+                ++p;
+                break;
+
+            case s_chunk_size_lf:
+                if (c != '\n')
+                {
+                    setError(INVALID_CHUNK);
+                    break;
+                }
+                ++p;
+                if (m_chunkSize == 0)
+                {
+                    m_trailerStart = p;
+                    m_state = s_trailer_start;
+                }
+                else if (m_bodyEnd - m_bodyStart + m_chunkSize > m_maxBodySize)
+                {
+                    setError(BODY_TOO_LARGE);
+                    break;
+                }
+                else
+                {
+                    m_bodyLeft = m_chunkSize;
+                    m_state = s_chunk_data;
+                }
+                m_chunkSize = 0;
+                m_chunkDigits = 0;
+                break;
+
+            case s_chunk_data:
+            {
+                uint64_t n = len - p;
+                if (n > m_bodyLeft)
+                {
+                    n = m_bodyLeft;
+                }
+                // 原地解码: 分块数据前移, 与之前的数据连成一段
+                if (m_bodyEnd != p)
+                {
+                    memmove(data + m_bodyEnd, data + p, n);
+                }
+                m_bodyEnd += n;
+                p += n;
+                m_bodyLeft -= n;
+                if (m_bodyLeft == 0)
+                {
+                    m_state = s_chunk_data_cr;
+                }
+                break;
+            }
+
+            case s_chunk_data_cr:
+                if (c != '\r')
+                {
+                    setError(INVALID_CHUNK);
+                    break;
+                }
+                ++p;
+                m_state = s_chunk_data_lf;
+                break;
+
+            case s_chunk_data_lf:
+                if (c != '\n')
+                {
+                    setError(INVALID_CHUNK);
+                    break;
+                }
+                ++p;
+                m_state = s_chunk_size;
+                break;
+
+            case s_trailer_start:
+                if (c == '\r')
+                {
+                    ++p;
+                    m_state = s_trailer_end_lf;
+                }
+                else
+                {
+                    m_state = s_trailer_line;
+                }
+                break;
+
+            case s_trailer_line:
+            {
+                // trailer字段忽略
+                const char *cr = (const char *)memchr(data + p, '\r', len - p);
+                if (!cr)
+                {
+                    p = len;
+                    break;
+                }
+                p = cr - data + 1;
+                m_state = s_trailer_lf;
+                break;
+            }
+
+            case s_trailer_lf:
+                if (c != '\n')
+                {
+                    setError(INVALID_CHUNK);
+                    break;
+                }
+                ++p;
+                if (p - m_trailerStart > m_maxHeaderSize)
+                {
+                    setError(HEADER_TOO_LARGE);
+                    break;
+                }
+                m_state = s_trailer_start;
+                break;
+
+            case s_trailer_end_lf:
+                if (c != '\n')
+                {
+                    setError(INVALID_CHUNK);
+                    break;
+                }
+                ++p;
+                m_body = HttpSlice(m_bodyStart, m_bodyEnd - m_bodyStart);
+                m_state = s_done;
+                break;
+
+            default:
+                setError(INVALID_START_LINE);
+                break;
+            }
+        }
+
+        // 头部未结束时按已收到的长度检查上限, 避免无限缓存; trailer同样计入
+        if (!m_headerFinished && m_state != s_error && p - m_headerStart > m_maxHeaderSize)
+        {
+            setError(HEADER_TOO_LARGE);
+        }
+        else if ((m_state == s_trailer_start || m_state == s_trailer_line || m_state == s_trailer_lf ||
+                  m_state == s_trailer_end_lf) &&
+                 p - m_trailerStart > m_maxHeaderSize)
+        {
+            setError(HEADER_TOO_LARGE);
+        }
+        m_nread = p;
+        return p;
+    }
+
+    void HttpParser::finishEof()
+    {
+        if (m_state == s_body_eof)
+        {
+            m_body = HttpSlice(m_bodyStart, m_nread - m_bodyStart);
+            m_state = s_done;
+        }
+    }
+
+    bool HttpParser::isKeepAlive() const
+    {
+        if (m_state == s_body_eof)
+        {
+            return false;
+        }
+        if (m_version >= 0x11)
+        {
+            return !m_connClose;
+        }
+        return m_connKeepAlive && !m_connClose;
+    }
+
+    bool HttpParser::getHeader(const char *data, const char *name, HttpSlice &value) const
+    {
+        for (auto &h : m_headers)
+        {
+            if (h.name.equalsIgnoreCase(data, name))
+            {
+                value = h.value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    HttpRequest::ptr HttpParser::toRequest(const char *data) const
+    {
+        HttpRequest::ptr req = toRequestHead(data);
+        if (!m_body.empty())
+        {
+            std::string body(data + m_body.off, m_body.len);
+            req->swapBody(body);
+        }
+        return req;
+    }
+
+    HttpRequest::ptr HttpParser::toRequest(const BufferSlice &msg) const
+    {
+        HttpRequest::ptr req = toRequestHead(msg.data());
+        if (!m_body.empty())
+        {
+            req->setBodySlice(msg.sub(m_body.off, m_body.len));
+        }
+        return req;
+    }
+
+    HttpRequest::ptr HttpParser::toRequestHead(const char *data) const
+    {
+        HttpRequest::ptr req(new HttpRequest(m_version, !isKeepAlive()));
+        req->setMethod(m_method);
+        req->setPath(m_path.empty() ? "/" : m_path.toString(data));
+        req->setQuery(m_query.toString(data));
+        req->setFragment(m_fragment.toString(data));
+        for (auto &h : m_headers)
+        {
+            req->setHeader(h.name.toString(data), h.value.toString(data));
+        }
+        return req;
+    }
+
+    HttpResponse::ptr HttpParser::toResponse(const char *data) const
+    {
+        HttpResponse::ptr rsp(new HttpResponse(m_version, !isKeepAlive()));
+        rsp->setStatus((HttpStatus)m_status);
+        rsp->setReason(m_reason.toString(data));
+        for (auto &h : m_headers)
+        {
+            rsp->setHeader(h.name.toString(data), h.value.toString(data));
+        }
+        if (!m_body.empty())
+        {
+            std::string body(data + m_body.off, m_body.len);
+            rsp->swapBody(body);
+        }
+        return rsp;
+    }
+
+} // namespace sltj
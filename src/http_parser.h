@@ -0,0 +1,193 @@
+#ifndef __SLTJ_HTTP_PARSER_H__
+#define __SLTJ_HTTP_PARSER_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "http.h"
+
+namespace sltj
+{
+    // 缓冲区中的一段, 只记录偏移, 不拷贝; 缓冲区扩容搬移后依然有效
+    struct HttpSlice
+    {
+        size_t off = 0;
+        size_t len = 0;
+
+        HttpSlice() {}
+        HttpSlice(size_t o, size_t l) : off(o), len(l) {}
+
+        bool empty() const { return len == 0; }
+        std::string toString(const char *base) const { return std::string(base + off, len); }
+        bool equalsIgnoreCase(const char *base, const char *s) const;
+    };
+
+    // HTTP/1.x 请求/响应解析器
+    // 手写状态机, 直接在接收缓冲区上逐字节推进, 只记录各字段的偏移;
+    // 数据不完整时返回, 缓冲区追加新数据后从上次停下的位置继续, 不会重复扫描.
+    // chunked body在缓冲区中原地解码: 去掉分块头尾, 数据前移拼成连续的一段.
+    class HttpParser
+    {
+    public:
+        enum Type
+        {
+            REQUEST,
+            RESPONSE
+        };
+
+        enum Error
+        {
+            NONE = 0,
+            INVALID_METHOD,
+            INVALID_START_LINE,
+            INVALID_VERSION,
+            INVALID_STATUS,
+            INVALID_HEADER,
+            INVALID_CONTENT_LENGTH,
+            INVALID_CHUNK,
+            HEADER_TOO_LARGE,
+            BODY_TOO_LARGE,
+            // 请求的transfer-encoding最后一项不是chunked, chunked不在最后, 或与content-length同时出现
+            INVALID_TRANSFER_ENCODING
+        };
+
+        struct Header
+        {
+            HttpSlice name;
+            HttpSlice value;
+        };
+
+        // 头部/body大小上限取自配置项http.parser.max_header_size/max_body_size
+        HttpParser(Type type);
+
+        // 开始解析下一个消息, 保留大小上限设置
+        void reset();
+
+        // data为当前消息在缓冲区中的起始地址, len为已收到的字节数
+        // 返回已消费的字节数; 消息完成后即为该消息占用的长度, 之后的数据属于下一个消息(pipelining)
+        size_t execute(char *data, size_t len);
+        // 对端关闭连接: 没有长度信息的响应以此结束
+        void finishEof();
+
+        bool isFinished() const { return m_state == s_done; }
+        bool hasError() const { return m_error != NONE; }
+        Error getError() const { return m_error; }
+        bool isHeaderFinished() const { return m_headerFinished; }
+        // 响应body以连接关闭界定, 需要读到EOF
+        bool needEof() const { return m_state == s_body_eof; }
+        size_t getNread() const { return m_nread; }
+
+        Type getType() const { return m_type; }
+        HttpMethod getMethod() const { return m_method; }
+        uint32_t getStatus() const { return m_status; }
+        uint8_t getVersion() const { return m_version; }
+        bool isChunked() const { return m_chunked; }
+        // content-length, 没有该头部时为-1
+        int64_t getContentLength() const { return m_contentLength; }
+        bool isKeepAlive() const;
+
+        const HttpSlice &getUri() const { return m_uri; }
+        const HttpSlice &getPath() const { return m_path; }
+        const HttpSlice &getQuery() const { return m_query; }
+        const HttpSlice &getFragment() const { return m_fragment; }
+        const HttpSlice &getReason() const { return m_reason; }
+        const HttpSlice &getBody() const { return m_body; }
+        const std::vector<Header> &getHeaders() const { return m_headers; }
+        // 查找头部, 未找到返回false
+        bool getHeader(const char *data, const char *name, HttpSlice &value) const;
+
+        // 响应没有body(HEAD请求的响应), 需在解析前设置
+        void setSkipBody(bool v) { m_skipBody = v; }
+
+        uint64_t getMaxHeaderSize() const { return m_maxHeaderSize; }
+        void setMaxHeaderSize(uint64_t v) { m_maxHeaderSize = v; }
+        uint64_t getMaxBodySize() const { return m_maxBodySize; }
+        void setMaxBodySize(uint64_t v) { m_maxBodySize = v; }
+
+        // 按解析结果生成请求/响应对象, data为execute时传入的缓冲区
+        HttpRequest::ptr toRequest(const char *data) const;
+        // msg为整个消息在接收缓冲区中的切片, body以其子切片引用, 不拷贝
+        HttpRequest::ptr toRequest(const BufferSlice &msg) const;
+        HttpResponse::ptr toResponse(const char *data) const;
+
+    private:
+        enum State
+        {
+            s_start,
+            s_method,
+            s_uri,
+            s_req_version,
+            s_res_version,
+            s_res_status,
+            s_res_reason,
+            s_line_lf,
+            s_header_start,
+            s_header_field,
+            s_header_value_start,
+            s_header_value,
+            s_header_lf,
+            s_headers_lf,
+            s_body_identity,
+            s_body_eof,
+            s_chunk_size,
+            s_chunk_ext,
+            s_chunk_size_lf,
+            s_chunk_data,
+            s_chunk_data_cr,
+            s_chunk_data_lf,
+            s_trailer_start,
+            s_trailer_line,
+            s_trailer_lf,
+            s_trailer_end_lf,
+            s_done,
+            s_error
+        };
+
+        void setError(Error err);
+        bool parseVersion(const char *p, size_t len);
+        void splitUri(const char *data);
+        void onHeader(const char *data);
+        void onHeadersComplete(size_t pos);
+        // 请求中除body外的部分
+        HttpRequest::ptr toRequestHead(const char *data) const;
+
+    private:
+        Type m_type;
+        State m_state;
+        Error m_error;
+        size_t m_nread;
+        size_t m_mark;            // 当前字段起始偏移
+        size_t m_headerStart;     // 起始行的偏移(跳过前导空行)
+        bool m_headerFinished;
+        bool m_skipBody = false;
+        bool m_chunked;           // transfer-encoding的最后一项是chunked
+        bool m_transferEncoding;  // 出现过transfer-encoding
+        bool m_connClose;
+        bool m_connKeepAlive;
+        HttpMethod m_method;
+        uint32_t m_status;
+        uint32_t m_statusDigits;
+        uint8_t m_version;
+        int64_t m_contentLength;
+        uint64_t m_bodyLeft;      // identity body或当前chunk剩余字节
+        uint64_t m_chunkSize;
+        uint32_t m_chunkDigits;
+        size_t m_bodyStart;
+        size_t m_bodyEnd;         // chunked解码写入位置
+        size_t m_trailerStart;    // trailer的起始偏移, 与头部共用大小上限
+        uint64_t m_maxHeaderSize;
+        uint64_t m_maxBodySize;
+
+        HttpSlice m_uri;
+        HttpSlice m_path;
+        HttpSlice m_query;
+        HttpSlice m_fragment;
+        HttpSlice m_reason;
+        HttpSlice m_body;
+        HttpSlice m_curField;
+        std::vector<Header> m_headers;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,71 @@
+#include "http_server.h"
+#include "log.h"
+#include "object_pool.h"
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    HttpServer::HttpServer(bool keepalive, IOManager *worker, IOManager *accept_worker)
+        : TcpServer(worker, accept_worker), m_isKeepalive(keepalive)
+    {
+        m_dispatch.reset(new ServletDispatch);
+    }
+
+    // 解析失败对应的响应码
+    static HttpStatus ParseErrorToStatus(HttpParser::Error err)
+    {
+        switch (err)
+        {
+        case HttpParser::HEADER_TOO_LARGE:
+            return HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE;
+        case HttpParser::BODY_TOO_LARGE:
+            return HttpStatus::PAYLOAD_TOO_LARGE;
+        case HttpParser::INVALID_VERSION:
+            return HttpStatus::HTTP_VERSION_NOT_SUPPORTED;
+        case HttpParser::INVALID_METHOD:
+            return HttpStatus::NOT_IMPLEMENTED;
+        default:
+            return HttpStatus::BAD_REQUEST;
+        }
+    }
+
+    void HttpServer::handleClient(Socket::ptr client)
+    {
+        HttpSession::ptr session = ObjectPool<HttpSession>::MakeShared(client);
+        for (;;)
+        {
+            HttpRequest::ptr req = session->recvRequest();
+            if (!req)
+            {
+                HttpParser::Error err = session->getParseError();
+                if (err != HttpParser::NONE)
+                {
+                    SLTJ_LOG_DEBUG(g_logger) << "recv http request fail, error=" << (int)err
+                                             << " client:" << *client;
+                    HttpResponse::ptr rsp(new HttpResponse(0x11, true));
+                    rsp->setStatus(ParseErrorToStatus(err));
+                    rsp->setHeader("Server", getName());
+                    session->sendResponse(rsp);
+                }
+                break;
+            }
+
+            HttpResponse::ptr rsp(new HttpResponse(req->getVersion(), req->isClose() || !m_isKeepalive));
+            rsp->setHeader("Server", getName());
+            m_dispatch->handle(req, rsp, session);
+            // servlet可以要求处理完后关闭连接
+            bool close = rsp->isClose();
+            // 缓冲区中还有后续请求时先不发送, 与后面的响应合并
+            // HEAD的响应不带body, 否则客户端会把body当作下一个响应的开头
+            if (!session->sendResponse(rsp, close || !session->hasBufferedInput(),
+                                       req->getMethod() == HttpMethod::HEAD) ||
+                close)
+            {
+                break;
+            }
+        }
+        session->close();
+    }
+
+} // namespace sltj
@@ -0,0 +1,33 @@
+#ifndef __SLTJ_HTTP_SERVER_H__
+#define __SLTJ_HTTP_SERVER_H__
+
+#include <memory>
+#include "tcp_server.h"
+#include "http_session.h"
+#include "servlet.h"
+
+namespace sltj
+{
+    // HTTP/1.1服务器
+    // 每个连接一个协程, 循环读取请求并交给ServletDispatch处理; keepalive为false时每个请求后关闭连接
+    class HttpServer : public TcpServer
+    {
+    public:
+        using ptr = std::shared_ptr<HttpServer>;
+
+        HttpServer(bool keepalive = true, IOManager *worker = nullptr, IOManager *accept_worker = nullptr);
+
+        ServletDispatch::ptr getServletDispatch() const { return m_dispatch; }
+        void setServletDispatch(ServletDispatch::ptr v) { m_dispatch = v; }
+
+    protected:
+        void handleClient(Socket::ptr client) override;
+
+    private:
+        bool m_isKeepalive;
+        ServletDispatch::ptr m_dispatch;
+    };
+
+} // namespace sltj
+
+#endif
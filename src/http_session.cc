@@ -0,0 +1,201 @@
+#include "http_session.h"
+#include "log.h"
+
+#include <sstream>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    // 每次接收至少留出的空间, 不足时缓冲区整理或换一块
+    static const size_t s_min_read_size = 4096;
+    // 发送缓冲区超过该大小时立即发送, 不再等待合并
+    static const size_t s_max_pending_output = 64 * 1024;
+
+    HttpSession::HttpSession(Socket::ptr sock, bool owner)
+        : SocketStream(sock, owner), m_parser(HttpParser::REQUEST)
+    {
+    }
+
+    HttpSession::~HttpSession()
+    {
+        flush();
+    }
+
+    HttpRequest::ptr HttpSession::recvRequest()
+    {
+        m_parser.reset();
+        for (;;)
+        {
+            // 先解析缓冲区中已有的数据, 流水线请求不需要再次recv
+            if (!m_in.empty())
+            {
+                m_parser.execute(m_in.data(), m_in.size());
+                if (m_parser.hasError())
+                {
+                    return nullptr;
+                }
+                if (m_parser.isFinished())
+                {
+                    break;
+                }
+            }
+
+            // 阻塞读之前把已生成的响应发出去
+            if (!m_out.empty() && !flush())
+            {
+                return nullptr;
+            }
+
+            if (readSome() <= 0)
+            {
+                return nullptr;
+            }
+        }
+
+        // 请求占用的一段作为切片交出, 之后接收的数据不会覆盖它
+        size_t used = m_parser.getNread();
+        HttpRequest::ptr req = m_parser.toRequest(m_in.slice(0, used));
+        m_in.consume(used);
+        return req;
+    }
+
+    int HttpSession::readSome()
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        for (;;)
+        {
+            char *buf = m_in.prepare(s_min_read_size);
+            int rt = m_socket->tryRecv(buf, m_in.writable());
+            if (rt > 0)
+            {
+                m_in.commit(rt);
+                return rt;
+            }
+            int err = errno;
+            if (m_in.empty())
+            {
+                m_in.clear();
+            }
+            if (rt == 0 || err != EAGAIN)
+            {
+                errno = err;
+                return rt;
+            }
+            if (!m_socket->waitReadable())
+            {
+                return -1;
+            }
+        }
+    }
+
+    bool HttpSession::sendResponse(HttpResponse::ptr rsp, bool flush, bool head)
+    {
+        std::stringstream ss;
+        rsp->dumpHead(ss);
+        std::string header = ss.str();
+        m_out.append(header.data(), header.size());
+        if (head)
+        {
+            if (flush || m_out.size() >= s_max_pending_output)
+            {
+                return this->flush();
+            }
+            return true;
+        }
+
+        HttpFileBody::ptr file = rsp->getFileBody();
+        if (file)
+        {
+            // 头部带MSG_MORE, 与随后sendfile的数据合并成满包
+            if (!flushOut(MSG_MORE))
+            {
+                return false;
+            }
+            return sendFile(file->fd, file->offset, file->length) == (int64_t)file->length;
+        }
+
+        const std::string &body = rsp->getBody();
+        // 大body不拷贝进发送缓冲区, 与头部一起writev
+        if (body.size() >= s_max_pending_output)
+        {
+            iovec iov[2];
+            iov[0].iov_base = m_out.data();
+            iov[0].iov_len = m_out.size();
+            iov[1].iov_base = (void *)body.data();
+            iov[1].iov_len = body.size();
+            size_t total = m_out.size() + body.size();
+            size_t sent = 0;
+            iovec *cur = iov;
+            size_t cnt = 2;
+            while (sent < total)
+            {
+                int rt = m_socket->send(cur, cnt);
+                if (rt <= 0)
+                {
+                    m_out.clear();
+                    return false;
+                }
+                sent += rt;
+                size_t n = rt;
+                while (cnt > 0 && n >= cur->iov_len)
+                {
+                    n -= cur->iov_len;
+                    ++cur;
+                    --cnt;
+                }
+                if (cnt > 0)
+                {
+                    cur->iov_base = (char *)cur->iov_base + n;
+                    cur->iov_len -= n;
+                }
+            }
+            m_out.clear();
+            return true;
+        }
+
+        m_out.append(body.data(), body.size());
+        if (flush || m_out.size() >= s_max_pending_output)
+        {
+            return this->flush();
+        }
+        return true;
+    }
+
+    bool HttpSession::flush()
+    {
+        return flushOut(0);
+    }
+
+    bool HttpSession::flushOut(int flags)
+    {
+        size_t sent = 0;
+        while (sent < m_out.size())
+        {
+            int rt = isConnected() ? m_socket->send(m_out.data() + sent, m_out.size() - sent, flags) : -1;
+            if (rt <= 0)
+            {
+                SLTJ_LOG_DEBUG(g_logger) << "HttpSession flush fail rt=" << rt
+                                         << " errno=" << errno << " errstr=" << strerror(errno);
+                m_out.clear();
+                return false;
+            }
+            sent += rt;
+        }
+        m_out.clear();
+        return true;
+    }
+
+    void HttpSession::close()
+    {
+        flush();
+        SocketStream::close();
+    }
+
+} // namespace sltj
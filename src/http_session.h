@@ -0,0 +1,54 @@
+#ifndef __SLTJ_HTTP_SESSION_H__
+#define __SLTJ_HTTP_SESSION_H__
+
+#include <memory>
+#include <string>
+#include "http.h"
+#include "http_parser.h"
+#include "buffer_pool.h"
+#include "socket_stream.h"
+
+namespace sltj
+{
+    // 服务端的一个HTTP连接
+    // 收发缓冲区从BufferPool借用: 只在确实有数据可读/待发送时持有缓冲页, 数据处理完即归还,
+    // 空闲的连接不占用缓冲区. 解析器直接在接收缓冲区上工作, 请求body是其中的切片, 不拷贝;
+    // 一次recv可能收到多个请求(pipelining), 剩余数据留在缓冲区供下一次recvRequest解析.
+    // 响应先写入发送缓冲区, 只有在需要阻塞读之前或显式flush时才真正发送, 这样流水线中的多个响应合并为一次写.
+    class HttpSession : public SocketStream
+    {
+    public:
+        using ptr = std::shared_ptr<HttpSession>;
+
+        HttpSession(Socket::ptr sock, bool owner = true);
+        ~HttpSession();
+
+        // 读取一个完整请求, 连接关闭/超时/解析失败返回nullptr
+        HttpRequest::ptr recvRequest();
+        // 最近一次recvRequest的解析错误, NONE表示连接关闭或超时
+        HttpParser::Error getParseError() const { return m_parser.getError(); }
+
+        // 成功返回true; flush为false时只追加到发送缓冲区
+        // 文件body在头部之后用sendfile发送, 总是立即发出
+        // head为true(响应HEAD请求)时只发送状态行和头部, Content-Length仍为body的长度
+        bool sendResponse(HttpResponse::ptr rsp, bool flush = true, bool head = false);
+        bool flush();
+        // 缓冲区中是否还有未处理的请求数据
+        bool hasBufferedInput() const { return !m_in.empty(); }
+
+        void close() override;
+
+    private:
+        bool flushOut(int flags);
+        // 接收一次数据追加到m_in; 没有数据时先归还空的接收缓冲区再等待可读
+        int readSome();
+
+    private:
+        HttpParser m_parser;
+        IOBuffer m_in;  // 接收缓冲区, 从当前请求的起始处开始
+        IOBuffer m_out; // 待发送的数据
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,209 @@
+#include "io_uring.h"
+#include "log.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static int io_uring_setup(unsigned entries, io_uring_params *p)
+    {
+        return syscall(__NR_io_uring_setup, entries, p);
+    }
+
+    static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t argsz)
+    {
+        return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+    }
+
+    static int io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+    {
+        return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+    }
+
+    IOUring::~IOUring()
+    {
+        close();
+    }
+
+    bool IOUring::init(unsigned entries, unsigned flags)
+    {
+        close();
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        p.flags = flags;
+        int fd = io_uring_setup(entries, &p);
+        if (fd < 0)
+        {
+            return false;
+        }
+        // 需要单次映射SQ/CQ环(5.4)与带超时的io_uring_enter(5.11)
+        if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG))
+        {
+            ::close(fd);
+            errno = ENOSYS;
+            return false;
+        }
+
+        size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        m_ringSize = sq_size > cq_size ? sq_size : cq_size;
+        m_ringPtr = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (m_ringPtr == MAP_FAILED)
+        {
+            int err = errno;
+            m_ringPtr = nullptr;
+            ::close(fd);
+            errno = err;
+            return false;
+        }
+        m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+        m_sqesPtr = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (m_sqesPtr == MAP_FAILED)
+        {
+            int err = errno;
+            m_sqesPtr = nullptr;
+            munmap(m_ringPtr, m_ringSize);
+            m_ringPtr = nullptr;
+            ::close(fd);
+            errno = err;
+            return false;
+        }
+
+        char *ring = (char *)m_ringPtr;
+        m_sq.head = (std::atomic<unsigned> *)(ring + p.sq_off.head);
+        m_sq.tail = (std::atomic<unsigned> *)(ring + p.sq_off.tail);
+        m_sq.mask = *(unsigned *)(ring + p.sq_off.ring_mask);
+        m_sq.entries = *(unsigned *)(ring + p.sq_off.ring_entries);
+        m_sq.array = (unsigned *)(ring + p.sq_off.array);
+        m_sq.sqes = (io_uring_sqe *)m_sqesPtr;
+        m_sq.sqeTail = m_sq.tail->load(std::memory_order_relaxed);
+        // SQ数组按槽位一一对应, 之后只需移动tail
+        for (unsigned i = 0; i < m_sq.entries; ++i)
+        {
+            m_sq.array[i] = i;
+        }
+        m_cq.head = (std::atomic<unsigned> *)(ring + p.cq_off.head);
+        m_cq.tail = (std::atomic<unsigned> *)(ring + p.cq_off.tail);
+        m_cq.mask = *(unsigned *)(ring + p.cq_off.ring_mask);
+        m_cq.cqes = (io_uring_cqe *)(ring + p.cq_off.cqes);
+
+        m_fd = fd;
+        m_features = p.features;
+        return true;
+    }
+
+    void IOUring::close()
+    {
+        if (m_sqesPtr)
+        {
+            munmap(m_sqesPtr, m_sqesSize);
+            m_sqesPtr = nullptr;
+        }
+        if (m_ringPtr)
+        {
+            munmap(m_ringPtr, m_ringSize);
+            m_ringPtr = nullptr;
+        }
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_sq = SubmitQueue();
+        m_cq = CompleteQueue();
+    }
+
+    io_uring_sqe *IOUring::getSqe()
+    {
+        unsigned head = m_sq.head->load(std::memory_order_acquire);
+        if (m_sq.sqeTail - head >= m_sq.entries)
+        {
+            return nullptr;
+        }
+        io_uring_sqe *sqe = &m_sq.sqes[m_sq.sqeTail & m_sq.mask];
+        ++m_sq.sqeTail;
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    unsigned IOUring::flush()
+    {
+        m_sq.tail->store(m_sq.sqeTail, std::memory_order_release);
+        return m_sq.sqeTail - m_sq.head->load(std::memory_order_acquire);
+    }
+
+    int IOUring::submit(unsigned to_submit, unsigned wait_nr, int64_t timeout_ms)
+    {
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        io_uring_getevents_arg arg;
+        __kernel_timespec ts;
+        void *argp = nullptr;
+        size_t argsz = 0;
+        if (wait_nr && timeout_ms >= 0)
+        {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+            memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+        int rt = io_uring_enter(m_fd, to_submit, wait_nr, flags, argp, argsz);
+        return rt < 0 ? -errno : rt;
+    }
+
+    bool IOUring::registerFiles(const int *fds, unsigned n)
+    {
+        if (io_uring_register(m_fd, IORING_REGISTER_FILES, fds, n))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "io_uring register files n=" << n << " errno=" << errno << " errstr=" << strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    bool IOUring::updateFiles(unsigned offset, const int *fds, unsigned n)
+    {
+        io_uring_files_update up;
+        memset(&up, 0, sizeof(up));
+        up.offset = offset;
+        up.fds = (uint64_t)(uintptr_t)fds;
+        if (io_uring_register(m_fd, IORING_REGISTER_FILES_UPDATE, &up, n) < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "io_uring update files offset=" << offset << " errno=" << errno << " errstr=" << strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    bool IOUring::registerBuffers(const iovec *iovs, unsigned n)
+    {
+        if (io_uring_register(m_fd, IORING_REGISTER_BUFFERS, iovs, n))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "io_uring register buffers n=" << n << " errno=" << errno << " errstr=" << strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    bool IOUring::IsSupported()
+    {
+        static int s_supported = -1;
+        if (s_supported < 0)
+        {
+            IOUring ring;
+            s_supported = ring.init(2) ? 1 : 0;
+        }
+        return s_supported == 1;
+    }
+
+} // namespace sltj
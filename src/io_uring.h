@@ -0,0 +1,100 @@
+#ifndef __SLTJ_IO_URING_H__
+#define __SLTJ_IO_URING_H__
+
+#include <atomic>
+#include <memory>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+namespace sltj
+{
+    // io_uring的薄封装, 直接用io_uring_setup/io_uring_enter/io_uring_register系统调用, 不依赖liburing
+    // 本身不加锁: getSqe/flush由调用方串行, reap由调用方串行, 两者之间以及与submit之间可以并发
+    class IOUring
+    {
+    public:
+        using ptr = std::shared_ptr<IOUring>;
+
+        IOUring() = default;
+        ~IOUring();
+        IOUring(const IOUring &) = delete;
+        IOUring &operator=(const IOUring &) = delete;
+
+        // entries为SQ大小(内核向上取整到2的幂), 失败返回false并设置errno
+        bool init(unsigned entries, unsigned flags = 0);
+        void close();
+        bool isValid() const { return m_fd >= 0; }
+        int getFd() const { return m_fd; }
+        unsigned getFeatures() const { return m_features; }
+
+        // 取一个清零的SQE, SQ满时返回nullptr(先submit再取)
+        io_uring_sqe *getSqe();
+        // SQ中还能取的SQE数
+        unsigned space() const { return m_sq.entries - (m_sq.sqeTail - m_sq.head->load(std::memory_order_acquire)); }
+        // 把已取的SQE发布给内核, 返回尚未提交的数量
+        unsigned flush();
+        // io_uring_enter: 提交to_submit个并等待至少wait_nr个完成, timeout_ms<0时不限时
+        // 返回提交的数量, 失败返回-errno(等待超时为-ETIME, 被信号打断为-EINTR)
+        int submit(unsigned to_submit, unsigned wait_nr = 0, int64_t timeout_ms = -1);
+        // 依次处理已完成的CQE, 返回数量
+        template <class F>
+        unsigned reap(F cb)
+        {
+            unsigned head = m_cq.head->load(std::memory_order_relaxed);
+            unsigned tail = m_cq.tail->load(std::memory_order_acquire);
+            unsigned n = tail - head;
+            for (; head != tail; ++head)
+            {
+                cb(m_cq.cqes[head & m_cq.mask]);
+            }
+            m_cq.head->store(tail, std::memory_order_release);
+            return n;
+        }
+        bool hasCompletions() const
+        {
+            return m_cq.tail->load(std::memory_order_acquire) != m_cq.head->load(std::memory_order_relaxed);
+        }
+
+        // 注册固定文件表(fd为-1的槽位留空), 之后SQE可带IOSQE_FIXED_FILE用槽位号代替fd
+        bool registerFiles(const int *fds, unsigned n);
+        // 替换固定文件表中从offset开始的n个槽位
+        bool updateFiles(unsigned offset, const int *fds, unsigned n);
+        // 注册固定缓冲区, 供READ_FIXED/WRITE_FIXED用buf_index引用
+        bool registerBuffers(const iovec *iovs, unsigned n);
+
+        // 当前内核是否能创建io_uring(可能被内核配置或seccomp禁用)
+        static bool IsSupported();
+
+    private:
+        struct SubmitQueue
+        {
+            std::atomic<unsigned> *head = nullptr;
+            std::atomic<unsigned> *tail = nullptr;
+            unsigned mask = 0;
+            unsigned entries = 0;
+            unsigned *array = nullptr;
+            io_uring_sqe *sqes = nullptr;
+            unsigned sqeTail = 0; // 已取出但未发布的位置
+        };
+
+        struct CompleteQueue
+        {
+            std::atomic<unsigned> *head = nullptr;
+            std::atomic<unsigned> *tail = nullptr;
+            unsigned mask = 0;
+            io_uring_cqe *cqes = nullptr;
+        };
+
+        int m_fd = -1;
+        unsigned m_features = 0;
+        void *m_ringPtr = nullptr; // SQ与CQ共用一次映射(IORING_FEAT_SINGLE_MMAP)
+        size_t m_ringSize = 0;
+        void *m_sqesPtr = nullptr;
+        size_t m_sqesSize = 0;
+        SubmitQueue m_sq;
+        CompleteQueue m_cq;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,1060 @@
+#include "iomanager.h"
+#include "config.h"
+#include "io_uring.h"
+#include "log.h"
+#include "trace.h"
+
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static sltj::ConfigVar<std::string>::ptr g_iomanager_engine =
+        sltj::Config::Lookup<std::string>("iomanager.engine", "epoll", "io engine: epoll or io_uring(falls back to epoll)");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_iomanager_uring_entries =
+        sltj::Config::Lookup<uint32_t>("iomanager.uring_entries", 256, "io_uring submission queue entries");
+
+    // io_uring的user_data: 低3位为类型, 操作类型直接存放栈上UringOp的地址(8字节对齐)
+    // 就绪/accept类型: 第3位为事件(WRITE), 4~31位为fd, 高32位为序号
+    enum UringTag
+    {
+        TAG_TICKLE = 0,
+        TAG_OP = 1,
+        TAG_POLL = 2,
+        TAG_ACCEPT = 3,
+        TAG_IGNORE = 4,
+    };
+    static const uint64_t TAG_MASK = 7;
+
+    static uint64_t EncodeUserData(UringTag tag, int fd, IOManager::Event event, uint32_t seq)
+    {
+        return ((uint64_t)seq << 32) | ((uint64_t)(uint32_t)fd << 4) | (event == IOManager::WRITE ? 8 : 0) | tag;
+    }
+
+    // 提交到io_uring的一次操作, 在发起协程的栈上, 完成后由idle写入结果并恢复协程
+    struct UringOp
+    {
+        Scheduler *scheduler = nullptr;
+        Fiber::ptr fiber;
+        int res = 0;
+        __kernel_timespec timeout;
+    } __attribute__((aligned(8)));
+
+    struct IOManager::FdContext::AcceptWait
+    {
+        Scheduler *scheduler = nullptr;
+        Fiber::ptr fiber;
+        uint32_t id = 0;
+        int reason = 0; // 0: 有新连接或出错, 否则为ETIMEDOUT/ECANCELED
+    };
+
+    void IOManager::FdContext::resumeAcceptWaiter(int reason)
+    {
+        AcceptWait *wait = acceptWaiter;
+        acceptWaiter = nullptr;
+        wait->reason = reason;
+        Scheduler *scheduler = wait->scheduler;
+        Fiber::ptr fiber;
+        fiber.swap(wait->fiber);
+        scheduler->schedule(&fiber);
+    }
+
+    IOManager::FdContext::EventContext &IOManager::FdContext::getContext(IOManager::Event event)
+    {
+        switch (event)
+        {
+        case IOManager::READ:
+            return read;
+        case IOManager::WRITE:
+            return write;
+        default:
+            throw std::invalid_argument("getContext invalid event");
+        }
+    }
+
+    void IOManager::FdContext::resetContext(EventContext &ctx)
+    {
+        ctx.scheduler = nullptr;
+        ctx.fiber.reset();
+        ctx.cb = nullptr;
+    }
+
+    void IOManager::FdContext::triggerEvent(IOManager::Event event)
+    {
+        events = (Event)(events & ~event);
+        EventContext &ctx = getContext(event);
+        if (ctx.cb)
+        {
+            ctx.scheduler->schedule(&ctx.cb);
+        }
+        else
+        {
+            ctx.scheduler->schedule(&ctx.fiber);
+        }
+        ctx.scheduler = nullptr;
+    }
+
+    IOManager::IOManager(size_t threads, const std::string &name)
+        : Scheduler(threads, name)
+    {
+        m_tickleFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_tickleFd < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "eventfd error errno=" << errno << " errstr=" << strerror(errno);
+            throw std::logic_error("eventfd error");
+        }
+
+        const std::string &engine = g_iomanager_engine->getValue();
+        if (engine == "io_uring")
+        {
+            m_ring.reset(new IOUring);
+            if (m_ring->init(g_iomanager_uring_entries->getValue()))
+            {
+                armTickle();
+                contextResize(64);
+                start();
+                return;
+            }
+            SLTJ_LOG_WARN(g_logger) << "IOManager " << getName() << " io_uring unavailable errno=" << errno
+                                    << " errstr=" << strerror(errno) << ", fall back to epoll";
+            m_ring.reset();
+        }
+        else if (engine != "epoll")
+        {
+            SLTJ_LOG_WARN(g_logger) << "IOManager unknown iomanager.engine=" << engine << ", use epoll";
+        }
+
+        m_epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epfd < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "epoll_create1 error errno=" << errno << " errstr=" << strerror(errno);
+            close(m_tickleFd);
+            throw std::logic_error("epoll_create1 error");
+        }
+
+        // data.ptr为nullptr表示唤醒事件
+        epoll_event event;
+        memset(&event, 0, sizeof(epoll_event));
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = nullptr;
+        if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_tickleFd, &event))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "epoll_ctl tickle fd error errno=" << errno << " errstr=" << strerror(errno);
+            close(m_tickleFd);
+            close(m_epfd);
+            throw std::logic_error("epoll_ctl error");
+        }
+
+        contextResize(64);
+        start();
+    }
+
+    IOManager::~IOManager()
+    {
+        stop();
+        if (m_epfd >= 0)
+        {
+            close(m_epfd);
+        }
+        if (m_ring)
+        {
+            // 关闭io_uring时内核取消仍在进行的多发accept, 已完成未收割的连接在这里关闭
+            m_ring->reap([](const io_uring_cqe &cqe) {
+                if ((cqe.user_data & TAG_MASK) == TAG_ACCEPT && cqe.res >= 0)
+                {
+                    close(cqe.res);
+                }
+            });
+            m_ring.reset();
+        }
+        close(m_tickleFd);
+
+        for (size_t i = 0; i < m_fdContexts.size(); ++i)
+        {
+            for (int fd : m_fdContexts[i]->accepted)
+            {
+                close(fd);
+            }
+            delete m_fdContexts[i];
+        }
+    }
+
+    void IOManager::contextResize(size_t size)
+    {
+        size_t old = m_fdContexts.size();
+        m_fdContexts.resize(size);
+        for (size_t i = old; i < m_fdContexts.size(); ++i)
+        {
+            m_fdContexts[i] = new FdContext;
+            m_fdContexts[i]->fd = i;
+        }
+    }
+
+    int IOManager::addEvent(int fd, Event event, std::function<void()> cb)
+    {
+        FdContext *fd_ctx = nullptr;
+        RWMutexType::ReadMutex lock(m_mutex);
+        if ((int)m_fdContexts.size() > fd)
+        {
+            fd_ctx = m_fdContexts[fd];
+            lock.unlock();
+        }
+        else
+        {
+            lock.unlock();
+            RWMutexType::WriteMutex lock2(m_mutex);
+            if ((int)m_fdContexts.size() <= fd)
+            {
+                contextResize(fd * 1.5);
+            }
+            fd_ctx = m_fdContexts[fd];
+        }
+
+        FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+        if (fd_ctx->events & event)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "addEvent assert fd=" << fd << " event=" << (int)event
+                                     << " fd_ctx.event=" << (int)fd_ctx->events;
+            return -1;
+        }
+
+        if (m_ring)
+        {
+            if (!queuePoll(fd, event, ++fd_ctx->getContext(event).seq))
+            {
+                return -1;
+            }
+            // 其他线程排队的SQE要等空闲线程下一次io_uring_enter才提交, 唤醒它
+            if (Scheduler::GetThis() != this)
+            {
+                tickle();
+            }
+        }
+        else
+        {
+            int op = fd_ctx->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+            epoll_event epevent;
+            memset(&epevent, 0, sizeof(epoll_event));
+            epevent.events = EPOLLET | fd_ctx->events | event;
+            epevent.data.ptr = fd_ctx;
+
+            int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+            if (rt)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << op << ", " << fd << ", "
+                                         << epevent.events << "):" << rt << " (" << errno << ") (" << strerror(errno) << ")";
+                return -1;
+            }
+        }
+
+        ++m_pendingEventCount;
+        fd_ctx->events = (Event)(fd_ctx->events | event);
+        FdContext::EventContext &event_ctx = fd_ctx->getContext(event);
+        // 在调度器之外(如主线程)注册时, 事件交给本IOManager调度
+        event_ctx.scheduler = Scheduler::GetThis() ? Scheduler::GetThis() : this;
+        if (cb)
+        {
+            event_ctx.cb.swap(cb);
+        }
+        else
+        {
+            event_ctx.fiber = Fiber::GetThis();
+        }
+        return 0;
+    }
+
+    bool IOManager::delEvent(int fd, Event event)
+    {
+        RWMutexType::ReadMutex lock(m_mutex);
+        if ((int)m_fdContexts.size() <= fd)
+        {
+            return false;
+        }
+        FdContext *fd_ctx = m_fdContexts[fd];
+        lock.unlock();
+
+        FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+        if (!(fd_ctx->events & event))
+        {
+            return false;
+        }
+
+        Event new_events = (Event)(fd_ctx->events & ~event);
+        if (m_ring)
+        {
+            queuePollRemove(fd, event, fd_ctx->getContext(event).seq);
+        }
+        else
+        {
+            int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+            epoll_event epevent;
+            memset(&epevent, 0, sizeof(epoll_event));
+            epevent.events = EPOLLET | new_events;
+            epevent.data.ptr = fd_ctx;
+
+            int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+            if (rt)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << op << ", " << fd << ", "
+                                         << epevent.events << "):" << rt << " (" << errno << ") (" << strerror(errno) << ")";
+                return false;
+            }
+        }
+
+        --m_pendingEventCount;
+        fd_ctx->events = new_events;
+        FdContext::EventContext &event_ctx = fd_ctx->getContext(event);
+        fd_ctx->resetContext(event_ctx);
+        return true;
+    }
+
+    bool IOManager::cancelEvent(int fd, Event event)
+    {
+        RWMutexType::ReadMutex lock(m_mutex);
+        if ((int)m_fdContexts.size() <= fd)
+        {
+            return false;
+        }
+        FdContext *fd_ctx = m_fdContexts[fd];
+        lock.unlock();
+
+        FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+        if (!(fd_ctx->events & event))
+        {
+            return false;
+        }
+
+        Event new_events = (Event)(fd_ctx->events & ~event);
+        if (m_ring)
+        {
+            queuePollRemove(fd, event, fd_ctx->getContext(event).seq);
+        }
+        else
+        {
+            int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+            epoll_event epevent;
+            memset(&epevent, 0, sizeof(epoll_event));
+            epevent.events = EPOLLET | new_events;
+            epevent.data.ptr = fd_ctx;
+
+            int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+            if (rt)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << op << ", " << fd << ", "
+                                         << epevent.events << "):" << rt << " (" << errno << ") (" << strerror(errno) << ")";
+                return false;
+            }
+        }
+
+        fd_ctx->triggerEvent(event);
+        --m_pendingEventCount;
+        return true;
+    }
+
+    bool IOManager::cancelAll(int fd)
+    {
+        if (m_ring)
+        {
+            return cancelAllUring(fd);
+        }
+        RWMutexType::ReadMutex lock(m_mutex);
+        if ((int)m_fdContexts.size() <= fd)
+        {
+            return false;
+        }
+        FdContext *fd_ctx = m_fdContexts[fd];
+        lock.unlock();
+
+        FdContext::MutexType::Lock lock2(fd_ctx->mutex);
+        if (!fd_ctx->events)
+        {
+            return false;
+        }
+
+        int op = EPOLL_CTL_DEL;
+        epoll_event epevent;
+        memset(&epevent, 0, sizeof(epoll_event));
+        epevent.events = 0;
+        epevent.data.ptr = fd_ctx;
+
+        int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+        if (rt)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << op << ", " << fd << ", "
+                                     << epevent.events << "):" << rt << " (" << errno << ") (" << strerror(errno) << ")";
+            return false;
+        }
+
+        if (fd_ctx->events & READ)
+        {
+            fd_ctx->triggerEvent(READ);
+            --m_pendingEventCount;
+        }
+        if (fd_ctx->events & WRITE)
+        {
+            fd_ctx->triggerEvent(WRITE);
+            --m_pendingEventCount;
+        }
+        return true;
+    }
+
+    IOManager *IOManager::GetThis()
+    {
+        return dynamic_cast<IOManager *>(Scheduler::GetThis());
+    }
+
+    void IOManager::tickle()
+    {
+        if (!hasIdleThreads())
+        {
+            return;
+        }
+        uint64_t one = 1;
+        ssize_t rt = write(m_tickleFd, &one, sizeof(one));
+        if (rt != sizeof(one) && errno != EAGAIN)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "tickle write error errno=" << errno << " errstr=" << strerror(errno);
+        }
+    }
+
+    bool IOManager::stopping(uint64_t &timeout)
+    {
+        timeout = getNextTimer();
+        return timeout == ~0ull && m_pendingEventCount == 0 && Scheduler::stopping();
+    }
+
+    bool IOManager::stopping()
+    {
+        uint64_t timeout = 0;
+        return stopping(timeout);
+    }
+
+    void IOManager::idle()
+    {
+        if (m_ring)
+        {
+            idleUring();
+            return;
+        }
+        const uint64_t MAX_EVENTS = 256;
+        const uint64_t MAX_TIMEOUT = 3000;
+        epoll_event *events = new epoll_event[MAX_EVENTS]();
+        std::shared_ptr<epoll_event> shared_events(events, [](epoll_event *ptr) {
+            delete[] ptr;
+        });
+
+        while (true)
+        {
+            uint64_t next_timeout = 0;
+            if (stopping(next_timeout))
+            {
+                SLTJ_LOG_DEBUG(g_logger) << "name=" << getName() << " idle stopping exit";
+                // 唤醒其他仍在epoll_wait中的线程一起退出
+                tickle();
+                break;
+            }
+
+            // 空闲计数已增加, 此时再看一次任务队列: 若schedule在此之前入队则不阻塞,
+            // 之后入队的一方必然能看到空闲线程并tickle
+            if (hasPendingTasks())
+            {
+                next_timeout = 0;
+            }
+
+            int rt = 0;
+            {
+                SLTJ_TRACE_SCOPE("IOManager::epoll_wait");
+                do
+                {
+                    next_timeout = next_timeout > MAX_TIMEOUT ? MAX_TIMEOUT : next_timeout;
+                    rt = epoll_wait(m_epfd, events, MAX_EVENTS, (int)next_timeout);
+                } while (rt < 0 && errno == EINTR);
+            }
+
+            std::vector<std::function<void()>> cbs;
+            listExpiredCb(cbs);
+            if (!cbs.empty())
+            {
+                SLTJ_TRACE_SCOPE("IOManager::timers");
+                schedule(cbs.begin(), cbs.end());
+                cbs.clear();
+            }
+
+            // 作用域都在Yield之前结束
+            for (int i = 0; i < rt; ++i)
+            {
+                SLTJ_TRACE_SCOPE("IOManager::event");
+                epoll_event &event = events[i];
+                if (event.data.ptr == nullptr)
+                {
+                    // 清空eventfd计数
+                    uint64_t dummy;
+                    while (read(m_tickleFd, &dummy, sizeof(dummy)) > 0)
+                        ;
+                    continue;
+                }
+
+                FdContext *fd_ctx = (FdContext *)event.data.ptr;
+                FdContext::MutexType::Lock lock(fd_ctx->mutex);
+                // 出错或挂断时唤醒所有已注册事件, 由上层读写得到具体错误
+                if (event.events & (EPOLLERR | EPOLLHUP))
+                {
+                    event.events |= (EPOLLIN | EPOLLOUT) & fd_ctx->events;
+                }
+                int real_events = NONE;
+                if (event.events & EPOLLIN)
+                {
+                    real_events |= READ;
+                }
+                if (event.events & EPOLLOUT)
+                {
+                    real_events |= WRITE;
+                }
+
+                if ((fd_ctx->events & real_events) == NONE)
+                {
+                    continue;
+                }
+
+                int left_events = (fd_ctx->events & ~real_events);
+                int op = left_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+                event.events = EPOLLET | left_events;
+
+                int rt2 = epoll_ctl(m_epfd, op, fd_ctx->fd, &event);
+                if (rt2)
+                {
+                    SLTJ_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << op << ", " << fd_ctx->fd << ", "
+                                             << event.events << "):" << rt2 << " (" << errno << ") (" << strerror(errno) << ")";
+                    continue;
+                }
+
+                if (real_events & READ)
+                {
+                    fd_ctx->triggerEvent(READ);
+                    --m_pendingEventCount;
+                }
+                if (real_events & WRITE)
+                {
+                    fd_ctx->triggerEvent(WRITE);
+                    --m_pendingEventCount;
+                }
+            }
+
+            Fiber::YieldToHold();
+        }
+    }
+
+    IOManager::FdContext *IOManager::getFdContext(int fd, bool auto_create)
+    {
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        RWMutexType::ReadMutex lock(m_mutex);
+        if ((int)m_fdContexts.size() > fd)
+        {
+            return m_fdContexts[fd];
+        }
+        lock.unlock();
+        if (!auto_create)
+        {
+            return nullptr;
+        }
+        RWMutexType::WriteMutex lock2(m_mutex);
+        if ((int)m_fdContexts.size() <= fd)
+        {
+            contextResize(fd * 1.5 + 1);
+        }
+        return m_fdContexts[fd];
+    }
+
+    io_uring_sqe *IOManager::getSqe(unsigned count)
+    {
+        // SQ满时先把已有的提交; CQ溢出(EBUSY)时等idle线程收割后重试
+        while (m_ring->space() < count)
+        {
+            int rt = m_ring->submit(m_ring->flush());
+            if (rt < 0 && rt != -EINTR && rt != -EBUSY && rt != -EAGAIN)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "io_uring_enter submit error errno=" << -rt << " errstr=" << strerror(-rt);
+                return nullptr;
+            }
+            if (rt <= 0)
+            {
+                usleep(100);
+            }
+        }
+        return m_ring->getSqe();
+    }
+
+    ssize_t IOManager::submitOp(io_uring_sqe &proto, int64_t timeout_ms)
+    {
+        if (!m_ring || Scheduler::GetThis() != this || Fiber::GetFiberId() == 0)
+        {
+            errno = ENOSYS;
+            return -1;
+        }
+        UringOp op;
+        op.scheduler = this;
+        op.fiber = Fiber::GetThis();
+        proto.user_data = (uint64_t)(uintptr_t)&op | TAG_OP;
+        ++m_pendingEventCount;
+        {
+            Mutex::Lock lock(m_sqMutex);
+            io_uring_sqe *sqe = getSqe(timeout_ms >= 0 ? 2 : 1);
+            if (!sqe)
+            {
+                --m_pendingEventCount;
+                errno = EAGAIN;
+                return -1;
+            }
+            *sqe = proto;
+            if (timeout_ms >= 0)
+            {
+                // 到时内核取消前面的操作, 操作以-ECANCELED完成; 超时项自身的完成不关心
+                sqe->flags |= IOSQE_IO_LINK;
+                op.timeout.tv_sec = timeout_ms / 1000;
+                op.timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+                io_uring_sqe *link = m_ring->getSqe();
+                link->opcode = IORING_OP_LINK_TIMEOUT;
+                link->addr = (uint64_t)(uintptr_t)&op.timeout;
+                link->len = 1;
+                link->user_data = TAG_IGNORE;
+            }
+            // 只发布不进内核, 由idle线程在io_uring_enter中与等待一起批量提交
+            m_ring->flush();
+        }
+        Fiber::YieldToHold();
+        if (op.res < 0)
+        {
+            errno = (timeout_ms >= 0 && op.res == -ECANCELED) ? ETIMEDOUT : -op.res;
+            return -1;
+        }
+        return op.res;
+    }
+
+    int IOManager::ioAccept(int fd, int64_t timeout_ms)
+    {
+        if (!m_ring || Scheduler::GetThis() != this || Fiber::GetFiberId() == 0)
+        {
+            errno = ENOSYS;
+            return -1;
+        }
+        FdContext *fd_ctx = getFdContext(fd, true);
+        FdContext::MutexType::Lock lock(fd_ctx->mutex);
+        if (fd_ctx->accepted.empty() && !fd_ctx->acceptError)
+        {
+            if (fd_ctx->acceptWaiter)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "ioAccept fd=" << fd << " already has a waiter";
+                errno = EBUSY;
+                return -1;
+            }
+            if (!fd_ctx->acceptArmed)
+            {
+                Mutex::Lock lock2(m_sqMutex);
+                io_uring_sqe *sqe = getSqe();
+                if (!sqe)
+                {
+                    errno = EAGAIN;
+                    return -1;
+                }
+                sqe->opcode = IORING_OP_ACCEPT;
+                sqe->fd = fd;
+                sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+                sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+                sqe->user_data = EncodeUserData(TAG_ACCEPT, fd, READ, ++fd_ctx->acceptSeq);
+                m_ring->flush();
+                fd_ctx->acceptArmed = true;
+            }
+
+            FdContext::AcceptWait wait;
+            wait.scheduler = this;
+            wait.fiber = Fiber::GetThis();
+            wait.id = ++fd_ctx->acceptWaitId;
+            fd_ctx->acceptWaiter = &wait;
+            ++m_pendingEventCount;
+            Timer::ptr timer;
+            if (timeout_ms >= 0)
+            {
+                uint32_t id = wait.id;
+                timer = addTimer(timeout_ms, [this, fd_ctx, id]() {
+                    FdContext::MutexType::Lock lock(fd_ctx->mutex);
+                    if (fd_ctx->acceptWaiter && fd_ctx->acceptWaiter->id == id)
+                    {
+                        fd_ctx->resumeAcceptWaiter(ETIMEDOUT);
+                        --m_pendingEventCount;
+                    }
+                });
+            }
+            lock.unlock();
+            Fiber::YieldToHold();
+            if (timer)
+            {
+                timer->cancel();
+            }
+            lock.lock();
+            if (wait.reason)
+            {
+                errno = wait.reason;
+                return -1;
+            }
+        }
+        if (!fd_ctx->accepted.empty())
+        {
+            int newfd = fd_ctx->accepted.front();
+            fd_ctx->accepted.pop_front();
+            return newfd;
+        }
+        errno = fd_ctx->acceptError ? fd_ctx->acceptError : EAGAIN;
+        fd_ctx->acceptError = 0;
+        return -1;
+    }
+
+    ssize_t IOManager::ioRecv(int fd, void *buf, size_t len, int flags, int64_t timeout_ms)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = fd;
+        sqe.addr = (uint64_t)(uintptr_t)buf;
+        sqe.len = len;
+        sqe.msg_flags = flags;
+        return submitOp(sqe, timeout_ms);
+    }
+
+    ssize_t IOManager::ioSend(int fd, const void *buf, size_t len, int flags, int64_t timeout_ms)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_SEND;
+        sqe.fd = fd;
+        sqe.addr = (uint64_t)(uintptr_t)buf;
+        sqe.len = len;
+        sqe.msg_flags = flags;
+        return submitOp(sqe, timeout_ms);
+    }
+
+    ssize_t IOManager::ioRecvMsg(int fd, msghdr *msg, int flags, int64_t timeout_ms)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_RECVMSG;
+        sqe.fd = fd;
+        sqe.addr = (uint64_t)(uintptr_t)msg;
+        sqe.len = 1;
+        sqe.msg_flags = flags;
+        return submitOp(sqe, timeout_ms);
+    }
+
+    ssize_t IOManager::ioSendMsg(int fd, const msghdr *msg, int flags, int64_t timeout_ms)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_SENDMSG;
+        sqe.fd = fd;
+        sqe.addr = (uint64_t)(uintptr_t)msg;
+        sqe.len = 1;
+        sqe.msg_flags = flags;
+        return submitOp(sqe, timeout_ms);
+    }
+
+    ssize_t IOManager::ioRead(int fd, void *buf, size_t len, off_t offset)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.addr = (uint64_t)(uintptr_t)buf;
+        sqe.len = len;
+        sqe.off = offset;
+        return submitOp(sqe, -1);
+    }
+
+    ssize_t IOManager::ioWrite(int fd, const void *buf, size_t len, off_t offset)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = (uint64_t)(uintptr_t)buf;
+        sqe.len = len;
+        sqe.off = offset;
+        return submitOp(sqe, -1);
+    }
+
+    int IOManager::ioFsync(int fd, bool datasync)
+    {
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_FSYNC;
+        sqe.fd = fd;
+        sqe.fsync_flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+        return submitOp(sqe, -1);
+    }
+
+    bool IOManager::queuePoll(int fd, Event event, uint32_t seq)
+    {
+        Mutex::Lock lock(m_sqMutex);
+        io_uring_sqe *sqe = getSqe();
+        if (!sqe)
+        {
+            return false;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = event == READ ? POLLIN : POLLOUT;
+        sqe->user_data = EncodeUserData(TAG_POLL, fd, event, seq);
+        m_ring->flush();
+        return true;
+    }
+
+    void IOManager::queuePollRemove(int fd, Event event, uint32_t seq)
+    {
+        Mutex::Lock lock(m_sqMutex);
+        io_uring_sqe *sqe = getSqe();
+        if (!sqe)
+        {
+            return;
+        }
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = EncodeUserData(TAG_POLL, fd, event, seq);
+        sqe->user_data = TAG_IGNORE;
+        m_ring->flush();
+    }
+
+    void IOManager::armTickle()
+    {
+        // 多发poll: tickle写eventfd时产生完成, 唤醒阻塞在io_uring_enter中的线程
+        Mutex::Lock lock(m_sqMutex);
+        io_uring_sqe *sqe = getSqe();
+        if (!sqe)
+        {
+            return;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = m_tickleFd;
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = TAG_TICKLE;
+        m_ring->flush();
+    }
+
+    bool IOManager::cancelAllUring(int fd)
+    {
+        bool rt = false;
+        FdContext *fd_ctx = getFdContext(fd, false);
+        if (fd_ctx)
+        {
+            FdContext::MutexType::Lock lock(fd_ctx->mutex);
+            if (fd_ctx->events & READ)
+            {
+                fd_ctx->triggerEvent(READ);
+                --m_pendingEventCount;
+                rt = true;
+            }
+            if (fd_ctx->events & WRITE)
+            {
+                fd_ctx->triggerEvent(WRITE);
+                --m_pendingEventCount;
+                rt = true;
+            }
+            // 未取走的连接关闭, 之后到达的多发accept完成按序号作废
+            for (int i : fd_ctx->accepted)
+            {
+                close(i);
+            }
+            fd_ctx->accepted.clear();
+            fd_ctx->acceptError = 0;
+            ++fd_ctx->acceptSeq;
+            fd_ctx->acceptArmed = false;
+            if (fd_ctx->acceptWaiter)
+            {
+                fd_ctx->resumeAcceptWaiter(ECANCELED);
+                --m_pendingEventCount;
+                rt = true;
+            }
+        }
+
+        // 取消fd上所有进行中的请求(POLL_ADD、收发、多发accept); 内核按fd号找文件,
+        // 调用方随后就会close, 所以立即提交而不是等idle批量提交
+        Mutex::Lock lock(m_sqMutex);
+        io_uring_sqe *sqe = getSqe();
+        if (!sqe)
+        {
+            return rt;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = TAG_IGNORE;
+        int n = m_ring->submit(m_ring->flush());
+        if (n < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "io_uring cancel fd=" << fd << " errno=" << -n << " errstr=" << strerror(-n);
+        }
+        return rt;
+    }
+
+    void IOManager::onCompletion(const io_uring_cqe &cqe)
+    {
+        uint64_t data = cqe.user_data;
+        switch (data & TAG_MASK)
+        {
+        case TAG_TICKLE:
+        {
+            uint64_t dummy;
+            while (read(m_tickleFd, &dummy, sizeof(dummy)) > 0)
+                ;
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+            {
+                armTickle();
+            }
+            break;
+        }
+        case TAG_OP:
+        {
+            // 调度后协程随时可能恢复并释放op, 先取出需要的成员
+            UringOp *op = (UringOp *)(uintptr_t)(data & ~TAG_MASK);
+            op->res = cqe.res;
+            Scheduler *scheduler = op->scheduler;
+            Fiber::ptr fiber;
+            fiber.swap(op->fiber);
+            scheduler->schedule(&fiber);
+            --m_pendingEventCount;
+            break;
+        }
+        case TAG_POLL:
+        {
+            FdContext *fd_ctx = getFdContext((data >> 4) & 0xfffffff, false);
+            if (!fd_ctx)
+            {
+                break;
+            }
+            Event event = (data & 8) ? WRITE : READ;
+            FdContext::MutexType::Lock lock(fd_ctx->mutex);
+            // 已删除/取消或重新注册过, 是旧POLL_ADD迟到的完成
+            if (!(fd_ctx->events & event) || fd_ctx->getContext(event).seq != (uint32_t)(data >> 32))
+            {
+                break;
+            }
+            fd_ctx->triggerEvent(event);
+            --m_pendingEventCount;
+            break;
+        }
+        case TAG_ACCEPT:
+        {
+            FdContext *fd_ctx = getFdContext((data >> 4) & 0xfffffff, false);
+            if (!fd_ctx)
+            {
+                break;
+            }
+            FdContext::MutexType::Lock lock(fd_ctx->mutex);
+            if (fd_ctx->acceptSeq != (uint32_t)(data >> 32))
+            {
+                if (cqe.res >= 0)
+                {
+                    close(cqe.res);
+                }
+                break;
+            }
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+            {
+                fd_ctx->acceptArmed = false;
+            }
+            if (cqe.res >= 0)
+            {
+                fd_ctx->accepted.push_back(cqe.res);
+            }
+            else
+            {
+                fd_ctx->acceptError = -cqe.res;
+            }
+            if (fd_ctx->acceptWaiter)
+            {
+                fd_ctx->resumeAcceptWaiter(0);
+                --m_pendingEventCount;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void IOManager::idleUring()
+    {
+        const uint64_t MAX_TIMEOUT = 3000;
+        std::vector<io_uring_cqe> cqes;
+        while (true)
+        {
+            uint64_t next_timeout = 0;
+            if (stopping(next_timeout))
+            {
+                SLTJ_LOG_DEBUG(g_logger) << "name=" << getName() << " idle stopping exit";
+                tickle();
+                break;
+            }
+            if (hasPendingTasks())
+            {
+                next_timeout = 0;
+            }
+
+            unsigned to_submit = 0;
+            {
+                Mutex::Lock lock(m_sqMutex);
+                to_submit = m_ring->flush();
+            }
+            {
+                SLTJ_TRACE_SCOPE("IOManager::io_uring_enter");
+                // 提交协程们排队的请求与等待完成合并为一次系统调用; 已有完成时不等待
+                next_timeout = next_timeout > MAX_TIMEOUT ? MAX_TIMEOUT : next_timeout;
+                unsigned wait_nr = next_timeout && !m_ring->hasCompletions() ? 1 : 0;
+                if (to_submit || wait_nr)
+                {
+                    int rt = m_ring->submit(to_submit, wait_nr, next_timeout);
+                    if (rt < 0 && rt != -ETIME && rt != -EINTR && rt != -EBUSY && rt != -EAGAIN)
+                    {
+                        SLTJ_LOG_ERROR(g_logger) << "io_uring_enter error errno=" << -rt << " errstr=" << strerror(-rt);
+                    }
+                }
+            }
+
+            std::vector<std::function<void()>> cbs;
+            listExpiredCb(cbs);
+            if (!cbs.empty())
+            {
+                SLTJ_TRACE_SCOPE("IOManager::timers");
+                schedule(cbs.begin(), cbs.end());
+                cbs.clear();
+            }
+
+            {
+                Mutex::Lock lock(m_cqMutex);
+                m_ring->reap([&cqes](const io_uring_cqe &cqe) { cqes.push_back(cqe); });
+            }
+            for (auto &i : cqes)
+            {
+                SLTJ_TRACE_SCOPE("IOManager::completion");
+                onCompletion(i);
+            }
+            cqes.clear();
+
+            Fiber::YieldToHold();
+        }
+    }
+
+    void IOManager::onTimerInsertedAtFront()
+    {
+        tickle();
+    }
+
+} // namespace sltj
@@ -0,0 +1,140 @@
+#ifndef __SLTJ_IOMANAGER_H__
+#define __SLTJ_IOMANAGER_H__
+
+#include <deque>
+#include <vector>
+#include <sys/socket.h>
+#include "scheduler.h"
+#include "timer.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace sltj
+{
+    class IOUring;
+
+    // IO调度器, 事件就绪后唤醒等待的协程/回调
+    // 引擎由配置iomanager.engine在构造时选择: epoll(边缘触发, 默认)或io_uring(不可用时退回epoll);
+    // io_uring引擎下addEvent用POLL_ADD实现, 另外提供提交后挂起到完成的ioRecv/ioSend等操作
+    class IOManager : public Scheduler, public TimerManager
+    {
+    public:
+        using ptr = std::shared_ptr<IOManager>;
+        using RWMutexType = RWMutex;
+
+        enum Event
+        {
+            NONE = 0x0,
+            READ = 0x1,  // EPOLLIN
+            WRITE = 0x4, // EPOLLOUT
+        };
+
+        enum Engine
+        {
+            EPOLL = 0,
+            IO_URING = 1,
+        };
+
+    private:
+        struct FdContext
+        {
+            using MutexType = Mutex;
+
+            // 事件触发时要恢复的协程或回调
+            struct EventContext
+            {
+                Scheduler *scheduler = nullptr;
+                Fiber::ptr fiber;
+                std::function<void()> cb;
+                uint32_t seq = 0; // io_uring: 每次注册加一, 区分已取消的POLL_ADD的迟到完成
+            };
+
+            struct AcceptWait;
+
+            EventContext &getContext(Event event);
+            void resetContext(EventContext &ctx);
+            void triggerEvent(Event event);
+            // 唤醒等待accept的协程, 调用方持有mutex
+            void resumeAcceptWaiter(int reason);
+
+            EventContext read;
+            EventContext write;
+            int fd = 0;
+            Event events = NONE; // 已注册的事件
+            MutexType mutex;
+
+            // io_uring多发accept: 内核持续接受连接, 完成的连接排队等ioAccept取走
+            std::deque<int> accepted;
+            AcceptWait *acceptWaiter = nullptr;
+            int acceptError = 0;
+            uint32_t acceptSeq = 0;    // 每次提交多发accept加一
+            uint32_t acceptWaitId = 0; // 每次等待加一, 区分超时定时器对应的等待
+            bool acceptArmed = false;
+        };
+
+    public:
+        IOManager(size_t threads = 1, const std::string &name = "");
+        ~IOManager();
+
+        // cb为空时以当前协程作为唤醒对象, 成功返回0, 失败返回-1
+        int addEvent(int fd, Event event, std::function<void()> cb = nullptr);
+        // 删除事件, 不触发
+        bool delEvent(int fd, Event event);
+        // 删除事件并立即触发一次
+        bool cancelEvent(int fd, Event event);
+        // 取消fd上全部事件并触发
+        bool cancelAll(int fd);
+
+        Engine getEngine() const { return m_ring ? IO_URING : EPOLL; }
+
+        // 以下只在io_uring引擎的协程中可用(否则失败, errno为ENOSYS): 提交后挂起当前协程, 完成时恢复
+        // 返回值同对应的系统调用, 失败返回-1并设置errno, 超时为ETIMEDOUT, 被cancelAll取消为ECANCELED
+        // 多发accept, 一次提交持续接受连接; 返回的fd为非阻塞
+        int ioAccept(int fd, int64_t timeout_ms = -1);
+        ssize_t ioRecv(int fd, void *buf, size_t len, int flags, int64_t timeout_ms = -1);
+        ssize_t ioSend(int fd, const void *buf, size_t len, int flags, int64_t timeout_ms = -1);
+        ssize_t ioRecvMsg(int fd, msghdr *msg, int flags, int64_t timeout_ms = -1);
+        ssize_t ioSendMsg(int fd, const msghdr *msg, int flags, int64_t timeout_ms = -1);
+        ssize_t ioRead(int fd, void *buf, size_t len, off_t offset);
+        ssize_t ioWrite(int fd, const void *buf, size_t len, off_t offset);
+        int ioFsync(int fd, bool datasync = false);
+
+        static IOManager *GetThis();
+
+    protected:
+        void tickle() override;
+        bool stopping() override;
+        void idle() override;
+        void onTimerInsertedAtFront() override;
+
+        void contextResize(size_t size);
+        bool stopping(uint64_t &timeout);
+
+    private:
+        FdContext *getFdContext(int fd, bool auto_create);
+        // io_uring: 取count个连续的SQE, 调用方持有m_sqMutex
+        io_uring_sqe *getSqe(unsigned count = 1);
+        ssize_t submitOp(io_uring_sqe &proto, int64_t timeout_ms);
+        bool queuePoll(int fd, Event event, uint32_t seq);
+        void queuePollRemove(int fd, Event event, uint32_t seq);
+        void armTickle();
+        bool cancelAllUring(int fd);
+        void idleUring();
+        void onCompletion(const io_uring_cqe &cqe);
+
+    private:
+        int m_epfd = -1;
+        int m_tickleFd = 0; // eventfd, 用于唤醒epoll_wait
+        std::atomic<size_t> m_pendingEventCount{0};
+        RWMutexType m_mutex;
+        std::vector<FdContext *> m_fdContexts;
+
+        std::shared_ptr<IOUring> m_ring; // 为空时是epoll引擎
+        Mutex m_sqMutex;                 // 串行取SQE
+        Mutex m_cqMutex;                 // 串行收CQE
+    };
+
+} // namespace sltj
+
+#endif
@@ -1,11 +1,22 @@
 #include "log.h"
+#include "config.h"
+#include "fiber.h"
+#include "log_index.h"
+#include "metrics.h"
+#include "ringbuffer.h"
+#include "trace.h"
 
 #include <map>
+#include <algorithm>
+#include <deque>
+#include <queue>
 #include <iostream>
 #include <functional>
 #include <time.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <sched.h>
 
 // %m -- 消息体
 // %p -- level
@@ -18,20 +29,584 @@
 // %T -- Tab
 // %F -- 协程Id
 // %N -- 日志器名字
+// %W -- 线程名
+// %X -- 日志上下文, %X{key}输出key的值, 不带key时输出全部key=value
 
 namespace sltj
 {
-    LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char *file, int32_t line, uint32_t elapse, uint32_t threadId, uint32_t fiberId, uint32_t time)
+    static sltj::ConfigVar<bool>::ptr g_log_async_enable =
+        sltj::Config::Lookup<bool>("log.async.enable", false, "write logs through per-thread buffers and a backend thread");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_log_async_buffer_size =
+        sltj::Config::Lookup<uint32_t>("log.async.buffer_size", 8192, "async log events buffered per thread");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_log_async_flush_interval =
+        sltj::Config::Lookup<uint32_t>("log.async.flush_interval", 10, "async log backend flush interval(ms)");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_log_async_merge_window =
+        sltj::Config::Lookup<uint32_t>("log.async.merge_window", 1000, "async log events newer than this(us) wait for the next round");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_log_rate_limit_report_interval =
+        sltj::Config::Lookup<uint32_t>("log.rate_limit.report_interval", 10000, "suppressed log lines summary interval(ms)");
+
+    namespace
+    {
+        // 日志自身的指标; 不析构, 其他全局对象析构时仍可能打日志
+        struct LogMetrics
+        {
+            Counter::ptr events = Metrics::Lookup<Counter>("log.events", "log events emitted");
+            Counter::ptr dropped = Metrics::Lookup<Counter>("log.dropped", "log events not written by any appender");
+            Counter::ptr bytes = Metrics::Lookup<Counter>("log.bytes", "formatted log bytes written");
+            Counter::ptr suppressed = Metrics::Lookup<Counter>("log.suppressed", "log lines suppressed by rate limiting or sampling, counted when summarized");
+        };
+
+        static LogMetrics *GetLogMetrics()
+        {
+            static LogMetrics *s_metrics = new LogMetrics;
+            return s_metrics;
+        }
+
+        // 日志上下文的键与下标; 不析构
+        struct LogContextKeys
+        {
+            RWMutex mutex;
+            std::map<std::string, size_t> indexes;
+            std::vector<std::string> keys;
+        };
+
+        static LogContextKeys *GetLogContextKeys()
+        {
+            static LogContextKeys *s_keys = new LogContextKeys;
+            return s_keys;
+        }
+
+        static FiberLocal<LogContext::Values> &GetLogContextLocal()
+        {
+            static FiberLocal<LogContext::Values> *s_local = new FiberLocal<LogContext::Values>;
+            return *s_local;
+        }
+
+        // 有过压制的调用点, 首次压制时登记; 不析构
+        struct LogSiteRegistry
+        {
+            struct Entry
+            {
+                LogSite *site;
+                Logger::ptr logger;
+                LogLevel::Level level;
+            };
+            Mutex mutex;
+            std::vector<Entry> entries;
+            bool started = false;
+            std::atomic<bool> stopping{false};
+            Semaphore wakeup;
+            Thread::ptr thread;
+        };
+
+        static LogSiteRegistry *GetLogSiteRegistry()
+        {
+            static LogSiteRegistry *s_registry = new LogSiteRegistry;
+            return s_registry;
+        }
+
+        static void LogSiteReporterMain()
+        {
+            LogSiteRegistry *r = GetLogSiteRegistry();
+            while (!r->stopping)
+            {
+                r->wakeup.waitFor(g_log_rate_limit_report_interval->getValue());
+                LogSite::ReportSuppressed();
+            }
+        }
+
+        static void StopLogSiteReporter()
+        {
+            LogSiteRegistry *r = GetLogSiteRegistry();
+            Thread::ptr thread;
+            {
+                Mutex::Lock lock(r->mutex);
+                thread.swap(r->thread);
+            }
+            if (thread)
+            {
+                r->stopping = true;
+                r->wakeup.notify();
+                thread->join();
+            }
+        }
+    } // namespace
+
+    void LogSite::suppress(const Logger::ptr &logger, LogLevel::Level level)
+    {
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+        if (m_registered.load(std::memory_order_relaxed) || m_registered.exchange(true))
+        {
+            return;
+        }
+        LogSiteRegistry *r = GetLogSiteRegistry();
+        Mutex::Lock lock(r->mutex);
+        r->entries.push_back(LogSiteRegistry::Entry{this, logger, level});
+        if (!r->started)
+        {
+            r->started = true;
+            // 退出前停下汇总线程, 避免在单例析构后打日志
+            atexit(&StopLogSiteReporter);
+            r->thread.reset(new Thread(&LogSiteReporterMain, "log_limit"));
+        }
+    }
+
+    void LogSite::ReportSuppressed()
+    {
+        LogSiteRegistry *r = GetLogSiteRegistry();
+        std::vector<LogSiteRegistry::Entry> entries;
+        {
+            Mutex::Lock lock(r->mutex);
+            entries = r->entries;
+        }
+        for (auto &i : entries)
+        {
+            uint64_t n = i.site->m_suppressed.exchange(0, std::memory_order_relaxed);
+            if (n)
+            {
+                GetLogMetrics()->suppressed->inc(n);
+                SLTJ_LOG_LEVEL(i.logger, i.level) << "suppressed " << n << " log lines at "
+                                                  << i.site->m_file << ":" << i.site->m_line;
+            }
+        }
+    }
+
+    namespace
+    {
+        static uint64_t NowNS()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+
+        struct AsyncLogItem
+        {
+            uint64_t timestamp = 0; // 入队时间, 用于归并排序
+            LogLevel::Level level = LogLevel::UNKNOW;
+            LogEvent::ptr event; // 写出时用event->getLogger(), 入队不再复制logger的引用计数
+        };
+
+        struct AsyncLogBuffer
+        {
+            using ptr = std::shared_ptr<AsyncLogBuffer>;
+
+            AsyncLogBuffer(size_t capacity) : queue(capacity) {}
+
+            SPSCRingQueue<AsyncLogItem> queue;
+            std::deque<AsyncLogItem> pending; // 已取出, 等待归并; 只由消费端访问
+            std::atomic<bool> dead{false};    // 所属线程已退出
+        };
+
+        // 队列按缓存行对齐, C++11的new不保证, 单独申请
+        static AsyncLogBuffer::ptr NewAsyncLogBuffer(size_t capacity)
+        {
+            void *mem = nullptr;
+            if (posix_memalign(&mem, alignof(AsyncLogBuffer), sizeof(AsyncLogBuffer)))
+            {
+                throw std::bad_alloc();
+            }
+            return AsyncLogBuffer::ptr(new (mem) AsyncLogBuffer(capacity), [](AsyncLogBuffer *b) {
+                b->~AsyncLogBuffer();
+                free(b);
+            });
+        }
+
+        // 不析构: 退出过程中仍可能打日志
+        struct AsyncLogState
+        {
+            Mutex mutex; // 消费端互斥: 后台线程与Flush
+            Semaphore wakeup; // 缓冲满或停止时提前唤醒后台线程
+            std::vector<AsyncLogBuffer::ptr> buffers;
+            bool started = false;
+            std::atomic<bool> stopping{false};
+            Thread::ptr thread;
+            Gauge::ptr buffersGauge = Metrics::Lookup<Gauge>("log.async.buffers", "registered async log thread buffers");
+            Counter::ptr fullWaits = Metrics::Lookup<Counter>("log.async.full_waits", "async log pushes that waited on a full buffer");
+        };
+
+        static AsyncLogState *GetAsyncLogState()
+        {
+            static AsyncLogState *s_state = new AsyncLogState;
+            return s_state;
+        }
+
+        // 生产端只读这一个共享变量
+        static std::atomic<bool> s_async_running{false};
+
+        static thread_local AsyncLogBuffer *t_async_buffer = nullptr;
+        static thread_local bool t_async_buffer_dead = false;
+        // 当前线程正在取缓冲写出(后台线程或Flush中), 此时打的日志同步写出, 避免自锁
+        static thread_local bool t_async_consumer = false;
+
+        struct AsyncLogBufferHolder
+        {
+            AsyncLogBufferHolder()
+            {
+                buffer = NewAsyncLogBuffer(g_log_async_buffer_size->getValue());
+                AsyncLogState *s = GetAsyncLogState();
+                Mutex::Lock lock(s->mutex);
+                s->buffers.push_back(buffer);
+                s->buffersGauge->set(s->buffers.size());
+                t_async_buffer = buffer.get();
+            }
+            ~AsyncLogBufferHolder()
+            {
+                buffer->dead = true;
+                t_async_buffer = nullptr;
+                t_async_buffer_dead = true;
+                // 线程退出前写出自己的日志, 缓冲随后由消费端注销
+                AsyncLog::Flush();
+            }
+            AsyncLogBuffer::ptr buffer;
+        };
+
+        static AsyncLogBuffer *GetAsyncLogBuffer()
+        {
+            if (t_async_buffer)
+            {
+                return t_async_buffer;
+            }
+            if (t_async_buffer_dead)
+            {
+                return nullptr;
+            }
+            static thread_local AsyncLogBufferHolder t_holder;
+            return t_async_buffer;
+        }
+
+        // 写入本线程缓冲, 返回false时由调用方同步写出
+        static bool AsyncLogPush(LogLevel::Level level, LogEvent::ptr &event)
+        {
+            if (!s_async_running.load(std::memory_order_relaxed) || t_async_consumer)
+            {
+                return false;
+            }
+            AsyncLogBuffer *buf = GetAsyncLogBuffer();
+            if (!buf)
+            {
+                return false;
+            }
+            AsyncLogItem item;
+            item.level = level;
+            item.event = event;
+            item.timestamp = NowNS();
+            if (!buf->queue.tryPush(std::move(item)))
+            {
+                // 满了唤醒后台线程取走, 不丢日志; 重新取时间, 保证晚于已写出的日志
+                AsyncLogState *s = GetAsyncLogState();
+                s->fullWaits->inc();
+                s->wakeup.notify();
+                do
+                {
+                    if (!s_async_running)
+                    {
+                        return false;
+                    }
+                    sched_yield();
+                    item.timestamp = NowNS();
+                } while (!buf->queue.tryPush(std::move(item)));
+            }
+            // 与Stop竞争: 停止后的最后一次写出可能已经错过本条
+            if (!s_async_running)
+            {
+                AsyncLog::Flush();
+            }
+            return true;
+        }
+
+        // 取出各缓冲的日志, 按时间戳多路归并后写出. all为false时只写出早于合并窗口的日志,
+        // 其余留到下一轮, 以免与刚取完时间戳还未入队的日志乱序. 调用方持有s->mutex
+        static void AsyncLogDrain(AsyncLogState *s, bool all)
+        {
+            uint64_t window = g_log_async_merge_window->getValue() * 1000ull;
+            uint64_t now = NowNS();
+            uint64_t cutoff = all ? UINT64_MAX : (now > window ? now - window : 0);
+
+            std::vector<bool> dead(s->buffers.size());
+            AsyncLogItem batch[64];
+            size_t n;
+            for (size_t i = 0; i < s->buffers.size(); ++i)
+            {
+                AsyncLogBuffer *buf = s->buffers[i].get();
+                // 先读dead再取日志, 线程退出前写入的日志都能取到
+                dead[i] = buf->dead;
+                while ((n = buf->queue.popBatch(batch, 64)) > 0)
+                {
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        buf->pending.push_back(std::move(batch[j]));
+                    }
+                }
+            }
+
+            // 小根堆, 元素为(队首时间戳, 缓冲下标)
+            using HeapItem = std::pair<uint64_t, size_t>;
+            std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+            for (size_t i = 0; i < s->buffers.size(); ++i)
+            {
+                if (!s->buffers[i]->pending.empty())
+                {
+                    heap.push(HeapItem(s->buffers[i]->pending.front().timestamp, i));
+                }
+            }
+            std::vector<Logger::ptr> touched;
+            while (!heap.empty() && heap.top().first <= cutoff)
+            {
+                size_t i = heap.top().second;
+                heap.pop();
+                std::deque<AsyncLogItem> &pending = s->buffers[i]->pending;
+                AsyncLogItem &item = pending.front();
+                const Logger::ptr &logger = item.event->getLogger();
+                logger->append(item.level, item.event);
+                if (std::find(touched.begin(), touched.end(), logger) == touched.end())
+                {
+                    touched.push_back(logger);
+                }
+                pending.pop_front();
+                if (!pending.empty())
+                {
+                    heap.push(HeapItem(pending.front().timestamp, i));
+                }
+            }
+            // 每轮一次写出
+            for (auto &i : touched)
+            {
+                i->flush();
+            }
+
+            size_t count = s->buffers.size();
+            for (size_t i = s->buffers.size(); i > 0; --i)
+            {
+                if (dead[i - 1] && s->buffers[i - 1]->pending.empty())
+                {
+                    s->buffers.erase(s->buffers.begin() + i - 1);
+                }
+            }
+            if (count != s->buffers.size())
+            {
+                s->buffersGauge->set(s->buffers.size());
+            }
+        }
+
+        static void AsyncLogMain()
+        {
+            t_async_consumer = true;
+            AsyncLogState *s = GetAsyncLogState();
+            while (!s->stopping)
+            {
+                s->wakeup.waitFor(g_log_async_flush_interval->getValue());
+                Mutex::Lock lock(s->mutex);
+                AsyncLogDrain(s, false);
+            }
+        }
+
+        struct AsyncLogIniter
+        {
+            AsyncLogIniter()
+            {
+                g_log_async_enable->addListener([](const bool &old_value, const bool &new_value) {
+                    if (new_value)
+                    {
+                        AsyncLog::Start();
+                    }
+                    else
+                    {
+                        AsyncLog::Stop();
+                    }
+                });
+            }
+        };
+
+        static AsyncLogIniter s_async_initer;
+    } // namespace
+
+    bool AsyncLog::Start()
+    {
+        AsyncLogState *s = GetAsyncLogState();
+        Mutex::Lock lock(s->mutex);
+        if (s->started)
+        {
+            return false;
+        }
+        static bool s_atexit = false;
+        if (!s_atexit)
+        {
+            // 在LogManager等单例析构前停下后台线程并写出剩余日志
+            atexit([]() { AsyncLog::Stop(); });
+            s_atexit = true;
+        }
+        s->started = true;
+        s->stopping = false;
+        s->thread.reset(new Thread(&AsyncLogMain, "log_async"));
+        s_async_running = true;
+        return true;
+    }
+
+    void AsyncLog::Stop()
+    {
+        AsyncLogState *s = GetAsyncLogState();
+        Thread::ptr thread;
+        {
+            Mutex::Lock lock(s->mutex);
+            if (!s->started || s->stopping)
+            {
+                return;
+            }
+            s_async_running = false;
+            s->stopping = true;
+            thread.swap(s->thread);
+        }
+        s->wakeup.notify();
+        thread->join();
+        Flush();
+        Mutex::Lock lock(s->mutex);
+        s->started = false;
+    }
+
+    bool AsyncLog::IsRunning()
+    {
+        return s_async_running;
+    }
+
+    void AsyncLog::Flush()
+    {
+        // 已持有锁(如在输出器中崩溃)时不再取缓冲
+        if (t_async_consumer)
+        {
+            return;
+        }
+        AsyncLogState *s = GetAsyncLogState();
+        Mutex::Lock lock(s->mutex);
+        t_async_consumer = true;
+        AsyncLogDrain(s, true);
+        t_async_consumer = false;
+    }
+
+    bool AsyncLog::TryFlush()
+    {
+        if (t_async_consumer)
+        {
+            return false;
+        }
+        AsyncLogState *s = GetAsyncLogState();
+        if (!s->mutex.tryLock())
+        {
+            return false;
+        }
+        t_async_consumer = true;
+        AsyncLogDrain(s, true);
+        t_async_consumer = false;
+        s->mutex.unlock();
+        return true;
+    }
+
+    LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char *file, int32_t line, uint32_t elapse, uint32_t threadId, uint32_t fiberId, uint32_t time, const std::string &threadName)
         : m_file(file),
           m_line(line),
           m_elapse(elapse),
           m_threadId(threadId),
           m_fiberId(fiberId),
           m_time(time),
+          m_threadName(threadName),
           m_logger(logger),
           m_level(level)
     {
         m_name = logger->getName();
+        m_context = LogContext::Current();
+    }
+
+    size_t LogContext::GetIndex(const std::string &key)
+    {
+        LogContextKeys *keys = GetLogContextKeys();
+        {
+            RWMutex::ReadMutex lock(keys->mutex);
+            auto it = keys->indexes.find(key);
+            if (it != keys->indexes.end())
+            {
+                return it->second;
+            }
+        }
+        RWMutex::WriteMutex lock(keys->mutex);
+        auto it = keys->indexes.find(key);
+        if (it != keys->indexes.end())
+        {
+            return it->second;
+        }
+        keys->keys.push_back(key);
+        return keys->indexes[key] = keys->keys.size() - 1;
+    }
+
+    std::string LogContext::GetKey(size_t index)
+    {
+        LogContextKeys *keys = GetLogContextKeys();
+        RWMutex::ReadMutex lock(keys->mutex);
+        return index < keys->keys.size() ? keys->keys[index] : std::string();
+    }
+
+    void LogContext::Put(const std::string &key, const std::string &value)
+    {
+        Put(GetIndex(key), value);
+    }
+
+    void LogContext::Put(size_t index, const std::string &value)
+    {
+        FiberLocal<Values> &local = GetLogContextLocal();
+        Values *cur = local.get();
+        if (value.empty() && (!cur || index >= cur->size()))
+        {
+            return;
+        }
+        // 已创建的日志事件可能还持有旧数组, 复制后替换
+        std::shared_ptr<Values> values(cur ? new Values(*cur) : new Values);
+        if (index >= values->size())
+        {
+            values->resize(index + 1);
+        }
+        (*values)[index] = value;
+        local.set(values);
+    }
+
+    std::string LogContext::Get(const std::string &key)
+    {
+        Values *cur = GetLogContextLocal().get();
+        size_t index = GetIndex(key);
+        return cur && index < cur->size() ? (*cur)[index] : std::string();
+    }
+
+    void LogContext::Remove(const std::string &key)
+    {
+        Put(GetIndex(key), std::string());
+    }
+
+    void LogContext::Clear()
+    {
+        GetLogContextLocal().reset();
+    }
+
+    LogContext::ValuesPtr LogContext::Current()
+    {
+        return GetLogContextLocal().getShared();
+    }
+
+    LogContext::Scope::Scope(const std::string &key, const std::string &value)
+        : m_index(GetIndex(key))
+    {
+        Values *cur = GetLogContextLocal().get();
+        if (cur && m_index < cur->size())
+        {
+            m_old = (*cur)[m_index];
+        }
+        Put(m_index, value);
+    }
+
+    LogContext::Scope::~Scope()
+    {
+        Put(m_index, m_old);
     }
 
     Logger::Logger(const std::string &name)
@@ -43,19 +618,39 @@ namespace sltj
 
     void Logger::log(LogLevel::Level level, LogEvent::ptr &event)
     {
+        SLTJ_TRACE_SCOPE("Logger::log");
         // 事件等级够，有appender输出日志
+        LogMetrics *metrics = GetLogMetrics();
         if (level >= m_level)
         {
-            auto self = shared_from_this();
-            MutexType::Lock lock(m_mutex);
-            if (!m_appenders.empty())
+            metrics->events->inc();
+            // 后台线程按event所属的logger写出, 交给其他logger的事件同步写出
+            if (event->getLogger().get() != this || !AsyncLogPush(level, event))
             {
-                for (auto &i : m_appenders)
-                {
-                    i->log(level, event);
-                }
+                append(level, event);
+            }
+        }
+        else
+        {
+            metrics->dropped->inc();
+        }
+    }
+
+    void Logger::append(LogLevel::Level level, LogEvent::ptr &event)
+    {
+        auto self = shared_from_this();
+        MutexType::Lock lock(m_mutex);
+        if (!m_appenders.empty())
+        {
+            for (auto &i : m_appenders)
+            {
+                i->log(level, event);
             }
         }
+        else
+        {
+            GetLogMetrics()->dropped->inc();
+        }
     }
 
     LogEventWrap::~LogEventWrap()
@@ -68,6 +663,23 @@ namespace sltj
     {
     }
 
+    size_t LogEvent::getContentSize()
+    {
+        std::streampos pos = m_ss.tellp();
+        return pos < 0 ? 0 : (size_t)pos;
+    }
+
+    size_t LogEvent::readContent(size_t offset, char *buf, size_t len)
+    {
+        std::streambuf *sb = m_ss.rdbuf();
+        if (sb->pubseekpos(offset, std::ios::in) < 0)
+        {
+            return 0;
+        }
+        std::streamsize n = sb->sgetn(buf, len);
+        return n < 0 ? 0 : n;
+    }
+
     void LogEvent::format(const char *fmt, ...)
     {
         va_list al;
@@ -75,15 +687,27 @@ namespace sltj
         format(fmt, al);
         va_end(al);
     }
+
     void LogEvent::format(const char *fmt, va_list al)
     {
-        char *buf = nullptr;
-        int len = vasprintf(&buf, fmt, al);
-        if (len != -1)
+        // 多数日志放得下栈上缓冲, 放不下时按实际长度再格式化一次
+        char buf[512];
+        va_list copy;
+        va_copy(copy, al);
+        int len = vsnprintf(buf, sizeof(buf), fmt, copy);
+        va_end(copy);
+        if (len < 0)
+        {
+            return;
+        }
+        if (len < (int)sizeof(buf))
         {
-            m_ss << std::string(buf, len);
-            free(buf);
+            m_ss.write(buf, len);
+            return;
         }
+        std::vector<char> big(len + 1);
+        vsnprintf(&big[0], big.size(), fmt, al);
+        m_ss.write(&big[0], len);
     }
 
     const char *LogLevel::ToString(LogLevel::Level level)
@@ -189,20 +813,61 @@ namespace sltj
         }
     }
 
+    void Logger::flush()
+    {
+        MutexType::Lock lock(m_mutex);
+        for (auto &i : m_appenders)
+        {
+            i->flush();
+        }
+    }
+
     void StdoutLogAppender::log(LogLevel::Level level, LogEvent::ptr event)
     {
         if (level >= m_level)
         {
+            std::string str = m_formatter->format(level, event);
             MutexType::Lock lock(m_mutex);
-            std::cout << m_formatter->format(level, event);
+            std::cout << str;
+            GetLogMetrics()->bytes->inc(str.size());
         }
     }
     void FileLogAppender::log(LogLevel::Level level, LogEvent::ptr event)
     {
         if (level >= m_level)
         {
+            std::string str = m_formatter->format(level, event);
             MutexType::Lock lock(m_mutex);
-            m_filestream << m_formatter->format(level, event);
+            if (!m_filestream.is_open() || !m_filestream)
+            {
+                GetLogMetrics()->dropped->inc();
+                return;
+            }
+            m_filestream << str;
+            if (m_index)
+            {
+                m_index->append(str.size(), event->getTime(), level);
+            }
+            GetLogMetrics()->bytes->inc(str.size());
+        }
+    }
+
+    void StdoutLogAppender::flush()
+    {
+        MutexType::Lock lock(m_mutex);
+        std::cout.flush();
+    }
+
+    void FileLogAppender::flush()
+    {
+        MutexType::Lock lock(m_mutex);
+        if (m_filestream.is_open())
+        {
+            m_filestream.flush();
+        }
+        if (m_index)
+        {
+            m_index->flush();
         }
     }
 
@@ -212,11 +877,21 @@ namespace sltj
         if (m_filestream)
             m_filestream.close();
         m_filestream.open(m_filename);
+        if (m_indexInterval)
+        {
+            m_index.reset(new LogIndexWriter(m_filename + ".idx", m_indexInterval));
+            m_index->reopen();
+        }
+        else
+        {
+            m_index.reset();
+        }
         return !!m_filestream; // !!表示非0为1,0仍然为0
     }
 
     std::string LogFormatter::format(LogLevel::Level level, LogEvent::ptr event)
     {
+        SLTJ_TRACE_SCOPE("LogFormatter::format");
         std::stringstream ss;
         for (auto &ite : m_items)
         {
@@ -355,6 +1030,57 @@ namespace sltj
         }
     };
 
+    class ThreadNameFormatItem : public LogFormatter::FormatItem
+    {
+    public:
+        ThreadNameFormatItem(const std::string &format = "")
+        {
+        }
+        void format(std::ostream &os, LogLevel::Level level, LogEvent::ptr event)
+        {
+            os << event->getThreadName();
+        }
+    };
+
+    class ContextFormatItem : public LogFormatter::FormatItem
+    {
+    public:
+        // 键在解析格式时换成下标, 输出时直接按下标取值
+        ContextFormatItem(const std::string &key = "")
+            : m_all(key.empty()), m_index(key.empty() ? 0 : LogContext::GetIndex(key))
+        {
+        }
+        void format(std::ostream &os, LogLevel::Level level, LogEvent::ptr event)
+        {
+            const LogContext::ValuesPtr &ctx = event->getContext();
+            if (!ctx)
+            {
+                return;
+            }
+            if (!m_all)
+            {
+                if (m_index < ctx->size())
+                {
+                    os << (*ctx)[m_index];
+                }
+                return;
+            }
+            bool first = true;
+            for (size_t i = 0; i < ctx->size(); ++i)
+            {
+                if (!(*ctx)[i].empty())
+                {
+                    os << (first ? "" : " ") << LogContext::GetKey(i) << "=" << (*ctx)[i];
+                    first = false;
+                }
+            }
+        }
+
+    private:
+        bool m_all;
+        size_t m_index;
+    };
+
     class StringFormatItem : public LogFormatter::FormatItem
     {
     public:
@@ -478,7 +1204,9 @@ namespace sltj
             XX(l, LineFormatItem),     // l:行号
             XX(T, TabFormatItem),      // T:Tab
             XX(F, FiberIdFormatItem),  // F:协程id
-            XX(N, NameFormatItem)      // N:日志器名字
+            XX(N, NameFormatItem),     // N:日志器名字
+            XX(W, ThreadNameFormatItem), // W:线程名
+            XX(X, ContextFormatItem)     // X:日志上下文
 
 #undef XX
         };
@@ -527,6 +1255,27 @@ namespace sltj
         return m_root;
     }
 
+    void LogManager::flush()
+    {
+        AsyncLog::Flush();
+        m_root->flush();
+        for (auto &i : m_loggers)
+        {
+            i.second->flush();
+        }
+    }
+
+    bool LogManager::tryFlush()
+    {
+        bool drained = AsyncLog::TryFlush();
+        m_root->flush();
+        for (auto &i : m_loggers)
+        {
+            i.second->flush();
+        }
+        return drained;
+    }
+
     LogFormatter::ptr LogAppender::getFormatter()
     {
         MutexType::Lock lock(m_mutex);
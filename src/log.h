@@ -11,17 +11,26 @@
 #include <iostream>
 #include <stdarg.h>
 #include <map>
+#include <atomic>
+#include <time.h>
 
 #include "singleton.h"
+#include "format.h"
 #include "util.h"
 #include "thread.h"
+#include "object_pool.h"
 
 // 流式=======================================
+// 线程id/协程id/线程名均取自thread_local缓存,不产生系统调用
+// LogEvent与shared_ptr控制块从线程缓存的对象池中一次分配
+#define SLTJ_LOG_MAKE_EVENT(logger, level)                                                                        \
+    sltj::ObjectPool<sltj::LogEvent>::MakeShared(logger, level, __FILE__, __LINE__, 0,                            \
+                                                 sltj::GetThreadId(), sltj::GetFiberId(),                         \
+                                                 time(0), sltj::Thread::GetName())
+
 #define SLTJ_LOG_LEVEL(logger, level)                                                                             \
     if (logger->getLevel() <= level)                                                                              \
-    sltj::LogEventWrap(sltj::LogEvent::ptr(new sltj::LogEvent(logger, level, __FILE__, __LINE__, 0,               \
-                                                              sltj::GetThreadId(), sltj::GetFiberId(), time(0)))) \
-        .getSS()
+    sltj::LogEventWrap(SLTJ_LOG_MAKE_EVENT(logger, level)).getSS()
 
 #define SLTJ_LOG_DEBUG(logger) SLTJ_LOG_LEVEL(logger, sltj::LogLevel::DEBUG)
 #define SLTJ_LOG_INFO(logger) SLTJ_LOG_LEVEL(logger, sltj::LogLevel::INFO)
@@ -31,12 +40,11 @@
 // ==================================================================
 
 // 格式化===============================================
+// "{}"占位符, 参数按类型写入事件内容; 字面量fmt在编译期检查占位符个数, 其他fmt运行期格式化
 #define SLTJ_LOG_FMT_LEVEL(logger, level, fmt, ...)                                                               \
     if (logger->getLevel() <= level)                                                                              \
-    sltj::LogEventWrap(sltj::LogEvent::ptr(new sltj::LogEvent(logger, level, __FILE__, __LINE__, 0,               \
-                                                              sltj::GetThreadId(), sltj::GetFiberId(), time(0)))) \
-        .getEvent()                                                                                               \
-        ->format(fmt, __VA_ARGS__)
+    SLTJ_FORMAT_CHECK(fmt, __VA_ARGS__),                                                                          \
+        sltj::LogEventWrap(SLTJ_LOG_MAKE_EVENT(logger, level)).getEvent()->formatArgs(fmt, __VA_ARGS__)
 
 #define SLTJ_LOG_FMT_DEBUG(logger, fmt, ...) SLTJ_LOG_FMT_LEVEL(logger, sltj::LogLevel::DEBUG, fmt, __VA_ARGS__)
 #define SLTJ_LOG_FMT_INFO(logger, fmt, ...) SLTJ_LOG_FMT_LEVEL(logger, sltj::LogLevel::INFO, fmt, __VA_ARGS__)
@@ -45,6 +53,23 @@
 #define SLTJ_LOG_FMT_FATAL(logger, fmt, ...) SLTJ_LOG_FMT_LEVEL(logger, sltj::LogLevel::FATAL, fmt, __VA_ARGS__)
 // ==========================================================
 
+// 限流/采样===============================================
+// 每个调用点一个静态LogSite(常量初始化, 无守卫变量), 判断只需一两次原子操作;
+// 被压制的条数由后台线程每log.rate_limit.report_interval毫秒汇总输出一次
+#define SLTJ_LOG_SITE() \
+    ([]() -> sltj::LogSite & { static sltj::LogSite s_site(__FILE__, __LINE__); return s_site; }())
+
+// 第1, n+1, 2n+1...次输出
+#define SLTJ_LOG_EVERY_N(logger, level, n)                                                                        \
+    if (logger->getLevel() <= level && SLTJ_LOG_SITE().everyN(logger, level, n))                                  \
+    sltj::LogEventWrap(SLTJ_LOG_MAKE_EVENT(logger, level)).getSS()
+
+// 令牌桶: 平均每秒最多per_sec条, 允许一秒内的突发
+#define SLTJ_LOG_RATE_LIMITED(logger, level, per_sec)                                                             \
+    if (logger->getLevel() <= level && SLTJ_LOG_SITE().rateLimit(logger, level, per_sec))                         \
+    sltj::LogEventWrap(SLTJ_LOG_MAKE_EVENT(logger, level)).getSS()
+// ==========================================================
+
 // 获得主日志器
 #define SLTJ_LOG_ROOT() sltj::LoggerMgr::GetInstance()->getRoot()
 // 获得名为name的日志器
@@ -72,6 +97,40 @@ namespace sltj
         static LogLevel::Level FromString(const std::string &string);
     };
 
+    // 日志上下文(MDC): 键值存放在当前协程的局部存储中, 随协程在工作线程间迁移, 由格式项%X{key}输出
+    // 值按键的下标存放在不可变数组中, 修改时复制一份; 日志事件创建时只持有当前数组的引用
+    class LogContext
+    {
+    public:
+        using Values = std::vector<std::string>;
+        using ValuesPtr = std::shared_ptr<const Values>;
+
+        // 键对应的下标, 第一次使用时分配
+        static size_t GetIndex(const std::string &key);
+        static std::string GetKey(size_t index);
+        // 值为空等同于删除
+        static void Put(const std::string &key, const std::string &value);
+        static void Put(size_t index, const std::string &value);
+        static std::string Get(const std::string &key);
+        static void Remove(const std::string &key);
+        // 清空当前协程的上下文
+        static void Clear();
+        // 当前协程上下文的快照, 没有设置过时为nullptr
+        static ValuesPtr Current();
+
+        // 作用域内设置key, 析构时恢复原值
+        class Scope
+        {
+        public:
+            Scope(const std::string &key, const std::string &value);
+            ~Scope();
+
+        private:
+            size_t m_index;
+            std::string m_old;
+        };
+    };
+
     // 日志事件
     class LogEvent
     {
@@ -79,7 +138,7 @@ namespace sltj
         using ptr = std::shared_ptr<LogEvent>;
         LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char *file,
                  int32_t line, uint32_t elapse, uint32_t threadId,
-                 uint32_t fiberId, uint32_t time);
+                 uint32_t fiberId, uint32_t time, const std::string &threadName);
         ~LogEvent();
 
         const char *getFile() const { return m_file; }
@@ -88,12 +147,25 @@ namespace sltj
         uint32_t getThreadId() const { return m_threadId; }
         uint32_t getFiberId() const { return m_fiberId; }
         uint32_t getTime() const { return m_time; }
-        std::string getName() const { return m_name; }
+        const std::string &getThreadName() const { return m_threadName; }
+        const std::string &getName() const { return m_name; }
         std::string getContent() const { return m_ss.str(); }
+        // 内容长度与分段读取, 不产生临时string; 读取从offset处开始
+        size_t getContentSize();
+        size_t readContent(size_t offset, char *buf, size_t len);
         std::stringstream &&getSS() { return std::move(m_ss); }
-        std::shared_ptr<Logger> getLogger() const { return m_logger; }
+        const std::shared_ptr<Logger> &getLogger() const { return m_logger; }
         LogLevel::Level getLevel() const { return m_level; }
+        // 创建事件时所在协程的日志上下文
+        const LogContext::ValuesPtr &getContext() const { return m_context; }
 
+        // "{}"占位符格式化, 直接写入内容流
+        template <class... Args>
+        void formatArgs(const char *fmt, const Args &...args)
+        {
+            FormatTo(m_ss, fmt, args...);
+        }
+        // printf风格
         void format(const char *fmt, ...);
         void format(const char *fmt, va_list al);
 
@@ -104,10 +176,12 @@ namespace sltj
         uint32_t m_threadId = 0;      // 线程ID
         uint32_t m_fiberId = 0;       // 协程ID
         uint32_t m_time;              // 时间戳
+        std::string m_threadName;     // 线程名
         std::stringstream m_ss;       // 内容
         std::string m_name;           // 日志器名称
         std::shared_ptr<Logger> m_logger;
         LogLevel::Level m_level;
+        LogContext::ValuesPtr m_context; // 异步输出时格式化在其他线程, 创建时就取下
     };
 
     class LogEventWrap
@@ -164,12 +238,14 @@ namespace sltj
         LogAppender() = default;
         virtual ~LogAppender() {}
         virtual void log(LogLevel::Level level, LogEvent::ptr event) = 0;
+        // 把已缓冲的内容写出
+        virtual void flush() {}
         void setFormatter(LogFormatter::ptr formatter) { m_formatter = formatter; }
         LogFormatter::ptr getFormatter();
         void setLevel(LogLevel::Level level) { m_level = level; }
 
     protected:
-        LogLevel::Level m_level;
+        LogLevel::Level m_level = LogLevel::DEBUG;
         LogFormatter::ptr m_formatter;
         MutexType m_mutex;
     };
@@ -184,7 +260,10 @@ namespace sltj
         Logger(const std::string &name = "root");
         ~Logger() = default;
 
+        // 异步日志开启时写入本线程的缓冲, 否则直接交给各输出器
         void log(LogLevel::Level level, LogEvent::ptr &event);
+        // 直接写到各输出器, 不经过异步缓冲
+        void append(LogLevel::Level level, LogEvent::ptr &event);
 
         void debug(LogEvent::ptr event);
         void info(LogEvent::ptr event);
@@ -194,6 +273,7 @@ namespace sltj
 
         void addAppender(LogAppender::ptr appender);
         void delAppender(LogAppender::ptr appender);
+        void flush();
         LogLevel::Level getLogLevel() const { return m_level; }
         std::string getName() const { return m_name; }
         void setLevel(LogLevel::Level level) { m_level = level; }
@@ -216,10 +296,13 @@ namespace sltj
         using ptr = std::shared_ptr<StdoutLogAppender>;
         virtual ~StdoutLogAppender() {}
         virtual void log(LogLevel::Level level, LogEvent::ptr event) override;
+        virtual void flush() override;
 
     private:
     };
 
+    class LogIndexWriter;
+
     // 输出到文件
     class FileLogAppender : public LogAppender
     {
@@ -228,11 +311,16 @@ namespace sltj
         FileLogAppender(const std::string filename) : m_filename(filename) {}
         virtual ~FileLogAppender() {}
         virtual void log(LogLevel::Level level, LogEvent::ptr event) override;
+        virtual void flush() override;
         bool reopen(); // 重新打开文件，成功返回true
+        // 每写bytes字节在"文件名.idx"中记一项稀疏索引(见log_index.h), 0表示不建索引; 在reopen前设置
+        void setIndexInterval(uint32_t bytes) { m_indexInterval = bytes; }
 
     private:
         std::string m_filename;     // 文件名
         std::ofstream m_filestream; // 文件输出流
+        uint32_t m_indexInterval = 0;
+        std::shared_ptr<LogIndexWriter> m_index;
     };
 
     class LogManager
@@ -242,6 +330,10 @@ namespace sltj
         LogManager();
         Logger::ptr getLogger(const std::string& str);
         Logger::ptr getRoot() const;
+        // 所有日志器的输出器落盘
+        void flush();
+        // 崩溃处理使用: 异步日志缓冲只在能立即取得锁时取出, 否则跳过并返回false
+        bool tryFlush();
 
         void init();
     private:
@@ -252,6 +344,77 @@ namespace sltj
 
     using LoggerMgr = sltj::SingletonPtr<LogManager>;    
 
+    // 日志调用点的限流/采样状态, 只含原子量与字面量, 可作为常量初始化的静态变量
+    class LogSite
+    {
+    public:
+        constexpr LogSite(const char *file, int32_t line) : m_file(file), m_line(line) {}
+
+        bool everyN(const Logger::ptr &logger, LogLevel::Level level, uint64_t n)
+        {
+            if (m_count.fetch_add(1, std::memory_order_relaxed) % (n ? n : 1) == 0)
+            {
+                return true;
+            }
+            suppress(logger, level);
+            return false;
+        }
+
+        // GCRA: 记录下一条的理论到达时间, 超前现在一秒以上时压制
+        bool rateLimit(const Logger::ptr &logger, LogLevel::Level level, uint32_t per_sec)
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            uint64_t now = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+            uint64_t interval = per_sec ? 1000000000ull / per_sec : UINT64_MAX / 2;
+            uint64_t tat = m_tat.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                uint64_t next = (tat > now ? tat : now) + interval;
+                if (next > now + 1000000000ull)
+                {
+                    suppress(logger, level);
+                    return false;
+                }
+                if (m_tat.compare_exchange_weak(tat, next, std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+        }
+
+        uint64_t getSuppressed() const { return m_suppressed.load(std::memory_order_relaxed); }
+
+        // 输出各调用点自上次以来被压制的条数并清零
+        static void ReportSuppressed();
+
+    private:
+        void suppress(const Logger::ptr &logger, LogLevel::Level level);
+
+    private:
+        const char *m_file;
+        int32_t m_line;
+        std::atomic<uint64_t> m_count{0};      // everyN计数
+        std::atomic<uint64_t> m_tat{0};        // rateLimit下一条的理论到达时间(ns)
+        std::atomic<uint64_t> m_suppressed{0}; // 未汇总的压制条数
+        std::atomic<bool> m_registered{false};
+    };
+
+    // 异步日志: 每个线程写自己的SPSC缓冲(首次打日志时注册, 线程退出时写出并注销),
+    // 后台线程"log_async"按入队时间戳多路归并所有缓冲后交给输出器, 输出保持全局时间序.
+    // 缓冲满时生产者等待而不丢日志. 由配置log.async.enable开关
+    class AsyncLog
+    {
+    public:
+        static bool Start();
+        static void Stop();
+        static bool IsRunning();
+        // 立即取出所有缓冲中的日志写出并刷新输出器, 不等待合并窗口
+        static void Flush();
+        // 同Flush, 但缓冲正被其他线程取出时直接返回false, 供崩溃处理使用
+        static bool TryFlush();
+    };
+
 }
 
 #endif
@@ -0,0 +1,373 @@
+#include "log_index.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static const char kIndexMagic[8] = {'S', 'L', 'T', 'J', 'I', 'D', 'X', '1'};
+
+    static void ResetBlock(LogIndexEntry &block, uint64_t offset)
+    {
+        block.offset = offset;
+        block.size = 0;
+        block.minTime = UINT32_MAX;
+        block.maxTime = 0;
+        block.levels = 0;
+    }
+
+    LogIndexWriter::LogIndexWriter(const std::string &path, uint32_t interval)
+        : m_path(path), m_interval(interval)
+    {
+        ResetBlock(m_block, 0);
+    }
+
+    bool LogIndexWriter::reopen()
+    {
+        if (m_stream.is_open())
+        {
+            m_stream.close();
+        }
+        m_stream.open(m_path, std::ios::binary | std::ios::trunc);
+        m_stream.write(kIndexMagic, sizeof(kIndexMagic));
+        m_offset = 0;
+        ResetBlock(m_block, 0);
+        return !!m_stream;
+    }
+
+    void LogIndexWriter::append(size_t size, uint32_t time, LogLevel::Level level)
+    {
+        m_block.size += size;
+        m_block.minTime = std::min(m_block.minTime, time);
+        m_block.maxTime = std::max(m_block.maxTime, time);
+        m_block.levels |= 1u << level;
+        m_offset += size;
+        if (m_block.size >= m_interval)
+        {
+            m_stream.write((const char *)&m_block, sizeof(m_block));
+            ResetBlock(m_block, m_offset);
+        }
+    }
+
+    void LogIndexWriter::flush()
+    {
+        m_stream.flush();
+    }
+
+    LogQuery::~LogQuery()
+    {
+        close();
+    }
+
+    void LogQuery::close()
+    {
+        if (m_data)
+        {
+            munmap((void *)m_data, m_size);
+            m_data = nullptr;
+        }
+        m_size = 0;
+        m_index.clear();
+        m_prefixMax.clear();
+        m_suffixMin.clear();
+    }
+
+    bool LogQuery::open(const std::string &path, bool use_index)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "LogQuery open " << path << " errno=" << errno << " errstr=" << strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st))
+        {
+            ::close(fd);
+            return false;
+        }
+        m_size = st.st_size;
+        if (m_size)
+        {
+            void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "LogQuery mmap " << path << " errno=" << errno << " errstr=" << strerror(errno);
+                ::close(fd);
+                m_size = 0;
+                return false;
+            }
+            m_data = (const char *)data;
+        }
+        ::close(fd);
+        if (!use_index)
+        {
+            return true;
+        }
+
+        std::ifstream ifs(path + ".idx", std::ios::binary);
+        char magic[sizeof(kIndexMagic)];
+        if (!ifs.read(magic, sizeof(magic)) || memcmp(magic, kIndexMagic, sizeof(magic)))
+        {
+            return true;
+        }
+        LogIndexEntry entry;
+        while (ifs.read((char *)&entry, sizeof(entry)))
+        {
+            // 索引可能比日志先落盘, 超出日志长度的项不用
+            if (entry.offset + entry.size > m_size)
+            {
+                break;
+            }
+            m_index.push_back(entry);
+        }
+        size_t n = m_index.size();
+        m_prefixMax.resize(n);
+        m_suffixMin.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            m_prefixMax[i] = i ? std::max(m_prefixMax[i - 1], m_index[i].maxTime) : m_index[i].maxTime;
+        }
+        for (size_t i = n; i-- > 0;)
+        {
+            m_suffixMin[i] = i + 1 < n ? std::min(m_suffixMin[i + 1], m_index[i].minTime) : m_index[i].minTime;
+        }
+        return true;
+    }
+
+    const char *LogQuery::Find(const char *begin, const char *end, const std::string &needle)
+    {
+        size_t k = needle.size();
+        if (!k || (size_t)(end - begin) < k)
+        {
+            return k ? nullptr : begin;
+        }
+#ifdef __SSE2__
+        if (k > 1)
+        {
+            // 同时比较needle的首尾字符, 两者都命中的位置再memcmp
+            const __m128i first = _mm_set1_epi8(needle[0]);
+            const __m128i last = _mm_set1_epi8(needle[k - 1]);
+            const char *p = begin;
+            const char *stop = end - k + 1; // 候选起点上界(不含)
+            while (p + 16 <= stop)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)p);
+                __m128i b = _mm_loadu_si128((const __m128i *)(p + k - 1));
+                unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+                while (mask)
+                {
+                    int bit = __builtin_ctz(mask);
+                    if (memcmp(p + bit + 1, needle.data() + 1, k - 2) == 0)
+                    {
+                        return p + bit;
+                    }
+                    mask &= mask - 1;
+                }
+                p += 16;
+            }
+            return (const char *)memmem(p, end - p, needle.data(), k);
+        }
+#endif
+        return (const char *)memmem(begin, end - begin, needle.data(), k);
+    }
+
+    bool LogQuery::parseTime(const char *str, size_t len, uint32_t &t)
+    {
+        // YYYY-mm-dd HH:MM:SS
+        static const char kLayout[] = "dddd-dd-dd dd:dd:dd";
+        if (len < sizeof(kLayout) - 1)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < sizeof(kLayout) - 1; ++i)
+        {
+            if (kLayout[i] == 'd' ? (str[i] < '0' || str[i] > '9') : str[i] != kLayout[i])
+            {
+                return false;
+            }
+        }
+        if (memcmp(m_hourKey, str, sizeof(m_hourKey)))
+        {
+            struct tm tm;
+            memset(&tm, 0, sizeof(tm));
+            tm.tm_year = atoi(str) - 1900;
+            tm.tm_mon = atoi(str + 5) - 1;
+            tm.tm_mday = atoi(str + 8);
+            tm.tm_hour = atoi(str + 11);
+            tm.tm_isdst = -1;
+            time_t base = mktime(&tm);
+            if (base == -1)
+            {
+                return false;
+            }
+            memcpy(m_hourKey, str, sizeof(m_hourKey));
+            m_hourBase = base;
+        }
+        t = m_hourBase + ((str[14] - '0') * 10 + (str[15] - '0')) * 60 + (str[17] - '0') * 10 + (str[18] - '0');
+        return true;
+    }
+
+    bool LogQuery::matchLine(const Filter &filter, const char *line, size_t len)
+    {
+        const char *end = line + len;
+        if (filter.from || filter.to != UINT32_MAX)
+        {
+            uint32_t t;
+            if (!parseTime(line, len, t) || t < filter.from || t > filter.to)
+            {
+                return false;
+            }
+        }
+        if (!m_levelTokens.empty())
+        {
+            bool found = false;
+            for (auto &i : m_levelTokens)
+            {
+                if (Find(line, end, i))
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+            {
+                return false;
+            }
+        }
+        if (!filter.logger.empty() && !Find(line, end, "[" + filter.logger + "]"))
+        {
+            return false;
+        }
+        if (!filter.thread.empty())
+        {
+            std::string token = "\t" + filter.thread;
+            const char *p = line;
+            bool found = false;
+            while ((p = Find(p, end, token)))
+            {
+                const char *after = p + token.size();
+                if (after == end || *after == ' ' || *after == '\t')
+                {
+                    found = true;
+                    break;
+                }
+                ++p;
+            }
+            if (!found)
+            {
+                return false;
+            }
+        }
+        return filter.text.empty() || Find(line, end, filter.text);
+    }
+
+    size_t LogQuery::query(const Filter &filter, const std::function<bool(const char *, size_t)> &cb)
+    {
+        m_scanned = 0;
+        if (!m_data)
+        {
+            return 0;
+        }
+        m_levelTokens.clear();
+        uint32_t levels = ~0u;
+        if (filter.level != LogLevel::UNKNOW)
+        {
+            levels = 0;
+            for (int i = filter.level; i <= LogLevel::FATAL; ++i)
+            {
+                levels |= 1u << i;
+                m_levelTokens.push_back(std::string("[") + LogLevel::ToString((LogLevel::Level)i) + "]");
+            }
+        }
+
+        // 选出要扫描的区间
+        std::vector<std::pair<uint64_t, uint64_t>> ranges;
+        auto add = [&ranges](uint64_t begin, uint64_t end) {
+            if (!ranges.empty() && ranges.back().second == begin)
+            {
+                ranges.back().second = end;
+            }
+            else
+            {
+                ranges.push_back(std::make_pair(begin, end));
+            }
+        };
+        uint64_t indexed = 0;
+        if (!m_index.empty())
+        {
+            size_t lo = std::lower_bound(m_prefixMax.begin(), m_prefixMax.end(), filter.from) - m_prefixMax.begin();
+            size_t hi = std::upper_bound(m_suffixMin.begin(), m_suffixMin.end(), filter.to) - m_suffixMin.begin();
+            for (size_t i = lo; i < hi; ++i)
+            {
+                const LogIndexEntry &e = m_index[i];
+                if (e.minTime <= filter.to && e.maxTime >= filter.from && (e.levels & levels))
+                {
+                    add(e.offset, e.offset + e.size);
+                }
+            }
+            indexed = m_index.back().offset + m_index.back().size;
+        }
+        if (indexed < m_size)
+        {
+            add(indexed, m_size);
+        }
+
+        // 有子串条件时先用最有区分度的子串定位, 否则逐行
+        std::string needle = !filter.text.empty() ? filter.text
+                             : !filter.logger.empty() ? "[" + filter.logger + "]"
+                             : m_levelTokens.size() == 1 ? m_levelTokens[0]
+                                                         : std::string();
+        size_t matched = 0;
+        for (auto &r : ranges)
+        {
+            const char *begin = m_data + r.first;
+            const char *end = m_data + r.second;
+            m_scanned += r.second - r.first;
+            const char *p = begin;
+            while (p < end)
+            {
+                const char *line = p;
+                if (!needle.empty())
+                {
+                    const char *hit = Find(p, end, needle);
+                    if (!hit)
+                    {
+                        break;
+                    }
+                    line = hit;
+                    while (line > begin && line[-1] != '\n')
+                    {
+                        --line;
+                    }
+                }
+                const char *eol = (const char *)memchr(line, '\n', end - line);
+                if (!eol)
+                {
+                    eol = end;
+                }
+                if (matchLine(filter, line, eol - line))
+                {
+                    ++matched;
+                    if (!cb(line, eol - line))
+                    {
+                        return matched;
+                    }
+                }
+                p = eol + 1;
+            }
+        }
+        return matched;
+    }
+
+} // namespace sltj
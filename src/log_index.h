@@ -0,0 +1,103 @@
+#ifndef __SLTJ_LOG_INDEX_H__
+#define __SLTJ_LOG_INDEX_H__
+
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "log.h"
+
+namespace sltj
+{
+    // 日志文件的稀疏索引(<日志文件>.idx): 日志每写满一块(interval字节)追加一项,
+    // 记录块在日志中的位置、块内事件时间范围(秒)与出现过的等级
+    struct LogIndexEntry
+    {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t minTime;
+        uint32_t maxTime;
+        uint32_t levels; // 1 << LogLevel::Level
+    };
+    static_assert(sizeof(LogIndexEntry) == 24, "log index entry size");
+
+    // 由FileLogAppender在写日志的同时维护; 未写满的最后一块不进索引, 查询时整块扫描
+    class LogIndexWriter
+    {
+    public:
+        using ptr = std::shared_ptr<LogIndexWriter>;
+
+        LogIndexWriter(const std::string &path, uint32_t interval);
+
+        // 截断索引, 对应日志文件从头写
+        bool reopen();
+        // 日志文件追加了size字节的一条记录
+        void append(size_t size, uint32_t time, LogLevel::Level level);
+        void flush();
+
+        const std::string &getPath() const { return m_path; }
+        uint32_t getInterval() const { return m_interval; }
+
+    private:
+        std::string m_path;
+        uint32_t m_interval;
+        std::ofstream m_stream;
+        uint64_t m_offset = 0; // 日志文件当前长度
+        LogIndexEntry m_block;  // 正在写的块
+    };
+
+    // 查询日志文件: mmap日志与索引, 用索引定位时间范围与等级相关的块, 再逐行过滤
+    class LogQuery
+    {
+    public:
+        using ptr = std::shared_ptr<LogQuery>;
+
+        // 过滤条件, 空串/默认值表示不限制; 行的格式按默认模式"时间 \t线程id ... [等级] \t [日志器] ..."
+        struct Filter
+        {
+            uint32_t from = 0;
+            uint32_t to = UINT32_MAX;
+            LogLevel::Level level = LogLevel::UNKNOW; // 不低于此等级
+            std::string logger;
+            std::string thread; // 线程id或线程名, 作为一个完整字段匹配
+            std::string text;   // 子串
+        };
+
+        LogQuery() = default;
+        ~LogQuery();
+
+        // use_index为false时不读索引, 整个文件扫描
+        bool open(const std::string &path, bool use_index = true);
+        // 对每个匹配的行(不含换行)调用cb, cb返回false时停止; 返回匹配行数
+        size_t query(const Filter &filter, const std::function<bool(const char *, size_t)> &cb);
+
+        size_t getFileSize() const { return m_size; }
+        size_t getIndexEntries() const { return m_index.size(); }
+        // 上次查询扫描过的字节数
+        uint64_t getScannedBytes() const { return m_scanned; }
+
+        // 解析行首"YYYY-mm-dd HH:MM:SS"(本地时间), 失败返回false
+        bool parseTime(const char *str, size_t len, uint32_t &t);
+        // 在[begin, end)中找needle, 用SSE2一次比较16个位置; 找不到返回nullptr
+        static const char *Find(const char *begin, const char *end, const std::string &needle);
+
+    private:
+        bool matchLine(const Filter &filter, const char *line, size_t len);
+        void close();
+
+    private:
+        const char *m_data = nullptr;
+        size_t m_size = 0;
+        std::vector<LogIndexEntry> m_index;
+        std::vector<uint32_t> m_prefixMax; // maxTime的前缀最大值, 单调不减
+        std::vector<uint32_t> m_suffixMin; // minTime的后缀最小值, 单调不减
+        uint64_t m_scanned = 0;
+        char m_hourKey[13] = {0}; // 缓存"YYYY-mm-dd HH"对应的时间戳
+        uint32_t m_hourBase = 0;
+        std::vector<std::string> m_levelTokens; // 查询时按等级过滤用的"[LEVEL]"
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __SLTJ_MACRO_H__
+#define __SLTJ_MACRO_H__
+
+#include <assert.h>
+#include <stdlib.h>
+#include "log.h"
+#include "util.h"
+
+#if defined __GNUC__ || defined __llvm__
+#define SLTJ_LIKELY(x) __builtin_expect(!!(x), 1)
+#define SLTJ_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define SLTJ_LIKELY(x) (x)
+#define SLTJ_UNLIKELY(x) (x)
+#endif
+
+// 断言失败时打印调用栈后abort(与NDEBUG无关); 装了崩溃处理时日志会先落盘. x只求值一次
+#define SLTJ_ASSERT(x)                                                                  \
+    do                                                                                  \
+    {                                                                                   \
+        if (SLTJ_UNLIKELY(!(x)))                                                        \
+        {                                                                               \
+            SLTJ_LOG_ERROR(SLTJ_LOG_ROOT()) << "ASSERTION: " #x                         \
+                                            << "\nbacktrace:\n"                         \
+                                            << sltj::BacktraceToString(100, 2, "    "); \
+            abort();                                                                    \
+        }                                                                               \
+    } while (0)
+
+#define SLTJ_ASSERT2(x, w)                                                              \
+    do                                                                                  \
+    {                                                                                   \
+        if (SLTJ_UNLIKELY(!(x)))                                                        \
+        {                                                                               \
+            SLTJ_LOG_ERROR(SLTJ_LOG_ROOT()) << "ASSERTION: " #x                         \
+                                            << "\n"                                     \
+                                            << w                                        \
+                                            << "\nbacktrace:\n"                         \
+                                            << sltj::BacktraceToString(100, 2, "    "); \
+            abort();                                                                    \
+        }                                                                               \
+    } while (0)
+
+#endif
@@ -0,0 +1,411 @@
+#include "metrics.h"
+#include "log.h"
+#include "thread.h"
+
+#include <time.h>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    namespace
+    {
+        // 空闲分片号; 进程生命周期内不析构, 线程退出时的归还总是安全的
+        struct ShardPool
+        {
+            Mutex mutex;
+            std::vector<uint32_t> free;
+            uint32_t next = 0;
+        };
+
+        static ShardPool *GetShardPool()
+        {
+            static ShardPool *s_pool = new ShardPool;
+            return s_pool;
+        }
+
+        struct Registry
+        {
+            RWMutex mutex;
+            Metrics::MetricMap metrics;
+        };
+
+        // 不析构: 其他全局对象析构时仍可能打日志/更新指标
+        static Registry *GetRegistry()
+        {
+            static Registry *s_registry = new Registry;
+            return s_registry;
+        }
+
+        static uint64_t GetMonotonicUS()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+        }
+    } // namespace
+
+    MetricShard::Holder::Holder()
+    {
+        ShardPool *pool = GetShardPool();
+        Mutex::Lock lock(pool->mutex);
+        if (!pool->free.empty())
+        {
+            idx = pool->free.back();
+            pool->free.pop_back();
+        }
+        else
+        {
+            // 超过MAX_SHARDS个线程时共用分片, 结果仍正确, 只是可能争用
+            idx = pool->next++ % MAX_SHARDS;
+        }
+    }
+
+    MetricShard::Holder::~Holder()
+    {
+        ShardPool *pool = GetShardPool();
+        Mutex::Lock lock(pool->mutex);
+        pool->free.push_back(idx);
+    }
+
+    const char *MetricBase::TypeToString(Type type)
+    {
+        switch (type)
+        {
+#define XX(name)          \
+    case MetricBase::name: \
+        return #name;
+
+            XX(COUNTER)
+            XX(GAUGE)
+            XX(HISTOGRAM)
+#undef XX
+        default:
+            return "UNKNOW";
+        }
+    }
+
+    std::string MetricBase::getPrometheusName() const
+    {
+        std::string name = m_name;
+        for (auto &c : name)
+        {
+            if (c == '.')
+            {
+                c = '_';
+            }
+        }
+        return name;
+    }
+
+    int64_t ShardedValue::sum() const
+    {
+        int64_t v = 0;
+        for (auto &c : m_cells)
+        {
+            v += c.value.load(std::memory_order_relaxed);
+        }
+        return v;
+    }
+
+    void Counter::dump(std::ostream &os)
+    {
+        os << getName() << " counter " << getValue() << "\n";
+    }
+
+    void Counter::dumpPrometheus(std::ostream &os)
+    {
+        std::string name = getPrometheusName();
+        os << "# HELP " << name << " " << getDescription() << "\n"
+           << "# TYPE " << name << " counter\n"
+           << name << " " << getValue() << "\n";
+    }
+
+    void Gauge::setCallback(Callback cb)
+    {
+        std::shared_ptr<Callback> p;
+        if (cb)
+        {
+            p.reset(new Callback(cb));
+        }
+        std::atomic_store(&m_cb, p);
+    }
+
+    int64_t Gauge::getValue()
+    {
+        std::shared_ptr<Callback> cb = std::atomic_load(&m_cb);
+        return cb ? (*cb)() : m_value.sum();
+    }
+
+    void Gauge::dump(std::ostream &os)
+    {
+        os << getName() << " gauge " << getValue() << "\n";
+    }
+
+    void Gauge::dumpPrometheus(std::ostream &os)
+    {
+        std::string name = getPrometheusName();
+        os << "# HELP " << name << " " << getDescription() << "\n"
+           << "# TYPE " << name << " gauge\n"
+           << name << " " << getValue() << "\n";
+    }
+
+    Histogram::Shard::Shard()
+    {
+        for (auto &b : buckets)
+        {
+            b.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Histogram::Histogram(const std::string &name, const std::string &description)
+        : MetricBase(name, description, HISTOGRAM)
+    {
+        for (auto &s : m_shards)
+        {
+            s.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    Histogram::~Histogram()
+    {
+        for (auto &s : m_shards)
+        {
+            delete s.load(std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t Histogram::ValueToBucket(uint64_t v)
+    {
+        if (v < SUB_BUCKETS)
+        {
+            return v;
+        }
+        if (v > MAX_VALUE)
+        {
+            v = MAX_VALUE;
+        }
+        uint32_t hb = 63 - __builtin_clzll(v);
+        uint32_t shift = hb - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + (uint32_t)(v >> shift) - SUB_BUCKETS;
+    }
+
+    uint64_t Histogram::BucketLow(uint32_t idx)
+    {
+        if (idx < SUB_BUCKETS)
+        {
+            return idx;
+        }
+        uint32_t shift = idx / SUB_BUCKETS - 1;
+        return (uint64_t)(SUB_BUCKETS + idx % SUB_BUCKETS) << shift;
+    }
+
+    uint64_t Histogram::BucketHigh(uint32_t idx)
+    {
+        if (idx < SUB_BUCKETS)
+        {
+            return idx;
+        }
+        uint32_t shift = idx / SUB_BUCKETS - 1;
+        return BucketLow(idx) + (1ull << shift) - 1;
+    }
+
+    Histogram::Shard *Histogram::getShard()
+    {
+        std::atomic<Shard *> &slot = m_shards[MetricShard::GetThis()];
+        Shard *s = slot.load(std::memory_order_acquire);
+        if (__builtin_expect(s != nullptr, 1))
+        {
+            return s;
+        }
+        // 共用分片号的线程可能同时分配
+        Shard *n = new Shard;
+        if (slot.compare_exchange_strong(s, n, std::memory_order_acq_rel))
+        {
+            return n;
+        }
+        delete n;
+        return s;
+    }
+
+    void Histogram::record(uint64_t v)
+    {
+        Shard *s = getShard();
+        s->buckets[ValueToBucket(v)].fetch_add(1, std::memory_order_relaxed);
+        s->sum.fetch_add(v, std::memory_order_relaxed);
+        uint64_t cur = s->min.load(std::memory_order_relaxed);
+        while (v < cur && !s->min.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+        {
+        }
+        cur = s->max.load(std::memory_order_relaxed);
+        while (v > cur && !s->max.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    Histogram::Snapshot Histogram::snapshot() const
+    {
+        Snapshot snap;
+        snap.buckets.resize(BUCKET_COUNT);
+        uint64_t min = UINT64_MAX;
+        for (auto &slot : m_shards)
+        {
+            Shard *s = slot.load(std::memory_order_acquire);
+            if (!s)
+            {
+                continue;
+            }
+            for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+            {
+                uint64_t n = s->buckets[i].load(std::memory_order_relaxed);
+                snap.buckets[i] += n;
+                // 计数取自桶的和, 与percentile的总数一致
+                snap.count += n;
+            }
+            snap.sum += s->sum.load(std::memory_order_relaxed);
+            min = std::min(min, s->min.load(std::memory_order_relaxed));
+            snap.max = std::max(snap.max, s->max.load(std::memory_order_relaxed));
+        }
+        snap.min = snap.count ? min : 0;
+        return snap;
+    }
+
+    uint64_t Histogram::Snapshot::percentile(double q) const
+    {
+        if (!count)
+        {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(q * count + 0.5);
+        if (rank < 1)
+        {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+            {
+                return std::min(BucketHigh(i), max);
+            }
+        }
+        return max;
+    }
+
+    void Histogram::dump(std::ostream &os)
+    {
+        Snapshot s = snapshot();
+        os << getName() << " histogram count=" << s.count
+           << " mean=" << (uint64_t)s.mean()
+           << " min=" << s.min
+           << " p50=" << s.percentile(0.5)
+           << " p99=" << s.percentile(0.99)
+           << " p999=" << s.percentile(0.999)
+           << " max=" << s.max << "\n";
+    }
+
+    // 以summary类型导出分位数
+    void Histogram::dumpPrometheus(std::ostream &os)
+    {
+        Snapshot s = snapshot();
+        std::string name = getPrometheusName();
+        os << "# HELP " << name << " " << getDescription() << "\n"
+           << "# TYPE " << name << " summary\n"
+           << name << "{quantile=\"0.5\"} " << s.percentile(0.5) << "\n"
+           << name << "{quantile=\"0.99\"} " << s.percentile(0.99) << "\n"
+           << name << "{quantile=\"0.999\"} " << s.percentile(0.999) << "\n"
+           << name << "_sum " << s.sum << "\n"
+           << name << "_count " << s.count << "\n";
+    }
+
+    MetricBase::ptr Metrics::LookupBase(const std::string &name)
+    {
+        Registry *r = GetRegistry();
+        RWMutex::ReadMutex lock(r->mutex);
+        auto it = r->metrics.find(name);
+        return it == r->metrics.end() ? nullptr : it->second;
+    }
+
+    std::vector<MetricBase::ptr> Metrics::GetAll()
+    {
+        Registry *r = GetRegistry();
+        std::vector<MetricBase::ptr> all;
+        RWMutex::ReadMutex lock(r->mutex);
+        for (auto &i : r->metrics)
+        {
+            all.push_back(i.second);
+        }
+        return all;
+    }
+
+    MetricBase::ptr Metrics::Add(MetricBase::ptr v)
+    {
+        MetricBase::ptr exist;
+        {
+            Registry *r = GetRegistry();
+            RWMutex::WriteMutex lock(r->mutex);
+            auto it = r->metrics.find(v->getName());
+            if (it == r->metrics.end())
+            {
+                r->metrics[v->getName()] = v;
+                return v;
+            }
+            exist = it->second;
+        }
+        if (exist->getType() != v->getType())
+        {
+            TypeMismatch(v->getName(), exist->getType());
+        }
+        return exist;
+    }
+
+    void Metrics::CheckName(const std::string &name)
+    {
+        if (name.empty() || name.find_first_not_of("qwertyuiopasdfghjklzxcvbnm1234567890._QWERTYUIOPASDFGHJKLZXCVBNM") != std::string::npos)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Metrics name invalid: " << name;
+            throw std::invalid_argument(name);
+        }
+    }
+
+    void Metrics::TypeMismatch(const std::string &name, MetricBase::Type type)
+    {
+        SLTJ_LOG_ERROR(g_logger) << "Metrics name=" << name << " exists as " << MetricBase::TypeToString(type);
+        throw std::invalid_argument(name);
+    }
+
+    std::string Metrics::ToString()
+    {
+        std::stringstream ss;
+        for (auto &m : GetAll())
+        {
+            m->dump(ss);
+        }
+        return ss.str();
+    }
+
+    std::string Metrics::ToPrometheus()
+    {
+        std::stringstream ss;
+        for (auto &m : GetAll())
+        {
+            m->dumpPrometheus(ss);
+        }
+        return ss.str();
+    }
+
+    ScopedLatency::ScopedLatency(Histogram *hist)
+        : m_hist(hist), m_start(GetMonotonicUS())
+    {
+    }
+
+    ScopedLatency::~ScopedLatency()
+    {
+        m_hist->record(GetMonotonicUS() - m_start);
+    }
+
+} // namespace sltj
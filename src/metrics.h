@@ -0,0 +1,245 @@
+#ifndef __SLTJ_METRICS_H__
+#define __SLTJ_METRICS_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <stdint.h>
+
+namespace sltj
+{
+    // 指标分片: 每个线程在首次更新时领取一个分片号, 线程退出后归还.
+    // 活跃线程不超过MAX_SHARDS时各线程独占分片, 更新不会在核间争用同一缓存行.
+    class MetricShard
+    {
+    public:
+        static const uint32_t MAX_SHARDS = 64;
+
+        static uint32_t GetThis()
+        {
+            static thread_local Holder t_holder;
+            return t_holder.idx;
+        }
+
+    private:
+        struct Holder
+        {
+            Holder();
+            ~Holder();
+            uint32_t idx;
+        };
+    };
+
+    class MetricBase
+    {
+    public:
+        using ptr = std::shared_ptr<MetricBase>;
+
+        enum Type
+        {
+            COUNTER,
+            GAUGE,
+            HISTOGRAM,
+        };
+
+        MetricBase(const std::string &name, const std::string &description, Type type)
+            : m_name(name), m_description(description), m_type(type) {}
+        virtual ~MetricBase() {}
+
+        const std::string &getName() const { return m_name; }
+        const std::string &getDescription() const { return m_description; }
+        Type getType() const { return m_type; }
+
+        // 一行文本: name type 值
+        virtual void dump(std::ostream &os) = 0;
+        // Prometheus文本格式, 名字中的'.'换成'_'
+        virtual void dumpPrometheus(std::ostream &os) = 0;
+
+        static const char *TypeToString(Type type);
+
+    protected:
+        std::string getPrometheusName() const;
+
+    private:
+        std::string m_name;
+        std::string m_description;
+        Type m_type;
+    };
+
+    // 分片的int64累加值, 读时求和
+    class ShardedValue
+    {
+    public:
+        void add(int64_t v)
+        {
+            m_cells[MetricShard::GetThis()].value.fetch_add(v, std::memory_order_relaxed);
+        }
+        int64_t sum() const;
+
+    private:
+        // 补齐到64字节, 相邻分片不共享缓存行
+        struct Cell
+        {
+            std::atomic<int64_t> value{0};
+            char pad[64 - sizeof(std::atomic<int64_t>)];
+        };
+        Cell m_cells[MetricShard::MAX_SHARDS];
+    };
+
+    // 只增计数器
+    class Counter : public MetricBase
+    {
+    public:
+        using ptr = std::shared_ptr<Counter>;
+
+        Counter(const std::string &name, const std::string &description)
+            : MetricBase(name, description, COUNTER) {}
+
+        void inc(uint64_t v = 1) { m_value.add(v); }
+        uint64_t getValue() const { return m_value.sum(); }
+
+        void dump(std::ostream &os) override;
+        void dumpPrometheus(std::ostream &os) override;
+
+    private:
+        ShardedValue m_value;
+    };
+
+    // 可增可减的当前值; 设置了回调时读回调
+    class Gauge : public MetricBase
+    {
+    public:
+        using ptr = std::shared_ptr<Gauge>;
+        using Callback = std::function<int64_t()>;
+
+        Gauge(const std::string &name, const std::string &description)
+            : MetricBase(name, description, GAUGE) {}
+
+        void add(int64_t v) { m_value.add(v); }
+        void inc() { m_value.add(1); }
+        void dec() { m_value.add(-1); }
+        // 与并发的add不构成原子操作, 只用于单一写者
+        void set(int64_t v) { m_value.add(v - m_value.sum()); }
+        void setCallback(Callback cb);
+        int64_t getValue();
+
+        void dump(std::ostream &os) override;
+        void dumpPrometheus(std::ostream &os) override;
+
+    private:
+        ShardedValue m_value;
+        std::shared_ptr<Callback> m_cb;
+    };
+
+    // HDR风格的对数分桶直方图: 每个2的幂区间再线性分SUB_BUCKETS个桶, 相对误差不超过1/SUB_BUCKETS.
+    // 值超过MAX_VALUE的按MAX_VALUE计. 每个分片在所属线程首次记录时分配.
+    class Histogram : public MetricBase
+    {
+    public:
+        using ptr = std::shared_ptr<Histogram>;
+
+        static const uint32_t SUB_BUCKET_BITS = 5;
+        static const uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static const uint32_t MAX_BITS = 40;
+        static const uint64_t MAX_VALUE = (1ull << MAX_BITS) - 1;
+        static const uint32_t BUCKET_COUNT = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        // 某一时刻各分片汇总的结果
+        struct Snapshot
+        {
+            uint64_t count = 0;
+            uint64_t sum = 0;
+            uint64_t min = 0;
+            uint64_t max = 0;
+            std::vector<uint64_t> buckets;
+
+            // q取0~1, 返回所在桶的上界, 不超过max
+            uint64_t percentile(double q) const;
+            double mean() const { return count ? (double)sum / count : 0; }
+        };
+
+        Histogram(const std::string &name, const std::string &description);
+        ~Histogram();
+
+        void record(uint64_t v);
+        Snapshot snapshot() const;
+
+        void dump(std::ostream &os) override;
+        void dumpPrometheus(std::ostream &os) override;
+
+        static uint32_t ValueToBucket(uint64_t v);
+        // 桶内的最小值与最大值
+        static uint64_t BucketLow(uint32_t idx);
+        static uint64_t BucketHigh(uint32_t idx);
+
+    private:
+        struct Shard
+        {
+            std::atomic<uint64_t> buckets[BUCKET_COUNT];
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> min{UINT64_MAX};
+            std::atomic<uint64_t> max{0};
+            Shard();
+        };
+        Shard *getShard();
+
+    private:
+        std::atomic<Shard *> m_shards[MetricShard::MAX_SHARDS];
+    };
+
+    // 指标注册表, 与Config::Lookup用法相同: 同名返回已有的, 类型不符抛出std::invalid_argument
+    class Metrics
+    {
+    public:
+        using MetricMap = std::map<std::string, MetricBase::ptr>;
+
+        template <class T>
+        static typename T::ptr Lookup(const std::string &name, const std::string &description = "")
+        {
+            MetricBase::ptr v = LookupBase(name);
+            if (v)
+            {
+                typename T::ptr t = std::dynamic_pointer_cast<T>(v);
+                if (!t)
+                {
+                    TypeMismatch(name, v->getType());
+                }
+                return t;
+            }
+            CheckName(name);
+            return std::static_pointer_cast<T>(Add(MetricBase::ptr(new T(name, description))));
+        }
+
+        // 已注册返回对应指标, 否则nullptr
+        static MetricBase::ptr LookupBase(const std::string &name);
+        static std::vector<MetricBase::ptr> GetAll();
+
+        static std::string ToString();
+        static std::string ToPrometheus();
+
+    private:
+        // 并发注册同名指标时返回先注册的那个
+        static MetricBase::ptr Add(MetricBase::ptr v);
+        static void CheckName(const std::string &name);
+        static void TypeMismatch(const std::string &name, MetricBase::Type type);
+    };
+
+    // 作用域结束时把经过的微秒数记入直方图
+    class ScopedLatency
+    {
+    public:
+        ScopedLatency(Histogram *hist);
+        ~ScopedLatency();
+
+    private:
+        Histogram *m_hist;
+        uint64_t m_start;
+    };
+
+} // namespace sltj
+
+#endif
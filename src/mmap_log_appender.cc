@@ -0,0 +1,355 @@
+#include "mmap_log_appender.h"
+#include "metrics.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    namespace
+    {
+        struct MmapLogMetrics
+        {
+            Counter::ptr rolls = Metrics::Lookup<Counter>("log.mmap.rolls", "mmap log segments rolled");
+            Counter::ptr rollWaits = Metrics::Lookup<Counter>("log.mmap.roll_waits", "mmap log rolls that waited for the background thread to prepare a segment");
+            Counter::ptr dropped = Metrics::Lookup<Counter>("log.mmap.dropped", "log records dropped because no mmap segment could be opened");
+        };
+
+        static MmapLogMetrics *GetMmapLogMetrics()
+        {
+            static MmapLogMetrics *s_metrics = new MmapLogMetrics;
+            return s_metrics;
+        }
+    } // namespace
+
+    // 当前线程是某个输出器的后台线程: 它打的日志不能等切段, 否则等的是自己
+    static thread_local bool t_mmap_background = false;
+
+    struct MmapLogAppender::Segment
+    {
+        uint64_t index = 0;
+        int fd = -1;
+        char *base = nullptr;
+        size_t size = 0;
+        std::atomic<size_t> offset{0};    // 已预留到的位置, 可能超过size
+        std::atomic<size_t> committed{0}; // 已拷贝完成的字节数
+        size_t end = 0;                   // 切走时的有效长度, 由越界的写入者设置
+        size_t synced = 0;                // 已msync到的位置, 只由后台线程访问
+    };
+
+    MmapLogAppender::MmapLogAppender(const std::string &path, size_t segment_size)
+        : m_path(path)
+    {
+        size_t page = sysconf(_SC_PAGESIZE);
+        m_segmentSize = (std::max(segment_size, page) + page - 1) / page * page;
+        // 跳过已有的段
+        struct stat st;
+        while (stat(getSegmentPath(m_nextIndex).c_str(), &st) == 0)
+        {
+            ++m_nextIndex;
+        }
+        m_current = openSegment();
+        m_thread.reset(new Thread(std::bind(&MmapLogAppender::run, this), "log_mmap"));
+    }
+
+    MmapLogAppender::~MmapLogAppender()
+    {
+        m_stopping = true;
+        m_wakeup.notify();
+        m_thread->join();
+
+        Segment *seg = m_current.exchange(nullptr);
+        if (seg)
+        {
+            seg->end = std::min(seg->offset.load(), seg->size);
+            m_sealing.push_back(seg);
+        }
+        for (auto &i : m_sealing)
+        {
+            while (!seal(i))
+            {
+                sched_yield();
+            }
+        }
+        if (m_next)
+        {
+            discard(m_next);
+        }
+    }
+
+    std::string MmapLogAppender::getSegmentPath(uint64_t index) const
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), ".%06lu", (unsigned long)index);
+        return m_path + buf;
+    }
+
+    uint64_t MmapLogAppender::getSegmentIndex() const
+    {
+        Segment *seg = m_current.load(std::memory_order_acquire);
+        return seg ? seg->index : 0;
+    }
+
+    void MmapLogAppender::log(LogLevel::Level level, LogEvent::ptr event)
+    {
+        if (level >= m_level)
+        {
+            std::string str = m_formatter->format(level, event);
+            if (str.empty())
+            {
+                return;
+            }
+            write(str.data(), std::min(str.size(), m_segmentSize));
+        }
+    }
+
+    void MmapLogAppender::write(const char *data, size_t len)
+    {
+        for (;;)
+        {
+            Segment *seg = m_current.load(std::memory_order_acquire);
+            if (!seg)
+            {
+                GetMmapLogMetrics()->dropped->inc();
+                return;
+            }
+            size_t off = seg->offset.fetch_add(len, std::memory_order_relaxed);
+            if (off + len <= seg->size)
+            {
+                memcpy(seg->base + off, data, len);
+                seg->committed.fetch_add(len, std::memory_order_release);
+                return;
+            }
+            if (off <= seg->size)
+            {
+                // 跨过段尾的预留只有一个, 由它切换到下一段
+                seg->end = off;
+                roll(seg);
+                continue;
+            }
+            if (t_mmap_background)
+            {
+                GetMmapLogMetrics()->dropped->inc();
+                return;
+            }
+            while (m_current.load(std::memory_order_acquire) == seg)
+            {
+                sched_yield();
+            }
+        }
+    }
+
+    void MmapLogAppender::roll(Segment *seg)
+    {
+        Segment *next = nullptr;
+        bool waited = false;
+        {
+            Mutex::Lock lock(m_mutex);
+            m_sealing.push_back(seg);
+            // 后台没来得及准备时等它打开, 不在写入线程上fallocate和映射;
+            // 其他写入者在write中等m_current切换. 后台线程自己写满时不能等自己
+            uint64_t attempts = m_openAttempts;
+            while (!m_next && m_openAttempts == attempts && !m_stopping && !t_mmap_background)
+            {
+                lock.unlock();
+                waited = true;
+                m_wakeup.notify();
+                m_prepared.waitFor(10);
+                lock.lock();
+            }
+            next = m_next;
+            m_next = nullptr;
+            // 打开失败时置空, 期间的日志丢弃, 后台下一次打开成功后恢复写入
+            m_current.store(next, std::memory_order_release);
+        }
+        if (waited)
+        {
+            GetMmapLogMetrics()->rollWaits->inc();
+        }
+        GetMmapLogMetrics()->rolls->inc();
+        m_wakeup.notify();
+    }
+
+    MmapLogAppender::Segment *MmapLogAppender::openSegment()
+    {
+        std::unique_ptr<Segment> seg(new Segment);
+        {
+            Mutex::Lock lock(m_mutex);
+            seg->index = m_nextIndex++;
+        }
+        std::string path = getSegmentPath(seg->index);
+        seg->fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (seg->fd < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "MmapLogAppender open " << path << " errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+        // 先分配磁盘块, 写入时不会因为空间不足触发SIGBUS
+        int rt = fallocate(seg->fd, 0, 0, m_segmentSize);
+        if (rt && (errno == EOPNOTSUPP || errno == ENOSYS))
+        {
+            rt = ftruncate(seg->fd, m_segmentSize);
+        }
+        if (rt)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "MmapLogAppender fallocate " << path << " size=" << m_segmentSize
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+            close(seg->fd);
+            unlink(path.c_str());
+            return nullptr;
+        }
+        // MAP_POPULATE预先建立页表, 写入线程不再缺页
+        void *base = mmap(nullptr, m_segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, seg->fd, 0);
+        if (base == MAP_FAILED)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "MmapLogAppender mmap " << path << " errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            close(seg->fd);
+            unlink(path.c_str());
+            return nullptr;
+        }
+        madvise(base, m_segmentSize, MADV_SEQUENTIAL);
+        seg->base = (char *)base;
+        seg->size = m_segmentSize;
+
+        Segment *rt_seg = seg.get();
+        Mutex::Lock lock(m_mutex);
+        m_segments.push_back(std::move(seg));
+        return rt_seg;
+    }
+
+    // 预先创建但没用上的段
+    void MmapLogAppender::discard(Segment *seg)
+    {
+        munmap(seg->base, seg->size);
+        seg->base = nullptr;
+        close(seg->fd);
+        seg->fd = -1;
+        unlink(getSegmentPath(seg->index).c_str());
+    }
+
+    bool MmapLogAppender::seal(Segment *seg)
+    {
+        if (seg->committed.load(std::memory_order_acquire) != seg->end)
+        {
+            return false;
+        }
+        if (m_syncPolicy != SYNC_NONE)
+        {
+            msync(seg->base, seg->end, m_syncPolicy == SYNC_SYNC ? MS_SYNC : MS_ASYNC);
+        }
+        munmap(seg->base, seg->size);
+        seg->base = nullptr;
+        if (ftruncate(seg->fd, seg->end))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "MmapLogAppender truncate " << getSegmentPath(seg->index)
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+        }
+        if (m_syncPolicy == SYNC_SYNC)
+        {
+            // 已落盘, 封存的日志不再占页缓存
+            fdatasync(seg->fd);
+            posix_fadvise(seg->fd, 0, seg->end, POSIX_FADV_DONTNEED);
+        }
+        close(seg->fd);
+        seg->fd = -1;
+        return true;
+    }
+
+    void MmapLogAppender::sync(Segment *seg)
+    {
+        static size_t s_page = sysconf(_SC_PAGESIZE);
+        size_t end = std::min(seg->offset.load(std::memory_order_relaxed), seg->size);
+        size_t begin = seg->synced / s_page * s_page;
+        if (end > begin)
+        {
+            msync(seg->base + begin, end - begin, m_syncPolicy == SYNC_SYNC ? MS_SYNC : MS_ASYNC);
+            seg->synced = end;
+        }
+    }
+
+    // 段可能恰好被后台封存, 此时msync返回ENOMEM, 无害
+    void MmapLogAppender::flush()
+    {
+        static size_t s_page = sysconf(_SC_PAGESIZE);
+        Segment *seg = m_current.load(std::memory_order_acquire);
+        char *base = seg ? seg->base : nullptr;
+        if (base)
+        {
+            size_t end = std::min(seg->offset.load(std::memory_order_relaxed), seg->size);
+            msync(base, (end + s_page - 1) / s_page * s_page, MS_ASYNC);
+        }
+    }
+
+    void MmapLogAppender::run()
+    {
+        t_mmap_background = true;
+        uint64_t lastSync = GetCurrentMS();
+        while (!m_stopping)
+        {
+            m_wakeup.waitFor(m_syncPolicy == SYNC_NONE ? 100 : std::min<uint64_t>(m_syncInterval, 100));
+
+            bool prepare;
+            std::vector<Segment *> sealing;
+            {
+                Mutex::Lock lock(m_mutex);
+                prepare = !m_next;
+                sealing.swap(m_sealing);
+            }
+            if (prepare && !m_stopping)
+            {
+                Segment *next = openSegment();
+                Mutex::Lock lock(m_mutex);
+                m_next = next;
+                ++m_openAttempts;
+                m_prepared.notify();
+            }
+            // 之前打开失败时, 用准备好的段恢复写入
+            {
+                Mutex::Lock lock(m_mutex);
+                if (!m_current.load(std::memory_order_relaxed) && m_next)
+                {
+                    m_current.store(m_next, std::memory_order_release);
+                    m_next = nullptr;
+                }
+            }
+
+            // 还有写入者在拷贝的段留到下一轮
+            std::vector<Segment *> busy;
+            for (auto &i : sealing)
+            {
+                if (!seal(i))
+                {
+                    busy.push_back(i);
+                }
+            }
+            if (!busy.empty())
+            {
+                Mutex::Lock lock(m_mutex);
+                m_sealing.insert(m_sealing.end(), busy.begin(), busy.end());
+            }
+
+            uint64_t now = GetCurrentMS();
+            if (m_syncPolicy != SYNC_NONE && now - lastSync >= m_syncInterval)
+            {
+                lastSync = now;
+                Segment *seg = m_current.load(std::memory_order_acquire);
+                if (seg)
+                {
+                    sync(seg);
+                }
+            }
+        }
+    }
+
+} // namespace sltj
@@ -0,0 +1,82 @@
+#ifndef __SLTJ_MMAP_LOG_APPENDER_H__
+#define __SLTJ_MMAP_LOG_APPENDER_H__
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "log.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // 按固定大小分段的mmap文件输出器, 文件名为 path.000000, path.000001, ...
+    // 写入线程用fetch_add在当前段上预留空间后直接memcpy进映射, 热路径上没有系统调用;
+    // 后台线程"log_mmap"预先分配(fallocate)并映射下一段, 封存写满的段(msync, 截断到实际长度);
+    // 切段时下一段还没准备好, 写入者等后台打开, 不在自己线程上做fallocate和映射
+    class MmapLogAppender : public LogAppender
+    {
+    public:
+        using ptr = std::shared_ptr<MmapLogAppender>;
+
+        // 持久化策略: 进程崩溃时已写入映射的数据不会丢, 策略只影响掉电/宕机
+        enum SyncPolicy
+        {
+            SYNC_NONE = 0,  // 交给内核回写
+            SYNC_ASYNC = 1, // 每个同步间隔msync(MS_ASYNC)发起回写
+            SYNC_SYNC = 2   // 每个同步间隔msync(MS_SYNC)等待落盘, 封存段后丢弃其页缓存
+        };
+
+        // segment_size向上取整到页大小; 从path下第一个不存在的段号开始写, 不覆盖已有文件
+        MmapLogAppender(const std::string &path, size_t segment_size = 64 * 1024 * 1024);
+        virtual ~MmapLogAppender();
+
+        virtual void log(LogLevel::Level level, LogEvent::ptr event) override;
+        // 对当前段已写的部分发起msync(MS_ASYNC)
+        virtual void flush() override;
+
+        void setSyncPolicy(SyncPolicy v) { m_syncPolicy = v; }
+        void setSyncInterval(uint64_t ms) { m_syncInterval = ms; }
+        const std::string &getPath() const { return m_path; }
+        size_t getSegmentSize() const { return m_segmentSize; }
+        // 第index段的文件名
+        std::string getSegmentPath(uint64_t index) const;
+        // 当前写入的段号
+        uint64_t getSegmentIndex() const;
+
+        struct Segment;
+
+    private:
+        void write(const char *data, size_t len);
+        void roll(Segment *seg);
+        Segment *openSegment();
+        // 写入者都完成后封存, 返回false表示还有写入者在拷贝
+        bool seal(Segment *seg);
+        void discard(Segment *seg);
+        void sync(Segment *seg);
+        void run();
+
+    private:
+        std::string m_path;
+        size_t m_segmentSize;
+        SyncPolicy m_syncPolicy = SYNC_NONE;
+        uint64_t m_syncInterval = 1000;
+
+        std::atomic<Segment *> m_current{nullptr};
+        Mutex m_mutex;                   // 保护以下成员
+        uint64_t m_nextIndex = 0;        // 下一个要创建的段号
+        Segment *m_next = nullptr;       // 预先映射好的下一段
+        uint64_t m_openAttempts = 0;     // 后台打开下一段的次数(含失败), 切段时据此判断是否已尝试过
+        std::vector<Segment *> m_sealing; // 已切走待封存
+        // 封存后的段结构不释放(只有几十字节): 停顿的写入者可能还持有指针
+        std::vector<std::unique_ptr<Segment>> m_segments;
+
+        Semaphore m_wakeup;
+        Semaphore m_prepared; // 后台打开下一段后通知等待切段的写入者
+        std::atomic<bool> m_stopping{false};
+        Thread::ptr m_thread;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,366 @@
+#include "object_pool.h"
+#include "thread.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <set>
+#include <algorithm>
+
+namespace sltj
+{
+    // 大小级别: 128以内按16递增, 之后每翻一倍分4级
+    static const size_t s_class_sizes[] = {
+        16, 32, 48, 64, 80, 96, 112, 128,
+        160, 192, 224, 256,
+        320, 384, 448, 512,
+        640, 768, 896, 1024};
+    static const size_t CLASS_COUNT = sizeof(s_class_sizes) / sizeof(s_class_sizes[0]);
+    static const size_t SLAB_SIZE = 64 * 1024;
+
+    // 不用查表: 静态初始化期间(其他编译单元的全局对象构造中)也可能分配
+    static inline size_t SizeToClass(size_t size)
+    {
+        if (size <= 128)
+        {
+            return (size - 1) >> 4;
+        }
+        size_t hb = 63 - __builtin_clzl(size - 1);
+        return 8 + (hb - 7) * 4 + ((size - 1) >> (hb - 2)) - 4;
+    }
+
+    // 线程缓存与全局链表之间每次搬移的对象数
+    static inline uint32_t BatchSize(size_t cls)
+    {
+        return std::max<size_t>(4, std::min<size_t>(64, 16384 / s_class_sizes[cls]));
+    }
+
+    // 只由所属线程写, 统计时由其他线程读
+    static inline void Bump(std::atomic<uint64_t> &c)
+    {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    namespace
+    {
+        struct FreeObject
+        {
+            FreeObject *next;
+        };
+
+        struct Counters
+        {
+            std::atomic<uint64_t> allocs{0};
+            std::atomic<uint64_t> frees{0};
+            std::atomic<uint64_t> hits{0};
+        };
+
+        // 某一级别的全局空闲链表
+        struct CentralList
+        {
+            SpinLock mutex;
+            FreeObject *head = nullptr;
+            uint64_t count = 0;
+            std::atomic<uint64_t> slabs{0};
+        };
+
+        class ThreadCache;
+
+        struct Central
+        {
+            CentralList lists[CLASS_COUNT];
+            // 线程登记与退出线程的统计
+            Mutex mutex;
+            std::set<ThreadCache *> caches;
+            Counters retired[CLASS_COUNT];
+            std::atomic<uint64_t> reserved{0};
+            std::atomic<uint64_t> largeAllocs{0};
+            std::atomic<int64_t> largeBytes{0};
+
+            // 取最多n个对象串成链表, 返回实际个数
+            uint32_t fetch(size_t cls, uint32_t n, FreeObject *&head)
+            {
+                CentralList &l = lists[cls];
+                SpinLock::Lock lock(l.mutex);
+                if (!l.head)
+                {
+                    carve(cls, l);
+                }
+                head = l.head;
+                FreeObject *tail = head;
+                uint32_t got = 1;
+                while (got < n && tail->next)
+                {
+                    tail = tail->next;
+                    ++got;
+                }
+                l.head = tail->next;
+                l.count -= got;
+                tail->next = nullptr;
+                return got;
+            }
+
+            void release(size_t cls, FreeObject *head, FreeObject *tail, uint32_t n)
+            {
+                CentralList &l = lists[cls];
+                SpinLock::Lock lock(l.mutex);
+                tail->next = l.head;
+                l.head = head;
+                l.count += n;
+            }
+
+            // 切分一个新的slab挂到全局链表, 调用方持有l.mutex
+            void carve(size_t cls, CentralList &l)
+            {
+                char *slab = (char *)malloc(SLAB_SIZE);
+                if (!slab)
+                {
+                    throw std::bad_alloc();
+                }
+                size_t size = s_class_sizes[cls];
+                size_t n = SLAB_SIZE / size;
+                for (size_t i = n; i > 0; --i)
+                {
+                    FreeObject *obj = (FreeObject *)(slab + (i - 1) * size);
+                    obj->next = l.head;
+                    l.head = obj;
+                }
+                l.count += n;
+                l.slabs.fetch_add(1, std::memory_order_relaxed);
+                reserved.fetch_add(SLAB_SIZE, std::memory_order_relaxed);
+            }
+        };
+
+        // 进程生命周期内不析构, 线程退出时的归还总是安全的
+        static Central *GetCentral()
+        {
+            static Central *s_central = new Central;
+            return s_central;
+        }
+
+        class ThreadCache
+        {
+        public:
+            struct FreeList
+            {
+                FreeObject *head = nullptr;
+                uint32_t count = 0;
+            };
+
+            ThreadCache()
+            {
+                Central *c = GetCentral();
+                Mutex::Lock lock(c->mutex);
+                c->caches.insert(this);
+            }
+
+            // 线程退出: 空闲对象还给全局链表, 统计并入retired
+            ~ThreadCache()
+            {
+                Central *c = GetCentral();
+                for (size_t i = 0; i < CLASS_COUNT; ++i)
+                {
+                    FreeList &fl = lists[i];
+                    if (fl.head)
+                    {
+                        FreeObject *tail = fl.head;
+                        while (tail->next)
+                        {
+                            tail = tail->next;
+                        }
+                        c->release(i, fl.head, tail, fl.count);
+                        fl.head = nullptr;
+                        fl.count = 0;
+                    }
+                }
+                Mutex::Lock lock(c->mutex);
+                for (size_t i = 0; i < CLASS_COUNT; ++i)
+                {
+                    c->retired[i].allocs += counters[i].allocs;
+                    c->retired[i].frees += counters[i].frees;
+                    c->retired[i].hits += counters[i].hits;
+                }
+                c->caches.erase(this);
+            }
+
+            void *allocate(size_t cls)
+            {
+                FreeList &fl = lists[cls];
+                Bump(counters[cls].allocs);
+                if (fl.head)
+                {
+                    Bump(counters[cls].hits);
+                }
+                else
+                {
+                    fl.count = GetCentral()->fetch(cls, BatchSize(cls), fl.head);
+                }
+                FreeObject *obj = fl.head;
+                fl.head = obj->next;
+                --fl.count;
+                return obj;
+            }
+
+            void deallocate(void *p, size_t cls)
+            {
+                FreeList &fl = lists[cls];
+                Bump(counters[cls].frees);
+                FreeObject *obj = (FreeObject *)p;
+                obj->next = fl.head;
+                fl.head = obj;
+                ++fl.count;
+
+                uint32_t batch = BatchSize(cls);
+                if (fl.count > batch * 2)
+                {
+                    // 过长时把链表头部的batch个归还到全局链表
+                    FreeObject *head = fl.head;
+                    FreeObject *tail = head;
+                    for (uint32_t i = 1; i < batch; ++i)
+                    {
+                        tail = tail->next;
+                    }
+                    fl.head = tail->next;
+                    fl.count -= batch;
+                    GetCentral()->release(cls, head, tail, batch);
+                }
+            }
+
+            FreeList lists[CLASS_COUNT];
+            Counters counters[CLASS_COUNT];
+        };
+
+        // 线程缓存在线程退出时析构; 析构之后(其他thread_local对象析构中)的分配走全局链表
+        static thread_local ThreadCache *t_cache = nullptr;
+        static thread_local bool t_cache_dead = false;
+
+        struct ThreadCacheHolder
+        {
+            ThreadCacheHolder() { t_cache = &cache; }
+            ~ThreadCacheHolder()
+            {
+                t_cache = nullptr;
+                t_cache_dead = true;
+            }
+            ThreadCache cache;
+        };
+
+        static ThreadCache *GetThreadCache()
+        {
+            if (t_cache)
+            {
+                return t_cache;
+            }
+            if (t_cache_dead)
+            {
+                return nullptr;
+            }
+            static thread_local ThreadCacheHolder t_holder;
+            return t_cache;
+        }
+    } // namespace
+
+    void *SlabAllocator::Allocate(size_t size)
+    {
+        if (size > MAX_SIZE)
+        {
+            void *p = malloc(size);
+            if (!p)
+            {
+                throw std::bad_alloc();
+            }
+            Central *c = GetCentral();
+            c->largeAllocs.fetch_add(1, std::memory_order_relaxed);
+            c->largeBytes.fetch_add(size, std::memory_order_relaxed);
+            return p;
+        }
+
+        size_t cls = SizeToClass(size ? size : 1);
+        ThreadCache *cache = GetThreadCache();
+        if (cache)
+        {
+            return cache->allocate(cls);
+        }
+
+        Central *c = GetCentral();
+        FreeObject *obj;
+        c->fetch(cls, 1, obj);
+        c->retired[cls].allocs.fetch_add(1, std::memory_order_relaxed);
+        return obj;
+    }
+
+    void SlabAllocator::Deallocate(void *p, size_t size)
+    {
+        if (!p)
+        {
+            return;
+        }
+        if (size > MAX_SIZE)
+        {
+            GetCentral()->largeBytes.fetch_sub(size, std::memory_order_relaxed);
+            free(p);
+            return;
+        }
+
+        size_t cls = SizeToClass(size ? size : 1);
+        ThreadCache *cache = GetThreadCache();
+        if (cache)
+        {
+            cache->deallocate(p, cls);
+            return;
+        }
+
+        Central *c = GetCentral();
+        FreeObject *obj = (FreeObject *)p;
+        c->release(cls, obj, obj, 1);
+        c->retired[cls].frees.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t SlabAllocator::GetClassCount()
+    {
+        return CLASS_COUNT;
+    }
+
+    size_t SlabAllocator::GetClassSize(size_t idx)
+    {
+        return idx < CLASS_COUNT ? s_class_sizes[idx] : 0;
+    }
+
+    SlabAllocator::Stats SlabAllocator::GetStats()
+    {
+        Stats s;
+        s.classes.resize(CLASS_COUNT);
+        Central *c = GetCentral();
+        {
+            Mutex::Lock lock(c->mutex);
+            for (size_t i = 0; i < CLASS_COUNT; ++i)
+            {
+                ClassStats &cs = s.classes[i];
+                cs.size = s_class_sizes[i];
+                cs.allocs = c->retired[i].allocs;
+                cs.frees = c->retired[i].frees;
+                cs.hits = c->retired[i].hits;
+                cs.slabs = c->lists[i].slabs;
+                for (auto tc : c->caches)
+                {
+                    cs.allocs += tc->counters[i].allocs.load(std::memory_order_relaxed);
+                    cs.frees += tc->counters[i].frees.load(std::memory_order_relaxed);
+                    cs.hits += tc->counters[i].hits.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        for (auto &cs : s.classes)
+        {
+            // 统计读取不是原子快照, 差值可能短暂为负
+            if (cs.allocs > cs.frees)
+            {
+                s.bytesInUse += (cs.allocs - cs.frees) * cs.size;
+            }
+        }
+        int64_t large = c->largeBytes;
+        s.bytesInUse += large > 0 ? large : 0;
+        s.bytesReserved = c->reserved;
+        s.largeAllocs = c->largeAllocs;
+        return s;
+    }
+
+} // namespace sltj
@@ -0,0 +1,127 @@
+#ifndef __SLTJ_OBJECT_POOL_H__
+#define __SLTJ_OBJECT_POOL_H__
+
+#include <memory>
+#include <vector>
+#include <new>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sltj
+{
+    // 按大小分级的slab分配器, 用于小而短命的对象
+    // 每个线程每个大小级别有一个空闲链表, 分配/释放只在本线程链表上进行, 不加锁;
+    // 链表过长时成批归还到该级别的全局链表, 为空时从全局链表成批取回或切分新的slab.
+    // 因此在A线程分配、B线程释放的对象经全局链表回到分配侧.
+    // 超过MAX_SIZE的请求直接走malloc. slab内存不会还给系统.
+    class SlabAllocator
+    {
+    public:
+        static const size_t MAX_SIZE = 1024;
+        static const size_t ALIGN = 16;
+
+        struct ClassStats
+        {
+            size_t size = 0;          // 对象大小
+            uint64_t allocs = 0;
+            uint64_t frees = 0;
+            uint64_t hits = 0;        // 直接由线程缓存满足的分配
+            uint64_t slabs = 0;       // 切分的slab数
+            double hitRate() const { return allocs ? (double)hits / allocs : 0; }
+        };
+
+        struct Stats
+        {
+            uint64_t bytesInUse = 0;      // 已分配未释放的字节数(按级别大小计)
+            uint64_t bytesReserved = 0;   // slab占用的字节数
+            uint64_t largeAllocs = 0;     // 超过MAX_SIZE转给malloc的次数
+            std::vector<ClassStats> classes;
+        };
+
+        // size为0时按1处理; 失败抛出std::bad_alloc
+        static void *Allocate(size_t size);
+        // size须与分配时一致
+        static void Deallocate(void *p, size_t size);
+
+        // 级别数与各级别大小
+        static size_t GetClassCount();
+        static size_t GetClassSize(size_t idx);
+
+        // 汇总所有线程的统计, 开销较大, 用于监控
+        static Stats GetStats();
+    };
+
+    // 固定类型的对象池
+    template <class T>
+    class ObjectPool
+    {
+    public:
+        static_assert(alignof(T) <= SlabAllocator::ALIGN, "ObjectPool: over-aligned type");
+
+        template <class... Args>
+        static T *New(Args &&...args)
+        {
+            void *p = SlabAllocator::Allocate(sizeof(T));
+            try
+            {
+                return new (p) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                SlabAllocator::Deallocate(p, sizeof(T));
+                throw;
+            }
+        }
+
+        static void Delete(T *p)
+        {
+            if (p)
+            {
+                p->~T();
+                SlabAllocator::Deallocate(p, sizeof(T));
+            }
+        }
+
+        // 对象与shared_ptr控制块在同一次池分配中
+        template <class... Args>
+        static std::shared_ptr<T> MakeShared(Args &&...args);
+    };
+
+    // 从SlabAllocator分配的std::allocator适配器, 无状态
+    template <class T>
+    class PoolAllocator
+    {
+    public:
+        using value_type = T;
+
+        template <class U>
+        struct rebind
+        {
+            using other = PoolAllocator<U>;
+        };
+
+        PoolAllocator() noexcept {}
+        template <class U>
+        PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+        T *allocate(size_t n) { return (T *)SlabAllocator::Allocate(n * sizeof(T)); }
+        void deallocate(T *p, size_t n) noexcept { SlabAllocator::Deallocate(p, n * sizeof(T)); }
+    };
+
+    template <class T, class U>
+    bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) { return true; }
+
+    template <class T, class U>
+    bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) { return false; }
+
+    template <class T>
+    template <class... Args>
+    std::shared_ptr<T> ObjectPool<T>::MakeShared(Args &&...args)
+    {
+        return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+    }
+
+} // namespace sltj
+
+#endif
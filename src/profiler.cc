@@ -0,0 +1,409 @@
+#include "profiler.h"
+#include "config.h"
+#include "metrics.h"
+#include "ringbuffer.h"
+#include "thread.h"
+#include "util.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <unwind.h>
+#include <cxxabi.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static sltj::ConfigVar<bool>::ptr g_profiler_enable =
+        sltj::Config::Lookup<bool>("profiler.enable", false, "start/stop the sampling cpu profiler");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_profiler_frequency =
+        sltj::Config::Lookup<uint32_t>("profiler.frequency", 99, "profiler samples per cpu second");
+
+    static sltj::ConfigVar<std::string>::ptr g_profiler_output =
+        sltj::Config::Lookup<std::string>("profiler.output", "", "folded stacks written when profiler.enable turns off");
+
+    namespace
+    {
+        static const int MAX_DEPTH = 64;
+        // 信号处理函数自身与信号返回跳板
+        static const int SKIP_FRAMES = 2;
+        static const size_t QUEUE_SIZE = 4096;
+
+        struct Sample
+        {
+            pid_t tid;
+            uint32_t fiberId;
+            uint32_t depth;
+            void *pcs[MAX_DEPTH];   // pcs[0]为最内层
+        };
+        using SampleQueue = MPSCRingQueue<Sample>;
+
+        // 信号处理函数只访问这三个变量
+        static std::atomic<SampleQueue *> s_queue{nullptr};
+        static std::atomic<bool> s_sampling{false};
+        static std::atomic<uint64_t> s_dropped{0};
+
+        // 不析构: 退出过程中仍可能收到信号
+        struct ProfilerState
+        {
+            Mutex mutex;
+            bool started = false;
+            bool installed = false;
+            std::atomic<bool> stopping{false};
+            Thread::ptr thread;
+            // 键为tid, fiber id, 调用栈
+            std::map<std::vector<uintptr_t>, uint64_t> profile;
+            std::unordered_map<uintptr_t, std::string> symbols;
+            std::unordered_map<pid_t, std::string> threadNames;
+            uint64_t samples = 0;
+            uint64_t dropped = 0;
+            Counter::ptr samplesCounter = Metrics::Lookup<Counter>("profiler.samples", "profiler samples collected");
+            Counter::ptr droppedCounter = Metrics::Lookup<Counter>("profiler.dropped", "profiler samples dropped on full buffer");
+        };
+
+        static ProfilerState *GetState()
+        {
+            static ProfilerState *s_state = new ProfilerState;
+            return s_state;
+        }
+
+        struct UnwindState
+        {
+            void **pcs;
+            int skip;
+            int depth;
+        };
+
+        static _Unwind_Reason_Code UnwindFrame(struct _Unwind_Context *ctx, void *arg)
+        {
+            UnwindState *state = (UnwindState *)arg;
+            uintptr_t pc = _Unwind_GetIP(ctx);
+            if (!pc)
+            {
+                return _URC_END_OF_STACK;
+            }
+            if (state->skip > 0)
+            {
+                --state->skip;
+                return _URC_NO_REASON;
+            }
+            state->pcs[state->depth++] = (void *)pc;
+            return state->depth < MAX_DEPTH ? _URC_NO_REASON : _URC_END_OF_STACK;
+        }
+
+        static void ProfHandler(int sig, siginfo_t *info, void *context)
+        {
+            int saved_errno = errno;
+            SampleQueue *queue = s_queue.load(std::memory_order_acquire);
+            if (queue && s_sampling.load(std::memory_order_relaxed))
+            {
+                // 直接用libgcc的unwinder写入样本, 不经glibc的backtrace(首次调用时dlopen libgcc_s).
+                // glibc>=2.35时libgcc经_dl_find_object查找FDE, 不加锁也不分配内存
+                Sample s;
+                s.tid = syscall(SYS_gettid);
+                s.fiberId = GetFiberId();
+                UnwindState state = {s.pcs, SKIP_FRAMES, 0};
+                _Unwind_Backtrace(&UnwindFrame, &state);
+                s.depth = state.depth;
+                if (!queue->tryPush(std::move(s)))
+                {
+                    s_dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            errno = saved_errno;
+        }
+
+        static std::string ReadThreadName(pid_t tid)
+        {
+            std::ifstream ifs("/proc/self/task/" + std::to_string(tid) + "/comm");
+            std::string name;
+            if (!std::getline(ifs, name) || name.empty())
+            {
+                name = std::to_string(tid);
+            }
+            return name;
+        }
+
+        // 调用方持有s->mutex
+        static void Drain(ProfilerState *s)
+        {
+            SampleQueue *queue = s_queue.load(std::memory_order_acquire);
+            if (!queue)
+            {
+                return;
+            }
+            Sample batch[64];
+            size_t n;
+            std::vector<uintptr_t> key;
+            while ((n = queue->popBatch(batch, 64)) > 0)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    Sample &sample = batch[i];
+                    key.assign({(uintptr_t)sample.tid, sample.fiberId});
+                    key.insert(key.end(), (uintptr_t *)sample.pcs, (uintptr_t *)sample.pcs + sample.depth);
+                    ++s->profile[key];
+                    // 线程还在时读名字
+                    if (s->threadNames.find(sample.tid) == s->threadNames.end())
+                    {
+                        s->threadNames[sample.tid] = ReadThreadName(sample.tid);
+                    }
+                }
+                s->samples += n;
+                s->samplesCounter->inc(n);
+            }
+            uint64_t dropped = s_dropped.exchange(0, std::memory_order_relaxed);
+            s->dropped += dropped;
+            s->droppedCounter->inc(dropped);
+        }
+
+        // 返回地址指向call的下一条指令, 减1落回调用所在函数
+        static const std::string &Symbolize(ProfilerState *s, uintptr_t pc)
+        {
+            auto it = s->symbols.find(pc);
+            if (it != s->symbols.end())
+            {
+                return it->second;
+            }
+            std::string name;
+            Dl_info info;
+            if (dladdr((void *)pc, &info) && info.dli_sname)
+            {
+                int status = 0;
+                char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                name = status == 0 && demangled ? demangled : info.dli_sname;
+                free(demangled);
+            }
+            else if (info.dli_fname)
+            {
+                // 未导出的符号按所在模块合并
+                const char *base = strrchr(info.dli_fname, '/');
+                name = std::string("[") + (base ? base + 1 : info.dli_fname) + "]";
+            }
+            else
+            {
+                name = "[unknown]";
+            }
+            for (auto &c : name)
+            {
+                if (c == ';')
+                {
+                    c = ':';
+                }
+            }
+            return s->symbols[pc] = name;
+        }
+
+        static void ProfilerMain()
+        {
+            ProfilerState *s = GetState();
+            while (!s->stopping)
+            {
+                {
+                    Mutex::Lock lock(s->mutex);
+                    Drain(s);
+                }
+                usleep(50 * 1000);
+            }
+        }
+
+        struct ProfilerIniter
+        {
+            ProfilerIniter()
+            {
+                g_profiler_enable->addListener([](const bool &old_value, const bool &new_value) {
+                    if (new_value)
+                    {
+                        Profiler::Start();
+                        return;
+                    }
+                    Profiler::Stop();
+                    std::string output = g_profiler_output->getValue();
+                    if (!output.empty())
+                    {
+                        Profiler::Dump(output);
+                    }
+                });
+            }
+        };
+
+        static ProfilerIniter s_initer;
+    } // namespace
+
+    bool Profiler::Start(uint32_t hz)
+    {
+        if (!hz)
+        {
+            hz = g_profiler_frequency->getValue();
+        }
+        ProfilerState *s = GetState();
+        Mutex::Lock lock(s->mutex);
+        if (s->started)
+        {
+            return false;
+        }
+
+        // unwinder首次调用时初始化寄存器表(pthread_once), 先在信号处理函数之外完成
+        void *dummy[MAX_DEPTH];
+        UnwindState state = {dummy, 0, 0};
+        _Unwind_Backtrace(&UnwindFrame, &state);
+
+        if (!s_queue.load(std::memory_order_relaxed))
+        {
+            // 队列按缓存行对齐, C++11的new不保证; 进程生命周期内不释放
+            void *mem = nullptr;
+            if (posix_memalign(&mem, alignof(SampleQueue), sizeof(SampleQueue)))
+            {
+                throw std::bad_alloc();
+            }
+            s_queue.store(new (mem) SampleQueue(QUEUE_SIZE), std::memory_order_release);
+        }
+        else
+        {
+            Drain(s);
+        }
+        s->profile.clear();
+        s->threadNames.clear();
+        s->samples = 0;
+        s->dropped = 0;
+
+        if (!s->installed)
+        {
+            // 安装后不再恢复, 停止后迟到的SIGPROF直接返回, 不会触发默认的终止进程
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_sigaction = &ProfHandler;
+            sa.sa_flags = SA_RESTART | SA_SIGINFO;
+            sigemptyset(&sa.sa_mask);
+            if (sigaction(SIGPROF, &sa, nullptr))
+            {
+                SLTJ_LOG_ERROR(g_logger) << "Profiler::Start sigaction errno=" << errno << " " << strerror(errno);
+                return false;
+            }
+            s->installed = true;
+        }
+
+        s_sampling = true;
+        struct itimerval timer;
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = hz >= 1000000 ? 1 : 1000000 / hz;
+        timer.it_value = timer.it_interval;
+        if (setitimer(ITIMER_PROF, &timer, nullptr))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Profiler::Start setitimer errno=" << errno << " " << strerror(errno);
+            s_sampling = false;
+            return false;
+        }
+        s->stopping = false;
+        s->thread.reset(new Thread(&ProfilerMain, "profiler"));
+        s->started = true;
+        return true;
+    }
+
+    void Profiler::Stop()
+    {
+        ProfilerState *s = GetState();
+        Thread::ptr thread;
+        {
+            Mutex::Lock lock(s->mutex);
+            if (!s->started)
+            {
+                return;
+            }
+            struct itimerval timer;
+            memset(&timer, 0, sizeof(timer));
+            setitimer(ITIMER_PROF, &timer, nullptr);
+            s_sampling = false;
+            s->stopping = true;
+            s->started = false;
+            thread.swap(s->thread);
+        }
+        thread->join();
+        Mutex::Lock lock(s->mutex);
+        Drain(s);
+    }
+
+    bool Profiler::IsRunning()
+    {
+        ProfilerState *s = GetState();
+        Mutex::Lock lock(s->mutex);
+        return s->started;
+    }
+
+    std::string Profiler::GetFolded(bool per_fiber)
+    {
+        ProfilerState *s = GetState();
+        Mutex::Lock lock(s->mutex);
+        Drain(s);
+
+        // 符号化后不同地址可能落在同一函数, 再合并一次
+        std::map<std::string, uint64_t> folded;
+        std::string line;
+        for (auto &i : s->profile)
+        {
+            const std::vector<uintptr_t> &key = i.first;
+            pid_t tid = key[0];
+            auto name = s->threadNames.find(tid);
+            line = name != s->threadNames.end() ? name->second : std::to_string(tid);
+            if (per_fiber)
+            {
+                line += ";fiber_" + std::to_string(key[1]);
+            }
+            for (size_t j = key.size(); j > 2; --j)
+            {
+                uintptr_t pc = key[j - 1];
+                line += ';';
+                // 最内层是被中断处的地址, 其余为返回地址
+                line += Symbolize(s, j == 3 ? pc : pc - 1);
+            }
+            folded[line] += i.second;
+        }
+
+        std::stringstream ss;
+        for (auto &i : folded)
+        {
+            ss << i.first << ' ' << i.second << '\n';
+        }
+        return ss.str();
+    }
+
+    bool Profiler::Dump(const std::string &path, bool per_fiber)
+    {
+        std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+        if (!ofs)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Profiler::Dump open " << path << " fail";
+            return false;
+        }
+        ofs << GetFolded(per_fiber);
+        return !!ofs;
+    }
+
+    uint64_t Profiler::GetSampleCount()
+    {
+        ProfilerState *s = GetState();
+        Mutex::Lock lock(s->mutex);
+        Drain(s);
+        return s->samples;
+    }
+
+    uint64_t Profiler::GetDroppedCount()
+    {
+        ProfilerState *s = GetState();
+        Mutex::Lock lock(s->mutex);
+        Drain(s);
+        return s->dropped;
+    }
+
+} // namespace sltj
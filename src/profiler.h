@@ -0,0 +1,33 @@
+#ifndef __SLTJ_PROFILER_H__
+#define __SLTJ_PROFILER_H__
+
+#include <string>
+#include <stdint.h>
+
+namespace sltj
+{
+    // 采样CPU分析器: ITIMER_PROF按进程CPU时间定时发出SIGPROF, 内核把信号投递给正在运行的线程,
+    // 信号处理函数用_Unwind_Backtrace抓取调用栈, 写入预分配的无锁队列; 后台线程"profiler"汇总并符号化.
+    // 结果为folded格式(每行"线程;[fiber_N;]外层帧;...;内层帧 次数"), 可直接交给flamegraph.pl.
+    // 线程名取自/proc/self/task/<tid>/comm(最多15个字符), 线程已退出时为tid.
+    // 也可通过配置profiler.enable启停, 关闭时若profiler.output非空则写出结果.
+    class Profiler
+    {
+    public:
+        // hz为每秒采样次数, 0取配置profiler.frequency; 开始时清空上次的结果
+        static bool Start(uint32_t hz = 0);
+        static void Stop();
+        static bool IsRunning();
+
+        // per_fiber为true时在线程名之后加一层fiber_<id>
+        static std::string GetFolded(bool per_fiber = false);
+        static bool Dump(const std::string &path, bool per_fiber = false);
+
+        // 已汇总的样本数与队列满时丢弃的样本数
+        static uint64_t GetSampleCount();
+        static uint64_t GetDroppedCount();
+    };
+
+} // namespace sltj
+
+#endif
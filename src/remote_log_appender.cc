@@ -0,0 +1,445 @@
+#include "remote_log_appender.h"
+#include "metrics.h"
+#include "util.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    namespace
+    {
+        // 攒到这么多字节就提前唤醒发送线程
+        static const size_t kBatchBytes = 64 * 1024;
+        // 一次sendmmsg最多的数据报数, 每个数据报最多的记录数
+        static const size_t kMaxMsgs = 64;
+        static const size_t kMaxRecordsPerMsg = 64;
+        // 流模式一次发出的最多记录数(每条两个iovec, 不超过UIO_MAXIOV)
+        static const size_t kMaxStreamRecords = 512;
+
+        struct RemoteLogMetrics
+        {
+            Counter::ptr sent = Metrics::Lookup<Counter>("log.remote.sent", "log records sent to remote collectors");
+            Counter::ptr dropped = Metrics::Lookup<Counter>("log.remote.dropped", "log records dropped by remote appenders");
+            Counter::ptr reconnects = Metrics::Lookup<Counter>("log.remote.reconnects", "remote log appender reconnects");
+        };
+
+        static RemoteLogMetrics *GetRemoteLogMetrics()
+        {
+            static RemoteLogMetrics *s_metrics = new RemoteLogMetrics;
+            return s_metrics;
+        }
+    } // namespace
+
+    RemoteLogAppender::ptr RemoteLogAppender::Create(const std::string &uri, size_t max_pending)
+    {
+        size_t pos = uri.find("://");
+        if (pos == std::string::npos)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "RemoteLogAppender invalid uri=" << uri;
+            return nullptr;
+        }
+        std::string scheme = uri.substr(0, pos);
+        std::string rest = uri.substr(pos + 3);
+        try
+        {
+            if (scheme == "udp")
+            {
+                IPAddress::ptr addr = Address::LookupAnyIPAddress(rest, AF_UNSPEC, SOCK_DGRAM);
+                if (addr)
+                {
+                    return RemoteLogAppender::ptr(new RemoteLogAppender(UDP, addr, max_pending));
+                }
+            }
+            else if ((scheme == "unix" || scheme == "unixgram") && !rest.empty())
+            {
+                Address::ptr addr(new UnixAddress(rest));
+                return RemoteLogAppender::ptr(new RemoteLogAppender(scheme == "unix" ? UNIX_STREAM : UNIX_DGRAM,
+                                                                    addr, max_pending));
+            }
+        }
+        catch (std::exception &e)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "RemoteLogAppender uri=" << uri << " error: " << e.what();
+            return nullptr;
+        }
+        SLTJ_LOG_ERROR(g_logger) << "RemoteLogAppender invalid uri=" << uri;
+        return nullptr;
+    }
+
+    RemoteLogAppender::RemoteLogAppender(Type type, Address::ptr address, size_t max_pending)
+        : m_type(type), m_address(address), m_maxPending(max_pending)
+    {
+        if (!address || (type == UDP) != (address->getFamily() == AF_INET || address->getFamily() == AF_INET6))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "RemoteLogAppender type=" << type << " address mismatch";
+            throw std::invalid_argument("RemoteLogAppender address mismatch");
+        }
+        m_maxDatagram = type == UDP ? 8192 : 64 * 1024;
+        m_backoff = m_backoffMin;
+        m_thread.reset(new Thread(std::bind(&RemoteLogAppender::run, this), "log_remote"));
+    }
+
+    RemoteLogAppender::~RemoteLogAppender()
+    {
+        m_stopping = true;
+        m_wakeup.notify();
+        m_thread->join();
+    }
+
+    void RemoteLogAppender::setReconnectBackoff(uint64_t min_ms, uint64_t max_ms)
+    {
+        m_backoffMin = min_ms;
+        m_backoffMax = std::max(min_ms, max_ms);
+        m_backoff = m_backoffMin;
+    }
+
+    void RemoteLogAppender::log(LogLevel::Level level, LogEvent::ptr event)
+    {
+        if (level < m_level)
+        {
+            return;
+        }
+        std::string str = m_formatter->format(level, event);
+        if (str.empty())
+        {
+            return;
+        }
+        if (m_type != UNIX_STREAM && str.size() > m_maxDatagram)
+        {
+            str.resize(m_maxDatagram);
+            str.back() = '\n';
+        }
+        size_t bytes = str.size() + (m_type == UNIX_STREAM ? sizeof(uint32_t) : 0);
+        size_t pending;
+        {
+            Mutex::Lock lock(m_queueMutex);
+            pending = m_pendingBytes.load(std::memory_order_relaxed);
+            if (pending + bytes > m_maxPending)
+            {
+                lock.unlock();
+                drop(1, 0);
+                return;
+            }
+            m_queue.push_back(std::move(str));
+            m_pendingBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        if (pending + bytes >= kBatchBytes && !m_notified.exchange(true))
+        {
+            m_wakeup.notify();
+        }
+    }
+
+    void RemoteLogAppender::flush()
+    {
+        if (!m_pendingBytes)
+        {
+            return;
+        }
+        if (!m_notified.exchange(true))
+        {
+            m_wakeup.notify();
+        }
+        // 退避中不等待, 数据留在队列里
+        for (int i = 0; i < 1000 && m_pendingBytes && GetCurrentMS() >= m_nextConnect; ++i)
+        {
+            usleep(1000);
+        }
+    }
+
+    void RemoteLogAppender::drop(size_t records, size_t bytes)
+    {
+        m_dropped.fetch_add(records, std::memory_order_relaxed);
+        GetRemoteLogMetrics()->dropped->inc(records);
+        m_pendingBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    void RemoteLogAppender::run()
+    {
+        for (;;)
+        {
+            bool stopping = m_stopping;
+            if (!stopping)
+            {
+                uint64_t wait = m_flushInterval;
+                uint64_t now = GetCurrentMS();
+                if (!m_connected && !m_sending.empty() && m_nextConnect > now)
+                {
+                    wait = m_nextConnect - now;
+                }
+                m_wakeup.waitFor(wait);
+                m_notified = false;
+            }
+
+            {
+                Mutex::Lock lock(m_queueMutex);
+                if (m_sending.empty())
+                {
+                    m_sending.swap(m_queue);
+                }
+                else
+                {
+                    for (auto &i : m_queue)
+                    {
+                        m_sending.push_back(std::move(i));
+                    }
+                    m_queue.clear();
+                }
+            }
+
+            if (!m_sending.empty() && (m_connected || connect()))
+            {
+                bool ok = m_type == UNIX_STREAM ? sendStream() : sendDgram();
+                if (!ok)
+                {
+                    disconnect();
+                }
+            }
+
+            if (stopping)
+            {
+                size_t bytes = 0;
+                for (auto &i : m_sending)
+                {
+                    bytes += i.size() + (m_type == UNIX_STREAM ? sizeof(uint32_t) : 0);
+                }
+                drop(m_sending.size(), bytes - m_sendOffset);
+                m_sending.clear();
+                m_sendOffset = 0;
+                break;
+            }
+        }
+        if (m_sock)
+        {
+            m_sock->close();
+            m_sock.reset();
+        }
+        m_connected = false;
+    }
+
+    bool RemoteLogAppender::connect()
+    {
+        uint64_t now = GetCurrentMS();
+        if (now < m_nextConnect)
+        {
+            return false;
+        }
+        Socket::ptr sock(new Socket(m_address->getFamily(), m_type == UNIX_STREAM ? Socket::TCP : Socket::UDP, 0));
+        if (!sock->connect(m_address, 1000))
+        {
+            SLTJ_LOG_RATE_LIMITED(g_logger, sltj::LogLevel::WARN, 1)
+                << "RemoteLogAppender connect " << m_address->toString() << " failed errno=" << errno
+                << " errstr=" << strerror(errno) << ", retry in " << m_backoff << "ms";
+            m_nextConnect = now + m_backoff;
+            m_backoff = std::min(m_backoff * 2, m_backoffMax);
+            return false;
+        }
+        m_sock = sock;
+        m_connected = true;
+        m_backoff = m_backoffMin;
+        if (m_everConnected)
+        {
+            ++m_reconnects;
+            GetRemoteLogMetrics()->reconnects->inc();
+        }
+        m_everConnected = true;
+        return true;
+    }
+
+    void RemoteLogAppender::disconnect()
+    {
+        SLTJ_LOG_RATE_LIMITED(g_logger, sltj::LogLevel::WARN, 1)
+            << "RemoteLogAppender send to " << m_address->toString() << " failed errno=" << errno
+            << " errstr=" << strerror(errno) << ", reconnect in " << m_backoff << "ms";
+        m_sock->close();
+        m_sock.reset();
+        m_connected = false;
+        m_nextConnect = GetCurrentMS() + m_backoff;
+        m_backoff = std::min(m_backoff * 2, m_backoffMax);
+        // 半条记录重连后无法续上, 丢弃
+        if (m_sendOffset)
+        {
+            drop(1, m_sending.front().size() + sizeof(uint32_t) - m_sendOffset);
+            m_sending.pop_front();
+            m_sendOffset = 0;
+        }
+    }
+
+    bool RemoteLogAppender::waitWritable(int timeout_ms)
+    {
+        pollfd pfd;
+        pfd.fd = m_sock->getSocket();
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        int rt;
+        do
+        {
+            rt = poll(&pfd, 1, timeout_ms);
+        } while (rt == -1 && errno == EINTR);
+        return rt > 0;
+    }
+
+    bool RemoteLogAppender::sendDgram()
+    {
+        mmsghdr msgs[kMaxMsgs];
+        iovec iovs[kMaxMsgs * kMaxRecordsPerMsg];
+        size_t records[kMaxMsgs];
+        size_t bytes[kMaxMsgs];
+        while (!m_sending.empty())
+        {
+            // 把连续的记录装进数据报, 每个不超过m_maxDatagram
+            size_t nmsg = 0;
+            size_t rec = 0;
+            size_t niov = 0;
+            while (rec < m_sending.size() && nmsg < kMaxMsgs)
+            {
+                size_t first = rec;
+                size_t len = 0;
+                iovec *iov = iovs + niov;
+                while (rec < m_sending.size() && rec - first < kMaxRecordsPerMsg)
+                {
+                    const std::string &str = m_sending[rec];
+                    if (rec != first && len + str.size() > m_maxDatagram)
+                    {
+                        break;
+                    }
+                    iovs[niov].iov_base = (void *)str.data();
+                    iovs[niov].iov_len = std::min(str.size(), m_maxDatagram);
+                    len += iovs[niov].iov_len;
+                    ++niov;
+                    ++rec;
+                }
+                memset(&msgs[nmsg], 0, sizeof(mmsghdr));
+                msgs[nmsg].msg_hdr.msg_iov = iov;
+                msgs[nmsg].msg_hdr.msg_iovlen = rec - first;
+                records[nmsg] = rec - first;
+                bytes[nmsg] = 0;
+                for (size_t i = first; i < rec; ++i)
+                {
+                    bytes[nmsg] += m_sending[i].size();
+                }
+                ++nmsg;
+            }
+
+            int n = sendmmsg(m_sock->getSocket(), msgs, nmsg, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN)
+                {
+                    // 对端来不及收, 剩下的留到下一轮
+                    if (!waitWritable(100))
+                    {
+                        return true;
+                    }
+                    continue;
+                }
+                if (errno == EMSGSIZE)
+                {
+                    for (size_t i = 0; i < records[0]; ++i)
+                    {
+                        m_sending.pop_front();
+                    }
+                    drop(records[0], bytes[0]);
+                    continue;
+                }
+                return false;
+            }
+            size_t sent = 0;
+            size_t sentBytes = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                sent += records[i];
+                sentBytes += bytes[i];
+            }
+            m_sending.erase(m_sending.begin(), m_sending.begin() + sent);
+            m_pendingBytes.fetch_sub(sentBytes, std::memory_order_relaxed);
+            m_sent.fetch_add(sent, std::memory_order_relaxed);
+            GetRemoteLogMetrics()->sent->inc(sent);
+        }
+        return true;
+    }
+
+    // 字节流的部分写不能跨消息续写, 所以流模式只用一个msghdr, 靠多个iovec批量
+    bool RemoteLogAppender::sendStream()
+    {
+        mmsghdr msg;
+        iovec iovs[kMaxStreamRecords * 2];
+        uint32_t hdrs[kMaxStreamRecords];
+        while (!m_sending.empty())
+        {
+            size_t count = std::min(m_sending.size(), kMaxStreamRecords);
+            size_t niov = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const std::string &str = m_sending[i];
+                hdrs[i] = htonl((uint32_t)str.size());
+                size_t skip = i == 0 ? m_sendOffset : 0;
+                if (skip < sizeof(uint32_t))
+                {
+                    iovs[niov].iov_base = (char *)&hdrs[i] + skip;
+                    iovs[niov].iov_len = sizeof(uint32_t) - skip;
+                    ++niov;
+                    skip = 0;
+                }
+                else
+                {
+                    skip -= sizeof(uint32_t);
+                }
+                iovs[niov].iov_base = (void *)(str.data() + skip);
+                iovs[niov].iov_len = str.size() - skip;
+                ++niov;
+            }
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_hdr.msg_iov = iovs;
+            msg.msg_hdr.msg_iovlen = niov;
+
+            int n = sendmmsg(m_sock->getSocket(), &msg, 1, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN)
+                {
+                    if (!waitWritable(100))
+                    {
+                        return true;
+                    }
+                    continue;
+                }
+                return false;
+            }
+            size_t left = msg.msg_len;
+            m_pendingBytes.fetch_sub(left, std::memory_order_relaxed);
+            size_t sent = 0;
+            while (left)
+            {
+                size_t rest = m_sending.front().size() + sizeof(uint32_t) - m_sendOffset;
+                if (left < rest)
+                {
+                    m_sendOffset += left;
+                    break;
+                }
+                left -= rest;
+                m_sendOffset = 0;
+                m_sending.pop_front();
+                ++sent;
+            }
+            m_sent.fetch_add(sent, std::memory_order_relaxed);
+            GetRemoteLogMetrics()->sent->inc(sent);
+        }
+        return true;
+    }
+
+} // namespace sltj
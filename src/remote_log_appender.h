@@ -0,0 +1,101 @@
+#ifndef __SLTJ_REMOTE_LOG_APPENDER_H__
+#define __SLTJ_REMOTE_LOG_APPENDER_H__
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include "address.h"
+#include "log.h"
+#include "socket.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // 把日志发给远端收集器, 不落本地盘.
+    // 格式化后的记录进入有界队列, 后台线程"log_remote"批量用sendmmsg发出:
+    //   UDP/Unix数据报: 多条记录拼成一个数据报(不超过max datagram), 记录以'\n'结尾
+    //   Unix流: 每条记录前加4字节网络序长度
+    // 队列(含发送中)超过max_pending字节时丢弃新记录并计数; 连接失败按指数退避重连
+    class RemoteLogAppender : public LogAppender
+    {
+    public:
+        using ptr = std::shared_ptr<RemoteLogAppender>;
+
+        enum Type
+        {
+            UDP = 1,
+            UNIX_DGRAM = 2,
+            UNIX_STREAM = 3
+        };
+
+        // uri: udp://host:port, unixgram:///path, unix:///path(流); 格式错误返回nullptr
+        static RemoteLogAppender::ptr Create(const std::string &uri, size_t max_pending = 4 * 1024 * 1024);
+
+        RemoteLogAppender(Type type, Address::ptr address, size_t max_pending = 4 * 1024 * 1024);
+        virtual ~RemoteLogAppender();
+
+        virtual void log(LogLevel::Level level, LogEvent::ptr event) override;
+        // 唤醒发送线程, 最多等待1秒直到队列发完或连接断开
+        virtual void flush() override;
+
+        // 单个数据报最大字节数, 超长的单条记录被截断; 流模式不使用
+        void setMaxDatagram(size_t v) { m_maxDatagram = v; }
+        // 未攒满一批时的发送间隔
+        void setFlushInterval(uint64_t ms) { m_flushInterval = ms; }
+        // 重连退避从min_ms开始翻倍, 不超过max_ms
+        void setReconnectBackoff(uint64_t min_ms, uint64_t max_ms);
+
+        Type getType() const { return m_type; }
+        Address::ptr getAddress() const { return m_address; }
+        bool isConnected() const { return m_connected; }
+        size_t getPendingBytes() const { return m_pendingBytes; }
+        uint64_t getSent() const { return m_sent; }
+        uint64_t getDropped() const { return m_dropped; }
+        uint64_t getReconnects() const { return m_reconnects; }
+
+    private:
+        void run();
+        bool connect();
+        void disconnect();
+        // 发送m_sending中的记录, 出错断开时返回false
+        bool sendDgram();
+        bool sendStream();
+        // 等待可写, 超时返回false
+        bool waitWritable(int timeout_ms);
+        void drop(size_t records, size_t bytes);
+
+    private:
+        Type m_type;
+        Address::ptr m_address;
+        size_t m_maxPending;
+        size_t m_maxDatagram;
+        uint64_t m_flushInterval = 100;
+        uint64_t m_backoffMin = 100;
+        uint64_t m_backoffMax = 5000;
+
+        Mutex m_queueMutex;
+        std::deque<std::string> m_queue;     // 待发送, 受m_queueMutex保护
+        std::deque<std::string> m_sending;   // 发送线程私有
+        size_t m_sendOffset = 0;             // 流模式下m_sending首条已发出的字节
+        std::atomic<size_t> m_pendingBytes{0};
+        std::atomic<bool> m_notified{false}; // 已唤醒发送线程, 避免每条记录都notify
+        Semaphore m_wakeup;
+
+        Socket::ptr m_sock;
+        std::atomic<bool> m_connected{false};
+        bool m_everConnected = false;
+        uint64_t m_backoff;
+        std::atomic<uint64_t> m_nextConnect{0}; // 退避中, 此时间(ms)前不重连
+
+        std::atomic<uint64_t> m_sent{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<uint64_t> m_reconnects{0};
+
+        std::atomic<bool> m_stopping{false};
+        Thread::ptr m_thread;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,445 @@
+#include "ring_buffer_log_appender.h"
+#include "util.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fstream>
+#include <set>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    namespace
+    {
+        // 记录头, 之后依次为日志器名, 线程名, 内容; 在环中不对齐, 读写都用memcpy
+        struct RecordHeader
+        {
+            uint32_t size; // 整条记录字节数(含头)
+            uint8_t level;
+            uint8_t nameLen;
+            uint8_t threadNameLen;
+            uint8_t reserved;
+            int32_t line;
+            uint32_t threadId;
+            uint32_t fiberId;
+            uint32_t contentLen;
+            uint64_t timestamp; // CLOCK_REALTIME纳秒
+            const char *file;   // __FILE__字面量
+        };
+
+        static uint64_t RealtimeNS()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+
+        static std::atomic<uint64_t> s_next_id{1};
+
+        // 正在转储的线程, 转储中打的日志只记录不再触发转储
+        static thread_local bool t_dumping = false;
+    } // namespace
+
+    // 单写者(所属线程)的覆盖式环形缓冲; 读者(转储)与写者并发, 读完后按tail丢弃被覆盖的部分
+    class RingBufferLogAppender::Buffer
+    {
+    public:
+        Buffer(size_t capacity)
+            : m_data((char *)malloc(capacity)), m_capacity(capacity)
+        {
+            if (!m_data)
+            {
+                throw std::bad_alloc();
+            }
+        }
+        ~Buffer() { free(m_data); }
+
+        void write(LogLevel::Level level, LogEvent::ptr &event)
+        {
+            const std::string &name = event->getName();
+            const std::string &threadName = event->getThreadName();
+            RecordHeader hdr;
+            hdr.level = level;
+            hdr.nameLen = std::min<size_t>(name.size(), 255);
+            hdr.threadNameLen = std::min<size_t>(threadName.size(), 255);
+            hdr.reserved = 0;
+            hdr.line = event->getLine();
+            hdr.threadId = event->getThreadId();
+            hdr.fiberId = event->getFiberId();
+            hdr.timestamp = RealtimeNS();
+            hdr.file = event->getFile();
+            size_t fixed = sizeof(hdr) + hdr.nameLen + hdr.threadNameLen;
+            // 单条记录不超过缓冲的一半, 超长内容截断
+            size_t content = std::min(event->getContentSize(), m_capacity / 2 > fixed ? m_capacity / 2 - fixed : 0);
+            hdr.contentLen = content;
+            hdr.size = fixed + content;
+
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            uint64_t tail = m_tail.load(std::memory_order_relaxed);
+            while (head + hdr.size - tail > m_capacity)
+            {
+                uint32_t size;
+                get(tail, &size, sizeof(size));
+                tail += size;
+            }
+            m_tail.store(tail, std::memory_order_relaxed);
+            // 先发布tail再覆盖数据: 读者若读到了新数据, 必能看到新的tail
+            std::atomic_thread_fence(std::memory_order_release);
+
+            uint64_t pos = head;
+            put(pos, &hdr, sizeof(hdr));
+            pos += sizeof(hdr);
+            put(pos, name.data(), hdr.nameLen);
+            pos += hdr.nameLen;
+            put(pos, threadName.data(), hdr.threadNameLen);
+            pos += hdr.threadNameLen;
+            size_t done = 0;
+            while (done < content)
+            {
+                size_t idx = (pos + done) % m_capacity;
+                size_t n = std::min(content - done, m_capacity - idx);
+                n = event->readContent(done, m_data + idx, n);
+                if (!n)
+                {
+                    // 内容比预期短, 补空格保持记录长度
+                    memset(m_data + idx, ' ', std::min(content - done, m_capacity - idx));
+                    n = std::min(content - done, m_capacity - idx);
+                }
+                done += n;
+            }
+            m_head.store(head + hdr.size, std::memory_order_release);
+        }
+
+        // 复制出完整的记录, 按写入顺序连续存放
+        void snapshot(std::vector<char> &out)
+        {
+            uint64_t tail = m_tail.load(std::memory_order_acquire);
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            out.resize(head - tail);
+            if (!out.empty())
+            {
+                get(tail, &out[0], out.size());
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t newTail = m_tail.load(std::memory_order_relaxed);
+            if (newTail >= head)
+            {
+                out.clear();
+            }
+            else if (newTail > tail)
+            {
+                out.erase(out.begin(), out.begin() + (newTail - tail));
+            }
+        }
+
+        std::atomic<bool> dead{false}; // 所属线程已退出, 可由新线程接着写
+
+    private:
+        void put(uint64_t pos, const void *src, size_t len)
+        {
+            size_t idx = pos % m_capacity;
+            size_t first = std::min(len, m_capacity - idx);
+            memcpy(m_data + idx, src, first);
+            memcpy(m_data, (const char *)src + first, len - first);
+        }
+
+        void get(uint64_t pos, void *dst, size_t len) const
+        {
+            size_t idx = pos % m_capacity;
+            size_t first = std::min(len, m_capacity - idx);
+            memcpy(dst, m_data + idx, first);
+            memcpy((char *)dst + first, m_data, len - first);
+        }
+
+    private:
+        char *m_data;
+        size_t m_capacity;
+        std::atomic<uint64_t> m_head{0}; // 只由写者修改
+        std::atomic<uint64_t> m_tail{0}; // 最早一条完整记录的位置
+    };
+
+    namespace
+    {
+        // 本线程在各实例中的缓冲; 线程退出时标记为dead
+        struct RingBufferHolder
+        {
+            struct Entry
+            {
+                uint64_t id;
+                RingBufferLogAppender::Buffer *buffer; // 实例存活时有效
+                std::weak_ptr<RingBufferLogAppender::Buffer> weak;
+            };
+
+            ~RingBufferHolder();
+
+            std::vector<Entry> entries;
+        };
+
+        static thread_local bool t_holder_dead = false;
+
+        RingBufferHolder::~RingBufferHolder()
+        {
+            t_holder_dead = true;
+            for (auto &i : entries)
+            {
+                auto buffer = i.weak.lock();
+                if (buffer)
+                {
+                    buffer->dead = true;
+                }
+            }
+        }
+
+        static RingBufferHolder *GetHolder()
+        {
+            if (t_holder_dead)
+            {
+                return nullptr;
+            }
+            static thread_local RingBufferHolder t_holder;
+            return &t_holder;
+        }
+
+        // 不析构: 信号线程与退出过程中仍可能访问
+        struct RingRegistry
+        {
+            RingRegistry() { sem_init(&sem, 0, 0); }
+
+            Mutex mutex;
+            std::set<RingBufferLogAppender *> appenders;
+            sem_t sem; // 信号处理函数中只能用sem_post
+            Thread::ptr thread;
+            std::string signalName;
+        };
+
+        static RingRegistry *GetRegistry()
+        {
+            static RingRegistry *s_registry = new RingRegistry;
+            return s_registry;
+        }
+
+        static void DumpSignalHandler(int sig)
+        {
+            int saved_errno = errno;
+            sem_post(&GetRegistry()->sem);
+            errno = saved_errno;
+        }
+
+        static void RecorderMain()
+        {
+            RingRegistry *r = GetRegistry();
+            for (;;)
+            {
+                if (sem_wait(&r->sem))
+                {
+                    continue;
+                }
+                std::string reason;
+                {
+                    Mutex::Lock lock(r->mutex);
+                    reason = r->signalName;
+                }
+                RingBufferLogAppender::DumpAll(reason);
+            }
+        }
+
+        static void WriteRecord(std::ostream &os, const RecordHeader &hdr, const char *body)
+        {
+            char buf[128];
+            time_t sec = hdr.timestamp / 1000000000ull;
+            struct tm tm;
+            localtime_r(&sec, &tm);
+            size_t n = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+            n += snprintf(buf + n, sizeof(buf) - n, ".%06u\t%u\t", (unsigned)(hdr.timestamp % 1000000000ull / 1000), hdr.threadId);
+            os.write(buf, n);
+            os.write(body + hdr.nameLen, hdr.threadNameLen);
+            n = snprintf(buf, sizeof(buf), "\t%u\t[%s]\t[", hdr.fiberId, LogLevel::ToString((LogLevel::Level)hdr.level));
+            os.write(buf, n);
+            os.write(body, hdr.nameLen);
+            os << "]\t" << (hdr.file ? hdr.file : "") << ':' << hdr.line << '\t';
+            os.write(body + hdr.nameLen + hdr.threadNameLen, hdr.contentLen);
+            if (!hdr.contentLen || body[hdr.nameLen + hdr.threadNameLen + hdr.contentLen - 1] != '\n')
+            {
+                os << '\n';
+            }
+        }
+    } // namespace
+
+    RingBufferLogAppender::RingBufferLogAppender(const std::string &path, size_t capacity)
+        : m_path(path),
+          m_capacity(std::max<size_t>(capacity, 4096)),
+          m_id(s_next_id.fetch_add(1))
+    {
+        RingRegistry *r = GetRegistry();
+        Mutex::Lock lock(r->mutex);
+        r->appenders.insert(this);
+    }
+
+    RingBufferLogAppender::~RingBufferLogAppender()
+    {
+        RingRegistry *r = GetRegistry();
+        Mutex::Lock lock(r->mutex);
+        r->appenders.erase(this);
+    }
+
+    RingBufferLogAppender::Buffer *RingBufferLogAppender::getBuffer()
+    {
+        RingBufferHolder *holder = GetHolder();
+        if (!holder)
+        {
+            return nullptr;
+        }
+        for (auto &i : holder->entries)
+        {
+            if (i.id == m_id)
+            {
+                return i.buffer;
+            }
+        }
+
+        std::shared_ptr<Buffer> buffer;
+        {
+            Mutex::Lock lock(m_bufferMutex);
+            // 复用已退出线程的缓冲, 缓冲总数不超过同时存活的线程数
+            for (auto &i : m_buffers)
+            {
+                bool expected = true;
+                if (i->dead.compare_exchange_strong(expected, false))
+                {
+                    buffer = i;
+                    break;
+                }
+            }
+            if (!buffer)
+            {
+                buffer.reset(new Buffer(m_capacity));
+                m_buffers.push_back(buffer);
+            }
+        }
+        holder->entries.push_back(RingBufferHolder::Entry{m_id, buffer.get(), buffer});
+        return buffer.get();
+    }
+
+    void RingBufferLogAppender::log(LogLevel::Level level, LogEvent::ptr event)
+    {
+        if (level < m_level)
+        {
+            return;
+        }
+        Buffer *buffer = getBuffer();
+        if (buffer)
+        {
+            buffer->write(level, event);
+        }
+        if (m_dumpLevel != LogLevel::UNKNOW && level >= m_dumpLevel && !t_dumping)
+        {
+            uint64_t now = GetCurrentMS();
+            uint64_t last = m_lastDump;
+            if (now - last >= m_dumpInterval && m_lastDump.compare_exchange_strong(last, now))
+            {
+                dump(LogLevel::ToString(level));
+            }
+        }
+    }
+
+    bool RingBufferLogAppender::dump(const std::string &reason)
+    {
+        t_dumping = true;
+        Mutex::Lock lock(m_dumpMutex);
+        std::vector<std::shared_ptr<Buffer>> buffers;
+        {
+            Mutex::Lock lock(m_bufferMutex);
+            buffers = m_buffers;
+        }
+
+        // 取各缓冲快照, 按时间合并
+        std::vector<std::vector<char>> snapshots(buffers.size());
+        std::vector<std::pair<uint64_t, const char *>> records;
+        for (size_t i = 0; i < buffers.size(); ++i)
+        {
+            std::vector<char> &data = snapshots[i];
+            buffers[i]->snapshot(data);
+            size_t pos = 0;
+            while (pos + sizeof(RecordHeader) <= data.size())
+            {
+                RecordHeader hdr;
+                memcpy(&hdr, &data[pos], sizeof(hdr));
+                if (hdr.size < sizeof(hdr) || pos + hdr.size > data.size())
+                {
+                    break;
+                }
+                records.push_back(std::make_pair(hdr.timestamp, &data[pos]));
+                pos += hdr.size;
+            }
+        }
+        std::stable_sort(records.begin(), records.end(),
+                         [](const std::pair<uint64_t, const char *> &a, const std::pair<uint64_t, const char *> &b) {
+                             return a.first < b.first;
+                         });
+
+        std::ofstream ofs(m_path, std::ios::out | std::ios::app);
+        if (!ofs)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "RingBufferLogAppender::dump open " << m_path << " fail";
+            t_dumping = false;
+            return false;
+        }
+        ofs << "==== flight recorder dump reason=" << reason << " pid=" << getpid()
+            << " records=" << records.size() << " ====\n";
+        for (auto &i : records)
+        {
+            RecordHeader hdr;
+            memcpy(&hdr, i.second, sizeof(hdr));
+            WriteRecord(ofs, hdr, i.second + sizeof(hdr));
+        }
+        ofs << "==== end of dump ====\n";
+        ofs.close();
+        ++m_dumpCount;
+        t_dumping = false;
+        return !!ofs;
+    }
+
+    void RingBufferLogAppender::DumpAll(const std::string &reason)
+    {
+        RingRegistry *r = GetRegistry();
+        Mutex::Lock lock(r->mutex);
+        for (auto &i : r->appenders)
+        {
+            i->dump(reason);
+        }
+    }
+
+    bool RingBufferLogAppender::SetDumpSignal(int sig)
+    {
+        RingRegistry *r = GetRegistry();
+        {
+            Mutex::Lock lock(r->mutex);
+            r->signalName = "signal " + std::to_string(sig);
+            if (!r->thread)
+            {
+                r->thread.reset(new Thread(&RecorderMain, "log_recorder"));
+            }
+        }
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = &DumpSignalHandler;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(sig, &sa, nullptr))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "RingBufferLogAppender::SetDumpSignal sigaction errno=" << errno
+                                     << " " << strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace sltj
@@ -0,0 +1,63 @@
+#ifndef __SLTJ_RING_BUFFER_LOG_APPENDER_H__
+#define __SLTJ_RING_BUFFER_LOG_APPENDER_H__
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "log.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // 飞行记录器: 每个线程一个可覆盖的环形缓冲, 以二进制保存最近的日志(不格式化, 不做I/O),
+    // 出错时(事件等级>=dump level)、收到指定信号或调用dump()时按时间合并写到文件末尾.
+    // 用法: 日志器等级设为DEBUG, 文件等输出器设较高等级, 本输出器保留全部细节
+    class RingBufferLogAppender : public LogAppender
+    {
+    public:
+        using ptr = std::shared_ptr<RingBufferLogAppender>;
+
+        // capacity为每个线程的缓冲字节数
+        RingBufferLogAppender(const std::string &path, size_t capacity = 1024 * 1024);
+        virtual ~RingBufferLogAppender();
+
+        virtual void log(LogLevel::Level level, LogEvent::ptr event) override;
+
+        // 写出当前所有线程缓冲中的记录, reason写在本次转储的标题行
+        bool dump(const std::string &reason = "api");
+
+        // 事件等级达到level时自动转储, 两次自动转储至少间隔interval毫秒; UNKNOW表示不自动转储
+        void setDumpLevel(LogLevel::Level level) { m_dumpLevel = level; }
+        void setDumpInterval(uint64_t ms) { m_dumpInterval = ms; }
+        const std::string &getPath() const { return m_path; }
+        size_t getCapacity() const { return m_capacity; }
+        uint64_t getDumpCount() const { return m_dumpCount; }
+
+        // 转储所有存活的RingBufferLogAppender
+        static void DumpAll(const std::string &reason);
+        // 收到sig时由后台线程"log_recorder"转储所有实例, 信号处理函数只做sem_post
+        static bool SetDumpSignal(int sig);
+
+    public:
+        class Buffer;
+
+    private:
+        Buffer *getBuffer();
+
+    private:
+        std::string m_path;
+        size_t m_capacity;
+        uint64_t m_id; // 区分实例, 用于线程缓存
+        LogLevel::Level m_dumpLevel = LogLevel::ERROR;
+        uint64_t m_dumpInterval = 1000;
+        std::atomic<uint64_t> m_lastDump{0};
+        std::atomic<uint64_t> m_dumpCount{0};
+        Mutex m_bufferMutex;
+        std::vector<std::shared_ptr<Buffer>> m_buffers;
+        Mutex m_dumpMutex;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,497 @@
+#ifndef __SLTJ_RINGBUFFER_H__
+#define __SLTJ_RINGBUFFER_H__
+
+// 有界无锁环形队列(header-only)
+// SPSCRingQueue: 单生产者单消费者
+// MPSCRingQueue: 多生产者单消费者,生产端为Vyukov序号槽位
+// MPMCRingQueue: 多生产者多消费者,Vyukov有界队列
+// BlockingQueue: 以两个Semaphore包装上面任一队列,提供可阻塞的push/pop
+//
+// 容量会向上取整为2的幂; 元素类型需可默认构造、可移动赋值
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <sched.h>
+#include "thread.h"
+
+#define SLTJ_CACHELINE_SIZE 64
+
+namespace sltj
+{
+    inline size_t RoundUpPowerOfTwo(size_t v)
+    {
+        size_t rt = 2;
+        while (rt < v)
+        {
+            rt <<= 1;
+        }
+        return rt;
+    }
+
+    // 单生产者单消费者
+    template <class T>
+    class SPSCRingQueue
+    {
+    public:
+        using ptr = std::shared_ptr<SPSCRingQueue>;
+        using value_type = T;
+
+        explicit SPSCRingQueue(size_t capacity)
+            : m_mask(RoundUpPowerOfTwo(capacity) - 1),
+              m_buffer(new T[m_mask + 1])
+        {
+        }
+
+        bool tryPush(const T &v)
+        {
+            T tmp(v);
+            return tryPush(std::move(tmp));
+        }
+
+        bool tryPush(T &&v)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_cachedHead > m_mask)
+            {
+                m_cachedHead = m_head.load(std::memory_order_acquire);
+                if (tail - m_cachedHead > m_mask)
+                {
+                    return false;
+                }
+            }
+            m_buffer[tail & m_mask] = std::move(v);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T &v)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_cachedTail)
+            {
+                m_cachedTail = m_tail.load(std::memory_order_acquire);
+                if (head == m_cachedTail)
+                {
+                    return false;
+                }
+            }
+            v = std::move(m_buffer[head & m_mask]);
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 批量入队,元素从items中移出,返回实际入队个数
+        size_t pushBatch(T *items, size_t count)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t free = m_mask + 1 - (tail - m_cachedHead);
+            if (free < count)
+            {
+                m_cachedHead = m_head.load(std::memory_order_acquire);
+                free = m_mask + 1 - (tail - m_cachedHead);
+            }
+            size_t n = count < free ? count : free;
+            for (size_t i = 0; i < n; ++i)
+            {
+                m_buffer[(tail + i) & m_mask] = std::move(items[i]);
+            }
+            if (n)
+            {
+                m_tail.store(tail + n, std::memory_order_release);
+            }
+            return n;
+        }
+
+        // 批量出队,返回实际出队个数
+        size_t popBatch(T *items, size_t count)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            size_t avail = m_cachedTail - head;
+            if (avail < count)
+            {
+                m_cachedTail = m_tail.load(std::memory_order_acquire);
+                avail = m_cachedTail - head;
+            }
+            size_t n = count < avail ? count : avail;
+            for (size_t i = 0; i < n; ++i)
+            {
+                items[i] = std::move(m_buffer[(head + i) & m_mask]);
+            }
+            if (n)
+            {
+                m_head.store(head + n, std::memory_order_release);
+            }
+            return n;
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+        size_t size() const
+        {
+            return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+        }
+        bool empty() const { return size() == 0; }
+
+    private:
+        SPSCRingQueue(const SPSCRingQueue &) = delete;
+        SPSCRingQueue &operator=(const SPSCRingQueue &) = delete;
+
+    private:
+        // 消费端
+        alignas(SLTJ_CACHELINE_SIZE) std::atomic<size_t> m_head{0};
+        size_t m_cachedTail = 0; // 消费者看到的tail缓存,减少对生产端缓存行的读取
+        // 生产端
+        alignas(SLTJ_CACHELINE_SIZE) std::atomic<size_t> m_tail{0};
+        size_t m_cachedHead = 0; // 生产者看到的head缓存
+        // 只读部分
+        alignas(SLTJ_CACHELINE_SIZE) const size_t m_mask;
+        std::unique_ptr<T[]> m_buffer;
+    };
+
+    // Vyukov序号槽位: seq == pos 表示可写, seq == pos + 1 表示可读
+    template <class T>
+    struct RingQueueCell
+    {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    // 多生产者多消费者
+    template <class T>
+    class MPMCRingQueue
+    {
+    public:
+        using ptr = std::shared_ptr<MPMCRingQueue>;
+        using value_type = T;
+
+        explicit MPMCRingQueue(size_t capacity)
+            : m_mask(RoundUpPowerOfTwo(capacity) - 1),
+              m_cells(new RingQueueCell<T>[m_mask + 1])
+        {
+            for (size_t i = 0; i <= m_mask; ++i)
+            {
+                m_cells[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool tryPush(const T &v)
+        {
+            T tmp(v);
+            return tryPush(std::move(tmp));
+        }
+
+        bool tryPush(T &&v)
+        {
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            RingQueueCell<T> *cell;
+            for (;;)
+            {
+                cell = &m_cells[pos & m_mask];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+                if (dif == 0)
+                {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return false; // 满
+                }
+                else
+                {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+            cell->data = std::move(v);
+            cell->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T &v)
+        {
+            size_t pos = m_head.load(std::memory_order_relaxed);
+            RingQueueCell<T> *cell;
+            for (;;)
+            {
+                cell = &m_cells[pos & m_mask];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (dif == 0)
+                {
+                    if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return false; // 空
+                }
+                else
+                {
+                    pos = m_head.load(std::memory_order_relaxed);
+                }
+            }
+            v = std::move(cell->data);
+            cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 一次CAS占用连续的count个空槽,返回实际入队个数
+        size_t pushBatch(T *items, size_t count)
+        {
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            size_t n = claim(m_tail, pos, count, 0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                RingQueueCell<T> &cell = m_cells[(pos + i) & m_mask];
+                cell.data = std::move(items[i]);
+                cell.seq.store(pos + i + 1, std::memory_order_release);
+            }
+            return n;
+        }
+
+        // 一次CAS取走连续的count个已就绪槽,返回实际出队个数
+        size_t popBatch(T *items, size_t count)
+        {
+            size_t pos = m_head.load(std::memory_order_relaxed);
+            size_t n = claim(m_head, pos, count, 1);
+            for (size_t i = 0; i < n; ++i)
+            {
+                RingQueueCell<T> &cell = m_cells[(pos + i) & m_mask];
+                items[i] = std::move(cell.data);
+                cell.seq.store(pos + i + m_mask + 1, std::memory_order_release);
+            }
+            return n;
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+        size_t size() const
+        {
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            size_t head = m_head.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+        bool empty() const { return size() == 0; }
+
+    protected:
+        // 从pos开始查找seq == pos + i + ready的连续槽位并CAS推进index,
+        // 成功后pos为占到的起始位置,返回占到的个数(0表示满/空)
+        size_t claim(std::atomic<size_t> &index, size_t &pos, size_t count, size_t ready)
+        {
+            if (count > m_mask + 1)
+            {
+                count = m_mask + 1;
+            }
+            for (;;)
+            {
+                size_t n = 0;
+                intptr_t dif = 0;
+                while (n < count)
+                {
+                    size_t seq = m_cells[(pos + n) & m_mask].seq.load(std::memory_order_acquire);
+                    dif = (intptr_t)seq - (intptr_t)(pos + n + ready);
+                    if (dif != 0)
+                    {
+                        break;
+                    }
+                    ++n;
+                }
+                if (n == 0)
+                {
+                    if (dif < 0)
+                    {
+                        return 0;
+                    }
+                    pos = index.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (index.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+                {
+                    return n;
+                }
+            }
+        }
+
+    private:
+        MPMCRingQueue(const MPMCRingQueue &) = delete;
+        MPMCRingQueue &operator=(const MPMCRingQueue &) = delete;
+
+    protected:
+        alignas(SLTJ_CACHELINE_SIZE) std::atomic<size_t> m_head{0}; // 出队位置
+        alignas(SLTJ_CACHELINE_SIZE) std::atomic<size_t> m_tail{0}; // 入队位置
+        alignas(SLTJ_CACHELINE_SIZE) const size_t m_mask;
+        std::unique_ptr<RingQueueCell<T>[]> m_cells;
+    };
+
+    // 多生产者单消费者: 生产端与MPMC相同,消费端只有一个线程,出队无需CAS
+    template <class T>
+    class MPSCRingQueue : public MPMCRingQueue<T>
+    {
+    public:
+        using ptr = std::shared_ptr<MPSCRingQueue>;
+        using value_type = T;
+        using MPMCRingQueue<T>::m_head;
+        using MPMCRingQueue<T>::m_mask;
+        using MPMCRingQueue<T>::m_cells;
+
+        explicit MPSCRingQueue(size_t capacity)
+            : MPMCRingQueue<T>(capacity)
+        {
+        }
+
+        bool tryPop(T &v)
+        {
+            size_t pos = m_head.load(std::memory_order_relaxed);
+            RingQueueCell<T> &cell = m_cells[pos & m_mask];
+            if (cell.seq.load(std::memory_order_acquire) != pos + 1)
+            {
+                return false;
+            }
+            v = std::move(cell.data);
+            cell.seq.store(pos + m_mask + 1, std::memory_order_release);
+            m_head.store(pos + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        size_t popBatch(T *items, size_t count)
+        {
+            size_t pos = m_head.load(std::memory_order_relaxed);
+            size_t n = 0;
+            while (n < count)
+            {
+                RingQueueCell<T> &cell = m_cells[(pos + n) & m_mask];
+                if (cell.seq.load(std::memory_order_acquire) != pos + n + 1)
+                {
+                    break;
+                }
+                items[n] = std::move(cell.data);
+                cell.seq.store(pos + n + m_mask + 1, std::memory_order_release);
+                ++n;
+            }
+            if (n)
+            {
+                m_head.store(pos + n, std::memory_order_relaxed);
+            }
+            return n;
+        }
+    };
+
+    // 可阻塞队列: m_items计数可读元素, m_spaces计数空闲槽位
+    // Queue为上面任一环形队列, 并发约束与Queue一致
+    template <class Queue>
+    class BlockingQueue
+    {
+    public:
+        using ptr = std::shared_ptr<BlockingQueue>;
+        using value_type = typename Queue::value_type;
+
+        explicit BlockingQueue(size_t capacity)
+            : m_queue(capacity),
+              m_items(0),
+              m_spaces(m_queue.capacity())
+        {
+        }
+
+        // 队列满时阻塞
+        void push(value_type v)
+        {
+            m_spaces.wait();
+            pushReserved(v);
+            m_items.notify();
+        }
+
+        bool tryPush(value_type v)
+        {
+            if (!m_spaces.tryWait())
+            {
+                return false;
+            }
+            pushReserved(v);
+            m_items.notify();
+            return true;
+        }
+
+        // 队列空时阻塞
+        void pop(value_type &v)
+        {
+            m_items.wait();
+            popReserved(v);
+            m_spaces.notify();
+        }
+
+        bool tryPop(value_type &v)
+        {
+            if (!m_items.tryWait())
+            {
+                return false;
+            }
+            popReserved(v);
+            m_spaces.notify();
+            return true;
+        }
+
+        // 至少等到一个元素, 之后尽量多取, 返回出队个数
+        size_t popBatch(value_type *items, size_t count)
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+            m_items.wait();
+            size_t reserved = 1;
+            while (reserved < count && m_items.tryWait())
+            {
+                ++reserved;
+            }
+            size_t n = 0;
+            while (n < reserved)
+            {
+                size_t rt = m_queue.popBatch(items + n, reserved - n);
+                if (rt == 0)
+                {
+                    sched_yield();
+                }
+                n += rt;
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                m_spaces.notify();
+            }
+            return n;
+        }
+
+        size_t capacity() const { return m_queue.capacity(); }
+        size_t size() const { return m_queue.size(); }
+        bool empty() const { return m_queue.empty(); }
+
+    private:
+        // 已拿到信号量名额, 槽位可能因其他线程尚未完成读写而暂时不可用, 让出后重试
+        void pushReserved(value_type &v)
+        {
+            while (!m_queue.tryPush(std::move(v)))
+            {
+                sched_yield();
+            }
+        }
+        void popReserved(value_type &v)
+        {
+            while (!m_queue.tryPop(v))
+            {
+                sched_yield();
+            }
+        }
+
+    private:
+        Queue m_queue;
+        Semaphore m_items;
+        Semaphore m_spaces;
+    };
+
+} // namespace sltj
+
+#endif
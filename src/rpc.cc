@@ -0,0 +1,304 @@
+#include "rpc.h"
+#include "config.h"
+#include "log.h"
+#include "metrics.h"
+#include "scheduler.h"
+
+#include <errno.h>
+#include <string.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_rpc_max_body_size =
+        sltj::Config::Lookup<uint32_t>("rpc.max_body_size", 16 * 1024 * 1024, "max rpc frame body size, larger frames close the connection");
+
+    namespace
+    {
+        struct RpcMetrics
+        {
+            Counter::ptr framesSent = Metrics::Lookup<Counter>("rpc.frames_sent", "rpc frames sent");
+            Counter::ptr writes = Metrics::Lookup<Counter>("rpc.writes", "rpc send syscalls, several frames may share one");
+            Counter::ptr framesRecv = Metrics::Lookup<Counter>("rpc.frames_recv", "rpc frames received");
+            Counter::ptr badFrames = Metrics::Lookup<Counter>("rpc.bad_frames", "rpc connections closed on an invalid frame");
+        };
+
+        static RpcMetrics *GetRpcMetrics()
+        {
+            static RpcMetrics *s_metrics = new RpcMetrics;
+            return s_metrics;
+        }
+    } // namespace
+
+    // 每次接收至少留出的空间
+    static const size_t s_min_read_size = 4096;
+
+    void RpcHeader::encode(char *buf) const
+    {
+        buf[0] = magic >> 8;
+        buf[1] = magic & 0xff;
+        buf[2] = version;
+        buf[3] = flags;
+        for (int i = 0; i < 4; ++i)
+        {
+            buf[4 + i] = seq >> (24 - 8 * i);
+            buf[8 + i] = length >> (24 - 8 * i);
+        }
+    }
+
+    bool RpcHeader::decode(const char *buf)
+    {
+        const uint8_t *p = (const uint8_t *)buf;
+        magic = (p[0] << 8) | p[1];
+        version = p[2];
+        flags = p[3];
+        seq = ((uint32_t)p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+        length = ((uint32_t)p[8] << 24) | (p[9] << 16) | (p[10] << 8) | p[11];
+        return magic == MAGIC && version == VERSION;
+    }
+
+    size_t RpcCodec::EncodeVarint(uint64_t v, char *buf)
+    {
+        size_t n = 0;
+        while (v >= 0x80)
+        {
+            buf[n++] = (char)(v | 0x80);
+            v >>= 7;
+        }
+        buf[n++] = (char)v;
+        return n;
+    }
+
+    size_t RpcCodec::DecodeVarint(const char *p, size_t len, uint64_t &v)
+    {
+        v = 0;
+        for (size_t i = 0; i < len && i < 10; ++i)
+        {
+            uint8_t b = p[i];
+            v |= (uint64_t)(b & 0x7f) << (7 * i);
+            if (!(b & 0x80))
+            {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+
+    void RpcCodec::EncodeRequest(IOBuffer &out, uint32_t seq, bool oneway, const std::string &method,
+                                 const void *payload, size_t len)
+    {
+        char varint[10];
+        size_t vn = EncodeVarint(method.size(), varint);
+        RpcHeader hdr;
+        hdr.flags = oneway ? RpcHeader::ONEWAY : 0;
+        hdr.seq = seq;
+        hdr.length = vn + method.size() + len;
+        // 帧一次写入发送缓冲区, 只搬移一次
+        char *p = out.prepare(RpcHeader::SIZE + hdr.length);
+        hdr.encode(p);
+        p += RpcHeader::SIZE;
+        memcpy(p, varint, vn);
+        memcpy(p + vn, method.data(), method.size());
+        if (len)
+        {
+            memcpy(p + vn + method.size(), payload, len);
+        }
+        out.commit(RpcHeader::SIZE + hdr.length);
+    }
+
+    void RpcCodec::EncodeResponse(IOBuffer &out, uint32_t seq, uint32_t status, const void *payload, size_t len)
+    {
+        char varint[10];
+        size_t vn = EncodeVarint(status, varint);
+        RpcHeader hdr;
+        hdr.flags = RpcHeader::RESPONSE;
+        hdr.seq = seq;
+        hdr.length = vn + len;
+        char *p = out.prepare(RpcHeader::SIZE + hdr.length);
+        hdr.encode(p);
+        p += RpcHeader::SIZE;
+        memcpy(p, varint, vn);
+        if (len)
+        {
+            memcpy(p + vn, payload, len);
+        }
+        out.commit(RpcHeader::SIZE + hdr.length);
+    }
+
+    bool RpcCodec::DecodeRequest(const BufferSlice &body, RpcRequest &req)
+    {
+        uint64_t mlen;
+        size_t vn = DecodeVarint(body.data(), body.size(), mlen);
+        if (!vn || mlen > body.size() - vn)
+        {
+            return false;
+        }
+        req.method.assign(body.data() + vn, mlen);
+        req.payload = body.sub(vn + mlen, body.size() - vn - mlen);
+        return true;
+    }
+
+    bool RpcCodec::DecodeResponse(const BufferSlice &body, uint32_t &status, BufferSlice &payload)
+    {
+        uint64_t v;
+        size_t vn = DecodeVarint(body.data(), body.size(), v);
+        if (!vn || v > UINT32_MAX)
+        {
+            return false;
+        }
+        status = v;
+        payload = body.sub(vn, body.size() - vn);
+        return true;
+    }
+
+    RpcSession::RpcSession(Socket::ptr sock)
+        : m_sock(sock), m_maxBodySize(g_rpc_max_body_size->getValue())
+    {
+    }
+
+    RpcSession::~RpcSession()
+    {
+        close();
+    }
+
+    bool RpcSession::recvFrame(RpcHeader &hdr, BufferSlice &body)
+    {
+        // 上一帧在返回时已消费, 缓冲区中剩余的是后续帧(流水线的请求/响应)
+        while (m_in.size() < RpcHeader::SIZE)
+        {
+            if (readSome() <= 0)
+            {
+                return false;
+            }
+        }
+        if (!hdr.decode(m_in.data()) || hdr.length > m_maxBodySize)
+        {
+            GetRpcMetrics()->badFrames->inc();
+            SLTJ_LOG_DEBUG(g_logger) << "rpc bad frame magic=" << hdr.magic << " version=" << (int)hdr.version
+                                     << " length=" << hdr.length << " peer:" << *m_sock;
+            return false;
+        }
+        size_t total = RpcHeader::SIZE + hdr.length;
+        while (m_in.size() < total)
+        {
+            if (readSome() <= 0)
+            {
+                return false;
+            }
+        }
+        body = m_in.slice(RpcHeader::SIZE, hdr.length);
+        m_in.consume(total);
+        GetRpcMetrics()->framesRecv->inc();
+        return true;
+    }
+
+    int RpcSession::readSome()
+    {
+        for (;;)
+        {
+            char *buf = m_in.prepare(s_min_read_size);
+            int rt = m_sock->tryRecv(buf, m_in.writable());
+            if (rt > 0)
+            {
+                m_in.commit(rt);
+                return rt;
+            }
+            int err = errno;
+            if (m_in.empty())
+            {
+                m_in.clear();
+            }
+            if (rt == 0 || err != EAGAIN)
+            {
+                errno = err;
+                return rt;
+            }
+            if (!m_sock->waitReadable())
+            {
+                return -1;
+            }
+        }
+    }
+
+    bool RpcSession::sendRequest(uint32_t seq, bool oneway, const std::string &method, const void *payload, size_t len)
+    {
+        Mutex::Lock lock(m_outMutex);
+        if (!isConnected())
+        {
+            return false;
+        }
+        RpcCodec::EncodeRequest(m_out, seq, oneway, method, payload, len);
+        return queueLocked(lock);
+    }
+
+    bool RpcSession::sendResponse(uint32_t seq, uint32_t status, const void *payload, size_t len)
+    {
+        Mutex::Lock lock(m_outMutex);
+        if (!isConnected())
+        {
+            return false;
+        }
+        RpcCodec::EncodeResponse(m_out, seq, status, payload, len);
+        return queueLocked(lock);
+    }
+
+    bool RpcSession::queueLocked(Mutex::Lock &lock)
+    {
+        GetRpcMetrics()->framesSent->inc();
+        if (m_sending)
+        {
+            return true;
+        }
+        m_sending = true;
+        // 排到调度队列末尾, 已就绪的协程先把各自的帧放进来
+        Scheduler *scheduler = Scheduler::GetThis();
+        if (scheduler && Fiber::GetFiberId() != 0)
+        {
+            scheduler->schedule(std::bind(&RpcSession::flush, shared_from_this()));
+            return true;
+        }
+        lock.unlock();
+        flush();
+        return isConnected();
+    }
+
+    void RpcSession::flush()
+    {
+        Mutex::Lock lock(m_outMutex);
+        while (!m_out.empty())
+        {
+            // 发送期间新的帧写入m_out, 本轮发完后继续发送
+            IOBuffer out(std::move(m_out));
+            lock.unlock();
+            size_t sent = 0;
+            while (sent < out.size())
+            {
+                int rt = m_sock->send(out.data() + sent, out.size() - sent);
+                GetRpcMetrics()->writes->inc();
+                if (rt <= 0)
+                {
+                    break;
+                }
+                sent += rt;
+            }
+            bool ok = sent == out.size();
+            out.clear();
+            lock.lock();
+            if (!ok)
+            {
+                SLTJ_LOG_DEBUG(g_logger) << "rpc send fail errno=" << errno << " peer:" << *m_sock;
+                m_out.clear();
+                m_sock->close();
+                break;
+            }
+        }
+        m_sending = false;
+    }
+
+    void RpcSession::close()
+    {
+        m_sock->close();
+    }
+
+} // namespace sltj
@@ -0,0 +1,123 @@
+#ifndef __SLTJ_RPC_H__
+#define __SLTJ_RPC_H__
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+#include "buffer_pool.h"
+#include "socket.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // RPC帧头, 固定12字节, 网络字节序: magic(2) version(1) flags(1) seq(4) length(4), 之后是length字节的body
+    // 请求body: method(varint长度 + 字节) payload(其余字节)
+    // 响应body: status(varint) payload(其余字节), status非0时payload为错误信息
+    struct RpcHeader
+    {
+        static const uint16_t MAGIC = 0x534c; // "SL"
+        static const uint8_t VERSION = 1;
+        static const size_t SIZE = 12;
+
+        enum Flags
+        {
+            RESPONSE = 0x1, // 响应帧, 否则为请求
+            ONEWAY = 0x2,   // 请求不需要响应
+        };
+
+        uint16_t magic = MAGIC;
+        uint8_t version = VERSION;
+        uint8_t flags = 0;
+        uint32_t seq = 0;
+        uint32_t length = 0;
+
+        void encode(char *buf) const;
+        // magic/version不符返回false
+        bool decode(const char *buf);
+    };
+
+    // 响应状态, 0以外的值也可由处理函数自定义
+    enum class RpcStatus : uint32_t
+    {
+        OK = 0,
+        METHOD_NOT_FOUND = 1,
+        BAD_REQUEST = 2,
+        HANDLER_ERROR = 3,
+    };
+
+    // 服务端收到的请求, payload是接收缓冲区中的切片
+    struct RpcRequest
+    {
+        using ptr = std::shared_ptr<RpcRequest>;
+        uint32_t seq = 0;
+        bool oneway = false;
+        std::string method;
+        BufferSlice payload;
+    };
+
+    // 服务端的响应, 由处理函数填写
+    struct RpcResponse
+    {
+        using ptr = std::shared_ptr<RpcResponse>;
+        uint32_t status = 0;
+        std::string payload;
+    };
+
+    // 帧的编解码
+    class RpcCodec
+    {
+    public:
+        // varint: 每字节7位, 低位在前; 返回写入的字节数(最多10)
+        static size_t EncodeVarint(uint64_t v, char *buf);
+        // 成功返回读取的字节数, 数据不完整或超过10字节返回0
+        static size_t DecodeVarint(const char *p, size_t len, uint64_t &v);
+
+        static void EncodeRequest(IOBuffer &out, uint32_t seq, bool oneway, const std::string &method,
+                                  const void *payload, size_t len);
+        static void EncodeResponse(IOBuffer &out, uint32_t seq, uint32_t status, const void *payload, size_t len);
+        // 从body解出请求的method与payload, 格式错误返回false
+        static bool DecodeRequest(const BufferSlice &body, RpcRequest &req);
+        static bool DecodeResponse(const BufferSlice &body, uint32_t &status, BufferSlice &payload);
+    };
+
+    // 一个RPC连接上的帧收发, 服务端与客户端共用
+    // 接收缓冲区与发送缓冲区从BufferPool借用, 没有数据时不占用.
+    // 任意线程/协程可同时send: 帧先编码进发送缓冲区, 协程中由调度到当前调度器队尾的flush任务发出,
+    // 同一轮调度中产生的请求/响应(流水线)合并成一次write; 非协程环境直接发送
+    class RpcSession : public std::enable_shared_from_this<RpcSession>
+    {
+    public:
+        using ptr = std::shared_ptr<RpcSession>;
+
+        RpcSession(Socket::ptr sock);
+        ~RpcSession();
+
+        // 读取下一帧, body为接收缓冲区中的切片; 连接关闭、出错或帧不合法返回false
+        bool recvFrame(RpcHeader &hdr, BufferSlice &body);
+        // 连接已断开返回false; 发送失败时关闭连接, 由读协程感知
+        bool sendRequest(uint32_t seq, bool oneway, const std::string &method, const void *payload, size_t len);
+        bool sendResponse(uint32_t seq, uint32_t status, const void *payload, size_t len);
+        void close();
+
+        Socket::ptr getSocket() const { return m_sock; }
+        bool isConnected() const { return m_sock->isConnected(); }
+
+    private:
+        // 调用方持有m_outMutex, 帧已在m_out中
+        bool queueLocked(Mutex::Lock &lock);
+        // 发出m_out中的全部帧
+        void flush();
+        int readSome();
+
+    private:
+        Socket::ptr m_sock;
+        uint32_t m_maxBodySize;
+        IOBuffer m_in; // 只由读协程访问
+        Mutex m_outMutex;
+        IOBuffer m_out;
+        bool m_sending = false; // 已有flush任务或正在发送
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,280 @@
+#include "rpc_client.h"
+#include "log.h"
+
+#include <sstream>
+#include <vector>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    std::string RpcResult::toString() const
+    {
+        std::stringstream ss;
+        ss << "[RpcResult result=" << (int)result
+           << " status=" << status
+           << " error=" << error
+           << " payload_size=" << payload.size()
+           << "]";
+        return ss.str();
+    }
+
+    RpcClient::RpcClient(IOManager *iom)
+        : m_iom(iom ? iom : IOManager::GetThis())
+    {
+    }
+
+    RpcClient::~RpcClient()
+    {
+        close();
+    }
+
+    bool RpcClient::connect(Address::ptr addr, uint64_t timeout_ms)
+    {
+        if (!m_iom)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "rpc client connect without IOManager, addr:" << *addr;
+            return false;
+        }
+        Socket::ptr sock = Socket::CreateTCP(addr);
+        if (!sock->connect(addr, timeout_ms))
+        {
+            SLTJ_LOG_DEBUG(g_logger) << "rpc client connect fail, addr:" << *addr << " errno=" << errno;
+            return false;
+        }
+        close();
+        RpcSession::ptr session(new RpcSession(sock));
+        {
+            MutexType::Lock lock(m_mutex);
+            m_session = session;
+        }
+        m_iom->schedule(std::bind(&RpcClient::ReadLoop, std::weak_ptr<RpcClient>(shared_from_this()), session));
+        return true;
+    }
+
+    void RpcClient::close()
+    {
+        RpcSession::ptr session;
+        {
+            MutexType::Lock lock(m_mutex);
+            session.swap(m_session);
+        }
+        if (!session)
+        {
+            return;
+        }
+        // 读协程等待在iom上, 只有在iom中关闭才能取消其等待的事件
+        if (IOManager::GetThis() == m_iom)
+        {
+            session->close();
+        }
+        else
+        {
+            m_iom->schedule(std::bind(&RpcSession::close, session));
+        }
+        failAll("client closed");
+    }
+
+    bool RpcClient::isConnected() const
+    {
+        MutexType::Lock lock(m_mutex);
+        return m_session && m_session->isConnected();
+    }
+
+    size_t RpcClient::getPendingCount()
+    {
+        MutexType::Lock lock(m_mutex);
+        return m_pending.size();
+    }
+
+    bool RpcClient::takePending(uint32_t seq, Pending &pending)
+    {
+        MutexType::Lock lock(m_mutex);
+        auto it = m_pending.find(seq);
+        if (it == m_pending.end())
+        {
+            return false;
+        }
+        pending = std::move(it->second);
+        m_pending.erase(it);
+        return true;
+    }
+
+    void RpcClient::failAll(const std::string &error)
+    {
+        std::unordered_map<uint32_t, Pending> pending;
+        {
+            MutexType::Lock lock(m_mutex);
+            pending.swap(m_pending);
+        }
+        for (auto &i : pending)
+        {
+            if (i.second.timer)
+            {
+                i.second.timer->cancel();
+            }
+            i.second.cb(std::make_shared<RpcResult>(RpcResult::Error::CONNECTION_CLOSED, error));
+        }
+    }
+
+    void RpcClient::ReadLoop(std::weak_ptr<RpcClient> weak, RpcSession::ptr session)
+    {
+        RpcHeader hdr;
+        BufferSlice body;
+        while (session->recvFrame(hdr, body))
+        {
+            RpcClient::ptr client = weak.lock();
+            if (!client)
+            {
+                break;
+            }
+            RpcResult::ptr result(new RpcResult(RpcResult::Error::OK, ""));
+            if (!(hdr.flags & RpcHeader::RESPONSE) || !RpcCodec::DecodeResponse(body, result->status, result->payload))
+            {
+                SLTJ_LOG_DEBUG(g_logger) << "rpc client recv bad frame, seq=" << hdr.seq;
+                break;
+            }
+            Pending pending;
+            // 已超时的调用
+            if (!client->takePending(hdr.seq, pending))
+            {
+                continue;
+            }
+            if (pending.timer)
+            {
+                pending.timer->cancel();
+            }
+            pending.cb(result);
+        }
+        session->close();
+
+        RpcClient::ptr client = weak.lock();
+        if (!client)
+        {
+            return;
+        }
+        {
+            MutexType::Lock lock(client->m_mutex);
+            if (client->m_session != session)
+            {
+                // 已由close/connect处理
+                return;
+            }
+            client->m_session.reset();
+        }
+        client->failAll("connection closed");
+    }
+
+    void RpcClient::callAsync(const std::string &method, const std::string &payload, uint64_t timeout_ms, Callback cb)
+    {
+        RpcSession::ptr session;
+        {
+            MutexType::Lock lock(m_mutex);
+            session = m_session;
+        }
+        if (!session || !session->isConnected())
+        {
+            cb(std::make_shared<RpcResult>(RpcResult::Error::NOT_CONNECTED, "not connected"));
+            return;
+        }
+
+        uint32_t seq = ++m_seq;
+        {
+            MutexType::Lock lock(m_mutex);
+            m_pending[seq].cb = cb;
+        }
+        // 先登记再发送, 响应可能在send返回前到达; timeout_ms为-1时不限时
+        Timer::ptr timer;
+        if (timeout_ms != (uint64_t)-1)
+        {
+            std::weak_ptr<RpcClient> weak(shared_from_this());
+            timer = m_iom->addConditionTimer(timeout_ms, [weak, seq, timeout_ms]() {
+                RpcClient::ptr client = weak.lock();
+                Pending pending;
+                if (client && client->takePending(seq, pending))
+                {
+                    pending.cb(std::make_shared<RpcResult>(RpcResult::Error::TIMEOUT,
+                                                           "timeout_ms:" + std::to_string(timeout_ms)));
+                }
+            }, weak);
+            MutexType::Lock lock(m_mutex);
+            auto it = m_pending.find(seq);
+            if (it == m_pending.end())
+            {
+                lock.unlock();
+                timer->cancel();
+                return;
+            }
+            it->second.timer = timer;
+        }
+
+        if (!session->sendRequest(seq, false, method, payload.data(), payload.size()))
+        {
+            Pending pending;
+            if (takePending(seq, pending))
+            {
+                if (timer)
+                {
+                    timer->cancel();
+                }
+                pending.cb(std::make_shared<RpcResult>(RpcResult::Error::SEND_FAIL,
+                                                       "send request fail, errno:" + std::to_string(errno)));
+            }
+        }
+    }
+
+    namespace
+    {
+        // 等待调用完成的协程或线程
+        struct CallWaiter
+        {
+            Fiber::ptr fiber;
+            Scheduler *scheduler = nullptr;
+            Semaphore sem;
+            RpcResult::ptr result;
+        };
+    } // namespace
+
+    RpcResult::ptr RpcClient::call(const std::string &method, const std::string &payload, uint64_t timeout_ms)
+    {
+        std::shared_ptr<CallWaiter> w(new CallWaiter);
+        Scheduler *scheduler = Scheduler::GetThis();
+        if (scheduler && Fiber::GetFiberId() != 0)
+        {
+            w->fiber = Fiber::GetThis();
+            w->scheduler = scheduler;
+        }
+        // 回调只会执行一次
+        callAsync(method, payload, timeout_ms, [w](RpcResult::ptr result) {
+            w->result = result;
+            if (w->fiber)
+            {
+                w->scheduler->schedule(w->fiber);
+            }
+            else
+            {
+                w->sem.notify();
+            }
+        });
+        if (w->fiber)
+        {
+            Fiber::YieldToHold();
+        }
+        else
+        {
+            w->sem.wait();
+        }
+        return w->result;
+    }
+
+    bool RpcClient::notify(const std::string &method, const std::string &payload)
+    {
+        RpcSession::ptr session;
+        {
+            MutexType::Lock lock(m_mutex);
+            session = m_session;
+        }
+        return session && session->sendRequest(++m_seq, true, method, payload.data(), payload.size());
+    }
+
+} // namespace sltj
@@ -0,0 +1,95 @@
+#ifndef __SLTJ_RPC_CLIENT_H__
+#define __SLTJ_RPC_CLIENT_H__
+
+#include <memory>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <atomic>
+#include "rpc.h"
+#include "iomanager.h"
+#include "address.h"
+
+namespace sltj
+{
+    // 一次RPC调用的结果
+    struct RpcResult
+    {
+        using ptr = std::shared_ptr<RpcResult>;
+
+        enum class Error
+        {
+            OK = 0,
+            NOT_CONNECTED,
+            SEND_FAIL,
+            TIMEOUT,
+            // 等待响应期间连接断开
+            CONNECTION_CLOSED,
+        };
+
+        RpcResult(Error _result, const std::string &_error)
+            : result(_result), error(_error)
+        {
+        }
+
+        std::string toString() const;
+
+        Error result;
+        // result为OK时有效, 服务端返回的状态(RpcStatus或处理函数自定义)
+        uint32_t status = 0;
+        // 接收缓冲区中的切片
+        BufferSlice payload;
+        std::string error;
+    };
+
+    // RPC客户端, 一个连接上同时进行任意多个调用
+    // 请求带递增的seq, 响应按seq匹配, 不要求按序返回; 每个调用一个定时器, 超时后迟到的响应被丢弃.
+    // 连接的读协程运行在iom上, 连接断开时所有未完成的调用以CONNECTION_CLOSED结束. 需由shared_ptr持有
+    class RpcClient : public std::enable_shared_from_this<RpcClient>
+    {
+    public:
+        using ptr = std::shared_ptr<RpcClient>;
+        using MutexType = Mutex;
+        // 在读协程或定时器中回调, 不要在回调中阻塞
+        using Callback = std::function<void(RpcResult::ptr)>;
+
+        // iom为空时取当前线程的IOManager
+        RpcClient(IOManager *iom = nullptr);
+        ~RpcClient();
+
+        bool connect(Address::ptr addr, uint64_t timeout_ms = -1);
+        void close();
+        bool isConnected() const;
+        // 等待响应的调用数
+        size_t getPendingCount();
+
+        // timeout_ms为-1时不限时, 只在连接断开时结束
+        void callAsync(const std::string &method, const std::string &payload, uint64_t timeout_ms, Callback cb);
+        // 协程中只挂起当前协程, 其他线程阻塞等待
+        RpcResult::ptr call(const std::string &method, const std::string &payload, uint64_t timeout_ms);
+        // 单向调用, 服务端不返回响应
+        bool notify(const std::string &method, const std::string &payload);
+
+    private:
+        struct Pending
+        {
+            Callback cb;
+            Timer::ptr timer;
+        };
+
+        static void ReadLoop(std::weak_ptr<RpcClient> weak, RpcSession::ptr session);
+        // 取出seq对应的调用, 已完成(超时)返回false
+        bool takePending(uint32_t seq, Pending &pending);
+        void failAll(const std::string &error);
+
+    private:
+        IOManager *m_iom;
+        RpcSession::ptr m_session;
+        std::atomic<uint32_t> m_seq{0};
+        mutable MutexType m_mutex;
+        std::unordered_map<uint32_t, Pending> m_pending;
+    };
+
+} // namespace sltj
+
+#endif
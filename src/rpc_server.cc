@@ -0,0 +1,94 @@
+#include "rpc_server.h"
+#include "log.h"
+
+#include <exception>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    RpcServer::RpcServer(IOManager *worker, IOManager *io_worker, IOManager *accept_worker)
+        : TcpServer(io_worker, accept_worker), m_worker(worker ? worker : m_ioWorker)
+    {
+        setName("sltj-rpc/1.0.0");
+    }
+
+    void RpcServer::registerMethod(const std::string &method, Handler handler)
+    {
+        RWMutex::WriteMutex lock(m_mutex);
+        m_methods[method] = handler;
+    }
+
+    // 在worker上执行处理函数并发回响应
+    static void RunHandler(RpcSession::ptr session, RpcServer::Handler handler, RpcRequest::ptr req)
+    {
+        RpcResponse::ptr rsp(new RpcResponse);
+        try
+        {
+            handler(req, rsp);
+        }
+        catch (std::exception &e)
+        {
+            rsp->status = (uint32_t)RpcStatus::HANDLER_ERROR;
+            rsp->payload = e.what();
+        }
+        catch (...)
+        {
+            rsp->status = (uint32_t)RpcStatus::HANDLER_ERROR;
+            rsp->payload = "unknown exception";
+        }
+        if (!req->oneway)
+        {
+            session->sendResponse(req->seq, rsp->status, rsp->payload.data(), rsp->payload.size());
+        }
+    }
+
+    void RpcServer::handleClient(Socket::ptr client)
+    {
+        RpcSession::ptr session(new RpcSession(client));
+        RpcHeader hdr;
+        BufferSlice body;
+        while (session->recvFrame(hdr, body))
+        {
+            if (hdr.flags & RpcHeader::RESPONSE)
+            {
+                SLTJ_LOG_DEBUG(g_logger) << "rpc server recv response frame, client:" << *client;
+                break;
+            }
+            RpcRequest::ptr req(new RpcRequest);
+            req->seq = hdr.seq;
+            req->oneway = hdr.flags & RpcHeader::ONEWAY;
+            if (!RpcCodec::DecodeRequest(body, *req))
+            {
+                static const std::string s_bad = "bad request body";
+                if (!req->oneway)
+                {
+                    session->sendResponse(hdr.seq, (uint32_t)RpcStatus::BAD_REQUEST, s_bad.data(), s_bad.size());
+                }
+                continue;
+            }
+
+            Handler handler;
+            {
+                RWMutex::ReadMutex lock(m_mutex);
+                auto it = m_methods.find(req->method);
+                if (it != m_methods.end())
+                {
+                    handler = it->second;
+                }
+            }
+            if (!handler)
+            {
+                if (!req->oneway)
+                {
+                    std::string msg = "method not found: " + req->method;
+                    session->sendResponse(hdr.seq, (uint32_t)RpcStatus::METHOD_NOT_FOUND, msg.data(), msg.size());
+                }
+                continue;
+            }
+            m_worker->schedule(std::bind(&RunHandler, session, handler, req));
+        }
+        session->close();
+    }
+
+} // namespace sltj
@@ -0,0 +1,41 @@
+#ifndef __SLTJ_RPC_SERVER_H__
+#define __SLTJ_RPC_SERVER_H__
+
+#include <memory>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include "tcp_server.h"
+#include "rpc.h"
+
+namespace sltj
+{
+    // RPC服务器
+    // 每个连接一个读协程, 只负责拆帧; 请求投递到worker调度器上执行处理函数, 同一连接上的请求并发处理,
+    // 响应按完成顺序发回, 由客户端按seq匹配
+    class RpcServer : public TcpServer
+    {
+    public:
+        using ptr = std::shared_ptr<RpcServer>;
+        // 处理函数填写rsp; 抛出异常时返回HANDLER_ERROR, 异常信息作为payload
+        using Handler = std::function<void(RpcRequest::ptr req, RpcResponse::ptr rsp)>;
+
+        // worker为空时在io调度器上执行处理函数
+        RpcServer(IOManager *worker = nullptr, IOManager *io_worker = nullptr, IOManager *accept_worker = nullptr);
+
+        // 在start之前注册
+        void registerMethod(const std::string &method, Handler handler);
+        IOManager *getWorker() const { return m_worker; }
+
+    protected:
+        void handleClient(Socket::ptr client) override;
+
+    private:
+        IOManager *m_worker;
+        RWMutex m_mutex;
+        std::unordered_map<std::string, Handler> m_methods;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,264 @@
+#include "scheduler.h"
+#include "log.h"
+#include "object_pool.h"
+#include "trace.h"
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static thread_local Scheduler *t_scheduler = nullptr;  // 当前线程所属调度器
+    static thread_local Fiber *t_scheduler_fiber = nullptr; // 工作线程主协程
+
+    Scheduler::Scheduler(size_t threads, const std::string &name)
+        : m_name(name.empty() ? "scheduler" : name)
+    {
+        m_threadCount = threads ? threads : 1;
+    }
+
+    Scheduler::~Scheduler()
+    {
+        if (!m_stopping)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Scheduler " << m_name << " destroyed without stop()";
+        }
+        if (GetThis() == this)
+        {
+            t_scheduler = nullptr;
+        }
+    }
+
+    Scheduler *Scheduler::GetThis()
+    {
+        return t_scheduler;
+    }
+
+    Fiber *Scheduler::GetMainFiber()
+    {
+        return t_scheduler_fiber;
+    }
+
+    void Scheduler::setThis()
+    {
+        t_scheduler = this;
+    }
+
+    void Scheduler::start()
+    {
+        MutexType::Lock lock(m_mutex);
+        if (!m_stopping)
+        {
+            return;
+        }
+        m_stopping = false;
+
+        m_threads.resize(m_threadCount);
+        for (size_t i = 0; i < m_threadCount; ++i)
+        {
+            m_threads[i].reset(new Thread(std::bind(&Scheduler::run, this),
+                                          m_name + "_" + std::to_string(i)));
+            m_threadIds.push_back(m_threads[i]->getId());
+        }
+    }
+
+    void Scheduler::stop()
+    {
+        if (GetThis() == this)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "Scheduler::stop called from its own worker thread, name=" << m_name;
+            return;
+        }
+        m_autoStop = true;
+        if (m_stopping && m_threads.empty())
+        {
+            return;
+        }
+        m_stopping = true;
+        for (size_t i = 0; i < m_threadCount; ++i)
+        {
+            tickle();
+        }
+
+        std::vector<Thread::ptr> thrs;
+        {
+            MutexType::Lock lock(m_mutex);
+            thrs.swap(m_threads);
+        }
+
+        for (auto &i : thrs)
+        {
+            i->join();
+        }
+    }
+
+    void Scheduler::run()
+    {
+        SLTJ_LOG_DEBUG(g_logger) << m_name << " run";
+        setThis();
+        t_scheduler_fiber = Fiber::GetThis().get();
+
+        Fiber::ptr idle_fiber(new Fiber(std::bind(&Scheduler::idle, this)));
+        Fiber::ptr cb_fiber;
+
+        FiberAndThread ft;
+        int my_id = GetThreadId();
+        while (true)
+        {
+            ft.reset();
+            bool tickle_me = false;
+            bool is_active = false;
+            {
+                MutexType::Lock lock(m_mutex);
+                auto it = m_fibers.begin();
+                while (it != m_fibers.end())
+                {
+                    if (it->thread != -1 && it->thread != my_id)
+                    {
+                        ++it;
+                        tickle_me = true;
+                        continue;
+                    }
+
+                    // 协程刚让出, 还未在原线程上完全切出
+                    if (it->fiber && it->fiber->getState() == Fiber::EXEC)
+                    {
+                        ++it;
+                        tickle_me = true;
+                        continue;
+                    }
+
+                    ft = *it;
+                    m_fibers.erase(it++);
+                    ++m_activeThreadCount;
+                    is_active = true;
+                    break;
+                }
+                tickle_me |= it != m_fibers.end();
+            }
+
+            if (tickle_me)
+            {
+                tickle();
+            }
+
+            if (ft.fiber && (ft.fiber->getState() != Fiber::TERM && ft.fiber->getState() != Fiber::EXCEPT))
+            {
+                {
+                    SLTJ_TRACE_SCOPE("Scheduler::resume");
+                    ft.fiber->swapIn();
+                }
+                --m_activeThreadCount;
+
+                if (ft.fiber->getState() == Fiber::READY)
+                {
+                    schedule(ft.fiber);
+                }
+                else if (ft.fiber->getState() != Fiber::TERM && ft.fiber->getState() != Fiber::EXCEPT)
+                {
+                    ft.fiber->m_state = Fiber::HOLD;
+                }
+                ft.reset();
+            }
+            else if (ft.cb)
+            {
+                if (cb_fiber)
+                {
+                    cb_fiber->reset(ft.cb);
+                }
+                else
+                {
+                    // 协程对象与控制块从对象池分配, 栈仍单独申请
+                    cb_fiber = ObjectPool<Fiber>::MakeShared(ft.cb);
+                }
+                ft.reset();
+                {
+                    SLTJ_TRACE_SCOPE("Scheduler::callback");
+                    cb_fiber->swapIn();
+                }
+                --m_activeThreadCount;
+                if (cb_fiber->getState() == Fiber::READY)
+                {
+                    schedule(cb_fiber);
+                    cb_fiber.reset();
+                }
+                else if (cb_fiber->getState() == Fiber::EXCEPT || cb_fiber->getState() == Fiber::TERM)
+                {
+                    // 执行完毕, 保留栈空间给下一个回调
+                    cb_fiber->reset(nullptr);
+                }
+                else
+                {
+                    // 挂起等待事件, 由事件持有
+                    cb_fiber->m_state = Fiber::HOLD;
+                    cb_fiber.reset();
+                }
+            }
+            else
+            {
+                if (is_active)
+                {
+                    --m_activeThreadCount;
+                    continue;
+                }
+                if (idle_fiber->getState() == Fiber::TERM)
+                {
+                    SLTJ_LOG_DEBUG(g_logger) << m_name << " idle fiber term";
+                    break;
+                }
+
+                ++m_idleThreadCount;
+                idle_fiber->swapIn();
+                --m_idleThreadCount;
+                if (idle_fiber->getState() != Fiber::TERM && idle_fiber->getState() != Fiber::EXCEPT)
+                {
+                    idle_fiber->m_state = Fiber::HOLD;
+                }
+            }
+        }
+    }
+
+    void Scheduler::tickle()
+    {
+    }
+
+    bool Scheduler::stopping()
+    {
+        MutexType::Lock lock(m_mutex);
+        return m_autoStop && m_stopping && m_fibers.empty() && m_activeThreadCount == 0;
+    }
+
+    bool Scheduler::hasPendingTasks()
+    {
+        MutexType::Lock lock(m_mutex);
+        return !m_fibers.empty();
+    }
+
+    void Scheduler::idle()
+    {
+        while (!stopping())
+        {
+            Fiber::YieldToHold();
+        }
+    }
+
+    std::ostream &Scheduler::dump(std::ostream &os)
+    {
+        os << "[Scheduler name=" << m_name
+           << " size=" << m_threadCount
+           << " active_count=" << m_activeThreadCount
+           << " idle_count=" << m_idleThreadCount
+           << " stopping=" << m_stopping
+           << " ]" << std::endl
+           << "    ";
+        for (size_t i = 0; i < m_threadIds.size(); ++i)
+        {
+            if (i)
+            {
+                os << ", ";
+            }
+            os << m_threadIds[i];
+        }
+        return os;
+    }
+
+} // namespace sltj
@@ -0,0 +1,163 @@
+#ifndef __SLTJ_SCHEDULER_H__
+#define __SLTJ_SCHEDULER_H__
+
+#include <memory>
+#include <vector>
+#include <list>
+#include <string>
+#include <atomic>
+#include "fiber.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // 协程调度器: N个工作线程从任务队列中取协程/回调执行
+    class Scheduler
+    {
+    public:
+        using ptr = std::shared_ptr<Scheduler>;
+        using MutexType = Mutex;
+
+        Scheduler(size_t threads = 1, const std::string &name = "");
+        virtual ~Scheduler();
+
+        const std::string &getName() const { return m_name; }
+        size_t getThreadCount() const { return m_threadCount; }
+        // 工作线程id, start之后有效
+        std::vector<int> getThreadIds() const { return m_threadIds; }
+
+        // 当前线程所属的调度器, 非工作线程返回nullptr
+        static Scheduler *GetThis();
+        // 当前工作线程的主协程
+        static Fiber *GetMainFiber();
+
+        void start();
+        // 等待任务全部完成后停止所有工作线程
+        void stop();
+
+        // thread为-1时任意线程执行, 否则只在该线程id上执行
+        template <class FiberOrCb>
+        void schedule(FiberOrCb fc, int thread = -1)
+        {
+            bool need_tickle = false;
+            {
+                MutexType::Lock lock(m_mutex);
+                need_tickle = scheduleNoLock(fc, thread);
+            }
+
+            if (need_tickle)
+            {
+                tickle();
+            }
+        }
+
+        template <class InputIterator>
+        void schedule(InputIterator begin, InputIterator end)
+        {
+            bool need_tickle = false;
+            {
+                MutexType::Lock lock(m_mutex);
+                while (begin != end)
+                {
+                    need_tickle = scheduleNoLock(&*begin, -1) || need_tickle;
+                    ++begin;
+                }
+            }
+            if (need_tickle)
+            {
+                tickle();
+            }
+        }
+
+        std::ostream &dump(std::ostream &os);
+
+    protected:
+        // 通知有新任务
+        virtual void tickle();
+        // 工作线程主循环
+        void run();
+        // 是否可以停止
+        virtual bool stopping();
+        // 无任务时执行的协程
+        virtual void idle();
+
+        void setThis();
+
+        bool hasIdleThreads() { return m_idleThreadCount > 0; }
+        // 任务队列是否非空, idle在阻塞等待前检查, 避免与schedule之间丢失唤醒
+        bool hasPendingTasks();
+
+    private:
+        template <class FiberOrCb>
+        bool scheduleNoLock(FiberOrCb fc, int thread)
+        {
+            bool need_tickle = m_fibers.empty();
+            FiberAndThread ft(fc, thread);
+            if (ft.fiber || ft.cb)
+            {
+                m_fibers.push_back(ft);
+            }
+            return need_tickle;
+        }
+
+    private:
+        // 任务: 协程或回调, 可指定线程
+        struct FiberAndThread
+        {
+            Fiber::ptr fiber;
+            std::function<void()> cb;
+            int thread;
+
+            FiberAndThread(Fiber::ptr f, int thr)
+                : fiber(f), thread(thr)
+            {
+            }
+
+            FiberAndThread(Fiber::ptr *f, int thr)
+                : thread(thr)
+            {
+                fiber.swap(*f);
+            }
+
+            FiberAndThread(std::function<void()> f, int thr)
+                : cb(f), thread(thr)
+            {
+            }
+
+            FiberAndThread(std::function<void()> *f, int thr)
+                : thread(thr)
+            {
+                cb.swap(*f);
+            }
+
+            FiberAndThread()
+                : thread(-1)
+            {
+            }
+
+            void reset()
+            {
+                fiber = nullptr;
+                cb = nullptr;
+                thread = -1;
+            }
+        };
+
+    private:
+        MutexType m_mutex;
+        std::vector<Thread::ptr> m_threads;
+        std::list<FiberAndThread> m_fibers; // 待执行任务
+        std::string m_name;
+
+    protected:
+        std::vector<int> m_threadIds;
+        size_t m_threadCount = 0;
+        std::atomic<size_t> m_activeThreadCount{0};
+        std::atomic<size_t> m_idleThreadCount{0};
+        bool m_stopping = true;
+        bool m_autoStop = false;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,211 @@
+#include "servlet.h"
+
+#include <fnmatch.h>
+#include <string.h>
+
+namespace sltj
+{
+    FunctionServlet::FunctionServlet(callback cb)
+        : Servlet("FunctionServlet"), m_cb(cb)
+    {
+    }
+
+    int32_t FunctionServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                    HttpSession::ptr session)
+    {
+        return m_cb(request, response, session);
+    }
+
+    NotFoundServlet::NotFoundServlet(const std::string &name)
+        : Servlet("NotFoundServlet")
+    {
+        m_content = "<html><head><title>404 Not Found</title></head>"
+                    "<body><center><h1>404 Not Found</h1></center>"
+                    "<hr><center>" + name + "</center></body></html>";
+    }
+
+    int32_t NotFoundServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                    HttpSession::ptr session)
+    {
+        response->setStatus(HttpStatus::NOT_FOUND);
+        response->setHeader("Content-Type", "text/html");
+        response->setBody(m_content);
+        return 0;
+    }
+
+    static const char *GetContentType(const std::string &path)
+    {
+        static const struct
+        {
+            const char *ext;
+            const char *type;
+        } s_types[] = {
+            {".html", "text/html"},
+            {".htm", "text/html"},
+            {".css", "text/css"},
+            {".js", "application/javascript"},
+            {".json", "application/json"},
+            {".txt", "text/plain"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".gif", "image/gif"},
+            {".svg", "image/svg+xml"},
+        };
+        size_t pos = path.rfind('.');
+        if (pos != std::string::npos && path.find('/', pos) == std::string::npos)
+        {
+            for (auto &i : s_types)
+            {
+                if (strcasecmp(path.c_str() + pos, i.ext) == 0)
+                {
+                    return i.type;
+                }
+            }
+        }
+        return "application/octet-stream";
+    }
+
+    StaticFileServlet::StaticFileServlet(const std::string &root, const std::string &prefix)
+        : Servlet("StaticFileServlet"), m_root(root), m_prefix(prefix)
+    {
+    }
+
+    int32_t StaticFileServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                      HttpSession::ptr session)
+    {
+        std::string path = request->getPath();
+        if (path.compare(0, m_prefix.size(), m_prefix) == 0)
+        {
+            path = path.substr(m_prefix.size());
+        }
+        // 不允许跳出root目录
+        if (path.find("..") != std::string::npos)
+        {
+            response->setStatus(HttpStatus::FORBIDDEN);
+            return 0;
+        }
+        if (path.empty() || path[path.size() - 1] == '/')
+        {
+            path += "index.html";
+        }
+        if (path[0] != '/')
+        {
+            path = "/" + path;
+        }
+
+        HttpFileBody::ptr file = HttpFileBody::Open(m_root + path);
+        if (!file)
+        {
+            response->setStatus(HttpStatus::NOT_FOUND);
+            return 0;
+        }
+        response->setHeader("Content-Type", GetContentType(path));
+        response->setFileBody(file);
+        return 0;
+    }
+
+    ServletDispatch::ServletDispatch()
+        : Servlet("ServletDispatch")
+    {
+        m_default.reset(new NotFoundServlet("sltj/1.0.0"));
+    }
+
+    int32_t ServletDispatch::handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                                    HttpSession::ptr session)
+    {
+        Servlet::ptr slt = getMatchedServlet(request->getPath());
+        if (slt)
+        {
+            return slt->handle(request, response, session);
+        }
+        return 0;
+    }
+
+    void ServletDispatch::addServlet(const std::string &uri, Servlet::ptr slt)
+    {
+        RWMutexType::WriteMutex lock(m_mutex);
+        m_datas[uri] = slt;
+    }
+
+    void ServletDispatch::addServlet(const std::string &uri, FunctionServlet::callback cb)
+    {
+        addServlet(uri, Servlet::ptr(new FunctionServlet(cb)));
+    }
+
+    void ServletDispatch::addGlobServlet(const std::string &uri, Servlet::ptr slt)
+    {
+        RWMutexType::WriteMutex lock(m_mutex);
+        for (auto it = m_globs.begin(); it != m_globs.end(); ++it)
+        {
+            if (it->first == uri)
+            {
+                m_globs.erase(it);
+                break;
+            }
+        }
+        m_globs.push_back(std::make_pair(uri, slt));
+    }
+
+    void ServletDispatch::addGlobServlet(const std::string &uri, FunctionServlet::callback cb)
+    {
+        addGlobServlet(uri, Servlet::ptr(new FunctionServlet(cb)));
+    }
+
+    void ServletDispatch::delServlet(const std::string &uri)
+    {
+        RWMutexType::WriteMutex lock(m_mutex);
+        m_datas.erase(uri);
+    }
+
+    void ServletDispatch::delGlobServlet(const std::string &uri)
+    {
+        RWMutexType::WriteMutex lock(m_mutex);
+        for (auto it = m_globs.begin(); it != m_globs.end(); ++it)
+        {
+            if (it->first == uri)
+            {
+                m_globs.erase(it);
+                break;
+            }
+        }
+    }
+
+    Servlet::ptr ServletDispatch::getServlet(const std::string &uri)
+    {
+        RWMutexType::ReadMutex lock(m_mutex);
+        auto it = m_datas.find(uri);
+        return it == m_datas.end() ? nullptr : it->second;
+    }
+
+    Servlet::ptr ServletDispatch::getGlobServlet(const std::string &uri)
+    {
+        RWMutexType::ReadMutex lock(m_mutex);
+        for (auto &i : m_globs)
+        {
+            if (fnmatch(i.first.c_str(), uri.c_str(), 0) == 0)
+            {
+                return i.second;
+            }
+        }
+        return nullptr;
+    }
+
+    Servlet::ptr ServletDispatch::getMatchedServlet(const std::string &uri)
+    {
+        RWMutexType::ReadMutex lock(m_mutex);
+        auto mit = m_datas.find(uri);
+        if (mit != m_datas.end())
+        {
+            return mit->second;
+        }
+        for (auto &i : m_globs)
+        {
+            if (fnmatch(i.first.c_str(), uri.c_str(), 0) == 0)
+            {
+                return i.second;
+            }
+        }
+        return m_default;
+    }
+
+} // namespace sltj
@@ -0,0 +1,116 @@
+#ifndef __SLTJ_SERVLET_H__
+#define __SLTJ_SERVLET_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "http.h"
+#include "http_session.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // 请求处理器
+    class Servlet
+    {
+    public:
+        using ptr = std::shared_ptr<Servlet>;
+
+        Servlet(const std::string &name) : m_name(name) {}
+        virtual ~Servlet() {}
+
+        // 返回0表示成功
+        virtual int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                               HttpSession::ptr session) = 0;
+
+        const std::string &getName() const { return m_name; }
+
+    protected:
+        std::string m_name;
+    };
+
+    // 以回调函数处理请求
+    class FunctionServlet : public Servlet
+    {
+    public:
+        using ptr = std::shared_ptr<FunctionServlet>;
+        using callback = std::function<int32_t(HttpRequest::ptr request, HttpResponse::ptr response,
+                                               HttpSession::ptr session)>;
+
+        FunctionServlet(callback cb);
+        int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                       HttpSession::ptr session) override;
+
+    private:
+        callback m_cb;
+    };
+
+    // 未匹配到路由时的默认处理, 返回404
+    class NotFoundServlet : public Servlet
+    {
+    public:
+        using ptr = std::shared_ptr<NotFoundServlet>;
+
+        NotFoundServlet(const std::string &name);
+        int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                       HttpSession::ptr session) override;
+
+    private:
+        std::string m_content;
+    };
+
+    // 静态文件: 请求路径去掉prefix后拼到root目录下, 文件内容用sendfile直接发送
+    class StaticFileServlet : public Servlet
+    {
+    public:
+        using ptr = std::shared_ptr<StaticFileServlet>;
+
+        StaticFileServlet(const std::string &root, const std::string &prefix = "");
+        int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                       HttpSession::ptr session) override;
+
+    private:
+        std::string m_root;
+        std::string m_prefix;
+    };
+
+    // 按路径分发请求: 先查精确路由(哈希表), 再按添加顺序匹配通配路由(fnmatch), 最后交给默认处理器
+    class ServletDispatch : public Servlet
+    {
+    public:
+        using ptr = std::shared_ptr<ServletDispatch>;
+        using RWMutexType = RWMutex;
+
+        ServletDispatch();
+        int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response,
+                       HttpSession::ptr session) override;
+
+        void addServlet(const std::string &uri, Servlet::ptr slt);
+        void addServlet(const std::string &uri, FunctionServlet::callback cb);
+        // uri为通配模式, 如/static/*
+        void addGlobServlet(const std::string &uri, Servlet::ptr slt);
+        void addGlobServlet(const std::string &uri, FunctionServlet::callback cb);
+
+        void delServlet(const std::string &uri);
+        void delGlobServlet(const std::string &uri);
+
+        Servlet::ptr getDefault() const { return m_default; }
+        void setDefault(Servlet::ptr v) { m_default = v; }
+
+        Servlet::ptr getServlet(const std::string &uri);
+        Servlet::ptr getGlobServlet(const std::string &uri);
+        // 精确 -> 通配 -> 默认
+        Servlet::ptr getMatchedServlet(const std::string &uri);
+
+    private:
+        RWMutexType m_mutex;
+        std::unordered_map<std::string, Servlet::ptr> m_datas;
+        std::vector<std::pair<std::string, Servlet::ptr>> m_globs;
+        Servlet::ptr m_default;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,408 @@
+#include "shm_log_appender.h"
+#include "metrics.h"
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    const char *const ShmLogRing::kPrefix = "sltj_log.";
+
+    namespace
+    {
+        static const uint32_t kMagic = 0x534c4f47; // "SLOG"
+        static const uint32_t kVersion = 1;
+        static const size_t kHeaderSize = 4096;
+
+        // 记录状态, 写者最后以release写入; 读者读完后把整条记录清零
+        enum RecordState : uint32_t
+        {
+            RECORD_EMPTY = 0,
+            RECORD_COMMITTED = 1,
+            RECORD_PADDING = 2 // 环尾放不下时的填充
+        };
+
+        // 记录头, 之后依次为文件名, 日志器名, 线程名, 内容; 整条按8字节对齐
+        struct ShmRecord
+        {
+            std::atomic<uint32_t> state;
+            uint32_t size;
+            uint8_t level;
+            uint8_t nameLen;
+            uint8_t threadNameLen;
+            uint8_t reserved;
+            int32_t line;
+            uint32_t threadId;
+            uint32_t fiberId;
+            uint32_t time;
+            uint32_t elapse;
+            uint16_t fileLen;
+            uint16_t reserved2;
+            uint32_t contentLen;
+        };
+        static_assert(sizeof(ShmRecord) % 8 == 0, "record header alignment");
+
+        static size_t Align8(size_t v)
+        {
+            return (v + 7) & ~(size_t)7;
+        }
+
+        static Counter::ptr GetShmDropped()
+        {
+            static Counter::ptr s_dropped = Metrics::Lookup<Counter>("log.shm.dropped", "log records dropped because the shared memory ring was full");
+            return s_dropped;
+        }
+
+        static std::atomic<uint32_t> s_ring_seq{0};
+    } // namespace
+
+    struct ShmLogRing::Header
+    {
+        std::atomic<uint32_t> magic; // 初始化完成后写入
+        uint32_t version;
+        uint64_t capacity;
+        int32_t pid;
+        std::atomic<uint32_t> closed;
+        char app[64];
+        alignas(64) std::atomic<uint64_t> head; // 写者预留到的位置
+        alignas(64) std::atomic<uint64_t> tail; // 读者读到的位置
+        alignas(64) std::atomic<uint64_t> dropped;
+    };
+    static_assert(sizeof(ShmLogRing::Header) <= kHeaderSize, "shm log header size");
+
+    ShmLogRing::ptr ShmLogRing::Create(const std::string &app, size_t capacity)
+    {
+        std::string safe = app.substr(0, 48);
+        for (auto &c : safe)
+        {
+            if (c == '/' || c == '.')
+            {
+                c = '_';
+            }
+        }
+        ShmLogRing::ptr ring(new ShmLogRing);
+        ring->m_writer = true;
+        ring->m_shmName = std::string(kPrefix) + safe + "." + std::to_string(getpid()) + "." + std::to_string(s_ring_seq++);
+        capacity = Align8(std::max<size_t>(capacity, 4096));
+        ring->m_mapSize = kHeaderSize + capacity;
+
+        std::string path = "/" + ring->m_shmName;
+        // 同名的是pid被复用前留下的, 直接替换
+        shm_unlink(path.c_str());
+        int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "ShmLogRing shm_open " << path << " errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            return nullptr;
+        }
+        if (ftruncate(fd, ring->m_mapSize))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "ShmLogRing ftruncate " << path << " size=" << ring->m_mapSize
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+            ::close(fd);
+            shm_unlink(path.c_str());
+            return nullptr;
+        }
+        void *base = mmap(nullptr, ring->m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "ShmLogRing mmap " << path << " errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            shm_unlink(path.c_str());
+            return nullptr;
+        }
+        ring->m_header = (Header *)base;
+        ring->m_data = (char *)base + kHeaderSize;
+
+        Header *h = ring->m_header;
+        h->version = kVersion;
+        h->capacity = capacity;
+        h->pid = getpid();
+        strncpy(h->app, app.c_str(), sizeof(h->app) - 1);
+        h->magic.store(kMagic, std::memory_order_release);
+        return ring;
+    }
+
+    ShmLogRing::ptr ShmLogRing::Open(const std::string &shm_name)
+    {
+        std::string path = "/" + shm_name;
+        int fd = shm_open(path.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) || (size_t)st.st_size <= kHeaderSize)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        void *base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        ShmLogRing::ptr ring(new ShmLogRing);
+        ring->m_shmName = shm_name;
+        ring->m_header = (Header *)base;
+        ring->m_data = (char *)base + kHeaderSize;
+        ring->m_mapSize = st.st_size;
+        Header *h = ring->m_header;
+        if (h->magic.load(std::memory_order_acquire) != kMagic || h->version != kVersion ||
+            h->capacity + kHeaderSize != (uint64_t)st.st_size)
+        {
+            return nullptr;
+        }
+        return ring;
+    }
+
+    ShmLogRing::~ShmLogRing()
+    {
+        if (m_header)
+        {
+            munmap(m_header, m_mapSize);
+        }
+    }
+
+    bool ShmLogRing::write(LogLevel::Level level, LogEvent::ptr &event)
+    {
+        Header *h = m_header;
+        const uint64_t cap = h->capacity;
+        const std::string &name = event->getName();
+        const std::string &threadName = event->getThreadName();
+        const char *file = event->getFile() ? event->getFile() : "";
+        size_t fileLen = std::min<size_t>(strlen(file), 65535);
+        size_t nameLen = std::min<size_t>(name.size(), 255);
+        size_t threadNameLen = std::min<size_t>(threadName.size(), 255);
+        size_t fixed = sizeof(ShmRecord) + fileLen + nameLen + threadNameLen;
+        // 单条记录不超过环的1/4, 超长内容截断
+        size_t content = std::min(event->getContentSize(), cap / 4 > fixed ? cap / 4 - fixed : 0);
+        size_t size = Align8(fixed + content);
+
+        uint64_t head = h->head.load(std::memory_order_relaxed);
+        uint64_t pos;
+        uint64_t need;
+        do
+        {
+            uint64_t tail = h->tail.load(std::memory_order_acquire);
+            pos = head % cap;
+            // 环尾剩余空间放不下时, 先用填充记录占满
+            need = size <= cap - pos ? size : cap - pos + size;
+            if (head + need - tail > cap)
+            {
+                h->dropped.fetch_add(1, std::memory_order_relaxed);
+                GetShmDropped()->inc();
+                return false;
+            }
+        } while (!h->head.compare_exchange_weak(head, head + need, std::memory_order_acq_rel));
+
+        // 预留后先写入长度: 写线程在提交前死掉时, 读者据此跳过这条记录, 继续读后面已提交的
+        ShmRecord *pad = nullptr;
+        if (need != size)
+        {
+            pad = (ShmRecord *)(m_data + pos);
+            pad->size = cap - pos;
+            pos = 0;
+        }
+        ShmRecord *rec = (ShmRecord *)(m_data + pos);
+        rec->size = size;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        if (pad)
+        {
+            pad->state.store(RECORD_PADDING, std::memory_order_release);
+        }
+
+        rec->level = level;
+        rec->nameLen = nameLen;
+        rec->threadNameLen = threadNameLen;
+        rec->line = event->getLine();
+        rec->threadId = event->getThreadId();
+        rec->fiberId = event->getFiberId();
+        rec->time = event->getTime();
+        rec->elapse = event->getElapse();
+        rec->fileLen = fileLen;
+        rec->contentLen = content;
+        char *p = (char *)(rec + 1);
+        memcpy(p, file, fileLen);
+        p += fileLen;
+        memcpy(p, name.data(), nameLen);
+        p += nameLen;
+        memcpy(p, threadName.data(), threadNameLen);
+        p += threadNameLen;
+        size_t done = 0;
+        while (done < content)
+        {
+            size_t n = event->readContent(done, p + done, content - done);
+            if (!n)
+            {
+                // 内容比预期短, 补空格保持记录长度
+                memset(p + done, ' ', content - done);
+                break;
+            }
+            done += n;
+        }
+        rec->state.store(RECORD_COMMITTED, std::memory_order_release);
+        return true;
+    }
+
+    size_t ShmLogRing::read(const std::function<void(const Record &)> &cb, size_t max)
+    {
+        Header *h = m_header;
+        const uint64_t cap = h->capacity;
+        uint64_t tail = h->tail.load(std::memory_order_relaxed);
+        uint64_t head = h->head.load(std::memory_order_acquire);
+        size_t n = 0;
+        Record r;
+        // 写者进程是否已退出, 遇到未提交的记录时才检查
+        int exited = -1;
+        while (tail < head && n < max)
+        {
+            ShmRecord *rec = (ShmRecord *)(m_data + tail % cap);
+            uint32_t state = rec->state.load(std::memory_order_acquire);
+            uint32_t size = rec->size;
+            if (state == RECORD_EMPTY)
+            {
+                if (exited < 0)
+                {
+                    exited = isWriterExited();
+                }
+                // 写者还在拷贝; 或已退出但死在写入长度之前, 无法定位下一条
+                if (!exited || size < 8 || size % 8 || size > cap - tail % cap || size > head - tail)
+                {
+                    break;
+                }
+                // 写者在预留之后、提交之前死掉, 跳过这条, 之后其他线程提交的记录照常读出
+                SLTJ_LOG_WARN(g_logger) << "ShmLogRing " << m_shmName << " skip uncommitted record size=" << size;
+                memset((void *)rec, 0, size);
+                tail += size;
+                continue;
+            }
+            if (size < 8 || size % 8 || size > cap - tail % cap)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "ShmLogRing " << m_shmName << " corrupted record size=" << size
+                                         << ", skip " << head - tail << " bytes";
+                memset(m_data, 0, cap);
+                tail = head;
+                break;
+            }
+            if (state == RECORD_COMMITTED)
+            {
+                const char *p = (const char *)(rec + 1);
+                r.level = (LogLevel::Level)rec->level;
+                r.line = rec->line;
+                r.threadId = rec->threadId;
+                r.fiberId = rec->fiberId;
+                r.time = rec->time;
+                r.elapse = rec->elapse;
+                r.file.assign(p, rec->fileLen);
+                p += rec->fileLen;
+                r.name.assign(p, rec->nameLen);
+                p += rec->nameLen;
+                r.threadName.assign(p, rec->threadNameLen);
+                p += rec->threadNameLen;
+                r.content = p;
+                r.contentLen = rec->contentLen;
+                cb(r);
+                ++n;
+            }
+            // 清零后写者复用这段空间时, 未提交的位置一定读到RECORD_EMPTY
+            memset((void *)rec, 0, size);
+            tail += size;
+        }
+        h->tail.store(tail, std::memory_order_release);
+        return n;
+    }
+
+    void ShmLogRing::close()
+    {
+        m_header->closed.store(1, std::memory_order_release);
+    }
+
+    std::string ShmLogRing::getApp() const
+    {
+        return std::string(m_header->app, strnlen(m_header->app, sizeof(m_header->app)));
+    }
+
+    pid_t ShmLogRing::getPid() const
+    {
+        return m_header->pid;
+    }
+
+    size_t ShmLogRing::getCapacity() const
+    {
+        return m_header->capacity;
+    }
+
+    uint64_t ShmLogRing::getDropped() const
+    {
+        return m_header->dropped.load(std::memory_order_relaxed);
+    }
+
+    bool ShmLogRing::isClosed() const
+    {
+        return m_header->closed.load(std::memory_order_acquire);
+    }
+
+    bool ShmLogRing::hasPending() const
+    {
+        return m_header->tail.load(std::memory_order_acquire) != m_header->head.load(std::memory_order_acquire);
+    }
+
+    bool ShmLogRing::isWriterExited() const
+    {
+        return kill(m_header->pid, 0) == -1 && errno == ESRCH;
+    }
+
+    bool ShmLogRing::isAbandoned() const
+    {
+        if (isClosed() && !hasPending())
+        {
+            return true;
+        }
+        return isWriterExited();
+    }
+
+    bool ShmLogRing::unlink()
+    {
+        return shm_unlink(("/" + m_shmName).c_str()) == 0;
+    }
+
+    ShmLogAppender::ShmLogAppender(const std::string &app, size_t capacity)
+    {
+        m_ring = ShmLogRing::Create(app.empty() ? program_invocation_short_name : app, capacity);
+    }
+
+    ShmLogAppender::~ShmLogAppender()
+    {
+        if (m_ring)
+        {
+            m_ring->close();
+        }
+    }
+
+    void ShmLogAppender::log(LogLevel::Level level, LogEvent::ptr event)
+    {
+        if (level < m_level)
+        {
+            return;
+        }
+        if (!m_ring)
+        {
+            GetShmDropped()->inc();
+            return;
+        }
+        m_ring->write(level, event);
+    }
+
+} // namespace sltj
@@ -0,0 +1,99 @@
+#ifndef __SLTJ_SHM_LOG_APPENDER_H__
+#define __SLTJ_SHM_LOG_APPENDER_H__
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "log.h"
+
+namespace sltj
+{
+    // 共享内存日志环(shm_open, /dev/shm/sltj_log.<app>.<pid>):
+    // 本进程多个线程CAS预留空间写入二进制记录, 独立进程sltj_logd作为唯一读者取走并格式化落盘.
+    // 写入进程崩溃时, 已提交到环中的记录仍由sltj_logd读出, 只丢失崩溃时正在拷贝的记录
+    class ShmLogRing
+    {
+    public:
+        using ptr = std::shared_ptr<ShmLogRing>;
+
+        static const char *const kPrefix; // 共享内存名前缀"sltj_log."
+
+        struct Header;
+
+        // 读者看到的一条记录, 指针指向环内, 只在回调中有效
+        struct Record
+        {
+            LogLevel::Level level;
+            int32_t line;
+            uint32_t threadId;
+            uint32_t fiberId;
+            uint32_t time;
+            uint32_t elapse;
+            std::string file;
+            std::string name;
+            std::string threadName;
+            const char *content;
+            size_t contentLen;
+        };
+
+        // 写者: 创建/打开失败返回nullptr
+        static ShmLogRing::ptr Create(const std::string &app, size_t capacity);
+        // 读者: shm_name为不带'/'的名字, 写者还未初始化完成时返回nullptr
+        static ShmLogRing::ptr Open(const std::string &shm_name);
+        ~ShmLogRing();
+
+        // 环满时丢弃并计数, 不阻塞
+        bool write(LogLevel::Level level, LogEvent::ptr &event);
+        // 按写入顺序读出最多max条已提交的记录, 返回条数.
+        // 遇到未提交的记录时停下等待写者; 写者进程已退出时跳过它, 继续读后面已提交的记录
+        size_t read(const std::function<void(const Record &)> &cb, size_t max = (size_t)-1);
+        // 写者退出(析构)时标记关闭
+        void close();
+
+        const std::string &getShmName() const { return m_shmName; }
+        std::string getApp() const;
+        pid_t getPid() const;
+        size_t getCapacity() const;
+        uint64_t getDropped() const;
+        bool isClosed() const;
+        // 环中还有未读的数据(包括写了一半的记录)
+        bool hasPending() const;
+        // 写者进程已退出, 或已关闭且剩余数据都已读出; 此后read能读出剩余的全部已提交记录
+        bool isAbandoned() const;
+        bool isWriterExited() const;
+        // 删除共享内存名字, 已映射的进程不受影响
+        bool unlink();
+
+    private:
+        ShmLogRing() = default;
+
+    private:
+        std::string m_shmName;
+        Header *m_header = nullptr;
+        char *m_data = nullptr;
+        size_t m_mapSize = 0;
+        bool m_writer = false;
+    };
+
+    // 日志写入共享内存环, 由sltj_logd负责格式化、写文件与滚动, 本进程不碰日志盘
+    class ShmLogAppender : public LogAppender
+    {
+    public:
+        using ptr = std::shared_ptr<ShmLogAppender>;
+
+        // app为空时取进程名; capacity为环的字节数
+        ShmLogAppender(const std::string &app = "", size_t capacity = 4 * 1024 * 1024);
+        virtual ~ShmLogAppender();
+
+        virtual void log(LogLevel::Level level, LogEvent::ptr event) override;
+
+        ShmLogRing::ptr getRing() const { return m_ring; }
+        uint64_t getDropped() const { return m_ring ? m_ring->getDropped() : 0; }
+
+    private:
+        ShmLogRing::ptr m_ring;
+    };
+
+} // namespace sltj
+
+#endif
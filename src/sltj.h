@@ -3,8 +3,45 @@
 
 #include "config.h"
 #include "util.h"
+#include "arena.h"
+#include "object_pool.h"
+#include "buffer_pool.h"
+#include "format.h"
 #include "log.h"
+#include "ring_buffer_log_appender.h"
+#include "remote_log_appender.h"
+#include "mmap_log_appender.h"
+#include "shm_log_appender.h"
+#include "log_index.h"
+#include "uring_log_appender.h"
+#include "metrics.h"
+#include "trace.h"
+#include "profiler.h"
+#include "crash.h"
+#include "macro.h"
 #include "thread.h"
 #include "singleton.h"
+#include "ringbuffer.h"
+#include "bytearray.h"
+#include "endian.h"
+#include "address.h"
+#include "socket.h"
+#include "stream.h"
+#include "socket_stream.h"
+#include "fiber.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "io_uring.h"
+#include "iomanager.h"
+#include "tcp_server.h"
+#include "http.h"
+#include "http_parser.h"
+#include "http_session.h"
+#include "servlet.h"
+#include "http_server.h"
+#include "http_connection.h"
+#include "rpc.h"
+#include "rpc_server.h"
+#include "rpc_client.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,851 @@
+#include "socket.h"
+#include "log.h"
+#include "util.h"
+#include "iomanager.h"
+
+#include <sstream>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    // 在IOManager的协程中: 注册事件后让出协程, 超时由条件定时器取消事件
+    // sock被close后(其fd不再等于fd)视为取消, 返回false且errno为EBADF
+    static bool WaitFdReadyInFiber(IOManager *iom, const Socket *sock, int fd, short events, int64_t timeout_ms)
+    {
+        IOManager::Event event = (events & POLLIN) ? IOManager::READ : IOManager::WRITE;
+        if (iom->addEvent(fd, event))
+        {
+            return false;
+        }
+        // close先置fd无效再取消事件, 注册晚于取消时在这里发现
+        if (sock->getSocket() != fd)
+        {
+            iom->delEvent(fd, event);
+            errno = EBADF;
+            return false;
+        }
+
+        std::shared_ptr<int> timed_out(new int(0));
+        Timer::ptr timer;
+        if (timeout_ms >= 0)
+        {
+            std::weak_ptr<int> wtimed_out(timed_out);
+            timer = iom->addConditionTimer(timeout_ms, [wtimed_out, fd, iom, event]() {
+                std::shared_ptr<int> t = wtimed_out.lock();
+                if (!t || *t)
+                {
+                    return;
+                }
+                *t = 1;
+                iom->cancelEvent(fd, event);
+            }, wtimed_out);
+        }
+
+        Fiber::YieldToHold();
+        if (timer)
+        {
+            timer->cancel();
+        }
+        if (*timed_out)
+        {
+            errno = ETIMEDOUT;
+            return false;
+        }
+        if (sock->getSocket() != fd)
+        {
+            errno = EBADF;
+            return false;
+        }
+        return true;
+    }
+
+    // 等待fd可读/可写, timeout_ms为-1时一直等待; 失败返回false并设置errno(超时为ETIMEDOUT)
+    // 在IOManager的协程中只挂起当前协程, 其他情况阻塞在poll上
+    static bool WaitFdReady(const Socket *sock, int fd, short events, int64_t timeout_ms)
+    {
+        IOManager *iom = IOManager::GetThis();
+        if (iom && Fiber::GetFiberId() != 0)
+        {
+            return WaitFdReadyInFiber(iom, sock, fd, events, timeout_ms);
+        }
+
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = events;
+        pfd.revents = 0;
+        int rt;
+        do
+        {
+            rt = poll(&pfd, 1, timeout_ms < 0 ? -1 : (int)timeout_ms);
+        } while (rt == -1 && errno == EINTR);
+        if (rt == 0)
+        {
+            errno = ETIMEDOUT;
+        }
+        return rt > 0;
+    }
+
+    // 在sock的非阻塞fd上执行fun, 返回EAGAIN时等待就绪再重试, 整体不超过timeout_ms
+    template <class F>
+    static ssize_t do_io(const Socket *sock, short events, int64_t timeout_ms, F fun)
+    {
+        int fd = sock->getSocket();
+        uint64_t deadline = timeout_ms < 0 ? 0 : GetCurrentMS() + timeout_ms;
+        for (;;)
+        {
+            ssize_t n;
+            do
+            {
+                n = fun();
+            } while (n == -1 && errno == EINTR);
+
+            if (n != -1 || errno != EAGAIN)
+            {
+                return n;
+            }
+
+            int64_t left = -1;
+            if (timeout_ms >= 0)
+            {
+                uint64_t now = GetCurrentMS();
+                left = now >= deadline ? 0 : deadline - now;
+            }
+            if (!WaitFdReady(sock, fd, events, left))
+            {
+                return -1;
+            }
+        }
+    }
+
+    // io_uring引擎的协程中收发/accept直接提交给内核, 完成后恢复协程, 返回nullptr时走就绪等待+非阻塞调用
+    static IOManager *GetUringIOManager()
+    {
+        IOManager *iom = IOManager::GetThis();
+        return iom && iom->getEngine() == IOManager::IO_URING && Fiber::GetFiberId() != 0 ? iom : nullptr;
+    }
+
+    // 操作期间sock被close(取消了进行中的请求)时按EBADF返回, 与就绪等待的路径一致
+    static ssize_t uring_result(const Socket *sock, int fd, ssize_t n)
+    {
+        if (n == -1 && sock->getSocket() != fd)
+        {
+            errno = EBADF;
+        }
+        return n;
+    }
+
+    Socket::ptr Socket::CreateTCP(sltj::Address::ptr address)
+    {
+        Socket::ptr sock(new Socket(address->getFamily(), TCP, 0));
+        return sock;
+    }
+
+    Socket::ptr Socket::CreateUDP(sltj::Address::ptr address)
+    {
+        Socket::ptr sock(new Socket(address->getFamily(), UDP, 0));
+        sock->newSock();
+        sock->m_isConnected = true;
+        return sock;
+    }
+
+    Socket::ptr Socket::CreateTCPSocket()
+    {
+        Socket::ptr sock(new Socket(IPv4, TCP, 0));
+        return sock;
+    }
+
+    Socket::ptr Socket::CreateUDPSocket()
+    {
+        Socket::ptr sock(new Socket(IPv4, UDP, 0));
+        sock->newSock();
+        sock->m_isConnected = true;
+        return sock;
+    }
+
+    Socket::ptr Socket::CreateTCPSocket6()
+    {
+        Socket::ptr sock(new Socket(IPv6, TCP, 0));
+        return sock;
+    }
+
+    Socket::ptr Socket::CreateUDPSocket6()
+    {
+        Socket::ptr sock(new Socket(IPv6, UDP, 0));
+        sock->newSock();
+        sock->m_isConnected = true;
+        return sock;
+    }
+
+    Socket::ptr Socket::CreateUnixTCPSocket()
+    {
+        Socket::ptr sock(new Socket(UNIX, TCP, 0));
+        return sock;
+    }
+
+    Socket::ptr Socket::CreateUnixUDPSocket()
+    {
+        Socket::ptr sock(new Socket(UNIX, UDP, 0));
+        sock->newSock();
+        sock->m_isConnected = true;
+        return sock;
+    }
+
+    Socket::Socket(int family, int type, int protocol)
+        : m_sock(-1),
+          m_family(family),
+          m_type(type),
+          m_protocol(protocol),
+          m_isConnected(false)
+    {
+    }
+
+    Socket::~Socket()
+    {
+        close();
+    }
+
+    bool Socket::getOption(int level, int option, void *result, socklen_t *len)
+    {
+        int rt = getsockopt(m_sock, level, option, result, (socklen_t *)len);
+        if (rt)
+        {
+            SLTJ_LOG_DEBUG(g_logger) << "getOption sock=" << m_sock
+                                     << " level=" << level << " option=" << option
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    bool Socket::setOption(int level, int option, const void *result, socklen_t len)
+    {
+        // SO_REUSEPORT等需要在bind之前设置, fd尚未创建时先创建
+        if (!isValid())
+        {
+            newSock();
+        }
+        if (setsockopt(m_sock, level, option, result, (socklen_t)len))
+        {
+            SLTJ_LOG_DEBUG(g_logger) << "setOption sock=" << m_sock
+                                     << " level=" << level << " option=" << option
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    bool Socket::setReuseAddr(bool v)
+    {
+        int val = v;
+        return setOption(SOL_SOCKET, SO_REUSEADDR, val);
+    }
+
+    bool Socket::setReusePort(bool v)
+    {
+        int val = v;
+        return setOption(SOL_SOCKET, SO_REUSEPORT, val);
+    }
+
+    bool Socket::setTcpNoDelay(bool v)
+    {
+        int val = v;
+        return setOption(IPPROTO_TCP, TCP_NODELAY, val);
+    }
+
+    bool Socket::setKeepAlive(bool v)
+    {
+        int val = v;
+        return setOption(SOL_SOCKET, SO_KEEPALIVE, val);
+    }
+
+    bool Socket::setRecvBufferSize(int v)
+    {
+        return setOption(SOL_SOCKET, SO_RCVBUF, v);
+    }
+
+    bool Socket::setSendBufferSize(int v)
+    {
+        return setOption(SOL_SOCKET, SO_SNDBUF, v);
+    }
+
+    Socket::ptr Socket::accept()
+    {
+        Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
+        int fd = m_sock;
+        int newsock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            newsock = uring_result(this, fd, iom->ioAccept(fd, m_recvTimeout));
+        }
+        else
+        {
+            newsock = do_io(this, POLLIN, m_recvTimeout, [fd]() {
+                return ::accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            });
+        }
+        if (newsock == -1)
+        {
+            // 超时或socket已被close(停止监听)时不记录错误
+            if (errno != ETIMEDOUT && isValid())
+            {
+                SLTJ_LOG_ERROR(g_logger) << "accept(" << m_sock << ") errno="
+                                         << errno << " errstr=" << strerror(errno);
+            }
+            return nullptr;
+        }
+        if (sock->init(newsock))
+        {
+            return sock;
+        }
+        return nullptr;
+    }
+
+    bool Socket::init(int sock)
+    {
+        m_sock = sock;
+        m_isConnected = true;
+        initSock();
+        getLocalAddress();
+        getRemoteAddress();
+        return true;
+    }
+
+    bool Socket::bind(const Address::ptr addr)
+    {
+        if (!isValid())
+        {
+            newSock();
+            if (!isValid())
+            {
+                return false;
+            }
+        }
+
+        if (addr->getFamily() != m_family)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "bind sock.family(" << m_family << ") addr.family("
+                                     << addr->getFamily() << ") not equal, addr=" << addr->toString();
+            return false;
+        }
+
+        UnixAddress::ptr uaddr = std::dynamic_pointer_cast<UnixAddress>(addr);
+        if (uaddr)
+        {
+            // 已有进程在监听则失败, 否则清理残留的socket文件
+            Socket::ptr sock(new Socket(UNIX, m_type, 0));
+            if (sock->connect(uaddr))
+            {
+                return false;
+            }
+            unlink(uaddr->getPath().c_str());
+        }
+
+        if (::bind(m_sock, addr->getAddr(), addr->getAddrLen()))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "bind error errno=" << errno
+                                     << " errstr=" << strerror(errno) << " addr=" << addr->toString();
+            return false;
+        }
+        getLocalAddress();
+        return true;
+    }
+
+    bool Socket::reconnect(uint64_t timeout_ms)
+    {
+        if (!m_remoteAddress)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "reconnect m_remoteAddress is null";
+            return false;
+        }
+        m_localAddress.reset();
+        return connect(m_remoteAddress, timeout_ms);
+    }
+
+    bool Socket::connect(const Address::ptr addr, uint64_t timeout_ms)
+    {
+        m_remoteAddress = addr;
+        if (!isValid())
+        {
+            newSock();
+            if (!isValid())
+            {
+                return false;
+            }
+        }
+
+        if (addr->getFamily() != m_family)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "connect sock.family(" << m_family << ") addr.family("
+                                     << addr->getFamily() << ") not equal, addr=" << addr->toString();
+            return false;
+        }
+
+        int rt;
+        do
+        {
+            rt = ::connect(m_sock, addr->getAddr(), addr->getAddrLen());
+        } while (rt == -1 && errno == EINTR);
+
+        if (rt == -1 && (errno == EINPROGRESS || errno == EAGAIN))
+        {
+            // 非阻塞connect, 等待可写后取SO_ERROR
+            if (WaitFdReady(this, m_sock, POLLOUT, (int64_t)timeout_ms))
+            {
+                int error = 0;
+                socklen_t len = sizeof(int);
+                if (getsockopt(m_sock, SOL_SOCKET, SO_ERROR, &error, &len) == -1)
+                {
+                    error = errno;
+                }
+                if (error == 0)
+                {
+                    rt = 0;
+                }
+                else
+                {
+                    errno = error;
+                }
+            }
+        }
+
+        if (rt)
+        {
+            SLTJ_LOG_DEBUG(g_logger) << "sock=" << m_sock << " connect(" << addr->toString()
+                                     << ") timeout=" << (int64_t)timeout_ms << " error errno="
+                                     << errno << " errstr=" << strerror(errno);
+            int err = errno;
+            close();
+            errno = err;
+            return false;
+        }
+        m_isConnected = true;
+        getRemoteAddress();
+        getLocalAddress();
+        return true;
+    }
+
+    bool Socket::listen(int backlog)
+    {
+        if (!isValid())
+        {
+            SLTJ_LOG_ERROR(g_logger) << "listen error sock=-1";
+            return false;
+        }
+        if (::listen(m_sock, backlog))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "listen error errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    bool Socket::close()
+    {
+        if (!m_isConnected && m_sock == -1)
+        {
+            return true;
+        }
+        m_isConnected = false;
+        if (m_sock != -1)
+        {
+            // 先置为无效再唤醒仍在等待该fd的协程, 被唤醒的协程据此退出而不是重新等待
+            int fd = m_sock;
+            m_sock = -1;
+            IOManager *iom = IOManager::GetThis();
+            if (iom)
+            {
+                iom->cancelAll(fd);
+            }
+            ::close(fd);
+        }
+        return true;
+    }
+
+    bool Socket::cancelRead()
+    {
+        IOManager *iom = IOManager::GetThis();
+        return iom && m_sock != -1 && iom->cancelEvent(m_sock, IOManager::READ);
+    }
+
+    bool Socket::cancelWrite()
+    {
+        IOManager *iom = IOManager::GetThis();
+        return iom && m_sock != -1 && iom->cancelEvent(m_sock, IOManager::WRITE);
+    }
+
+    bool Socket::cancelAccept()
+    {
+        return cancelRead();
+    }
+
+    bool Socket::cancelAll()
+    {
+        IOManager *iom = IOManager::GetThis();
+        return iom && m_sock != -1 && iom->cancelAll(m_sock);
+    }
+
+    int Socket::send(const void *buffer, size_t length, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            return uring_result(this, fd, iom->ioSend(fd, buffer, length, flags | MSG_NOSIGNAL, m_sendTimeout));
+        }
+        return do_io(this, POLLOUT, m_sendTimeout, [=]() {
+            return ::send(fd, buffer, length, flags | MSG_NOSIGNAL);
+        });
+    }
+
+    int Socket::send(const iovec *buffers, size_t length, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec *)buffers;
+        msg.msg_iovlen = length;
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            return uring_result(this, fd, iom->ioSendMsg(fd, &msg, flags | MSG_NOSIGNAL, m_sendTimeout));
+        }
+        return do_io(this, POLLOUT, m_sendTimeout, [fd, &msg, flags]() {
+            return ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL);
+        });
+    }
+
+    int Socket::sendTo(const void *buffer, size_t length, const Address::ptr to, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            iovec iov;
+            iov.iov_base = (void *)buffer;
+            iov.iov_len = length;
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_name = to->getAddr();
+            msg.msg_namelen = to->getAddrLen();
+            return uring_result(this, fd, iom->ioSendMsg(fd, &msg, flags | MSG_NOSIGNAL, m_sendTimeout));
+        }
+        return do_io(this, POLLOUT, m_sendTimeout, [=]() {
+            return ::sendto(fd, buffer, length, flags | MSG_NOSIGNAL, to->getAddr(), to->getAddrLen());
+        });
+    }
+
+    int Socket::sendTo(const iovec *buffers, size_t length, const Address::ptr to, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec *)buffers;
+        msg.msg_iovlen = length;
+        msg.msg_name = to->getAddr();
+        msg.msg_namelen = to->getAddrLen();
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            return uring_result(this, fd, iom->ioSendMsg(fd, &msg, flags | MSG_NOSIGNAL, m_sendTimeout));
+        }
+        return do_io(this, POLLOUT, m_sendTimeout, [fd, &msg, flags]() {
+            return ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL);
+        });
+    }
+
+    int64_t Socket::sendFile(int in_fd, off_t *offset, size_t count)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        int fd = m_sock;
+        return do_io(this, POLLOUT, m_sendTimeout, [fd, in_fd, offset, count]() {
+            return ::sendfile(fd, in_fd, offset, count);
+        });
+    }
+
+    int Socket::recv(void *buffer, size_t length, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            return uring_result(this, fd, iom->ioRecv(fd, buffer, length, flags, m_recvTimeout));
+        }
+        return do_io(this, POLLIN, m_recvTimeout, [=]() {
+            return ::recv(fd, buffer, length, flags);
+        });
+    }
+
+    int Socket::tryRecv(void *buffer, size_t length, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        ssize_t n;
+        do
+        {
+            n = ::recv(m_sock, buffer, length, flags | MSG_DONTWAIT);
+        } while (n == -1 && errno == EINTR);
+        return n;
+    }
+
+    bool Socket::waitReadable()
+    {
+        if (!isConnected())
+        {
+            errno = EBADF;
+            return false;
+        }
+        return WaitFdReady(this, m_sock, POLLIN, m_recvTimeout);
+    }
+
+    int Socket::recv(iovec *buffers, size_t length, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec *)buffers;
+        msg.msg_iovlen = length;
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            return uring_result(this, fd, iom->ioRecvMsg(fd, &msg, flags, m_recvTimeout));
+        }
+        return do_io(this, POLLIN, m_recvTimeout, [fd, &msg, flags]() {
+            return ::recvmsg(fd, &msg, flags);
+        });
+    }
+
+    int Socket::recvFrom(void *buffer, size_t length, Address::ptr from, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        socklen_t len = from->getAddrLen();
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            iovec iov;
+            iov.iov_base = buffer;
+            iov.iov_len = length;
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_name = from->getAddr();
+            msg.msg_namelen = len;
+            return uring_result(this, fd, iom->ioRecvMsg(fd, &msg, flags, m_recvTimeout));
+        }
+        return do_io(this, POLLIN, m_recvTimeout, [fd, buffer, length, flags, from, &len]() {
+            return ::recvfrom(fd, buffer, length, flags, from->getAddr(), &len);
+        });
+    }
+
+    int Socket::recvFrom(iovec *buffers, size_t length, Address::ptr from, int flags)
+    {
+        if (!isConnected())
+        {
+            return -1;
+        }
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (iovec *)buffers;
+        msg.msg_iovlen = length;
+        msg.msg_name = from->getAddr();
+        msg.msg_namelen = from->getAddrLen();
+        int fd = m_sock;
+        if (IOManager *iom = GetUringIOManager())
+        {
+            return uring_result(this, fd, iom->ioRecvMsg(fd, &msg, flags, m_recvTimeout));
+        }
+        return do_io(this, POLLIN, m_recvTimeout, [fd, &msg, flags]() {
+            return ::recvmsg(fd, &msg, flags);
+        });
+    }
+
+    Address::ptr Socket::getRemoteAddress()
+    {
+        if (m_remoteAddress)
+        {
+            return m_remoteAddress;
+        }
+
+        Address::ptr result;
+        switch (m_family)
+        {
+        case AF_INET:
+            result.reset(new IPv4Address());
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
+        default:
+            result.reset(new UnknownAddress(m_family));
+            break;
+        }
+        socklen_t addrlen = result->getAddrLen();
+        if (getpeername(m_sock, result->getAddr(), &addrlen))
+        {
+            return Address::ptr(new UnknownAddress(m_family));
+        }
+        if (m_family == AF_UNIX)
+        {
+            UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
+            addr->setAddrLen(addrlen);
+        }
+        m_remoteAddress = result;
+        return m_remoteAddress;
+    }
+
+    Address::ptr Socket::getLocalAddress()
+    {
+        if (m_localAddress)
+        {
+            return m_localAddress;
+        }
+
+        Address::ptr result;
+        switch (m_family)
+        {
+        case AF_INET:
+            result.reset(new IPv4Address());
+            break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
+        default:
+            result.reset(new UnknownAddress(m_family));
+            break;
+        }
+        socklen_t addrlen = result->getAddrLen();
+        if (getsockname(m_sock, result->getAddr(), &addrlen))
+        {
+            SLTJ_LOG_ERROR(g_logger) << "getsockname error sock=" << m_sock
+                                     << " errno=" << errno << " errstr=" << strerror(errno);
+            return Address::ptr(new UnknownAddress(m_family));
+        }
+        if (m_family == AF_UNIX)
+        {
+            UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
+            addr->setAddrLen(addrlen);
+        }
+        m_localAddress = result;
+        return m_localAddress;
+    }
+
+    bool Socket::isValid() const
+    {
+        return m_sock != -1;
+    }
+
+    int Socket::getError()
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (!getOption(SOL_SOCKET, SO_ERROR, &error, &len))
+        {
+            error = errno;
+        }
+        return error;
+    }
+
+    std::ostream &Socket::dump(std::ostream &os) const
+    {
+        os << "[Socket sock=" << m_sock
+           << " is_connected=" << m_isConnected
+           << " family=" << m_family
+           << " type=" << m_type
+           << " protocol=" << m_protocol;
+        if (m_localAddress)
+        {
+            os << " local_address=" << m_localAddress->toString();
+        }
+        if (m_remoteAddress)
+        {
+            os << " remote_address=" << m_remoteAddress->toString();
+        }
+        os << "]";
+        return os;
+    }
+
+    std::string Socket::toString() const
+    {
+        std::stringstream ss;
+        dump(ss);
+        return ss.str();
+    }
+
+    void Socket::initSock()
+    {
+        int flags = fcntl(m_sock, F_GETFL, 0);
+        if (!(flags & O_NONBLOCK))
+        {
+            fcntl(m_sock, F_SETFL, flags | O_NONBLOCK);
+        }
+        setReuseAddr(true);
+        if (m_type == SOCK_STREAM && m_family != AF_UNIX)
+        {
+            setTcpNoDelay(true);
+        }
+    }
+
+    void Socket::newSock()
+    {
+        m_sock = socket(m_family, m_type | SOCK_CLOEXEC, m_protocol);
+        if (m_sock != -1)
+        {
+            initSock();
+        }
+        else
+        {
+            SLTJ_LOG_ERROR(g_logger) << "socket(" << m_family
+                                     << ", " << m_type << ", " << m_protocol << ") errno="
+                                     << errno << " errstr=" << strerror(errno);
+        }
+    }
+
+    std::ostream &operator<<(std::ostream &os, const Socket &sock)
+    {
+        return sock.dump(os);
+    }
+
+} // namespace sltj
@@ -0,0 +1,146 @@
+#ifndef __SLTJ_SOCKET_H__
+#define __SLTJ_SOCKET_H__
+
+#include <memory>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "address.h"
+
+namespace sltj
+{
+    // socket封装
+    // fd内部始终为非阻塞, 对外提供带超时的阻塞语义: 操作返回EAGAIN时等待fd就绪后重试,
+    // 超时返回-1且errno为ETIMEDOUT. 在IOManager的协程中等待时只挂起当前协程, 不阻塞线程
+    class Socket : public std::enable_shared_from_this<Socket>
+    {
+    public:
+        using ptr = std::shared_ptr<Socket>;
+        using weak_ptr = std::weak_ptr<Socket>;
+
+        enum Type
+        {
+            TCP = SOCK_STREAM,
+            UDP = SOCK_DGRAM
+        };
+
+        enum Family
+        {
+            IPv4 = AF_INET,
+            IPv6 = AF_INET6,
+            UNIX = AF_UNIX
+        };
+
+        // 按地址类型创建
+        static Socket::ptr CreateTCP(sltj::Address::ptr address);
+        static Socket::ptr CreateUDP(sltj::Address::ptr address);
+
+        static Socket::ptr CreateTCPSocket();
+        static Socket::ptr CreateUDPSocket();
+        static Socket::ptr CreateTCPSocket6();
+        static Socket::ptr CreateUDPSocket6();
+        static Socket::ptr CreateUnixTCPSocket();
+        static Socket::ptr CreateUnixUDPSocket();
+
+        Socket(int family, int type, int protocol = 0);
+        virtual ~Socket();
+
+        // 超时时间(毫秒), -1表示不超时
+        int64_t getSendTimeout() const { return m_sendTimeout; }
+        void setSendTimeout(int64_t v) { m_sendTimeout = v; }
+        int64_t getRecvTimeout() const { return m_recvTimeout; }
+        void setRecvTimeout(int64_t v) { m_recvTimeout = v; }
+
+        bool getOption(int level, int option, void *result, socklen_t *len);
+        template <class T>
+        bool getOption(int level, int option, T &result)
+        {
+            socklen_t length = sizeof(T);
+            return getOption(level, option, &result, &length);
+        }
+
+        bool setOption(int level, int option, const void *result, socklen_t len);
+        template <class T>
+        bool setOption(int level, int option, const T &value)
+        {
+            return setOption(level, option, &value, sizeof(T));
+        }
+
+        // 常用选项
+        bool setReuseAddr(bool v);
+        bool setReusePort(bool v);
+        bool setTcpNoDelay(bool v);
+        bool setKeepAlive(bool v);
+        bool setRecvBufferSize(int v);
+        bool setSendBufferSize(int v);
+
+        // 等待新连接, 受recv超时控制, 失败返回nullptr
+        virtual Socket::ptr accept();
+        virtual bool bind(const Address::ptr addr);
+        virtual bool connect(const Address::ptr addr, uint64_t timeout_ms = -1);
+        virtual bool reconnect(uint64_t timeout_ms = -1);
+        virtual bool listen(int backlog = SOMAXCONN);
+        virtual bool close();
+
+        // 返回 >0 发送/接收的字节数, =0 对端关闭, <0 出错
+        virtual int send(const void *buffer, size_t length, int flags = 0);
+        virtual int send(const iovec *buffers, size_t length, int flags = 0);
+        virtual int sendTo(const void *buffer, size_t length, const Address::ptr to, int flags = 0);
+        virtual int sendTo(const iovec *buffers, size_t length, const Address::ptr to, int flags = 0);
+        virtual int recv(void *buffer, size_t length, int flags = 0);
+        virtual int recv(iovec *buffers, size_t length, int flags = 0);
+        virtual int recvFrom(void *buffer, size_t length, Address::ptr from, int flags = 0);
+        virtual int recvFrom(iovec *buffers, size_t length, Address::ptr from, int flags = 0);
+        // 只尝试一次非阻塞接收, 没有数据时返回-1且errno为EAGAIN
+        int tryRecv(void *buffer, size_t length, int flags = 0);
+        // 等待可读而不读取, 受recv超时控制; 与tryRecv配合, 没有数据时不必占着接收缓冲区等待
+        bool waitReadable();
+        // sendfile: 从文件in_fd的*offset处发送最多count字节, offset随之前移; 受send超时控制
+        virtual int64_t sendFile(int in_fd, off_t *offset, size_t count);
+
+        // 在IOManager中唤醒等待该socket的协程, 非IOManager线程返回false
+        bool cancelRead();
+        bool cancelWrite();
+        bool cancelAccept();
+        bool cancelAll();
+
+        Address::ptr getRemoteAddress();
+        Address::ptr getLocalAddress();
+
+        int getSocket() const { return m_sock; }
+        int getFamily() const { return m_family; }
+        int getType() const { return m_type; }
+        int getProtocol() const { return m_protocol; }
+        bool isConnected() const { return m_isConnected; }
+        bool isValid() const;
+        int getError();
+
+        virtual std::ostream &dump(std::ostream &os) const;
+        virtual std::string toString() const;
+
+    protected:
+        void initSock();
+        void newSock();
+        virtual bool init(int sock);
+
+    private:
+        Socket(const Socket &) = delete;
+        Socket &operator=(const Socket &) = delete;
+
+    protected:
+        int m_sock;
+        int m_family;
+        int m_type;
+        int m_protocol;
+        bool m_isConnected;
+        int64_t m_recvTimeout = -1;
+        int64_t m_sendTimeout = -1;
+        Address::ptr m_localAddress;
+        Address::ptr m_remoteAddress;
+    };
+
+    std::ostream &operator<<(std::ostream &os, const Socket &sock);
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __SLTJ_SOCKET_STREAM_H__
+#define __SLTJ_SOCKET_STREAM_H__
+
+#include "stream.h"
+#include "socket.h"
+
+namespace sltj
+{
+    // 基于Socket的流
+    // ByteArray的读写直接以其内部块作为iovec做readv/writev, 不经过中间缓冲
+    class SocketStream : public Stream
+    {
+    public:
+        using ptr = std::shared_ptr<SocketStream>;
+
+        // owner为true时析构关闭socket
+        SocketStream(Socket::ptr sock, bool owner = true);
+        ~SocketStream();
+
+        int read(void *buffer, size_t length) override;
+        int read(ByteArray::ptr ba, size_t length) override;
+        int write(const void *buffer, size_t length) override;
+        int write(ByteArray::ptr ba, size_t length) override;
+        void close() override;
+
+        // 用sendfile把文件fd从offset开始的length字节发出, 数据不经过用户态; 成功返回length
+        int64_t sendFile(int fd, uint64_t offset, uint64_t length);
+
+        Socket::ptr getSocket() const { return m_socket; }
+        bool isConnected() const;
+
+    protected:
+        Socket::ptr m_socket;
+        bool m_owner;
+    };
+
+} // namespace sltj
+
+#endif
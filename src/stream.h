@@ -0,0 +1,36 @@
+#ifndef __SLTJ_STREAM_H__
+#define __SLTJ_STREAM_H__
+
+#include <memory>
+#include "bytearray.h"
+
+namespace sltj
+{
+    // 流接口
+    // read/write返回实际读写的字节数, 0表示对端关闭, 小于0表示出错;
+    // readFixSize/writeFixSize循环直到读写满length字节
+    class Stream
+    {
+    public:
+        using ptr = std::shared_ptr<Stream>;
+
+        virtual ~Stream() {}
+
+        virtual int read(void *buffer, size_t length) = 0;
+        // 读到ba的当前位置之后, 完成后position前移
+        virtual int read(ByteArray::ptr ba, size_t length) = 0;
+        virtual int readFixSize(void *buffer, size_t length);
+        virtual int readFixSize(ByteArray::ptr ba, size_t length);
+
+        virtual int write(const void *buffer, size_t length) = 0;
+        // 写出ba从当前位置开始的数据, 完成后position前移
+        virtual int write(ByteArray::ptr ba, size_t length) = 0;
+        virtual int writeFixSize(const void *buffer, size_t length);
+        virtual int writeFixSize(ByteArray::ptr ba, size_t length);
+
+        virtual void close() = 0;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,215 @@
+#include "tcp_server.h"
+#include "config.h"
+#include "log.h"
+
+#include <string.h>
+#include <errno.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static sltj::ConfigVar<std::string>::ptr g_tcp_server_address =
+        sltj::Config::Lookup<std::string>("tcp_server.address", "0.0.0.0:8020",
+                                          "tcp server bind address, separated by ','");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_tcp_server_accept_threads =
+        sltj::Config::Lookup<uint32_t>("tcp_server.accept_threads", 1,
+                                       "tcp server accept threads, one SO_REUSEPORT socket per thread");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_tcp_server_io_threads =
+        sltj::Config::Lookup<uint32_t>("tcp_server.io_threads", 2, "tcp server io threads");
+
+    static sltj::ConfigVar<uint64_t>::ptr g_tcp_server_read_timeout =
+        sltj::Config::Lookup<uint64_t>("tcp_server.read_timeout", (uint64_t)(60 * 1000 * 2),
+                                       "tcp server read timeout(ms)");
+
+    TcpServer::TcpServer(IOManager *io_worker, IOManager *accept_worker)
+        : m_ioWorker(io_worker), m_acceptWorker(accept_worker),
+          m_recvTimeout(g_tcp_server_read_timeout->getValue()), m_name("sltj/1.0.0")
+    {
+        if (!m_ioWorker)
+        {
+            m_ownIOWorker.reset(new IOManager(g_tcp_server_io_threads->getValue(), "tcp_io"));
+            m_ioWorker = m_ownIOWorker.get();
+        }
+        if (!m_acceptWorker)
+        {
+            m_ownAcceptWorker.reset(new IOManager(g_tcp_server_accept_threads->getValue(), "tcp_accept"));
+            m_acceptWorker = m_ownAcceptWorker.get();
+        }
+    }
+
+    TcpServer::~TcpServer()
+    {
+        for (auto &sock : m_socks)
+        {
+            sock->close();
+        }
+        m_socks.clear();
+    }
+
+    bool TcpServer::bind()
+    {
+        std::vector<Address::ptr> addrs;
+        const std::string conf = g_tcp_server_address->getValue();
+        size_t begin = 0;
+        while (begin <= conf.size())
+        {
+            size_t end = conf.find(',', begin);
+            if (end == std::string::npos)
+            {
+                end = conf.size();
+            }
+            std::string item = conf.substr(begin, end - begin);
+            begin = end + 1;
+            if (item.empty())
+            {
+                continue;
+            }
+
+            Address::ptr addr = Address::LookupAny(item);
+            if (!addr)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "tcp_server.address invalid item=" << item;
+                return false;
+            }
+            addrs.push_back(addr);
+        }
+
+        std::vector<Address::ptr> fails;
+        return bind(addrs, fails);
+    }
+
+    bool TcpServer::bind(Address::ptr addr)
+    {
+        // unix socket不支持SO_REUSEPORT分流, 只建一个
+        size_t count = addr->getFamily() == AF_UNIX ? 1 : m_acceptWorker->getThreadCount();
+        Address::ptr bind_addr = addr;
+        std::vector<Socket::ptr> socks;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Socket::ptr sock = Socket::CreateTCP(bind_addr);
+            if (count > 1 && !sock->setReusePort(true))
+            {
+                SLTJ_LOG_ERROR(g_logger) << "setReusePort fail errno=" << errno
+                                         << " errstr=" << strerror(errno) << " addr=" << *bind_addr;
+                return false;
+            }
+            if (!sock->bind(bind_addr))
+            {
+                SLTJ_LOG_ERROR(g_logger) << "bind fail errno=" << errno
+                                         << " errstr=" << strerror(errno) << " addr=" << *bind_addr;
+                return false;
+            }
+            if (!sock->listen())
+            {
+                SLTJ_LOG_ERROR(g_logger) << "listen fail errno=" << errno
+                                         << " errstr=" << strerror(errno) << " addr=" << *bind_addr;
+                return false;
+            }
+            // 端口为0时由第一个socket确定端口, 其余socket绑定同一端口
+            if (i == 0)
+            {
+                bind_addr = sock->getLocalAddress();
+            }
+            socks.push_back(sock);
+        }
+
+        m_socks.insert(m_socks.end(), socks.begin(), socks.end());
+        SLTJ_LOG_INFO(g_logger) << "server " << m_name << " bind " << *bind_addr
+                                << " listen_socks=" << socks.size();
+        return true;
+    }
+
+    bool TcpServer::bind(const std::vector<Address::ptr> &addrs, std::vector<Address::ptr> &fails)
+    {
+        for (auto &addr : addrs)
+        {
+            if (!bind(addr))
+            {
+                fails.push_back(addr);
+            }
+        }
+
+        if (!fails.empty())
+        {
+            for (auto &sock : m_socks)
+            {
+                sock->close();
+            }
+            m_socks.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void TcpServer::startAccept(Socket::ptr sock)
+    {
+        while (!m_isStop)
+        {
+            Socket::ptr client = sock->accept();
+            if (client)
+            {
+                client->setRecvTimeout(m_recvTimeout);
+                m_ioWorker->schedule(std::bind(&TcpServer::handleClient, shared_from_this(), client));
+            }
+            else if (!m_isStop && errno != ETIMEDOUT)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "accept errno=" << errno << " errstr=" << strerror(errno);
+                // 监听socket已关闭
+                if (!sock->isValid())
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    bool TcpServer::start()
+    {
+        if (!m_isStop)
+        {
+            return true;
+        }
+        m_isStop = false;
+
+        // 每个监听socket一个accept协程, 初始分散到不同的accept线程
+        std::vector<int> ids = m_acceptWorker->getThreadIds();
+        for (size_t i = 0; i < m_socks.size(); ++i)
+        {
+            int thread = ids.empty() ? -1 : ids[i % ids.size()];
+            m_acceptWorker->schedule(std::bind(&TcpServer::startAccept, shared_from_this(), m_socks[i]), thread);
+        }
+        return true;
+    }
+
+    void TcpServer::stop()
+    {
+        m_isStop = true;
+        auto self = shared_from_this();
+        m_acceptWorker->schedule([this, self]() {
+            // close会唤醒并结束等待中的accept协程
+            for (auto &sock : m_socks)
+            {
+                sock->close();
+            }
+            m_socks.clear();
+        });
+
+        if (m_ownAcceptWorker)
+        {
+            m_ownAcceptWorker->stop();
+        }
+        if (m_ownIOWorker)
+        {
+            m_ownIOWorker->stop();
+        }
+    }
+
+    void TcpServer::handleClient(Socket::ptr client)
+    {
+        SLTJ_LOG_INFO(g_logger) << "handleClient: " << *client;
+    }
+
+} // namespace sltj
@@ -0,0 +1,68 @@
+#ifndef __SLTJ_TCP_SERVER_H__
+#define __SLTJ_TCP_SERVER_H__
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include "iomanager.h"
+#include "socket.h"
+#include "address.h"
+
+namespace sltj
+{
+    // TCP服务器
+    // 每个监听地址按accept线程数创建多个SO_REUSEPORT监听socket, 由内核在其间分配新连接,
+    // 每个监听socket一个accept协程; 接受的连接投递到io调度器上执行handleClient
+    class TcpServer : public std::enable_shared_from_this<TcpServer>
+    {
+    public:
+        using ptr = std::shared_ptr<TcpServer>;
+
+        // io_worker/accept_worker为空时按配置项tcp_server.io_threads/accept_threads创建
+        TcpServer(IOManager *io_worker = nullptr, IOManager *accept_worker = nullptr);
+        virtual ~TcpServer();
+
+        // 按配置项tcp_server.address绑定
+        bool bind();
+        virtual bool bind(Address::ptr addr);
+        // 失败的地址放入fails, 全部成功返回true
+        virtual bool bind(const std::vector<Address::ptr> &addrs, std::vector<Address::ptr> &fails);
+        virtual bool start();
+        // 停止accept并关闭监听socket; 自建的调度器会等待已接受的连接处理完后停止
+        virtual void stop();
+
+        uint64_t getRecvTimeout() const { return m_recvTimeout; }
+        void setRecvTimeout(uint64_t v) { m_recvTimeout = v; }
+        const std::string &getName() const { return m_name; }
+        void setName(const std::string &v) { m_name = v; }
+        bool isStop() const { return m_isStop; }
+        // 监听socket(每个地址可能有多个)
+        const std::vector<Socket::ptr> &getSocks() const { return m_socks; }
+
+        IOManager *getIOWorker() const { return m_ioWorker; }
+        IOManager *getAcceptWorker() const { return m_acceptWorker; }
+
+    protected:
+        // 处理新连接, 在io调度器的协程中执行
+        virtual void handleClient(Socket::ptr client);
+        virtual void startAccept(Socket::ptr sock);
+
+    protected:
+        std::vector<Socket::ptr> m_socks;
+        IOManager *m_ioWorker;
+        IOManager *m_acceptWorker;
+        uint64_t m_recvTimeout;
+        std::string m_name;
+        std::atomic<bool> m_isStop{true};
+
+    private:
+        // 未传入调度器时自建
+        std::shared_ptr<IOManager> m_ownIOWorker;
+        std::shared_ptr<IOManager> m_ownAcceptWorker;
+    };
+
+} // namespace sltj
+
+#endif
@@ -1,10 +1,13 @@
 #include "thread.h"
 #include "log.h"
+#include "crash.h"
+#include <errno.h>
+#include <time.h>
 
 namespace sltj
 {
     static thread_local Thread *t_thread = nullptr;    // 当前线程
-    static thread_local std::string t_name = "UNKNOW"; // 线程名字
+    static thread_local std::string t_name;            // 线程名字,为空表示尚未获取
 
     static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
 
@@ -12,8 +15,20 @@ namespace sltj
     {
         return t_thread;
     }
-    const std::string Thread::GetName()
+    const std::string &Thread::GetName()
     {
+        if (__builtin_expect(t_name.empty(), 0))
+        {
+            char buf[16] = {0};
+            if (pthread_getname_np(pthread_self(), buf, sizeof(buf)) == 0 && buf[0])
+            {
+                t_name = buf;
+            }
+            else
+            {
+                t_name = "UNKNOW";
+            }
+        }
         return t_name;
     }
     void Thread::SetName(const std::string &name)
@@ -37,8 +52,10 @@ namespace sltj
     {
         Thread *thread = (Thread *)arg;
         t_thread = thread;
+        t_name = thread->m_name;
         thread->m_id = sltj::GetThreadId();
         pthread_setname_np(pthread_self(), thread->m_name.substr(0, 15).c_str());
+        SetupCrashAltStack();
         std::function<void()> cb;
         cb.swap(thread->m_cb);
         thread->m_semphore.notify();
@@ -101,10 +118,52 @@ namespace sltj
 
     void Semaphore::wait()
     {
-        if (sem_wait(&m_semaphore))
+        while (sem_wait(&m_semaphore))
+        {
+            if (errno != EINTR)
+            {
+                throw std::logic_error("sem_wait error");
+            }
+        }
+    }
+    bool Semaphore::tryWait()
+    {
+        while (sem_trywait(&m_semaphore))
+        {
+            if (errno == EAGAIN)
+            {
+                return false;
+            }
+            if (errno != EINTR)
+            {
+                throw std::logic_error("sem_trywait error");
+            }
+        }
+        return true;
+    }
+    bool Semaphore::waitFor(uint64_t ms)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += ms / 1000;
+        ts.tv_nsec += (ms % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
         {
-            throw std::logic_error("sem_wait error");
+            ++ts.tv_sec;
+            ts.tv_nsec -= 1000000000;
+        }
+        while (sem_timedwait(&m_semaphore, &ts))
+        {
+            if (errno == ETIMEDOUT)
+            {
+                return false;
+            }
+            if (errno != EINTR)
+            {
+                throw std::logic_error("sem_timedwait error");
+            }
         }
+        return true;
     }
     void Semaphore::notify()
     {
@@ -25,8 +25,7 @@ namespace sltj
         }
         ~ScopedLockImpl()
         {
-            m_mutex.unlock();
-            m_locked = false;
+            unlock();
         }
         void lock()
         {
@@ -65,6 +64,8 @@ namespace sltj
         ~Semaphore();
 
         void wait();
+        bool tryWait(); // 非阻塞,计数为0时返回false
+        bool waitFor(uint64_t ms); // 最多等待ms毫秒,超时返回false
         void notify();
 
     private:
@@ -89,8 +90,7 @@ namespace sltj
         }
         ~ReadScopedLockImpl()
         {
-            m_mutex.unlock();
-            m_locked = false;
+            unlock();
         }
         void lock()
         {
@@ -130,8 +130,7 @@ namespace sltj
         }
         ~WriteScopedLockImpl()
         {
-            m_mutex.unlock();
-            m_locked = false;
+            unlock();
         }
         void lock()
         {
@@ -215,6 +214,11 @@ namespace sltj
         {
             pthread_mutex_unlock(&m_mutex);
         }
+        // 已被占用时返回false
+        bool tryLock()
+        {
+            return pthread_mutex_trylock(&m_mutex) == 0;
+        }
 
     private:
         pthread_mutex_t m_mutex;
@@ -299,7 +303,7 @@ namespace sltj
         pid_t getId() const { return m_id; }
 
         static Thread *GetThis();
-        static const std::string GetName();
+        static const std::string &GetName(); // 当前线程名,非sltj::Thread创建的线程首次调用时读取系统线程名
         void SetName(const std::string &name);
         static void *run(void *arg);
 
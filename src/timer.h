@@ -0,0 +1,83 @@
+#ifndef __SLTJ_TIMER_H__
+#define __SLTJ_TIMER_H__
+
+#include <memory>
+#include <functional>
+#include <vector>
+#include <set>
+#include <atomic>
+#include "thread.h"
+
+namespace sltj
+{
+    class TimerManager;
+
+    // 定时器
+    class Timer : public std::enable_shared_from_this<Timer>
+    {
+        friend class TimerManager;
+
+    public:
+        using ptr = std::shared_ptr<Timer>;
+
+        // 取消定时器, 已触发或已取消时返回false
+        bool cancel();
+        // 从现在开始重新计时
+        bool refresh();
+        // 修改间隔, from_now为false时从原开始时间计算
+        bool reset(uint64_t ms, bool from_now);
+
+    private:
+        Timer(uint64_t ms, std::function<void()> cb, bool recurring, TimerManager *manager);
+
+    private:
+        bool m_recurring = false;    // 是否循环
+        uint64_t m_ms = 0;           // 间隔
+        uint64_t m_next = 0;         // 触发时间(单调时钟毫秒)
+        std::function<void()> m_cb;
+        TimerManager *m_manager = nullptr;
+
+    private:
+        struct Comparator
+        {
+            bool operator()(const Timer::ptr &lhs, const Timer::ptr &rhs) const;
+        };
+    };
+
+    // 定时器管理, 时间取自CLOCK_MONOTONIC, 不受系统时间调整影响
+    class TimerManager
+    {
+        friend class Timer;
+
+    public:
+        using MutexType = RWMutex;
+
+        TimerManager();
+        virtual ~TimerManager();
+
+        Timer::ptr addTimer(uint64_t ms, std::function<void()> cb, bool recurring = false);
+        // 条件定时器: 触发时weak_cond已失效则不执行
+        Timer::ptr addConditionTimer(uint64_t ms, std::function<void()> cb,
+                                     std::weak_ptr<void> weak_cond, bool recurring = false);
+        // 距最近一个定时器触发的毫秒数, 没有定时器时返回~0ull
+        uint64_t getNextTimer();
+        // 取出所有已到期定时器的回调
+        void listExpiredCb(std::vector<std::function<void()>> &cbs);
+        bool hasTimer();
+
+        static uint64_t GetNowMS();
+
+    protected:
+        // 新定时器插到最前面时调用, 用于唤醒等待中的线程
+        virtual void onTimerInsertedAtFront() = 0;
+        void addTimer(Timer::ptr val, MutexType::WriteMutex &lock);
+
+    private:
+        MutexType m_mutex;
+        std::set<Timer::ptr, Timer::Comparator> m_timers;
+        std::atomic<bool> m_tickled{false}; // 避免重复唤醒
+    };
+
+} // namespace sltj
+
+#endif
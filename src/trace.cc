@@ -0,0 +1,349 @@
+#include "trace.h"
+#include "config.h"
+#include "metrics.h"
+#include "ringbuffer.h"
+#include "thread.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    static sltj::ConfigVar<bool>::ptr g_trace_enable =
+        sltj::Config::Lookup<bool>("trace.enable", false, "enable SLTJ_TRACE_SCOPE recording");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_trace_buffer_size =
+        sltj::Config::Lookup<uint32_t>("trace.buffer_size", 16384, "trace events buffered per thread");
+
+    static sltj::ConfigVar<uint32_t>::ptr g_trace_flush_interval =
+        sltj::Config::Lookup<uint32_t>("trace.flush_interval", 100, "trace flush interval(ms)");
+
+    std::atomic<bool> Tracer::s_enabled{false};
+
+    namespace
+    {
+        struct TraceBuffer
+        {
+            using ptr = std::shared_ptr<TraceBuffer>;
+
+            TraceBuffer(size_t capacity) : queue(capacity) {}
+
+            SPSCRingQueue<TraceEvent> queue;
+            pid_t tid = 0;
+            std::string threadName;
+            std::atomic<bool> dead{false};   // 所属线程已退出
+            bool named = false;              // 已写出thread_name元数据
+        };
+
+        // 队列按缓存行对齐, C++11的new不保证, 单独申请
+        static TraceBuffer::ptr NewTraceBuffer(size_t capacity)
+        {
+            void *mem = nullptr;
+            if (posix_memalign(&mem, alignof(TraceBuffer), sizeof(TraceBuffer)))
+            {
+                throw std::bad_alloc();
+            }
+            return TraceBuffer::ptr(new (mem) TraceBuffer(capacity), [](TraceBuffer *b) {
+                b->~TraceBuffer();
+                free(b);
+            });
+        }
+
+        // 不析构: 其他全局对象析构时仍可能记录
+        struct TraceState
+        {
+            Mutex mutex;
+            std::vector<TraceBuffer::ptr> buffers;
+            std::ofstream file;
+            bool first = true;
+            bool started = false;
+            std::atomic<bool> stopping{false};
+            Thread::ptr thread;
+            Counter::ptr events = Metrics::Lookup<Counter>("trace.events", "trace events written");
+            Counter::ptr dropped = Metrics::Lookup<Counter>("trace.dropped", "trace events dropped on full buffer");
+            Gauge::ptr buffersGauge = Metrics::Lookup<Gauge>("trace.buffers", "registered trace thread buffers");
+        };
+
+        static TraceState *GetState()
+        {
+            static TraceState *s_state = new TraceState;
+            return s_state;
+        }
+
+        // 没有输出文件时丢弃队列中的事件. 调用方持有s->mutex
+        static void DropEvents(TraceState *s, TraceBuffer *buf)
+        {
+            TraceEvent events[256];
+            size_t n;
+            while ((n = buf->queue.popBatch(events, 256)) > 0)
+            {
+                s->dropped->inc(n);
+            }
+        }
+
+        static thread_local TraceBuffer *t_buffer = nullptr;
+        static thread_local bool t_buffer_dead = false;
+
+        struct TraceBufferHolder
+        {
+            TraceBufferHolder()
+            {
+                buffer = NewTraceBuffer(g_trace_buffer_size->getValue());
+                buffer->tid = GetThreadId();
+                buffer->threadName = Thread::GetName();
+                TraceState *s = GetState();
+                Mutex::Lock lock(s->mutex);
+                s->buffers.push_back(buffer);
+                s->buffersGauge->set(s->buffers.size());
+                t_buffer = buffer.get();
+            }
+            ~TraceBufferHolder()
+            {
+                buffer->dead = true;
+                t_buffer = nullptr;
+                t_buffer_dead = true;
+                // 没有后台线程取事件时直接注销, 否则由Flush写出剩余事件后注销
+                TraceState *s = GetState();
+                Mutex::Lock lock(s->mutex);
+                if (!s->started)
+                {
+                    DropEvents(s, buffer.get());
+                    // 置dead后Flush可能已先注销
+                    auto it = std::find(s->buffers.begin(), s->buffers.end(), buffer);
+                    if (it != s->buffers.end())
+                    {
+                        s->buffers.erase(it);
+                        s->buffersGauge->set(s->buffers.size());
+                    }
+                }
+            }
+            TraceBuffer::ptr buffer;
+        };
+
+        static TraceBuffer *GetThreadBuffer()
+        {
+            if (t_buffer)
+            {
+                return t_buffer;
+            }
+            if (t_buffer_dead)
+            {
+                return nullptr;
+            }
+            static thread_local TraceBufferHolder t_holder;
+            return t_buffer;
+        }
+
+        // 名字来自字面量, 只需转义引号与反斜杠
+        static void WriteJsonString(std::ostream &os, const std::string &str)
+        {
+            os << '"';
+            for (char c : str)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    os << '\\';
+                }
+                os << c;
+            }
+            os << '"';
+        }
+
+        static void WriteSeparator(TraceState *s)
+        {
+            if (s->first)
+            {
+                s->first = false;
+            }
+            else
+            {
+                s->file << ",\n";
+            }
+        }
+
+        // 调用方持有s->mutex
+        static void DrainBuffer(TraceState *s, TraceBuffer *buf, pid_t pid)
+        {
+            if (!buf->named)
+            {
+                WriteSeparator(s);
+                s->file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+                        << ",\"tid\":" << buf->tid << ",\"args\":{\"name\":";
+                WriteJsonString(s->file, buf->threadName);
+                s->file << "}}";
+                buf->named = true;
+            }
+
+            TraceEvent events[256];
+            size_t n;
+            char num[64];
+            while ((n = buf->queue.popBatch(events, 256)) > 0)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    TraceEvent &e = events[i];
+                    WriteSeparator(s);
+                    s->file << "{\"name\":";
+                    WriteJsonString(s->file, e.name);
+                    // 微秒, 保留纳秒精度
+                    snprintf(num, sizeof(num), "%llu.%03llu,\"dur\":%llu.%03llu",
+                             (unsigned long long)(e.begin / 1000), (unsigned long long)(e.begin % 1000),
+                             (unsigned long long)(e.duration / 1000), (unsigned long long)(e.duration % 1000));
+                    s->file << ",\"cat\":\"sltj\",\"ph\":\"X\",\"ts\":" << num
+                            << ",\"pid\":" << pid << ",\"tid\":" << buf->tid
+                            << ",\"args\":{\"fiber\":" << e.fiberId << "}}";
+                }
+                s->events->inc(n);
+            }
+        }
+
+        static void TracerMain()
+        {
+            TraceState *s = GetState();
+            while (!s->stopping)
+            {
+                Tracer::Flush();
+                uint64_t waited = 0;
+                uint64_t interval = g_trace_flush_interval->getValue();
+                while (waited < interval && !s->stopping)
+                {
+                    usleep(10 * 1000);
+                    waited += 10;
+                }
+            }
+        }
+        // 配置项变化时更新运行时开关, 在加载配置的线程上执行
+        struct TraceIniter
+        {
+            TraceIniter()
+            {
+                Tracer::SetEnabled(g_trace_enable->getValue());
+                g_trace_enable->addListener([](const bool &old_value, const bool &new_value) {
+                    Tracer::SetEnabled(new_value);
+                });
+            }
+        };
+
+        static TraceIniter s_initer;
+    } // namespace
+
+    bool Tracer::Start(const std::string &path)
+    {
+        TraceState *s = GetState();
+        {
+            Mutex::Lock lock(s->mutex);
+            if (s->started)
+            {
+                return false;
+            }
+            s->file.open(path, std::ios::out | std::ios::trunc);
+            if (!s->file)
+            {
+                SLTJ_LOG_ERROR(g_logger) << "Tracer::Start open " << path << " fail";
+                return false;
+            }
+            s->file << "[\n";
+            s->first = true;
+            s->started = true;
+            s->stopping = false;
+            // 重新写出线程名
+            for (auto &b : s->buffers)
+            {
+                b->named = false;
+            }
+            s->thread.reset(new Thread(&TracerMain, "tracer"));
+        }
+        return true;
+    }
+
+    void Tracer::Stop()
+    {
+        TraceState *s = GetState();
+        Thread::ptr thread;
+        {
+            Mutex::Lock lock(s->mutex);
+            if (!s->started || s->stopping)
+            {
+                return;
+            }
+            s->stopping = true;
+            thread.swap(s->thread);
+        }
+        thread->join();
+        Flush();
+
+        Mutex::Lock lock(s->mutex);
+        s->file << "\n]\n";
+        s->file.close();
+        s->started = false;
+    }
+
+    void Tracer::Flush()
+    {
+        TraceState *s = GetState();
+        pid_t pid = getpid();
+        Mutex::Lock lock(s->mutex);
+        size_t count = s->buffers.size();
+        for (auto it = s->buffers.begin(); it != s->buffers.end();)
+        {
+            // 先读dead再取事件, 线程退出前写入的事件都能取到
+            bool dead = (*it)->dead;
+            if (s->started)
+            {
+                DrainBuffer(s, it->get(), pid);
+            }
+            else
+            {
+                // 没有输出文件: 丢弃事件, 已退出线程的缓冲照常注销
+                DropEvents(s, it->get());
+            }
+            if (dead)
+            {
+                it = s->buffers.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        if (count != s->buffers.size())
+        {
+            s->buffersGauge->set(s->buffers.size());
+        }
+        if (s->started)
+        {
+            s->file.flush();
+        }
+    }
+
+    void Tracer::SetEnabled(bool v)
+    {
+        s_enabled.store(v, std::memory_order_relaxed);
+    }
+
+    void Tracer::Record(const char *name, uint64_t begin, uint64_t end)
+    {
+        TraceBuffer *buf = GetThreadBuffer();
+        if (!buf)
+        {
+            return;
+        }
+        TraceEvent e;
+        e.name = name;
+        e.begin = begin;
+        e.duration = end - begin;
+        e.fiberId = GetFiberId();
+        if (!buf->queue.tryPush(std::move(e)))
+        {
+            GetState()->dropped->inc();
+        }
+    }
+
+} // namespace sltj
@@ -0,0 +1,85 @@
+#ifndef __SLTJ_TRACE_H__
+#define __SLTJ_TRACE_H__
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+#define SLTJ_TRACE_CONCAT_IMPL(a, b) a##b
+#define SLTJ_TRACE_CONCAT(a, b) SLTJ_TRACE_CONCAT_IMPL(a, b)
+
+// 记录所在作用域的耗时; name须为字符串字面量(只保存指针)
+#define SLTJ_TRACE_SCOPE(name) sltj::TraceScope SLTJ_TRACE_CONCAT(__sltj_trace_, __LINE__)(name)
+
+namespace sltj
+{
+    // 一段已结束的作用域, 导出为Chrome trace的complete事件("ph":"X")
+    struct TraceEvent
+    {
+        const char *name = nullptr;
+        uint64_t begin = 0;      // CLOCK_MONOTONIC_RAW纳秒
+        uint64_t duration = 0;   // 纳秒
+        uint32_t fiberId = 0;
+    };
+
+    // 每个线程把事件写入自己的单生产者环形队列, 后台线程"tracer"定期取出追加到文件.
+    // 文件为Chrome trace-event的JSON数组格式, chrome://tracing与Perfetto均可打开;
+    // 进程异常退出时缺少结尾的']'也能被识别.
+    // 开关为配置项trace.enable, 配置变化时立即生效; SetEnabled只改运行时开关, 不写回配置.
+    // 未启动时已退出线程的缓冲随即注销, Flush丢弃队列中的事件.
+    // 关闭时SLTJ_TRACE_SCOPE只有一次relaxed读和一次分支. 队列满时丢弃事件并计入trace.dropped.
+    class Tracer
+    {
+    public:
+        // 打开输出文件并启动后台线程; 已启动或打开失败返回false
+        static bool Start(const std::string &path);
+        // 停止后台线程, 取出剩余事件并关闭文件
+        static void Stop();
+        // 取出所有线程队列中的事件写入文件
+        static void Flush();
+
+        static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+        static void SetEnabled(bool v);
+
+        static uint64_t Now()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+            return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        }
+
+        // 在结束作用域的线程上记录, 跨Yield迁移的协程记在恢复后的线程上
+        static void Record(const char *name, uint64_t begin, uint64_t end);
+
+    private:
+        static std::atomic<bool> s_enabled;
+    };
+
+    class TraceScope
+    {
+    public:
+        TraceScope(const char *name)
+            : m_name(name), m_begin(Tracer::IsEnabled() ? Tracer::Now() : 0)
+        {
+        }
+        ~TraceScope()
+        {
+            if (m_begin)
+            {
+                Tracer::Record(m_name, m_begin, Tracer::Now());
+            }
+        }
+
+    private:
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    private:
+        const char *m_name;
+        uint64_t m_begin;
+    };
+
+} // namespace sltj
+
+#endif
@@ -0,0 +1,332 @@
+#include "uring_log_appender.h"
+#include "metrics.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace sltj
+{
+    static sltj::Logger::ptr g_logger = SLTJ_LOG_NAME("system");
+
+    namespace
+    {
+        struct UringLogMetrics
+        {
+            Counter::ptr writes = Metrics::Lookup<Counter>("log.uring.writes", "io_uring log writes submitted");
+            Counter::ptr fullWaits = Metrics::Lookup<Counter>("log.uring.full_waits", "io_uring log appends that waited for a buffer to be written");
+            Counter::ptr errors = Metrics::Lookup<Counter>("log.uring.errors", "io_uring log writes whose data was lost after the synchronous fallback failed too");
+            Counter::ptr retries = Metrics::Lookup<Counter>("log.uring.retries", "io_uring log writes resubmitted or rewritten synchronously after a failed completion");
+            Counter::ptr dropped = Metrics::Lookup<Counter>("log.uring.dropped", "log records dropped because the io_uring log file is not open");
+        };
+
+        static UringLogMetrics *GetUringLogMetrics()
+        {
+            static UringLogMetrics *s_metrics = new UringLogMetrics;
+            return s_metrics;
+        }
+    } // namespace
+
+    static const uint64_t kFsyncUserData = ~0ull;
+    // 完成返回EAGAIN/EINTR时重新提交的次数, 超过后同步写
+    static const uint32_t kMaxResubmits = 3;
+
+    // 同步写到指定偏移, 处理部分写入与EINTR
+    static bool PwriteAll(int fd, const char *data, size_t len, uint64_t offset)
+    {
+        while (len)
+        {
+            ssize_t n = pwrite(fd, data, len, offset);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            data += n;
+            len -= n;
+            offset += n;
+        }
+        return true;
+    }
+
+    UringFileLogAppender::UringFileLogAppender(const std::string &filename, size_t buffer_size, size_t buffers)
+        : m_filename(filename), m_bufferSize(buffer_size ? buffer_size : 4096)
+    {
+        m_buffers.resize(buffers ? buffers : 1);
+        std::vector<iovec> iovs;
+        for (auto &i : m_buffers)
+        {
+            void *p = nullptr;
+            if (posix_memalign(&p, 4096, m_bufferSize))
+            {
+                throw std::bad_alloc();
+            }
+            i.data = (char *)p;
+            iovec iov;
+            iov.iov_base = p;
+            iov.iov_len = m_bufferSize;
+            iovs.push_back(iov);
+        }
+        openFile();
+
+        // 固定文件占槽位0, 缓冲区按下标注册, 之后的写不再每次查找fd和映射用户页
+        if (!m_ring.init(m_buffers.size() * 2))
+        {
+            SLTJ_LOG_WARN(g_logger) << "UringFileLogAppender io_uring unavailable errno=" << errno
+                                    << " errstr=" << strerror(errno) << ", use write()";
+        }
+        else if (!m_ring.registerFiles(&m_fd, 1) || !m_ring.registerBuffers(&iovs[0], iovs.size()))
+        {
+            m_ring.close();
+        }
+    }
+
+    UringFileLogAppender::~UringFileLogAppender()
+    {
+        flush();
+        m_ring.close();
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+        for (auto &i : m_buffers)
+        {
+            free(i.data);
+        }
+    }
+
+    bool UringFileLogAppender::openFile()
+    {
+        m_fd = open(m_filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (m_fd < 0)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "UringFileLogAppender open " << m_filename << " errno=" << errno
+                                     << " errstr=" << strerror(errno);
+            return false;
+        }
+        off_t end = lseek(m_fd, 0, SEEK_END);
+        m_offset = end < 0 ? 0 : end;
+        return true;
+    }
+
+    bool UringFileLogAppender::reopen()
+    {
+        Mutex::Lock lock(m_writeMutex);
+        drain();
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+        bool ok = openFile();
+        if (m_ring.isValid() && !m_ring.updateFiles(0, &m_fd, 1))
+        {
+            m_ring.close();
+        }
+        return ok;
+    }
+
+    void UringFileLogAppender::log(LogLevel::Level level, LogEvent::ptr event)
+    {
+        if (level < m_level)
+        {
+            return;
+        }
+        std::string str = m_formatter->format(level, event);
+        Mutex::Lock lock(m_writeMutex);
+        if (m_fd < 0)
+        {
+            GetUringLogMetrics()->dropped->inc();
+            return;
+        }
+        if (!m_ring.isValid())
+        {
+            writeSync(str.data(), str.size());
+            return;
+        }
+
+        reap(false);
+        if (str.size() > m_bufferSize)
+        {
+            // 超过一个缓冲区的记录很少见, 等之前的写完成后直接写
+            drain();
+            writeSync(str.data(), str.size());
+            return;
+        }
+        if (m_buffers[m_current].size + str.size() > m_bufferSize)
+        {
+            submitCurrent();
+        }
+        while (m_buffers[m_current].inflight)
+        {
+            GetUringLogMetrics()->fullWaits->inc();
+            reap(true);
+        }
+        Buffer &buf = m_buffers[m_current];
+        memcpy(buf.data + buf.size, str.data(), str.size());
+        buf.size += str.size();
+        // 写满或距上次提交超过间隔时提交, 间隔内的日志攒成一次写
+        uint64_t now = GetCurrentMS();
+        if (now - m_lastSubmit >= m_flushInterval)
+        {
+            submitCurrent();
+        }
+    }
+
+    void UringFileLogAppender::flush()
+    {
+        Mutex::Lock lock(m_writeMutex);
+        if (m_fd < 0)
+        {
+            return;
+        }
+        if (!m_ring.isValid())
+        {
+            if (m_sync)
+            {
+                fdatasync(m_fd);
+            }
+            return;
+        }
+        submitCurrent();
+        if (m_sync)
+        {
+            // IO_DRAIN: 之前提交的写都完成后才执行
+            io_uring_sqe *sqe = m_ring.getSqe();
+            if (sqe)
+            {
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = 0;
+                sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_DRAIN;
+                sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                sqe->user_data = kFsyncUserData;
+                m_ring.submit(m_ring.flush());
+                ++m_inflight;
+            }
+        }
+        drain();
+    }
+
+    void UringFileLogAppender::submitCurrent()
+    {
+        Buffer &buf = m_buffers[m_current];
+        if (!buf.size || buf.inflight)
+        {
+            return;
+        }
+        buf.offset = m_offset;
+        buf.resubmits = 0;
+        if (!queueWrite(m_current))
+        {
+            // 每个缓冲区最多一个在途的写, 加上fsync也不会满
+            writeSync(buf.data, buf.size);
+            buf.size = 0;
+            return;
+        }
+        m_offset += buf.size;
+        m_lastSubmit = GetCurrentMS();
+        m_current = (m_current + 1) % m_buffers.size();
+    }
+
+    bool UringFileLogAppender::queueWrite(size_t index)
+    {
+        Buffer &buf = m_buffers[index];
+        io_uring_sqe *sqe = m_ring.getSqe();
+        if (!sqe)
+        {
+            return false;
+        }
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->fd = 0;
+        // 直接交给内核工作线程, 写日志的线程不等待拷贝进页缓存
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_ASYNC;
+        sqe->addr = (uint64_t)(uintptr_t)buf.data;
+        sqe->len = buf.size;
+        sqe->off = buf.offset;
+        sqe->buf_index = index;
+        sqe->user_data = index;
+        buf.inflight = true;
+        ++m_inflight;
+        // 提交失败时SQE留在队列中, 随下一次submit进入内核
+        m_ring.submit(m_ring.flush());
+        GetUringLogMetrics()->writes->inc();
+        return true;
+    }
+
+    void UringFileLogAppender::reap(bool wait)
+    {
+        if (wait && !m_ring.hasCompletions())
+        {
+            m_ring.submit(m_ring.flush(), 1);
+        }
+        m_ring.reap([this](const io_uring_cqe &cqe) {
+            --m_inflight;
+            if (cqe.user_data == kFsyncUserData)
+            {
+                if (cqe.res < 0)
+                {
+                    GetUringLogMetrics()->errors->inc();
+                }
+                return;
+            }
+            Buffer &buf = m_buffers[cqe.user_data];
+            buf.inflight = false;
+            if (cqe.res < 0)
+            {
+                // 文件偏移已经占用, 丢弃会在文件中留下空洞: 临时错误重新提交, 否则整块同步写
+                GetUringLogMetrics()->retries->inc();
+                if ((cqe.res == -EAGAIN || cqe.res == -EINTR) && buf.resubmits < kMaxResubmits)
+                {
+                    ++buf.resubmits;
+                    if (queueWrite(cqe.user_data))
+                    {
+                        return;
+                    }
+                }
+                if (!PwriteAll(m_fd, buf.data, buf.size, buf.offset))
+                {
+                    SLTJ_LOG_ERROR(g_logger) << "UringFileLogAppender write " << m_filename << " failed res=" << cqe.res
+                                             << " errno=" << errno << " errstr=" << strerror(errno);
+                    GetUringLogMetrics()->errors->inc();
+                }
+            }
+            else if ((size_t)cqe.res < buf.size)
+            {
+                // 短写(如磁盘满): 剩余部分同步补写, 保持文件中没有空洞
+                if (!PwriteAll(m_fd, buf.data + cqe.res, buf.size - cqe.res, buf.offset + cqe.res))
+                {
+                    GetUringLogMetrics()->errors->inc();
+                }
+            }
+            buf.size = 0;
+        });
+    }
+
+    void UringFileLogAppender::drain()
+    {
+        if (!m_ring.isValid())
+        {
+            return;
+        }
+        submitCurrent();
+        while (m_inflight)
+        {
+            reap(true);
+        }
+    }
+
+    void UringFileLogAppender::writeSync(const char *data, size_t len)
+    {
+        if (!PwriteAll(m_fd, data, len, m_offset))
+        {
+            GetUringLogMetrics()->errors->inc();
+        }
+        m_offset += len;
+    }
+
+} // namespace sltj
@@ -0,0 +1,74 @@
+#ifndef __SLTJ_URING_LOG_APPENDER_H__
+#define __SLTJ_URING_LOG_APPENDER_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "io_uring.h"
+#include "log.h"
+#include "thread.h"
+
+namespace sltj
+{
+    // 用io_uring异步写文件的输出器, 没有后台写线程:
+    // 格式化后的日志拷入已注册的缓冲区, 写满或距上次提交超过flush_interval时提交WRITE_FIXED(固定文件+固定缓冲区),
+    // 由之后的log/flush收割完成; 缓冲区都在途时等待最早的完成
+    // 按显式偏移从文件末尾追加, 多个写同时在途也不乱序; io_uring不可用时退回同步write
+    class UringFileLogAppender : public LogAppender
+    {
+    public:
+        using ptr = std::shared_ptr<UringFileLogAppender>;
+
+        UringFileLogAppender(const std::string &filename, size_t buffer_size = 256 * 1024, size_t buffers = 4);
+        virtual ~UringFileLogAppender();
+
+        virtual void log(LogLevel::Level level, LogEvent::ptr event) override;
+        // 提交缓冲区中剩余的日志并等待所有写完成; setSync(true)时在这些写之后执行fdatasync
+        virtual void flush() override;
+        // 等在途的写完成后重新打开文件(文件被移走后), 成功返回true
+        bool reopen();
+
+        void setSync(bool v) { m_sync = v; }
+        // 攒批的最长时间(ms), 0表示每条都提交; 只在写日志时检查, 之后没有日志时由flush提交
+        void setFlushInterval(uint64_t ms) { m_flushInterval = ms; }
+        bool isUring() const { return m_ring.isValid(); }
+        const std::string &getFilename() const { return m_filename; }
+
+    private:
+        struct Buffer
+        {
+            char *data = nullptr;
+            size_t size = 0;
+            uint64_t offset = 0; // 提交时的文件偏移, 短写或失败时同步补写到这里
+            uint32_t resubmits = 0;
+            bool inflight = false;
+        };
+
+        bool openFile();
+        // 提交当前缓冲区并切换到下一个
+        void submitCurrent();
+        // 按缓冲区记录的偏移提交写, SQ满时返回false
+        bool queueWrite(size_t index);
+        // 收割完成的写, wait为true时至少等待一个
+        void reap(bool wait);
+        void drain();
+        void writeSync(const char *data, size_t len);
+
+    private:
+        std::string m_filename;
+        size_t m_bufferSize;
+        bool m_sync = false;
+        uint64_t m_flushInterval = 100;
+        Mutex m_writeMutex; // 保护以下成员
+        int m_fd = -1;
+        uint64_t m_offset = 0; // 下一次写的文件偏移
+        IOUring m_ring;
+        std::vector<Buffer> m_buffers;
+        size_t m_current = 0; // 正在填充的缓冲区
+        size_t m_inflight = 0;
+        uint64_t m_lastSubmit = 0; // 上次提交的时间(ms)
+    };
+
+} // namespace sltj
+
+#endif
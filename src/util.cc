@@ -1,13 +1,105 @@
 #include "util.h"
+#include "fiber.h"
+#include <pthread.h>
+#include <sys/time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <sstream>
 
 namespace sltj
 {
+    static thread_local pid_t t_thread_id = 0; // 线程id缓存,0表示尚未获取
+
+    // fork后子进程沿用父线程的thread_local,需要清掉缓存
+    static void ResetThreadIdAfterFork()
+    {
+        t_thread_id = 0;
+    }
+
+    struct _ThreadIdForkIniter
+    {
+        _ThreadIdForkIniter()
+        {
+            pthread_atfork(nullptr, nullptr, &ResetThreadIdAfterFork);
+        }
+    };
+    static _ThreadIdForkIniter s_thread_id_fork_initer;
+
     pid_t GetThreadId(){
-        return syscall(SYS_gettid);
+        if (__builtin_expect(t_thread_id == 0, 0))
+        {
+            t_thread_id = syscall(SYS_gettid);
+        }
+        return t_thread_id;
     }
 
     uint32_t GetFiberId(){
-        return 0;
+        return sltj::Fiber::GetFiberId();
+    }
+
+    uint64_t GetCurrentMS(){
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec * 1000ul + tv.tv_usec / 1000;
+    }
+
+    uint64_t GetCurrentUS(){
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec * 1000 * 1000ul + tv.tv_usec;
+    }
+
+    // backtrace_symbols的格式为"模块(符号+偏移) [地址]", 只替换其中的符号
+    static std::string Demangle(const char *str)
+    {
+        const char *begin = strchr(str, '(');
+        const char *end = begin ? strchr(begin, '+') : nullptr;
+        if (!begin || !end || end == begin + 1)
+        {
+            return str;
+        }
+        std::string mangled(begin + 1, end);
+        int status = 0;
+        char *name = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+        if (status != 0 || !name)
+        {
+            free(name);
+            return str;
+        }
+        std::string rt = std::string(str, begin + 1) + name + end;
+        free(name);
+        return rt;
+    }
+
+    void Backtrace(std::vector<std::string> &bt, int size, int skip)
+    {
+        // 协程栈较小, 不在栈上放大数组
+        void **array = (void **)malloc(sizeof(void *) * size);
+        int n = ::backtrace(array, size);
+        char **strings = backtrace_symbols(array, n);
+        if (strings)
+        {
+            for (int i = skip; i < n; ++i)
+            {
+                bt.push_back(Demangle(strings[i]));
+            }
+            free(strings);
+        }
+        free(array);
+    }
+
+    std::string BacktraceToString(int size, int skip, const std::string &prefix)
+    {
+        std::vector<std::string> bt;
+        Backtrace(bt, size, skip);
+        std::stringstream ss;
+        for (auto &i : bt)
+        {
+            ss << prefix << i << std::endl;
+        }
+        return ss.str();
     }
 
 } // namespace sltj
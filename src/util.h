@@ -5,12 +5,22 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 namespace sltj
 {
+    // 线程id缓存在thread_local中,每个线程只在首次调用时发起一次gettid系统调用
     pid_t GetThreadId();
     uint32_t GetFiberId();
 
+    // 当前时间(毫秒/微秒)
+    uint64_t GetCurrentMS();
+    uint64_t GetCurrentUS();
+
+    // 当前调用栈, 每帧为"模块(函数+偏移) [地址]", 函数名已demangle; skip为跳过的最内层帧数
+    void Backtrace(std::vector<std::string> &bt, int size = 64, int skip = 1);
+    std::string BacktraceToString(int size = 64, int skip = 2, const std::string &prefix = "");
 
 } // namespace sltj
-#endif
\ No newline at end of file
+#endif
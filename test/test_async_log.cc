@@ -0,0 +1,266 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 记录写出顺序
+class RecordAppender : public sltj::LogAppender
+{
+public:
+    using ptr = std::shared_ptr<RecordAppender>;
+    void log(sltj::LogLevel::Level level, sltj::LogEvent::ptr event) override
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        lines.push_back(event->getContent());
+    }
+    std::vector<std::string> take()
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        std::vector<std::string> rt;
+        rt.swap(lines);
+        return rt;
+    }
+    std::vector<std::string> lines;
+
+private:
+    sltj::Mutex m_lock;
+};
+
+static RecordAppender::ptr s_record(new RecordAppender);
+static sltj::Logger::ptr s_logger;
+
+static int64_t buffers()
+{
+    return sltj::Metrics::Lookup<sltj::Gauge>("log.async.buffers")->getValue();
+}
+
+// 两个线程交替打日志, 因果顺序必须保持
+void test_order()
+{
+    const int N = 200;
+    std::atomic<int> turn{0};
+    auto player = [&](int me, const char *name) {
+        for (int i = 0; i < N; ++i)
+        {
+            while (turn != me)
+            {
+                sched_yield();
+            }
+            SLTJ_LOG_INFO(s_logger) << name << i;
+            turn = 1 - me;
+        }
+    };
+    sltj::Thread a([&]() { player(0, "a"); }, "order_a");
+    sltj::Thread b([&]() { player(1, "b"); }, "order_b");
+    a.join();
+    b.join();
+    sltj::AsyncLog::Flush();
+
+    std::vector<std::string> lines = s_record->take();
+    CHECK(lines.size() == 2 * N, lines.size());
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        std::string expect = std::string(i % 2 ? "b" : "a") + std::to_string(i / 2);
+        if (lines[i] != expect)
+        {
+            CHECK(lines[i] == expect, "line " << i << " " << lines[i]);
+            break;
+        }
+    }
+}
+
+// 线程退出时写出自己的缓冲并注销
+void test_thread_exit()
+{
+    int64_t before = buffers();
+    sltj::Thread t([]() {
+        SLTJ_LOG_INFO(s_logger) << "bye";
+        CHECK(buffers() >= 1, "registered");
+    }, "exit_t");
+    t.join();
+    std::vector<std::string> lines = s_record->take();
+    CHECK(lines.size() == 1 && lines[0] == "bye", lines.size());
+    CHECK(buffers() == before, buffers() << " " << before);
+}
+
+// 缓冲很小时生产者等待, 不丢日志, 每个线程内保持顺序
+void test_full()
+{
+    sltj::Config::Lookup<uint32_t>("log.async.buffer_size")->setValue(16);
+    sltj::Counter::ptr waits = sltj::Metrics::Lookup<sltj::Counter>("log.async.full_waits");
+    uint64_t waits_before = waits->getValue();
+    const int THREADS = 4;
+    const int N = 5000;
+    std::vector<sltj::Thread::ptr> threads;
+    for (int t = 0; t < THREADS; ++t)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([t]() {
+            for (int i = 0; i < N; ++i)
+            {
+                SLTJ_LOG_INFO(s_logger) << t << " " << i;
+            }
+        }, "full_" + std::to_string(t))));
+    }
+    for (auto &i : threads)
+    {
+        i->join();
+    }
+    sltj::AsyncLog::Flush();
+    sltj::Config::Lookup<uint32_t>("log.async.buffer_size")->setValue(8192);
+
+    std::vector<std::string> lines = s_record->take();
+    CHECK(lines.size() == THREADS * N, lines.size());
+    std::vector<int> next(THREADS, 0);
+    bool ordered = true;
+    for (auto &line : lines)
+    {
+        int t = 0, i = 0;
+        sscanf(line.c_str(), "%d %d", &t, &i);
+        if (t < 0 || t >= THREADS || next[t] != i)
+        {
+            ordered = false;
+            break;
+        }
+        ++next[t];
+    }
+    CHECK(ordered, "per thread order");
+    CHECK(waits->getValue() > waits_before, "full waits");
+}
+
+void test_config()
+{
+    sltj::ConfigVar<bool>::ptr enable = sltj::Config::Lookup<bool>("log.async.enable");
+    // 已在运行, 再次开启无影响
+    enable->setValue(true);
+    CHECK(sltj::AsyncLog::IsRunning(), "running");
+    enable->setValue(false);
+    CHECK(!sltj::AsyncLog::IsRunning(), "stopped by config");
+    // 停止后同步写出
+    SLTJ_LOG_INFO(s_logger) << "sync";
+    CHECK(s_record->lines.size() == 1, s_record->lines.size());
+    s_record->take();
+    enable->setValue(true);
+    CHECK(sltj::AsyncLog::IsRunning(), "started by config");
+}
+
+// 同步写出时多个线程同时调用appender, FileLogAppender本身不加锁
+class LockedAppender : public sltj::LogAppender
+{
+public:
+    LockedAppender(sltj::LogAppender::ptr appender) : m_appender(appender) {}
+    void log(sltj::LogLevel::Level level, sltj::LogEvent::ptr event) override
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        m_appender->log(level, event);
+    }
+    void flush() override
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        m_appender->flush();
+    }
+
+private:
+    sltj::LogAppender::ptr m_appender;
+    sltj::Mutex m_lock;
+};
+
+struct BenchResult
+{
+    double lines_per_sec = 0;
+    uint64_t p50 = 0; // 生产端单次打日志耗时, ns
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+};
+
+// 共total条日志分给threads个线程, 记录每次打日志在生产端的耗时
+static BenchResult run_bench(sltj::Logger::ptr logger, int threads, int total)
+{
+    int n = total / threads;
+    std::vector<std::vector<uint64_t>> costs(threads, std::vector<uint64_t>(n));
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<sltj::Thread::ptr> vec;
+    for (int t = 0; t < threads; ++t)
+    {
+        std::vector<uint64_t> *cost = &costs[t];
+        vec.push_back(sltj::Thread::ptr(new sltj::Thread([logger, n, cost]() {
+            for (int i = 0; i < n; ++i)
+            {
+                auto b = std::chrono::steady_clock::now();
+                SLTJ_LOG_INFO(logger) << "bench line " << i;
+                (*cost)[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - b).count();
+            }
+        }, "bench_" + std::to_string(t))));
+    }
+    for (auto &i : vec)
+    {
+        i->join();
+    }
+    sltj::AsyncLog::Flush();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::vector<uint64_t> all;
+    all.reserve(threads * n);
+    for (auto &i : costs)
+    {
+        all.insert(all.end(), i.begin(), i.end());
+    }
+    std::sort(all.begin(), all.end());
+    BenchResult rt;
+    rt.lines_per_sec = all.size() / sec;
+    rt.p50 = all[all.size() / 2];
+    rt.p99 = all[all.size() * 99 / 100];
+    rt.max = all.back();
+    return rt;
+}
+
+// 同步写文件与异步写出对比: 总吞吐(含最后一次写出)和生产端单次耗时
+void bench()
+{
+    const std::string path = "/tmp/sltj_test_async_log.log";
+    sltj::Logger::ptr logger(new sltj::Logger("async_bench"));
+    sltj::FileLogAppender::ptr file(new sltj::FileLogAppender(path));
+    file->reopen();
+    file->setFormatter(logger->getFormatter());
+    logger->addAppender(sltj::LogAppender::ptr(new LockedAppender(file)));
+
+    const int total = 256000;
+    for (int threads : {4, 64, 128})
+    {
+        sltj::AsyncLog::Stop();
+        BenchResult sync = run_bench(logger, threads, total);
+        sltj::AsyncLog::Start();
+        BenchResult async = run_bench(logger, threads, total);
+        SLTJ_LOG_INFO(g_logger) << threads << " threads"
+                                << " sync lines/s=" << (uint64_t)sync.lines_per_sec << " p50=" << sync.p50
+                                << "ns p99=" << sync.p99 << "ns max=" << sync.max << "ns"
+                                << " | async lines/s=" << (uint64_t)async.lines_per_sec << " p50=" << async.p50
+                                << "ns p99=" << async.p99 << "ns max=" << async.max << "ns";
+    }
+    unlink(path.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    s_logger.reset(new sltj::Logger("async_test"));
+    s_logger->addAppender(s_record);
+
+    CHECK(sltj::AsyncLog::Start(), "start");
+    CHECK(!sltj::AsyncLog::Start(), "start twice");
+
+    test_order();
+    test_thread_exit();
+    test_full();
+    test_config();
+    bench();
+
+    sltj::AsyncLog::Stop();
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
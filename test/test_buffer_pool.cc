@@ -0,0 +1,206 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <malloc.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 页是否常驻内存
+static bool resident(const void *p)
+{
+    unsigned char vec = 0;
+    void *page = (void *)((uintptr_t)p & ~(uintptr_t)(getpagesize() - 1));
+    return mincore(page, getpagesize(), &vec) == 0 && (vec & 1);
+}
+
+// 线程缓存复用, 跨线程归还, Shrink把空闲页还给系统
+void test_pool()
+{
+    uint64_t in_use = sltj::BufferPool::GetStats().pagesInUse;
+    sltj::BufferBlock *a = sltj::BufferPool::Allocate(100);
+    CHECK(a->pooled && a->capacity == sltj::BufferPool::PAGE_SIZE, a->capacity);
+    CHECK(sltj::BufferPool::GetStats().pagesInUse == in_use + 1, sltj::BufferPool::GetStats().pagesInUse);
+    char *data = a->data;
+    sltj::BufferPool::Release(a);
+    sltj::BufferBlock *b = sltj::BufferPool::Allocate(sltj::BufferPool::PAGE_SIZE);
+    CHECK(b->data == data, "thread cache not reused");
+
+    sltj::BufferBlock *large = sltj::BufferPool::Allocate(sltj::BufferPool::PAGE_SIZE + 1);
+    CHECK(!large->pooled && large->capacity == 2 * sltj::BufferPool::PAGE_SIZE, large->capacity);
+    CHECK(sltj::BufferPool::GetStats().largeBlocks >= 1, "large");
+    sltj::BufferPool::Release(large);
+
+    // 在另一个线程归还
+    memset(b->data, 1, b->capacity);
+    sltj::Thread t([b]() {
+        sltj::BufferPool::Release(b);
+    }, "buf_release");
+    t.join();
+    CHECK(sltj::BufferPool::GetStats().pagesInUse == in_use, sltj::BufferPool::GetStats().pagesInUse);
+
+    // 归还的线程已退出, 页在全局空闲表中; 全部还给系统后不再常驻
+    sltj::BufferPool::FlushThreadCache();
+    CHECK(resident(data), "page not resident before shrink");
+    size_t n = sltj::BufferPool::Shrink(0);
+    sltj::BufferPool::Stats st = sltj::BufferPool::GetStats();
+    CHECK(n > 0 && st.pagesReleased == st.pagesFree, n << " " << st.pagesReleased << "/" << st.pagesFree);
+    CHECK(!resident(data), "page still resident after shrink");
+    sltj::BufferBlock *c = sltj::BufferPool::Allocate(1);
+    c->data[0] = 'x';
+    CHECK(c->data[0] == 'x', "reuse released page");
+    sltj::BufferPool::Release(c);
+}
+
+// 切片在缓冲区继续读写、换块之后内容不变
+void test_buffer()
+{
+    sltj::IOBuffer buf;
+    CHECK(buf.capacity() == 0 && buf.empty(), "lazy");
+    buf.append("hello world", 11);
+    CHECK(buf.capacity() == sltj::BufferPool::PAGE_SIZE, buf.capacity());
+    sltj::BufferSlice hello = buf.slice(0, 5);
+    sltj::BufferSlice world = buf.slice(6, 100);
+    CHECK(world.size() == 5 && world.toString() == "world", world.toString());
+    buf.consume(6);
+    CHECK(std::string(buf.data(), buf.size()) == "world", "consume");
+
+    // 有切片引用时不在原地整理, 写满后换一块
+    std::string big(sltj::BufferPool::PAGE_SIZE - 8, 'a');
+    buf.append(big.data(), big.size());
+    CHECK(buf.size() == big.size() + 5 && buf.capacity() == sltj::BufferPool::PAGE_SIZE, buf.capacity());
+    CHECK(hello.toString() == "hello", hello.toString());
+    buf.append(big.data(), big.size());
+    CHECK(buf.capacity() >= 2 * big.size() + 5 && buf.size() == 2 * big.size() + 5, buf.capacity());
+    CHECK(memcmp(buf.data(), "world", 5) == 0, "moved");
+    CHECK(hello.toString() == "hello" && world.sub(1, 3).toString() == "orl", "slice after move");
+
+    // 全部消费后归还存储
+    buf.consume(buf.size());
+    CHECK(buf.capacity() == 0, buf.capacity());
+
+    std::stringstream ss;
+    ss << hello << ' ' << world;
+    CHECK(ss.str() == "hello world", ss.str());
+}
+
+// 每个连接发一个带body的请求后进入空闲, 空闲连接不持有缓冲页
+void test_idle_sessions()
+{
+    static const size_t kConns = 500;
+    sltj::Socket::ptr listener = sltj::Socket::CreateTCPSocket();
+    CHECK(listener->bind(sltj::Address::LookupAny("127.0.0.1:0")) && listener->listen(), "listen");
+    sltj::Address::ptr addr = listener->getLocalAddress();
+
+    std::vector<sltj::Socket::ptr> clients;
+    std::vector<sltj::Socket::ptr> servers;
+    for (size_t i = 0; i < kConns; ++i)
+    {
+        clients.push_back(sltj::Socket::CreateTCP(addr));
+        CHECK(clients.back()->connect(addr), "connect");
+        servers.push_back(listener->accept());
+    }
+    uint64_t in_use = sltj::BufferPool::GetStats().pagesInUse;
+
+    // 会话本身(不含socket)占用的堆内存
+    size_t heap_before = mallinfo2().uordblks;
+    std::vector<sltj::HttpSession::ptr> sessions;
+    for (size_t i = 0; i < kConns; ++i)
+    {
+        sessions.push_back(sltj::HttpSession::ptr(new sltj::HttpSession(servers[i])));
+    }
+    std::string req = "POST /echo HTTP/1.1\r\nHost: a\r\nContent-Length: 5\r\n\r\nhello";
+    for (size_t i = 0; i < kConns; ++i)
+    {
+        clients[i]->send(req.data(), req.size());
+        sltj::HttpRequest::ptr r = sessions[i]->recvRequest();
+        CHECK(r && r->getBodySlice().toString() == "hello", i);
+        sltj::HttpResponse::ptr rsp(new sltj::HttpResponse);
+        rsp->setBody(r ? r->getBody() : "");
+        CHECK(sessions[i]->sendResponse(rsp), "send");
+        char buf[256];
+        CHECK(clients[i]->recv(buf, sizeof(buf)) > 0, "recv");
+    }
+    size_t heap_after = mallinfo2().uordblks;
+    sltj::BufferPool::Stats st = sltj::BufferPool::GetStats();
+    CHECK(st.pagesInUse == in_use, st.pagesInUse << " pages held by idle sessions");
+    double per_conn = (double)(heap_after - heap_before) / kConns;
+    SLTJ_LOG_INFO(g_logger) << "idle session: heap bytes/conn=" << per_conn << " buffer pages in use=" << st.pagesInUse - in_use
+                            << " (was " << 4096 << " byte receive buffer + send buffer capacity)";
+    CHECK(per_conn < 1024, per_conn);
+}
+
+// 协程中的会话: 没有数据时只等待可读, 不占用缓冲页; 请求body切片在下一个请求到来后仍有效
+void test_fiber_sessions()
+{
+    static const size_t kConns = 100;
+    sltj::IOManager iom(2, "buf");
+    sltj::Socket::ptr listener = sltj::Socket::CreateTCPSocket();
+    CHECK(listener->bind(sltj::Address::LookupAny("127.0.0.1:0")) && listener->listen(), "listen");
+    sltj::Address::ptr addr = listener->getLocalAddress();
+    uint64_t in_use = sltj::BufferPool::GetStats().pagesInUse;
+
+    std::vector<sltj::Socket::ptr> clients;
+    std::atomic<int> served{0};
+    for (size_t i = 0; i < kConns; ++i)
+    {
+        clients.push_back(sltj::Socket::CreateTCP(addr));
+        CHECK(clients.back()->connect(addr), "connect");
+        sltj::Socket::ptr server = listener->accept();
+        iom.schedule([server, &served]() {
+            sltj::HttpSession::ptr session(new sltj::HttpSession(server));
+            sltj::HttpRequest::ptr prev;
+            while (sltj::HttpRequest::ptr req = session->recvRequest())
+            {
+                if (prev)
+                {
+                    CHECK(prev->getBodySlice().toString() == "first", prev->getBodySlice().toString());
+                }
+                prev = req;
+                sltj::HttpResponse::ptr rsp(new sltj::HttpResponse);
+                rsp->setBody(req->getBody());
+                session->sendResponse(rsp);
+                ++served;
+            }
+        });
+    }
+    std::string req = "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nfirst";
+    for (auto &c : clients)
+    {
+        c->send(req.data(), req.size());
+        char buf[256];
+        c->recv(buf, sizeof(buf));
+    }
+    // 服务端发出响应后才计数, 客户端收到时最后一个协程可能还没走到++served
+    for (int i = 0; i < 100 && served != (int)kConns; ++i)
+    {
+        usleep(10 * 1000);
+    }
+    CHECK(served == (int)kConns, served);
+    // 会话都阻塞在recvRequest中, 只有保存的上一个请求持有页
+    uint64_t held = sltj::BufferPool::GetStats().pagesInUse - in_use;
+    CHECK(held <= kConns, held);
+    std::string second = "POST / HTTP/1.1\r\nContent-Length: 6\r\n\r\nsecond";
+    for (auto &c : clients)
+    {
+        c->send(second.data(), second.size());
+        char buf[256];
+        c->recv(buf, sizeof(buf));
+        c->close();
+    }
+    iom.stop();
+    CHECK(served == 2 * (int)kConns, served);
+    CHECK(sltj::BufferPool::GetStats().pagesInUse == in_use, sltj::BufferPool::GetStats().pagesInUse);
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    test_pool();
+    test_buffer();
+    test_idle_sessions();
+    test_fiber_sessions();
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
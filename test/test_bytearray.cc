@@ -0,0 +1,174 @@
+#include "../src/sltj.h"
+#include "../src/bytearray.h"
+#include "test_check.h"
+#include <stdlib.h>
+#include <fcntl.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 随机写入len个type, 读回比较; 同时验证dump到文件再读回
+#define XX(type, len, write_fun, read_fun, base_len)                                  \
+    {                                                                                 \
+        std::vector<type> vec;                                                        \
+        for (int i = 0; i < len; ++i)                                                 \
+        {                                                                             \
+            vec.push_back((type)(((uint64_t)rand() << 32) | rand()) * (i % 2 ? 1 : -1)); \
+        }                                                                             \
+        sltj::ByteArray::ptr ba(new sltj::ByteArray(base_len));                       \
+        for (auto &i : vec)                                                           \
+        {                                                                             \
+            ba->write_fun(i);                                                         \
+        }                                                                             \
+        ba->setPosition(0);                                                           \
+        for (size_t i = 0; i < vec.size(); ++i)                                       \
+        {                                                                             \
+            type v = ba->read_fun();                                                  \
+            CHECK(v == vec[i], #write_fun " i=" << i);                                \
+        }                                                                             \
+        CHECK(ba->getReadSize() == 0, #write_fun);                                    \
+        ba->setPosition(0);                                                           \
+        std::string file = "/tmp/sltj_bytearray_" #type "_" #write_fun ".dat";         \
+        CHECK(ba->writeToFile(file), file);                                           \
+        sltj::ByteArray::ptr ba2(new sltj::ByteArray(base_len * 2));                  \
+        CHECK(ba2->readFromFile(file), file);                                         \
+        ba2->setPosition(0);                                                          \
+        CHECK(ba->toString() == ba2->toString(), file);                               \
+        CHECK(ba->getPosition() == 0 && ba2->getPosition() == 0, file);               \
+        SLTJ_LOG_INFO(g_logger) << #write_fun "/" #read_fun " (" #type ") len=" << len \
+                                << " base_len=" << base_len << " size=" << ba->getSize(); \
+    }
+
+void test_types()
+{
+    XX(int8_t, 100, writeFint8, readFint8, 1);
+    XX(uint8_t, 100, writeFuint8, readFuint8, 1);
+    XX(int16_t, 100, writeFint16, readFint16, 1);
+    XX(uint16_t, 100, writeFuint16, readFuint16, 1);
+    XX(int32_t, 100, writeFint32, readFint32, 1);
+    XX(uint32_t, 100, writeFuint32, readFuint32, 1);
+    XX(int64_t, 100, writeFint64, readFint64, 1);
+    XX(uint64_t, 100, writeFuint64, readFuint64, 1);
+
+    XX(int32_t, 100, writeInt32, readInt32, 1);
+    XX(uint32_t, 100, writeUint32, readUint32, 1);
+    XX(int64_t, 100, writeInt64, readInt64, 1);
+    XX(uint64_t, 100, writeUint64, readUint64, 1);
+
+    XX(int32_t, 1000, writeInt32, readInt32, 7);
+    XX(int64_t, 1000, writeFint64, readFint64, 13);
+}
+#undef XX
+
+void test_misc()
+{
+    sltj::ByteArray::ptr ba(new sltj::ByteArray(5));
+    // zigzag让小负数也只占1字节
+    ba->writeInt32(-1);
+    ba->writeInt64(-64);
+    CHECK(ba->getSize() == 2, ba->getSize());
+    // 字节序
+    ba->clear();
+    ba->writeFuint32(0x01020304);
+    ba->setPosition(0);
+    CHECK(ba->toHexString() == "01 02 03 04 ", ba->toHexString());
+    ba->clear();
+    ba->setIsLittleEndian(true);
+    ba->writeFuint32(0x01020304);
+    ba->setPosition(0);
+    CHECK(ba->toHexString() == "04 03 02 01 ", ba->toHexString());
+    CHECK(ba->readFuint32() == 0x01020304, "little endian");
+
+    ba->clear();
+    ba->writeFloat(3.5f);
+    ba->writeDouble(-1.25);
+    ba->writeStringF16("hello");
+    ba->writeStringF32("sltj");
+    ba->writeStringF64(std::string(100, 'x'));
+    ba->writeStringVint("varint string");
+    ba->writeStringWithoutLength("tail");
+    ba->setPosition(0);
+    CHECK(ba->readFloat() == 3.5f, "float");
+    CHECK(ba->readDouble() == -1.25, "double");
+    CHECK(ba->readStringF16() == "hello", "F16");
+    CHECK(ba->readStringF32() == "sltj", "F32");
+    CHECK(ba->readStringF64() == std::string(100, 'x'), "F64");
+    CHECK(ba->readStringVint() == "varint string", "Vint");
+    CHECK(ba->toString() == "tail", ba->toString());
+
+    bool thrown = false;
+    try
+    {
+        ba->setPosition(ba->getSize());
+        ba->readFuint8();
+    }
+    catch (std::out_of_range &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown, "read past end");
+
+    // 打开成功但读取出错(目录)时返回而不是一直循环
+    sltj::ByteArray::ptr dir(new sltj::ByteArray(5));
+    CHECK(!dir->readFromFile("/tmp") && dir->getSize() == 0, dir->getSize());
+    CHECK(!dir->readFromFile("/tmp/sltj_no_such_file"), "missing file");
+}
+
+// writev/readv直接操作内存块
+void test_iovec()
+{
+    std::string data;
+    for (int i = 0; i < 10000; ++i)
+    {
+        data.append(1, 'a' + i % 26);
+    }
+    sltj::ByteArray::ptr out(new sltj::ByteArray(64));
+    out->writeStringWithoutLength(data);
+    out->setPosition(0);
+
+    int fds[2];
+    CHECK(pipe(fds) == 0, "pipe");
+    fcntl(fds[1], F_SETPIPE_SZ, 1 << 16);
+
+    std::vector<iovec> iovs;
+    uint64_t len = out->getReadBuffers(iovs);
+    CHECK(len == data.size(), len);
+    CHECK(iovs.size() == (data.size() + 63) / 64, iovs.size());
+    ssize_t rt = writev(fds[1], &iovs[0], iovs.size() > IOV_MAX ? IOV_MAX : iovs.size());
+    CHECK(rt > 0, rt);
+    size_t sent = rt;
+    while (sent < data.size())
+    {
+        iovs.clear();
+        out->getReadBuffers(iovs, data.size() - sent, sent);
+        rt = writev(fds[1], &iovs[0], iovs.size() > IOV_MAX ? IOV_MAX : iovs.size());
+        CHECK(rt > 0, rt);
+        sent += rt;
+    }
+    CHECK(out->getPosition() == 0, "getReadBuffers must not move position");
+
+    sltj::ByteArray::ptr in(new sltj::ByteArray(100));
+    size_t recved = 0;
+    while (recved < data.size())
+    {
+        iovs.clear();
+        in->getWriteBuffers(iovs, data.size() - recved);
+        rt = readv(fds[0], &iovs[0], iovs.size() > IOV_MAX ? IOV_MAX : iovs.size());
+        CHECK(rt > 0, rt);
+        recved += rt;
+        in->setPosition(in->getPosition() + rt);
+    }
+    in->setPosition(0);
+    CHECK(in->toString() == data, "readv content");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char **argv)
+{
+    srand(time(0));
+    test_types();
+    test_misc();
+    test_iovec();
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#ifndef __SLTJ_TEST_CHECK_H__
+#define __SLTJ_TEST_CHECK_H__
+
+#include "../src/log.h"
+
+// 测试用断言: 失败时打日志并记下, 不中断后续检查; main最后按s_ok返回.
+// 展开处需要可见的g_logger
+static bool s_ok = true;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            SLTJ_LOG_ERROR(g_logger) << "check fail: " #cond " " << msg; \
+            s_ok = false;                                                \
+        }                                                                \
+    } while (0)
+
+#endif
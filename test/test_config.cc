@@ -13,5 +13,23 @@ int main(int argc,char** argv)
     SLTJ_LOG_INFO(SLTJ_LOG_ROOT()) << g_float_config->getValue();
     SLTJ_LOG_INFO(SLTJ_LOG_ROOT()) << g_float_config->toString();
 
+    // fromString解析传入的字符串, 并触发监听回调
+    int changed = 0;
+    g_int_config->addListener([&changed](const int &old_value, const int &new_value) {
+        SLTJ_LOG_INFO(SLTJ_LOG_ROOT()) << "system.port " << old_value << " -> " << new_value;
+        ++changed;
+    });
+    if (!g_int_config->fromString("9090") || g_int_config->getValue() != 9090 || changed != 1)
+    {
+        SLTJ_LOG_ERROR(SLTJ_LOG_ROOT()) << "fromString fail value=" << g_int_config->getValue() << " changed=" << changed;
+        return 1;
+    }
+    if (g_int_config->fromString("abc") || g_int_config->getValue() != 9090 || changed != 1)
+    {
+        SLTJ_LOG_ERROR(SLTJ_LOG_ROOT()) << "fromString accepted bad value";
+        return 1;
+    }
+    g_int_config->clearListener();
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+// 断言不依赖assert(), 定义NDEBUG时失败同样abort
+#define NDEBUG
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <fcntl.h>
+#include <fstream>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const std::string s_log_path = "/tmp/sltj_test_crash.log";
+static const std::string s_err_path = "/tmp/sltj_test_crash.err";
+
+// 导出符号(-rdynamic), 不内联, 便于在调用栈中按名字查找
+__attribute__((noinline)) std::string capture_backtrace()
+{
+    return sltj::BacktraceToString(64, 1);
+}
+
+__attribute__((noinline)) void crash_null()
+{
+    volatile int *p = nullptr;
+    *p = 1;
+}
+
+// cold: 整个函数放在一处, 失败分支不会拆成没有符号的.cold片段
+__attribute__((noinline, cold)) void crash_assert()
+{
+    int x = 0;
+    SLTJ_ASSERT2(x == 1, "x=" << x);
+}
+
+static volatile uint64_t s_sink = 0;
+static volatile uint64_t s_max_depth = UINT64_MAX;
+
+__attribute__((noinline)) uint64_t crash_overflow(uint64_t n)
+{
+    volatile char buf[1024];
+    buf[0] = (char)n;
+    if (n >= s_max_depth)
+    {
+        return 0;
+    }
+    // 使用返回值, 避免被优化成循环
+    return crash_overflow(n + 1) + buf[0];
+}
+
+static std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+void test_backtrace()
+{
+    std::string bt = capture_backtrace();
+    CHECK(bt.find("capture_backtrace") != std::string::npos, bt);
+    CHECK(bt.find("test_backtrace") != std::string::npos, bt);
+
+    std::vector<std::string> frames;
+    sltj::Backtrace(frames, 2, 0);
+    CHECK(frames.size() == 2, frames.size());
+}
+
+// 落盘时出错或卡住的输出器
+class BadFlushAppender : public sltj::LogAppender
+{
+public:
+    BadFlushAppender(bool hang) : m_hang(hang) {}
+    void log(sltj::LogLevel::Level level, sltj::LogEvent::ptr event) override {}
+    void flush() override
+    {
+        if (m_hang)
+        {
+            for (;;)
+            {
+                pause();
+            }
+        }
+        abort();
+    }
+
+private:
+    bool m_hang;
+};
+
+// 子进程: 装崩溃处理, 写一行只在缓冲里的日志, 然后崩溃
+static void run_child(const std::function<void()> &crash, sltj::LogAppender::ptr extra)
+{
+    int fd = open(s_err_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    sltj::InstallCrashHandler();
+    sltj::FileLogAppender::ptr appender(new sltj::FileLogAppender(s_log_path));
+    appender->reopen();
+    g_logger->addAppender(appender);
+    if (extra)
+    {
+        g_logger->addAppender(extra);
+    }
+    SLTJ_LOG_INFO(g_logger) << "last words";
+    crash();
+    _exit(0);
+}
+
+// 等待子进程结束, 超过timeout_ms杀掉并返回false
+static bool wait_child(pid_t pid, int &status, uint64_t timeout_ms)
+{
+    uint64_t deadline = sltj::GetCurrentMS() + timeout_ms;
+    while (waitpid(pid, &status, WNOHANG) == 0)
+    {
+        if (sltj::GetCurrentMS() >= deadline)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return false;
+        }
+        usleep(10 * 1000);
+    }
+    return true;
+}
+
+static void expect_crash(const std::string &name, int sig, const std::string &frame,
+                         const std::function<void()> &crash, sltj::LogAppender::ptr extra = nullptr)
+{
+    unlink(s_log_path.c_str());
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        run_child(crash, extra);
+    }
+    int status = 0;
+    CHECK(wait_child(pid, status, 10000), name << " hang");
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == sig, name << " status=" << status);
+
+    std::string log = read_file(s_log_path);
+    CHECK(log.find("last words") != std::string::npos, name << " log:\n" << log);
+
+    std::string err = read_file(s_err_path);
+    CHECK(err.find("*** " + name + " received") != std::string::npos, name << " stderr:\n" << err);
+    CHECK(err.find("[FATAL]") != std::string::npos, name << " stderr:\n" << err);
+    CHECK(err.find(frame) != std::string::npos, name << " stderr:\n" << err);
+    SLTJ_LOG_INFO(g_logger) << name << " stderr:\n" << err.substr(0, 1500);
+}
+
+// 断言宏是一条语句, 条件只求值一次
+void test_assert_macro()
+{
+    int n = 0;
+    bool other = false;
+    if (n == 0)
+        SLTJ_ASSERT(++n == 1);
+    else
+        other = true;
+    CHECK(n == 1 && !other, n);
+    if (n == 0)
+        SLTJ_ASSERT2(++n == 1, "n=" << n);
+    else
+        other = true;
+    CHECK(n == 1 && other, n);
+}
+
+void test_crash()
+{
+    expect_crash("SIGSEGV", SIGSEGV, "crash_null", []() {
+        sltj::Thread t(&crash_null, "crasher");
+        t.join();
+    });
+    expect_crash("SIGABRT", SIGABRT, "crash_assert", &crash_assert);
+    expect_crash("SIGSEGV", SIGSEGV, "crash_overflow", []() { s_sink = crash_overflow(0); });
+
+    // 落盘时abort: 同一线程再次进入处理时直接以SIGABRT结束, 而不是挂起
+    expect_crash("SIGSEGV", SIGABRT, "crash_null", &crash_null,
+                 sltj::LogAppender::ptr(new BadFlushAppender(false)));
+    // 落盘卡住: 看门狗超时后以原信号结束
+    uint64_t start = sltj::GetCurrentMS();
+    expect_crash("SIGSEGV", SIGSEGV, "crash_null", &crash_null,
+                 sltj::LogAppender::ptr(new BadFlushAppender(true)));
+    uint64_t used = sltj::GetCurrentMS() - start;
+    CHECK(used >= 2500 && used < 8000, used);
+    CHECK(read_file(s_err_path).find("timed out") != std::string::npos, "watchdog");
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_backtrace();
+    test_assert_macro();
+    test_crash();
+
+    unlink(s_log_path.c_str());
+    unlink(s_err_path.c_str());
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
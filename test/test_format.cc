@@ -0,0 +1,181 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <limits>
+#include <stdarg.h>
+#include <stdlib.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 编译期检查
+static_assert(sltj::FormatPlaceholders("a {} b {}") == 2, "count");
+static_assert(sltj::FormatPlaceholders("{{}} {}") == 1, "escape");
+static_assert(sltj::FormatPlaceholders("no args") == 0, "none");
+static_assert(sltj::FormatPlaceholders("bad { brace") == -1, "unbalanced");
+static_assert(sizeof(sltj::FormatArgCount(1, "a", 2.0)) - 1 == 3, "args");
+
+struct Point
+{
+    int x, y;
+};
+
+std::ostream &operator<<(std::ostream &os, const Point &p)
+{
+    return os << "(" << p.x << "," << p.y << ")";
+}
+
+template <class... Args>
+static std::string fmt(const char *f, const Args &...args)
+{
+    std::stringstream ss;
+    sltj::FormatTo(ss, f, args...);
+    return ss.str();
+}
+
+void test_values()
+{
+    CHECK(fmt("{}", 0) == "0", fmt("{}", 0));
+    CHECK(fmt("{} {}", -1, 12345) == "-1 12345", fmt("{} {}", -1, 12345));
+    CHECK(fmt("{}", std::numeric_limits<int64_t>::min()) == "-9223372036854775808", "int64 min");
+    CHECK(fmt("{}", std::numeric_limits<uint64_t>::max()) == "18446744073709551615", "uint64 max");
+    CHECK(fmt("{}", (uint16_t)65535) == "65535", "uint16");
+    CHECK(fmt("{}{}", true, false) == "truefalse", "bool");
+    CHECK(fmt("{}", 'c') == "c", "char");
+    CHECK(fmt("{}", 3.14) == "3.14", fmt("{}", 3.14));
+    CHECK(fmt("{}", 1e20) == "1e+20", fmt("{}", 1e20));
+    CHECK(fmt("{}", 0.5f) == "0.5", "float");
+    CHECK(fmt("{}/{}", "literal", std::string("string")) == "literal/string", "strings");
+    const char *cstr = "cstr";
+    CHECK(fmt("{}", cstr) == "cstr", "const char*");
+    CHECK(fmt("{}", (void *)0x1234) == "0x1234", fmt("{}", (void *)0x1234));
+    CHECK(fmt("{}", Point{1, 2}) == "(1,2)", "operator<<");
+    CHECK(fmt("{{}} {}", 7) == "{} 7", fmt("{{}} {}", 7));
+
+    // 数字的每一位长度
+    uint64_t v = 1;
+    for (int i = 0; i < 19; ++i, v *= 10)
+    {
+        CHECK(fmt("{}", v) == std::to_string(v), v);
+        CHECK(fmt("{}", v - 1) == std::to_string(v - 1), v - 1);
+    }
+
+    // 运行期格式串个数不符
+    const char *f = "{} {}";
+    CHECK(fmt(f, 1) == "1 <<missing arg>>", fmt(f, 1));
+    CHECK(fmt("{}", 1, 2) == "1<<extra args>>", fmt("{}", 1, 2));
+}
+
+class RecordAppender : public sltj::LogAppender
+{
+public:
+    void log(sltj::LogLevel::Level level, sltj::LogEvent::ptr event) override
+    {
+        last = event->getContent();
+    }
+    std::string last;
+};
+
+void test_macro()
+{
+    sltj::Logger::ptr logger(new sltj::Logger("format_test"));
+    std::shared_ptr<RecordAppender> record(new RecordAppender);
+    logger->addAppender(record);
+    SLTJ_LOG_FMT_INFO(logger, "x={} y={} name={}", 1, 2.5, "abc");
+    CHECK(record->last == "x=1 y=2.5 name=abc", record->last);
+    // SLTJ_LOG_FMT_INFO(logger, "x={} y={}", 1);  个数不符, 编译失败
+
+    // 运行期的格式串不做编译期检查, 个数不符时输出标记
+    const char *runtime = record->last.empty() ? "" : "a={} b={}";
+    SLTJ_LOG_FMT_INFO(logger, runtime, 1);
+    CHECK(record->last == "a=1 b=<<missing arg>>", record->last);
+    // 长格式串仍在编译期检查
+#define LONG_TEXT "0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqr"
+    SLTJ_LOG_FMT_INFO(logger, LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT
+                      LONG_TEXT LONG_TEXT "{}", 7);
+    CHECK(record->last.size() == 1001 && record->last.back() == '7', record->last.size());
+    static_assert(sltj::FormatPlaceholders(LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT LONG_TEXT
+                                           LONG_TEXT LONG_TEXT LONG_TEXT "{} {{}} {}") == 2,
+                  "long format string");
+#undef LONG_TEXT
+
+    // printf风格的format保留原语义
+    sltj::LogEvent::ptr event = SLTJ_LOG_MAKE_EVENT(logger, sltj::LogLevel::INFO);
+    event->format("%d-%s", 42, "x");
+    CHECK(event->getContent() == "42-x", event->getContent());
+
+    logger->setLevel(sltj::LogLevel::ERROR);
+    record->last.clear();
+    SLTJ_LOG_FMT_INFO(logger, "{}", 1);
+    CHECK(record->last.empty(), "level filtered");
+}
+
+// 原实现: vasprintf后复制到string再写入流
+static void old_format(std::stringstream &ss, const char *fmt, ...)
+{
+    va_list al;
+    va_start(al, fmt);
+    char *buf = nullptr;
+    int len = vasprintf(&buf, fmt, al);
+    if (len != -1)
+    {
+        ss << std::string(buf, len);
+        free(buf);
+    }
+    va_end(al);
+}
+
+
+void bench()
+{
+    const int N = 1000000;
+    sltj::Logger::ptr logger(new sltj::Logger("format_bench"));
+    auto run = [&](const std::function<void(sltj::LogEvent::ptr)> &cb) {
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i)
+        {
+            sltj::LogEvent::ptr event = SLTJ_LOG_MAKE_EVENT(logger, sltj::LogLevel::INFO);
+            cb(event);
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+    };
+    int i = 0;
+    double old_ns = run([&](sltj::LogEvent::ptr e) {
+        std::stringstream &&ss = e->getSS();
+        old_format(ss, "req %d from %s took %lu us status %d", ++i, "10.0.0.1", 12345ul, 200);
+    });
+    double printf_ns = run([&](sltj::LogEvent::ptr e) {
+        e->format("req %d from %s took %lu us status %d", ++i, "10.0.0.1", 12345ul, 200);
+    });
+    double new_ns = run([&](sltj::LogEvent::ptr e) {
+        e->formatArgs("req {} from {} took {} us status {}", ++i, "10.0.0.1", 12345ul, 200);
+    });
+    SLTJ_LOG_INFO(g_logger) << "ns per event (incl. event alloc) vasprintf=" << old_ns
+                            << " vsnprintf=" << printf_ns << " {}=" << new_ns;
+
+    // 只计格式化, 复用同一个流
+    std::stringstream ss;
+    auto only = [&](const std::function<void()> &cb) {
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i)
+        {
+            ss.seekp(0);
+            cb();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+    };
+    old_ns = only([&]() { old_format(ss, "req %d from %s took %lu us status %d", ++i, "10.0.0.1", 12345ul, 200); });
+    new_ns = only([&]() { sltj::FormatTo(ss, "req {} from {} took {} us status {}", ++i, "10.0.0.1", 12345ul, 200); });
+    SLTJ_LOG_INFO(g_logger) << "ns per format only vasprintf=" << old_ns << " {}=" << new_ns;
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_values();
+    test_macro();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
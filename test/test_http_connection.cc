@@ -0,0 +1,225 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 协程内休眠, 不阻塞工作线程
+static void fiber_sleep(uint64_t ms)
+{
+    sltj::IOManager *iom = sltj::IOManager::GetThis();
+    sltj::Fiber::ptr fiber = sltj::Fiber::GetThis();
+    iom->addTimer(ms, [iom, fiber]() {
+        iom->schedule(fiber);
+    });
+    sltj::Fiber::YieldToHold();
+}
+
+static void add_routes(sltj::HttpServer::ptr server)
+{
+    sltj::ServletDispatch::ptr sd = server->getServletDispatch();
+    sd->addServlet("/hello", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                                sltj::HttpSession::ptr session) {
+        rsp->setBody("hello " + req->getParam("n"));
+        return 0;
+    });
+    sd->addServlet("/echo", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                               sltj::HttpSession::ptr session) {
+        rsp->setBody(req->getHeader("Host") + ":" + req->getBody());
+        return 0;
+    });
+    sd->addServlet("/close", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                                sltj::HttpSession::ptr session) {
+        rsp->setClose(true);
+        rsp->setBody("bye");
+        return 0;
+    });
+    sd->addServlet("/slow", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                               sltj::HttpSession::ptr session) {
+        fiber_sleep(300);
+        rsp->setBody("slow");
+        return 0;
+    });
+}
+
+static uint16_t s_port = 0;
+
+sltj::HttpConnectionPool::ptr new_pool(uint32_t max_size, uint32_t max_alive_time, uint32_t max_request,
+                                       sltj::IOManager *iom = nullptr)
+{
+    return sltj::HttpConnectionPool::ptr(new sltj::HttpConnectionPool(
+        "127.0.0.1", "test.local", s_port, max_size, max_alive_time, max_request, iom));
+}
+
+// 8个协程共用最多2个连接
+void test_reuse()
+{
+    sltj::HttpConnectionPool::ptr pool = new_pool(2, 60000, 0);
+    std::atomic<int> ok{0};
+    {
+        sltj::IOManager iom(2, "client");
+        for (int i = 0; i < 8; ++i)
+        {
+            iom.schedule([pool, i, &ok]() {
+                for (int j = 0; j < 100; ++j)
+                {
+                    sltj::HttpResult::ptr r = pool->doGet("/hello?n=" + std::to_string(i), 3000);
+                    if (r->result == sltj::HttpResult::Error::OK &&
+                        r->response->getBody() == "hello " + std::to_string(i))
+                    {
+                        ++ok;
+                    }
+                    else
+                    {
+                        SLTJ_LOG_ERROR(g_logger) << r->toString();
+                    }
+                }
+            });
+        }
+        iom.schedule([pool]() {
+            sltj::HttpResult::ptr r = pool->doPost("/echo", 3000, {}, "body");
+            CHECK(r->response && r->response->getBody() == "test.local:body", r->toString());
+        });
+        iom.stop();
+    }
+    sltj::HttpConnectionPool::Stats s = pool->getStats();
+    CHECK(ok == 800, ok);
+    CHECK(s.miss == 2, s.miss);
+    CHECK(s.hit + s.miss == 801, s.hit);
+    CHECK(s.wait > 0, s.wait);
+    CHECK(s.total == 2 && s.idle == 2, s.total << " " << s.idle);
+    SLTJ_LOG_INFO(g_logger) << "reuse: " << pool->statsToString();
+}
+
+// 每个连接最多3个请求; 响应要求关闭的连接不复用
+void test_limits()
+{
+    sltj::HttpConnectionPool::ptr pool = new_pool(4, 60000, 3);
+    sltj::IOManager iom(1, "client");
+    iom.schedule([pool]() {
+        for (int i = 0; i < 9; ++i)
+        {
+            sltj::HttpResult::ptr r = pool->doGet("/hello", 3000);
+            CHECK(r->result == sltj::HttpResult::Error::OK, r->toString());
+        }
+        CHECK(pool->getStats().miss == 3, pool->getStats().miss);
+
+        sltj::HttpResult::ptr r = pool->doGet("/close", 3000);
+        CHECK(r->result == sltj::HttpResult::Error::OK && r->response->isClose(), r->toString());
+        CHECK(pool->getStats().total == 0, pool->getStats().total);
+    });
+    iom.stop();
+}
+
+void test_timeout()
+{
+    sltj::HttpConnectionPool::ptr pool = new_pool(1, 60000, 0);
+    {
+        sltj::IOManager iom(2, "client");
+        iom.schedule([pool]() {
+            uint64_t t0 = sltj::GetCurrentMS();
+            sltj::HttpResult::ptr r = pool->doGet("/slow", 100);
+            uint64_t used = sltj::GetCurrentMS() - t0;
+            CHECK(r->result == sltj::HttpResult::Error::TIMEOUT, r->toString());
+            CHECK(used >= 90 && used < 280, used);
+            // 超时的连接被丢弃
+            CHECK(pool->getStats().total == 0, pool->getStats().total);
+        });
+        iom.stop();
+    }
+
+    // 连接池满时等待超时
+    {
+        sltj::IOManager iom(2, "client");
+        iom.schedule([pool]() {
+            sltj::HttpConnection::ptr conn = pool->getConnection(1000);
+            CHECK(conn, "get connection");
+            fiber_sleep(300);
+        });
+        iom.schedule([pool]() {
+            fiber_sleep(50);
+            sltj::HttpResult::ptr r = pool->doGet("/hello", 100);
+            CHECK(r->result == sltj::HttpResult::Error::POOL_GET_CONNECTION, r->toString());
+            // 等待期间归还的连接可以拿到
+            r = pool->doGet("/hello", 1000);
+            CHECK(r->result == sltj::HttpResult::Error::OK, r->toString());
+        });
+        iom.stop();
+    }
+    CHECK(pool->getStats().timeout == 1, pool->getStats().timeout);
+    CHECK(pool->getStats().wait == 2, pool->getStats().wait);
+}
+
+// 定时回收过期的空闲连接; 服务端关闭的空闲连接在借出时被发现
+void test_reap()
+{
+    sltj::Config::Lookup<uint64_t>("http.pool.reap_interval")->setValue(50);
+    {
+        sltj::IOManager iom(1, "client");
+        sltj::HttpConnectionPool::ptr pool = new_pool(2, 150, 0, &iom);
+        iom.schedule([&pool]() {
+            CHECK(pool->doGet("/hello", 1000)->result == sltj::HttpResult::Error::OK, "get");
+            CHECK(pool->getStats().idle == 1, pool->getStats().idle);
+            fiber_sleep(400);
+            CHECK(pool->getStats().idle == 0, pool->getStats().idle);
+            CHECK(pool->getStats().reaped == 1, pool->getStats().reaped);
+            // 回收定时器随连接池析构取消, 之后iom才能停止
+            pool.reset();
+        });
+        iom.stop();
+    }
+    {
+        sltj::IOManager iom(1, "client");
+        sltj::HttpConnectionPool::ptr pool = new_pool(2, 60000, 0);
+        iom.schedule([pool]() {
+            CHECK(pool->doGet("/hello", 1000)->result == sltj::HttpResult::Error::OK, "get");
+            // 服务端读超时后关闭连接
+            fiber_sleep(400);
+            sltj::HttpResult::ptr r = pool->doGet("/hello", 1000);
+            CHECK(r->result == sltj::HttpResult::Error::OK, r->toString());
+            CHECK(pool->getStats().miss == 2, pool->getStats().miss);
+        });
+        iom.stop();
+    }
+}
+
+// 借出的连接晚于连接池释放: 直接关闭, 不再访问已析构的池
+void test_outlive()
+{
+    sltj::IOManager iom(1, "client");
+    iom.schedule([]() {
+        sltj::HttpConnectionPool::ptr pool = new_pool(2, 60000, 0);
+        sltj::HttpConnection::ptr conn = pool->getConnection(1000);
+        CHECK(conn, "borrow");
+        pool.reset();
+        conn.reset();
+    });
+    iom.stop();
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    sltj::IOManager io_worker(2, "io");
+    sltj::IOManager accept_worker(1, "accept");
+    {
+        sltj::HttpServer::ptr server(new sltj::HttpServer(true, &io_worker, &accept_worker));
+        add_routes(server);
+        server->setRecvTimeout(200);
+        CHECK(server->bind(sltj::Address::LookupAny("127.0.0.1:0")), "bind");
+        CHECK(server->start(), "start");
+        s_port = std::dynamic_pointer_cast<sltj::IPAddress>(server->getSocks()[0]->getLocalAddress())->getPort();
+
+        test_reuse();
+        test_limits();
+        test_timeout();
+        test_reap();
+        test_outlive();
+        server->stop();
+    }
+    accept_worker.stop();
+    io_worker.stop();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
@@ -0,0 +1,502 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <algorithm>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 对一段完整报文执行解析
+static bool parse_all(sltj::HttpParser &parser, std::string &data)
+{
+    parser.execute(&data[0], data.size());
+    return parser.isFinished();
+}
+
+void test_parse_request()
+{
+    std::string data = "GET /a/b?x=1&y=2#frag HTTP/1.1\r\n"
+                       "Host: localhost\r\n"
+                       "X-Empty:\r\n"
+                       "User-Agent:   test  \r\n"
+                       "\r\n";
+    sltj::HttpParser parser(sltj::HttpParser::REQUEST);
+    CHECK(parse_all(parser, data), "finished");
+    CHECK(parser.getNread() == data.size(), parser.getNread());
+    CHECK(parser.getMethod() == sltj::HttpMethod::GET, (int)parser.getMethod());
+    CHECK(parser.getVersion() == 0x11, (int)parser.getVersion());
+    CHECK(parser.getPath().toString(data.data()) == "/a/b", parser.getPath().toString(data.data()));
+    CHECK(parser.getQuery().toString(data.data()) == "x=1&y=2", "query");
+    CHECK(parser.getFragment().toString(data.data()) == "frag", "fragment");
+    CHECK(parser.getHeaders().size() == 3, parser.getHeaders().size());
+    CHECK(parser.isKeepAlive(), "keepalive");
+    CHECK(parser.getBody().empty(), "body");
+
+    sltj::HttpSlice ua;
+    CHECK(parser.getHeader(data.data(), "user-agent", ua) && ua.toString(data.data()) == "test",
+          ua.toString(data.data()));
+
+    sltj::HttpRequest::ptr req = parser.toRequest(data.data());
+    CHECK(req->getHeader("HOST") == "localhost", req->getHeader("HOST"));
+    CHECK(req->getParam("y") == "2", req->getParam("y"));
+    CHECK(!req->isClose(), "close");
+
+    // HTTP/1.0默认关闭连接
+    std::string data10 = "GET / HTTP/1.0\r\n\r\n";
+    parser.reset();
+    CHECK(parse_all(parser, data10) && !parser.isKeepAlive(), "http/1.0");
+
+    // 绝对形式的uri
+    std::string abs = "GET http://example.com/p?q HTTP/1.1\r\nConnection: close\r\n\r\n";
+    parser.reset();
+    CHECK(parse_all(parser, abs), "absolute uri");
+    CHECK(parser.getPath().toString(abs.data()) == "/p", parser.getPath().toString(abs.data()));
+    CHECK(!parser.isKeepAlive(), "connection close");
+}
+
+void test_parse_chunked()
+{
+    std::string data = "POST /upload HTTP/1.1\r\n"
+                       "Transfer-Encoding: chunked\r\n"
+                       "\r\n"
+                       "5\r\nhello\r\n"
+                       "6;ext=1\r\n world\r\n"
+                       "0\r\n"
+                       "X-Trailer: t\r\n"
+                       "\r\n";
+    // 逐字节喂入, 检验断点续解析
+    sltj::HttpParser parser(sltj::HttpParser::REQUEST);
+    std::string buf(data.size(), '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        buf[i] = data[i];
+        parser.execute(&buf[0], i + 1);
+        CHECK(!parser.hasError(), i);
+        if (parser.isFinished())
+        {
+            CHECK(i + 1 == data.size(), i);
+            break;
+        }
+    }
+    CHECK(parser.isFinished(), "chunked finished");
+    CHECK(parser.isChunked(), "chunked");
+    CHECK(parser.getBody().toString(buf.data()) == "hello world", parser.getBody().toString(buf.data()));
+
+    std::string bad = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n";
+    parser.reset();
+    parser.execute(&bad[0], bad.size());
+    CHECK(parser.getError() == sltj::HttpParser::INVALID_CHUNK, parser.getError());
+
+    // trailer与头部共用大小上限, 分多次到达或一次到达都会超限
+    std::string head = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\na\r\n0\r\n";
+    std::string trailer;
+    for (int i = 0; i < 100; ++i)
+    {
+        trailer += "X-T" + std::to_string(i) + ": " + std::string(20, 't') + "\r\n";
+    }
+    std::string big = head + trailer;
+    parser.reset();
+    parser.setMaxHeaderSize(1024);
+    parser.execute(&big[0], big.size());
+    CHECK(parser.getError() == sltj::HttpParser::HEADER_TOO_LARGE, parser.getError());
+    big = head + trailer + "\r\n";
+    parser.reset();
+    parser.execute(&big[0], big.size());
+    CHECK(parser.getError() == sltj::HttpParser::HEADER_TOO_LARGE, parser.getError());
+    big = head + trailer.substr(0, trailer.find("X-T20:")) + "\r\n";
+    parser.reset();
+    CHECK(parse_all(parser, big), "small trailer");
+}
+
+// 请求长度有歧义时拒绝(RFC 7230 3.3.3)
+void test_parse_framing()
+{
+    const char *bad[] = {
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\nContent-Length: 3\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: gzip\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, chunked\r\n\r\n",
+    };
+    sltj::HttpParser parser(sltj::HttpParser::REQUEST);
+    for (auto i : bad)
+    {
+        std::string data = i;
+        parser.reset();
+        parser.execute(&data[0], data.size());
+        CHECK(parser.getError() == sltj::HttpParser::INVALID_TRANSFER_ENCODING, i);
+    }
+
+    std::string ok = "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\nTransfer-Encoding: CHUNKED\r\n\r\n0\r\n\r\n";
+    parser.reset();
+    CHECK(parse_all(parser, ok) && parser.isChunked(), "gzip, chunked");
+
+    // 响应的最后一项不是chunked时读到连接关闭
+    std::string rsp = "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip\r\n\r\nabc";
+    sltj::HttpParser rsp_parser(sltj::HttpParser::RESPONSE);
+    rsp_parser.execute(&rsp[0], rsp.size());
+    CHECK(!rsp_parser.hasError() && rsp_parser.needEof(), "response gzip");
+}
+
+void test_parse_pipeline()
+{
+    std::string data = "POST /a HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                       "GET /b HTTP/1.1\r\n\r\n";
+    sltj::HttpParser parser(sltj::HttpParser::REQUEST);
+    size_t n = parser.execute(&data[0], data.size());
+    CHECK(parser.isFinished(), "first");
+    CHECK(parser.getBody().toString(data.data()) == "abc", "first body");
+    CHECK(parser.getContentLength() == 3, parser.getContentLength());
+
+    parser.reset();
+    std::string rest = data.substr(n);
+    CHECK(parse_all(parser, rest), "second");
+    CHECK(parser.getPath().toString(rest.data()) == "/b", "second path");
+}
+
+void test_parse_errors()
+{
+    sltj::HttpParser parser(sltj::HttpParser::REQUEST);
+
+    std::string method = "FOO / HTTP/1.1\r\n\r\n";
+    parser.execute(&method[0], method.size());
+    CHECK(parser.getError() == sltj::HttpParser::INVALID_METHOD, parser.getError());
+
+    std::string version = "GET / HTTP/2.0\r\n\r\n";
+    parser.reset();
+    parser.execute(&version[0], version.size());
+    CHECK(parser.getError() == sltj::HttpParser::INVALID_VERSION, parser.getError());
+
+    std::string cl = "POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n";
+    parser.reset();
+    parser.execute(&cl[0], cl.size());
+    CHECK(parser.getError() == sltj::HttpParser::INVALID_CONTENT_LENGTH, parser.getError());
+
+    // 19位、20位的长度溢出int64, 不能变成负数而把body当作下一个请求
+    const char *overflow[] = {"9300000000000000000", "18446744073709551621"};
+    for (const char *len : overflow)
+    {
+        std::string smuggle = std::string("POST / HTTP/1.1\r\nContent-Length: ") + len +
+                              "\r\n\r\nGET /admin HTTP/1.1\r\n\r\n";
+        parser.reset();
+        parser.execute(&smuggle[0], smuggle.size());
+        CHECK(parser.getError() == sltj::HttpParser::INVALID_CONTENT_LENGTH, len << " " << parser.getError());
+        CHECK(!parser.isFinished(), len);
+    }
+    // 不溢出但超过body上限
+    std::string huge = "POST / HTTP/1.1\r\nContent-Length: 9000000000000000000\r\n\r\n";
+    parser.reset();
+    parser.execute(&huge[0], huge.size());
+    CHECK(parser.getError() == sltj::HttpParser::BODY_TOO_LARGE, parser.getError());
+    // 前导0不限位数
+    std::string zeros = "POST / HTTP/1.1\r\nContent-Length: 00000000000000000002\r\n\r\nab";
+    parser.reset();
+    parser.execute(&zeros[0], zeros.size());
+    CHECK(!parser.hasError() && parser.isFinished() && parser.getContentLength() == 2, parser.getError());
+
+    // 头部未完成即超限
+    parser.reset();
+    parser.setMaxHeaderSize(64);
+    std::string big = "GET / HTTP/1.1\r\nX-Big: " + std::string(100, 'a');
+    parser.execute(&big[0], big.size());
+    CHECK(parser.getError() == sltj::HttpParser::HEADER_TOO_LARGE, parser.getError());
+
+    parser.reset();
+    parser.setMaxBodySize(10);
+    std::string body = "POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n";
+    parser.execute(&body[0], body.size());
+    CHECK(parser.getError() == sltj::HttpParser::BODY_TOO_LARGE, parser.getError());
+
+    // 配置项决定默认上限
+    CHECK(sltj::HttpParser(sltj::HttpParser::REQUEST).getMaxHeaderSize() ==
+              sltj::Config::Lookup<uint64_t>("http.parser.max_header_size")->getValue(),
+          "config");
+}
+
+void test_parse_response()
+{
+    std::string data = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+    sltj::HttpParser parser(sltj::HttpParser::RESPONSE);
+    CHECK(parse_all(parser, data), "response");
+    CHECK(parser.getStatus() == 200, parser.getStatus());
+    sltj::HttpResponse::ptr rsp = parser.toResponse(data.data());
+    CHECK(rsp->getReason() == "OK" && rsp->getBody() == "ok", rsp->getBody());
+
+    // 没有长度的响应读到EOF
+    std::string eof = "HTTP/1.0 200 OK\r\n\r\nsome data";
+    parser.reset();
+    parser.execute(&eof[0], eof.size());
+    CHECK(!parser.isFinished() && parser.needEof(), "need eof");
+    parser.finishEof();
+    CHECK(parser.isFinished() && parser.getBody().toString(eof.data()) == "some data", "eof body");
+
+    // 204没有body
+    std::string nc = "HTTP/1.1 204 No Content\r\n\r\n";
+    parser.reset();
+    CHECK(parse_all(parser, nc), "204");
+}
+
+// 简单的HTTP客户端连接: 发送原始报文, 按解析器读取响应
+class TestClient
+{
+public:
+    TestClient(sltj::Address::ptr addr)
+        : m_parser(sltj::HttpParser::RESPONSE)
+    {
+        m_sock = sltj::Socket::CreateTCP(addr);
+        m_connected = m_sock->connect(addr, 3000);
+        m_sock->setTcpNoDelay(true);
+        m_sock->setRecvTimeout(3000);
+    }
+
+    bool isConnected() const { return m_connected; }
+
+    bool send(const std::string &data)
+    {
+        size_t off = 0;
+        while (off < data.size())
+        {
+            int rt = m_sock->send(data.data() + off, data.size() - off);
+            if (rt <= 0)
+            {
+                return false;
+            }
+            off += rt;
+        }
+        return true;
+    }
+
+    // head为true时按HEAD请求的响应解析, 没有body
+    sltj::HttpResponse::ptr recv(bool head = false)
+    {
+        m_parser.reset();
+        m_parser.setSkipBody(head);
+        for (;;)
+        {
+            if (!m_buf.empty())
+            {
+                m_parser.execute(&m_buf[0], m_buf.size());
+                if (m_parser.hasError())
+                {
+                    return nullptr;
+                }
+                if (m_parser.isFinished())
+                {
+                    break;
+                }
+            }
+            char tmp[4096];
+            int rt = m_sock->recv(tmp, sizeof(tmp));
+            if (rt <= 0)
+            {
+                return nullptr;
+            }
+            m_buf.append(tmp, rt);
+        }
+        sltj::HttpResponse::ptr rsp = m_parser.toResponse(m_buf.data());
+        m_buf.erase(0, m_parser.getNread());
+        return rsp;
+    }
+
+    // 对端是否已关闭连接
+    bool isPeerClosed()
+    {
+        char c;
+        return m_buf.empty() && m_sock->recv(&c, 1) == 0;
+    }
+
+private:
+    sltj::Socket::ptr m_sock;
+    sltj::HttpParser m_parser;
+    std::string m_buf;
+    bool m_connected;
+};
+
+static void add_routes(sltj::HttpServer::ptr server)
+{
+    sltj::ServletDispatch::ptr sd = server->getServletDispatch();
+    sd->addServlet("/hello", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                                sltj::HttpSession::ptr session) {
+        rsp->setBody("hello");
+        return 0;
+    });
+    sd->addServlet("/echo", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                               sltj::HttpSession::ptr session) {
+        rsp->setBody(req->getBody());
+        return 0;
+    });
+    sd->addGlobServlet("/static/*", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                                       sltj::HttpSession::ptr session) {
+        rsp->setBody("static:" + req->getPath());
+        return 0;
+    });
+}
+
+void test_server(sltj::Address::ptr addr)
+{
+    {
+        TestClient client(addr);
+        CHECK(client.isConnected(), "connect");
+
+        client.send("GET /hello HTTP/1.1\r\nHost: t\r\n\r\n");
+        sltj::HttpResponse::ptr rsp = client.recv();
+        CHECK(rsp && rsp->getStatus() == sltj::HttpStatus::OK && rsp->getBody() == "hello", "exact");
+        CHECK(rsp && rsp->getHeader("server") == "sltj/1.0.0", "server header");
+        CHECK(rsp && !rsp->isClose(), "keepalive");
+
+        // 同一连接上继续请求
+        client.send("GET /static/js/app.js HTTP/1.1\r\n\r\n");
+        rsp = client.recv();
+        CHECK(rsp && rsp->getBody() == "static:/static/js/app.js", "glob");
+
+        client.send("POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n");
+        rsp = client.recv();
+        CHECK(rsp && rsp->getBody() == "abc", "echo chunked");
+
+        // HEAD的响应只有头部, 紧随其后的响应不受影响
+        client.send("HEAD /hello HTTP/1.1\r\n\r\nGET /hello HTTP/1.1\r\n\r\n");
+        rsp = client.recv(true);
+        CHECK(rsp && rsp->getStatus() == sltj::HttpStatus::OK && rsp->getBody().empty(), "head");
+        CHECK(rsp && rsp->getHeader("content-length") == "5", "head content-length");
+        rsp = client.recv();
+        CHECK(rsp && rsp->getBody() == "hello", "after head");
+
+        client.send("GET /nothing HTTP/1.1\r\n\r\n");
+        rsp = client.recv();
+        CHECK(rsp && rsp->getStatus() == sltj::HttpStatus::NOT_FOUND, "404");
+
+        // 一次发送三个请求, 按顺序收到三个响应
+        client.send("POST /echo HTTP/1.1\r\nContent-Length: 1\r\n\r\n1"
+                    "POST /echo HTTP/1.1\r\nContent-Length: 1\r\n\r\n2"
+                    "POST /echo HTTP/1.1\r\nContent-Length: 1\r\nConnection: close\r\n\r\n3");
+        for (int i = 1; i <= 3; ++i)
+        {
+            rsp = client.recv();
+            CHECK(rsp && rsp->getBody() == std::to_string(i), "pipeline " << i);
+        }
+        CHECK(rsp && rsp->isClose(), "close after last");
+        CHECK(client.isPeerClosed(), "peer closed");
+    }
+    {
+        TestClient client(addr);
+        client.send("GET / HTTP/3.0\r\n\r\n");
+        sltj::HttpResponse::ptr rsp = client.recv();
+        CHECK(rsp && rsp->getStatus() == sltj::HttpStatus::HTTP_VERSION_NOT_SUPPORTED, "505");
+        CHECK(client.isPeerClosed(), "closed on error");
+    }
+    {
+        // 长度有歧义的请求直接拒绝
+        TestClient client(addr);
+        client.send("POST /echo HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "0\r\n\r\n");
+        sltj::HttpResponse::ptr rsp = client.recv();
+        CHECK(rsp && rsp->getStatus() == sltj::HttpStatus::BAD_REQUEST, "te + cl");
+        CHECK(client.isPeerClosed(), "closed on te + cl");
+    }
+    {
+        TestClient client(addr);
+        client.send("GET / HTTP/1.1\r\nX-Big: " + std::string(10000, 'a') + "\r\n\r\n");
+        sltj::HttpResponse::ptr rsp = client.recv();
+        CHECK(rsp && rsp->getStatus() == sltj::HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE, "431");
+    }
+}
+
+static const size_t CLIENTS = 16;
+static const size_t REQUESTS_PER_CLIENT = 2000;
+
+static sltj::Mutex s_mutex;
+static std::vector<uint64_t> s_latency;
+static std::atomic<uint64_t> s_errors{0};
+
+// 长连接压测, 记录每个请求的往返时延(us)
+void load_client(sltj::Address::ptr addr)
+{
+    TestClient client(addr);
+    if (!client.isConnected())
+    {
+        ++s_errors;
+        return;
+    }
+    std::vector<uint64_t> lat;
+    lat.reserve(REQUESTS_PER_CLIENT);
+    const std::string req = "GET /hello HTTP/1.1\r\nHost: bench\r\n\r\n";
+    for (size_t i = 0; i < REQUESTS_PER_CLIENT; ++i)
+    {
+        uint64_t t0 = sltj::GetCurrentUS();
+        if (!client.send(req))
+        {
+            ++s_errors;
+            break;
+        }
+        sltj::HttpResponse::ptr rsp = client.recv();
+        if (!rsp || rsp->getBody() != "hello")
+        {
+            ++s_errors;
+            break;
+        }
+        lat.push_back(sltj::GetCurrentUS() - t0);
+    }
+    sltj::Mutex::Lock lock(s_mutex);
+    s_latency.insert(s_latency.end(), lat.begin(), lat.end());
+}
+
+void bench(sltj::Address::ptr addr)
+{
+    s_latency.clear();
+    s_errors = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        sltj::IOManager client_iom(2, "client");
+        for (size_t i = 0; i < CLIENTS; ++i)
+        {
+            client_iom.schedule(std::bind(&load_client, addr));
+        }
+        client_iom.stop();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1e6;
+
+    CHECK(s_errors == 0, s_errors);
+    CHECK(s_latency.size() == CLIENTS * REQUESTS_PER_CLIENT, s_latency.size());
+    if (s_latency.empty())
+    {
+        return;
+    }
+    std::sort(s_latency.begin(), s_latency.end());
+    SLTJ_LOG_INFO(g_logger) << "clients=" << CLIENTS
+                            << " req/s=" << (uint64_t)(s_latency.size() / sec)
+                            << " p50=" << s_latency[s_latency.size() / 2] << "us"
+                            << " p99=" << s_latency[s_latency.size() * 99 / 100] << "us";
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_parse_request();
+    test_parse_chunked();
+    test_parse_framing();
+    test_parse_pipeline();
+    test_parse_errors();
+    test_parse_response();
+
+    sltj::IOManager io_worker(2, "io");
+    sltj::IOManager accept_worker(1, "accept");
+    {
+        sltj::HttpServer::ptr server(new sltj::HttpServer(true, &io_worker, &accept_worker));
+        add_routes(server);
+        CHECK(server->bind(sltj::Address::LookupAny("127.0.0.1:0")), "bind");
+        CHECK(server->start(), "start");
+        sltj::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+        test_server(addr);
+        bench(addr);
+        server->stop();
+    }
+    accept_worker.stop();
+    io_worker.stop();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
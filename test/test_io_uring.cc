@@ -0,0 +1,399 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static sltj::ConfigVar<std::string>::ptr s_engine = sltj::Config::Lookup<std::string>("iomanager.engine");
+
+static const char *EngineName(sltj::IOManager::Engine e)
+{
+    return e == sltj::IOManager::IO_URING ? "io_uring" : "epoll";
+}
+
+// 回显服务
+class EchoServer : public sltj::TcpServer
+{
+public:
+    EchoServer(sltj::IOManager *io_worker, sltj::IOManager *accept_worker)
+        : sltj::TcpServer(io_worker, accept_worker)
+    {
+    }
+
+protected:
+    void handleClient(sltj::Socket::ptr client) override
+    {
+        char buf[4096];
+        while (true)
+        {
+            int n = client->recv(buf, sizeof(buf));
+            if (n <= 0)
+            {
+                break;
+            }
+            int off = 0;
+            while (off < n)
+            {
+                int rt = client->send(buf + off, n - off);
+                if (rt <= 0)
+                {
+                    client->close();
+                    return;
+                }
+                off += rt;
+            }
+        }
+        client->close();
+    }
+};
+
+static const size_t CLIENTS = 8;
+static const size_t CONNECTS_PER_CLIENT = 200;
+static const size_t REQUESTS_PER_CLIENT = 4000;
+static const size_t MSG_SIZE = 64;
+
+static std::atomic<uint64_t> s_connects{0};
+static std::atomic<uint64_t> s_requests{0};
+static std::atomic<uint64_t> s_errors{0};
+
+void connect_client(sltj::Address::ptr addr)
+{
+    for (size_t i = 0; i < CONNECTS_PER_CLIENT; ++i)
+    {
+        sltj::Socket::ptr sock = sltj::Socket::CreateTCP(addr);
+        if (!sock->connect(addr, 3000))
+        {
+            ++s_errors;
+            continue;
+        }
+        ++s_connects;
+        sock->close();
+    }
+}
+
+void request_client(sltj::Address::ptr addr)
+{
+    sltj::Socket::ptr sock = sltj::Socket::CreateTCP(addr);
+    if (!sock->connect(addr, 3000))
+    {
+        ++s_errors;
+        return;
+    }
+    sock->setTcpNoDelay(true);
+    sock->setRecvTimeout(3000);
+    char req[MSG_SIZE];
+    char rsp[MSG_SIZE];
+    memset(req, 'x', sizeof(req));
+    for (size_t i = 0; i < REQUESTS_PER_CLIENT; ++i)
+    {
+        if (sock->send(req, sizeof(req)) != (int)sizeof(req))
+        {
+            ++s_errors;
+            break;
+        }
+        size_t got = 0;
+        while (got < sizeof(rsp))
+        {
+            int n = sock->recv(rsp + got, sizeof(rsp) - got);
+            if (n <= 0)
+            {
+                break;
+            }
+            got += n;
+        }
+        if (got != sizeof(rsp) || memcmp(req, rsp, sizeof(req)))
+        {
+            ++s_errors;
+            break;
+        }
+        ++s_requests;
+    }
+    sock->close();
+}
+
+// 在客户端调度器上跑CLIENTS个协程, 返回耗时(秒)
+static double run_clients(void (*fun)(sltj::Address::ptr), sltj::Address::ptr addr)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        sltj::IOManager client_iom(1, "client");
+        for (size_t i = 0; i < CLIENTS; ++i)
+        {
+            client_iom.schedule(std::bind(fun, addr));
+        }
+        client_iom.stop();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// 本机回环上的短连接与一来一回请求, 服务端与客户端都用engine
+void bench_loopback(const std::string &engine)
+{
+    s_engine->setValue(engine);
+    s_connects = 0;
+    s_requests = 0;
+    s_errors = 0;
+    sltj::IOManager io_worker(1, "io");
+    sltj::IOManager accept_worker(1, "accept");
+    CHECK(EngineName(io_worker.getEngine()) == engine, engine);
+    {
+        std::shared_ptr<EchoServer> server(new EchoServer(&io_worker, &accept_worker));
+        CHECK(server->bind(sltj::Address::LookupAny("127.0.0.1:0")), "bind");
+        CHECK(server->start(), "start");
+        sltj::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+        double conn_sec = run_clients(&connect_client, addr);
+        double req_sec = run_clients(&request_client, addr);
+        CHECK(s_connects == CLIENTS * CONNECTS_PER_CLIENT, s_connects);
+        CHECK(s_requests == CLIENTS * REQUESTS_PER_CLIENT, s_requests);
+        CHECK(s_errors == 0, s_errors);
+        SLTJ_LOG_INFO(g_logger) << "loopback engine=" << engine
+                                << " connections/s=" << (uint64_t)(s_connects / conn_sec)
+                                << " req/s=" << (uint64_t)(s_requests / req_sec);
+        server->stop();
+    }
+    accept_worker.stop();
+    io_worker.stop();
+}
+
+// 超时、close取消进行中的recv/accept, 之后调度器能正常停止
+void test_timeout_and_cancel()
+{
+    s_engine->setValue("io_uring");
+    sltj::IOManager iom(1, "uring");
+    CHECK(iom.getEngine() == sltj::IOManager::IO_URING, "engine");
+    sltj::Socket::ptr listener = sltj::Socket::CreateTCPSocket();
+    CHECK(listener->bind(sltj::Address::LookupAny("127.0.0.1:0")) && listener->listen(), "listen");
+    sltj::Address::ptr addr = listener->getLocalAddress();
+
+    iom.schedule([listener, addr]() {
+        // accept超时
+        listener->setRecvTimeout(50);
+        uint64_t begin = sltj::GetCurrentMS();
+        CHECK(!listener->accept() && errno == ETIMEDOUT, errno);
+        CHECK(sltj::GetCurrentMS() - begin >= 40, sltj::GetCurrentMS() - begin);
+
+        sltj::Socket::ptr client = sltj::Socket::CreateTCP(addr);
+        CHECK(client->connect(addr, 1000), "connect");
+        listener->setRecvTimeout(1000);
+        sltj::Socket::ptr server = listener->accept();
+        CHECK(server, "accept");
+        if (!server)
+        {
+            return;
+        }
+        // recv超时
+        char buf[16];
+        server->setRecvTimeout(50);
+        CHECK(server->recv(buf, sizeof(buf)) == -1 && errno == ETIMEDOUT, errno);
+        // 对端发送的数据在超时之后仍能收到
+        CHECK(client->send("ping", 4) == 4, "send");
+        CHECK(server->recv(buf, sizeof(buf)) == 4 && memcmp(buf, "ping", 4) == 0, "recv");
+
+        // 另一个协程close时, 阻塞的recv返回EBADF
+        server->setRecvTimeout(-1);
+        sltj::IOManager::GetThis()->addTimer(50, [server]() { server->close(); });
+        CHECK(server->recv(buf, sizeof(buf)) == -1 && errno == EBADF, errno);
+
+        // 同样取消阻塞的accept
+        listener->setRecvTimeout(-1);
+        sltj::IOManager::GetThis()->addTimer(50, [listener]() { listener->close(); });
+        CHECK(!listener->accept() && errno == EBADF, errno);
+
+        // recvFrom/sendTo走msghdr
+        sltj::Socket::ptr u1 = sltj::Socket::CreateUDPSocket();
+        sltj::Socket::ptr u2 = sltj::Socket::CreateUDPSocket();
+        u1->bind(sltj::Address::LookupAny("127.0.0.1:0"));
+        u2->bind(sltj::Address::LookupAny("127.0.0.1:0"));
+        CHECK(u1->sendTo("hello", 5, u2->getLocalAddress()) == 5, "sendTo");
+        sltj::Address::ptr from(new sltj::IPv4Address);
+        CHECK(u2->recvFrom(buf, sizeof(buf), from) == 5 && memcmp(buf, "hello", 5) == 0, "recvFrom");
+        CHECK(from->toString() == u1->getLocalAddress()->toString(), from->toString());
+        client->close();
+    });
+    iom.stop();
+}
+
+// 在调度线程之外注册带回调的事件, 回调由该IOManager执行
+void test_add_event_outside(const std::string &engine)
+{
+    s_engine->setValue(engine);
+    sltj::IOManager iom(1, "outside");
+    int fds[2];
+    CHECK(pipe(fds) == 0, errno);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    std::atomic<bool> fired{false};
+    CHECK(iom.addEvent(fds[0], sltj::IOManager::READ, [&fired]() { fired = true; }) == 0, engine);
+    CHECK(write(fds[1], "x", 1) == 1, "write");
+    for (int i = 0; i < 100 && !fired; ++i)
+    {
+        usleep(10 * 1000);
+    }
+    CHECK(fired, engine << " callback not run");
+    iom.stop();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// IOManager上的文件读写与fsync
+void test_file_io()
+{
+    s_engine->setValue("io_uring");
+    const std::string path = "/tmp/sltj_test_io_uring.dat";
+    sltj::IOManager iom(1, "uring_file");
+    iom.schedule([&path]() {
+        sltj::IOManager *iom = sltj::IOManager::GetThis();
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        std::string data(1 << 20, 0);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = 'a' + i % 26;
+        }
+        size_t chunk = 64 * 1024;
+        for (size_t off = 0; off < data.size(); off += chunk)
+        {
+            CHECK(iom->ioWrite(fd, &data[off], chunk, off) == (ssize_t)chunk, off);
+        }
+        CHECK(iom->ioFsync(fd, true) == 0, errno);
+        std::string back(data.size(), 0);
+        CHECK(iom->ioRead(fd, &back[0], back.size(), 0) == (ssize_t)back.size(), "read");
+        CHECK(back == data, "content");
+        close(fd);
+        CHECK(iom->ioRead(fd, &back[0], 16, 0) == -1 && errno == EBADF, errno);
+    });
+    iom.stop();
+    unlink(path.c_str());
+
+    // 非io_uring引擎不可用
+    s_engine->setValue("epoll");
+    sltj::IOManager epoll_iom(1, "epoll_file");
+    CHECK(epoll_iom.getEngine() == sltj::IOManager::EPOLL, "epoll engine");
+    epoll_iom.schedule([]() {
+        char buf[4];
+        CHECK(sltj::IOManager::GetThis()->ioRead(0, buf, 4, 0) == -1 && errno == ENOSYS, errno);
+    });
+    epoll_iom.stop();
+}
+
+static const int kLogRecords = 200000;
+
+// threads个线程共写kLogRecords条日志, 返回每条的耗时(ns), 并检查文件中每个线程的记录齐全且有序
+static double write_log(sltj::LogAppender::ptr appender, const std::string &path, int threads_num)
+{
+    const int lines_per_thread = kLogRecords / threads_num;
+    sltj::Logger::ptr logger(new sltj::Logger("uring"));
+    logger->addAppender(appender);
+    appender->setFormatter(sltj::LogFormatter::ptr(new sltj::LogFormatter("%t %m%n")));
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<sltj::Thread::ptr> threads;
+    for (int t = 0; t < threads_num; ++t)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([logger, t, lines_per_thread]() {
+            for (int i = 0; i < lines_per_thread; ++i)
+            {
+                SLTJ_LOG_INFO(logger) << "writer " << t << " seq " << i << " some padding text for a typical log line";
+            }
+        }, "uring_w" + std::to_string(t))));
+    }
+    for (auto &i : threads)
+    {
+        i->join();
+    }
+    appender->flush();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / kLogRecords;
+
+    std::ifstream ifs(path);
+    std::string line;
+    std::vector<int> last(threads_num, -1);
+    size_t lines = 0, bad = 0, holes = 0;
+    while (std::getline(ifs, line))
+    {
+        // 写失败丢掉缓冲区会在已占用的偏移处留下全0的空洞
+        holes += std::count(line.begin(), line.end(), '\0');
+        int tid, t, seq;
+        if (sscanf(line.c_str(), "%d writer %d seq %d", &tid, &t, &seq) != 3 || t < 0 || t >= threads_num || seq != last[t] + 1)
+        {
+            ++bad;
+            continue;
+        }
+        last[t] = seq;
+        ++lines;
+    }
+    CHECK(lines == (size_t)kLogRecords && bad == 0, path << " lines=" << lines << " bad=" << bad);
+    CHECK(holes == 0, path << " zero bytes=" << holes);
+    return ns;
+}
+
+void bench_log_file()
+{
+    const std::string file_path = "/tmp/sltj_test_io_uring.file.log";
+    const std::string uring_path = "/tmp/sltj_test_io_uring.uring.log";
+    unlink(file_path.c_str());
+    unlink(uring_path.c_str());
+
+    sltj::FileLogAppender::ptr file(new sltj::FileLogAppender(file_path));
+    file->reopen();
+    // FileLogAppender本身不加锁, 只用一个线程写
+    double file_ns = write_log(file, file_path, 1);
+
+    sltj::UringFileLogAppender::ptr uring(new sltj::UringFileLogAppender(uring_path));
+    CHECK(uring->isUring(), "uring appender");
+    sltj::Counter::ptr writes = sltj::Metrics::Lookup<sltj::Counter>("log.uring.writes");
+    sltj::Counter::ptr errors = sltj::Metrics::Lookup<sltj::Counter>("log.uring.errors");
+    sltj::Counter::ptr retries = sltj::Metrics::Lookup<sltj::Counter>("log.uring.retries");
+    uint64_t writes_before = writes->getValue();
+    uint64_t errors_before = errors->getValue();
+    uint64_t retries_before = retries->getValue();
+    double uring_ns = write_log(uring, uring_path, 2);
+    uint64_t nwrites = writes->getValue() - writes_before;
+    CHECK(nwrites > 0 && nwrites < (uint64_t)kLogRecords / 10, nwrites);
+    // 失败的完成已重新提交或同步补写, 没有丢数据
+    CHECK(errors->getValue() == errors_before, "errors=" << errors->getValue() - errors_before
+                                                         << " retries=" << retries->getValue() - retries_before);
+
+    // 追加写, flush带fdatasync, reopen后继续
+    uring->setSync(true);
+    sltj::Logger::ptr logger(new sltj::Logger("uring"));
+    logger->addAppender(uring);
+    uring->setFormatter(sltj::LogFormatter::ptr(new sltj::LogFormatter("%m%n")));
+    SLTJ_LOG_INFO(logger) << "before reopen";
+    CHECK(rename(uring_path.c_str(), (uring_path + ".1").c_str()) == 0, "rename");
+    CHECK(uring->reopen(), "reopen");
+    SLTJ_LOG_INFO(logger) << "after reopen";
+    uring->flush();
+    std::ifstream ifs(uring_path);
+    std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    CHECK(content == "after reopen\n", content);
+    unlink((uring_path + ".1").c_str());
+
+    SLTJ_LOG_INFO(g_logger) << "log file ns/record: FileLogAppender=" << file_ns << " UringFileLogAppender=" << uring_ns
+                            << " (" << nwrites << " writes for " << kLogRecords << " records, "
+                            << retries->getValue() - retries_before << " retried)";
+    unlink(file_path.c_str());
+    unlink(uring_path.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    test_add_event_outside("epoll");
+    if (!sltj::IOUring::IsSupported())
+    {
+        SLTJ_LOG_WARN(g_logger) << "io_uring not supported here, skip";
+        return s_ok ? 0 : 1;
+    }
+    test_add_event_outside("io_uring");
+    test_timeout_and_cancel();
+    test_file_io();
+    bench_loopback("epoll");
+    bench_loopback("io_uring");
+    bench_log_file();
+
+    s_engine->setValue("epoll");
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// 本机日志收集器, 配合RemoteLogAppender测试:
+//   test_log_collector udp://127.0.0.1:9514 [count]
+//   test_log_collector unixgram:///tmp/sltj_log.sock [count]
+//   test_log_collector unix:///tmp/sltj_log.sock [count]
+// 收到的记录原样写到标准输出, 收满count条后退出, 统计写到标准错误
+#include "../src/sltj.h"
+#include <arpa/inet.h>
+#include <iostream>
+#include <map>
+#include <poll.h>
+#include <unistd.h>
+
+static uint64_t s_records = 0;
+static uint64_t s_messages = 0;
+static uint64_t s_bytes = 0;
+
+static void output(const char *data, size_t len)
+{
+    fwrite(data, 1, len, stdout);
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (data[i] == '\n')
+        {
+            ++s_records;
+        }
+    }
+    s_bytes += len;
+}
+
+// 流模式: 4字节网络序长度 + 记录; 返回已消费的字节数
+static size_t parse_frames(const std::string &buf)
+{
+    size_t pos = 0;
+    while (buf.size() - pos >= sizeof(uint32_t))
+    {
+        uint32_t len;
+        memcpy(&len, buf.data() + pos, sizeof(len));
+        len = ntohl(len);
+        if (buf.size() - pos - sizeof(len) < len)
+        {
+            break;
+        }
+        output(buf.data() + pos + sizeof(len), len);
+        ++s_messages;
+        pos += sizeof(len) + len;
+    }
+    return pos;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " udp://host:port|unixgram:///path|unix:///path [count]" << std::endl;
+        return 1;
+    }
+    std::string uri = argv[1];
+    uint64_t count = argc > 2 ? strtoull(argv[2], nullptr, 10) : 0;
+
+    sltj::Socket::ptr sock;
+    sltj::Address::ptr addr;
+    bool stream = false;
+    if (uri.compare(0, 6, "udp://") == 0)
+    {
+        addr = sltj::Address::LookupAnyIPAddress(uri.substr(6), AF_UNSPEC, SOCK_DGRAM);
+        if (addr)
+        {
+            sock = sltj::Socket::CreateUDP(addr);
+        }
+    }
+    else if (uri.compare(0, 11, "unixgram://") == 0)
+    {
+        addr.reset(new sltj::UnixAddress(uri.substr(11)));
+        unlink(uri.substr(11).c_str());
+        sock = sltj::Socket::CreateUnixUDPSocket();
+    }
+    else if (uri.compare(0, 7, "unix://") == 0)
+    {
+        addr.reset(new sltj::UnixAddress(uri.substr(7)));
+        unlink(uri.substr(7).c_str());
+        sock = sltj::Socket::CreateUnixTCPSocket();
+        stream = true;
+    }
+    if (!sock || !sock->bind(addr) || (stream && !sock->listen()))
+    {
+        std::cerr << "bind " << uri << " failed" << std::endl;
+        return 1;
+    }
+    sock->setRecvBufferSize(8 * 1024 * 1024);
+    std::cerr << "listening on " << addr->toString() << std::endl;
+
+    std::vector<char> buf(256 * 1024);
+    std::map<int, std::pair<sltj::Socket::ptr, std::string>> clients;
+    while (!count || s_records < count)
+    {
+        std::vector<pollfd> fds(1);
+        fds[0].fd = sock->getSocket();
+        fds[0].events = POLLIN;
+        for (auto &i : clients)
+        {
+            fds.push_back(pollfd{i.first, POLLIN, 0});
+        }
+        if (poll(&fds[0], fds.size(), -1) <= 0)
+        {
+            continue;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            if (stream)
+            {
+                sltj::Socket::ptr client = sock->accept();
+                if (client)
+                {
+                    clients[client->getSocket()].first = client;
+                }
+            }
+            else
+            {
+                ssize_t n = recv(sock->getSocket(), &buf[0], buf.size(), MSG_DONTWAIT);
+                if (n > 0)
+                {
+                    ++s_messages;
+                    output(&buf[0], n);
+                }
+            }
+        }
+        for (size_t i = 1; i < fds.size(); ++i)
+        {
+            if (!fds[i].revents)
+            {
+                continue;
+            }
+            auto &client = clients[fds[i].fd];
+            ssize_t n = recv(fds[i].fd, &buf[0], buf.size(), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+            {
+                clients.erase(fds[i].fd);
+                continue;
+            }
+            if (n > 0)
+            {
+                client.second.append(&buf[0], n);
+                client.second.erase(0, parse_frames(client.second));
+            }
+        }
+    }
+    fflush(stdout);
+    std::cerr << "records=" << s_records << " messages=" << s_messages << " bytes=" << s_bytes << std::endl;
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <set>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 把格式化后的日志存在内存里
+class CaptureAppender : public sltj::LogAppender
+{
+public:
+    using ptr = std::shared_ptr<CaptureAppender>;
+
+    void log(sltj::LogLevel::Level level, sltj::LogEvent::ptr event) override
+    {
+        std::string str = m_formatter->format(level, event);
+        sltj::Mutex::Lock lock(m_lines_mutex);
+        m_lines.push_back(str);
+    }
+
+    std::vector<std::string> lines()
+    {
+        sltj::Mutex::Lock lock(m_lines_mutex);
+        return m_lines;
+    }
+
+private:
+    sltj::Mutex m_lines_mutex;
+    std::vector<std::string> m_lines;
+};
+
+static sltj::FiberLocal<int> s_request_id;
+
+// 协程局部变量在线程主协程与子协程之间相互独立, 复用的协程不继承上一个回调的值
+void test_fiber_local()
+{
+    s_request_id.set(std::make_shared<int>(7));
+    CHECK(s_request_id.get() && *s_request_id.get() == 7, "main fiber");
+
+    sltj::Fiber::ptr fiber(new sltj::Fiber([]() {
+        CHECK(!s_request_id.get(), "new fiber sees main value");
+        s_request_id.set(std::make_shared<int>(8));
+        sltj::Fiber::YieldToHold();
+        CHECK(s_request_id.get() && *s_request_id.get() == 8, "value lost after yield");
+    }));
+    fiber->swapIn();
+    CHECK(*s_request_id.get() == 7, "fiber value leaked to main");
+    fiber->swapIn();
+    fiber->reset([]() {
+        CHECK(!s_request_id.get(), "reset fiber keeps old value");
+    });
+    fiber->swapIn();
+    s_request_id.reset();
+    CHECK(!s_request_id.get(), "reset");
+}
+
+static const int kFibers = 64;
+static const int kYields = 50;
+
+// 协程反复让出后在不同工作线程上恢复, 局部变量与日志上下文跟随协程
+void test_migrate()
+{
+    CaptureAppender::ptr appender(new CaptureAppender);
+    appender->setFormatter(sltj::LogFormatter::ptr(new sltj::LogFormatter("%X{req}|%m")));
+    sltj::Logger::ptr logger(new sltj::Logger("ctx"));
+    logger->addAppender(appender);
+
+    std::atomic<int> migrated{0};
+    {
+        sltj::IOManager iom(4, "ctx");
+        for (int i = 0; i < kFibers; ++i)
+        {
+            iom.schedule([i, logger, &migrated]() {
+                s_request_id.set(std::make_shared<int>(i));
+                sltj::LogContext::Put("req", "r" + std::to_string(i));
+                std::set<int> threads;
+                for (int n = 0; n < kYields; ++n)
+                {
+                    threads.insert(sltj::GetThreadId());
+                    sltj::Fiber::YieldToReady();
+                    CHECK(s_request_id.get() && *s_request_id.get() == i, i);
+                    CHECK(sltj::LogContext::Get("req") == "r" + std::to_string(i), sltj::LogContext::Get("req"));
+                }
+                SLTJ_LOG_INFO(logger) << i;
+                if (threads.size() > 1)
+                {
+                    ++migrated;
+                }
+            });
+        }
+        iom.stop();
+    }
+    CHECK(migrated > 0, "no fiber resumed on another thread");
+
+    std::vector<std::string> lines = appender->lines();
+    CHECK(lines.size() == (size_t)kFibers, lines.size());
+    for (auto &i : lines)
+    {
+        size_t pos = i.find('|');
+        CHECK(pos != std::string::npos && i.substr(0, pos) == "r" + i.substr(pos + 1), i);
+    }
+}
+
+// %X{key}与%X的输出, Scope恢复原值, 已创建的事件保留创建时的上下文
+void test_format()
+{
+    CaptureAppender::ptr appender(new CaptureAppender);
+    appender->setFormatter(sltj::LogFormatter::ptr(new sltj::LogFormatter("[%X{trace_id}] [%X] %m")));
+    sltj::Logger::ptr logger(new sltj::Logger("ctx"));
+    logger->addAppender(appender);
+
+    SLTJ_LOG_INFO(logger) << "empty";
+    sltj::LogContext::Put("trace_id", "abc");
+    sltj::LogContext::Put("user", "bob");
+    SLTJ_LOG_INFO(logger) << "both";
+    {
+        sltj::LogContext::Scope scope("trace_id", "def");
+        SLTJ_LOG_INFO(logger) << "scope";
+    }
+    sltj::LogEvent::ptr early = SLTJ_LOG_MAKE_EVENT(logger, sltj::LogLevel::INFO);
+    sltj::LogContext::Remove("user");
+    SLTJ_LOG_INFO(logger) << "removed";
+    sltj::LogContext::Clear();
+    SLTJ_LOG_INFO(logger) << "cleared";
+    early->getSS() << "early";
+    logger->log(sltj::LogLevel::INFO, early);
+
+    std::vector<std::string> lines = appender->lines();
+    const char *expect[] = {"[] [] empty", "[abc] [trace_id=abc user=bob] both", "[def] [trace_id=def user=bob] scope",
+                            "[abc] [trace_id=abc] removed", "[] [] cleared", "[abc] [trace_id=abc user=bob] early"};
+    CHECK(lines.size() == sizeof(expect) / sizeof(expect[0]), lines.size());
+    for (size_t i = 0; i < lines.size() && i < sizeof(expect) / sizeof(expect[0]); ++i)
+    {
+        CHECK(lines[i] == expect[i], lines[i]);
+    }
+}
+
+// 每条日志带请求id: 调用点拼接与%X{key}的耗时
+void bench()
+{
+    static const int kCount = 500000;
+    CaptureAppender::ptr appender(new CaptureAppender);
+    sltj::Logger::ptr logger(new sltj::Logger("bench"));
+    logger->setLevel(sltj::LogLevel::INFO);
+    sltj::LogFormatter::ptr concat(new sltj::LogFormatter("%m"));
+    sltj::LogFormatter::ptr ctx(new sltj::LogFormatter("trace_id=%X{trace_id} %m"));
+    std::string trace_id = "4bf92f3577b34da6a3ce929d0e0e4736";
+    size_t bytes = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCount; ++i)
+    {
+        sltj::LogEvent::ptr ev = SLTJ_LOG_MAKE_EVENT(logger, sltj::LogLevel::INFO);
+        ev->getSS() << "trace_id=" << trace_id << " request done";
+        bytes += concat->format(sltj::LogLevel::INFO, ev).size();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    sltj::LogContext::Put("trace_id", trace_id);
+    for (int i = 0; i < kCount; ++i)
+    {
+        sltj::LogEvent::ptr ev = SLTJ_LOG_MAKE_EVENT(logger, sltj::LogLevel::INFO);
+        ev->getSS() << "request done";
+        bytes -= ctx->format(sltj::LogLevel::INFO, ev).size();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    sltj::LogContext::Clear();
+    CHECK(bytes == 0, "formatted output differs");
+    SLTJ_LOG_INFO(g_logger) << "ns/event: concat=" << std::chrono::duration<double, std::nano>(t1 - t0).count() / kCount
+                            << " %X=" << std::chrono::duration<double, std::nano>(t2 - t1).count() / kCount;
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    test_fiber_local();
+    test_migrate();
+    test_format();
+    bench();
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+class RecordAppender : public sltj::LogAppender
+{
+public:
+    using ptr = std::shared_ptr<RecordAppender>;
+    void log(sltj::LogLevel::Level level, sltj::LogEvent::ptr event) override
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        lines.push_back(event->getContent());
+    }
+    std::vector<std::string> take()
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        std::vector<std::string> rt;
+        rt.swap(lines);
+        return rt;
+    }
+    std::vector<std::string> lines;
+
+private:
+    sltj::Mutex m_lock;
+};
+
+static RecordAppender::ptr s_record(new RecordAppender);
+static sltj::Logger::ptr s_logger;
+
+static size_t count_prefix(const std::vector<std::string> &lines, const std::string &prefix)
+{
+    size_t n = 0;
+    for (auto &i : lines)
+    {
+        if (i.compare(0, prefix.size(), prefix) == 0)
+        {
+            ++n;
+        }
+    }
+    return n;
+}
+
+void test_every_n()
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        SLTJ_LOG_EVERY_N(s_logger, sltj::LogLevel::ERROR, 10) << "every " << i;
+    }
+    // 汇总线程随时可能插入汇总行, 只数本调用点的行
+    std::vector<std::string> lines = s_record->take();
+    CHECK(count_prefix(lines, "every ") == 10, lines.size());
+    CHECK(!lines.empty() && lines[0] == "every 0", lines[0]);
+
+    // 各调用点独立计数
+    for (int i = 0; i < 4; ++i)
+    {
+        SLTJ_LOG_EVERY_N(s_logger, sltj::LogLevel::ERROR, 2) << "a " << i;
+        SLTJ_LOG_EVERY_N(s_logger, sltj::LogLevel::ERROR, 4) << "b " << i;
+    }
+    lines = s_record->take();
+    CHECK(count_prefix(lines, "a ") == 2 && count_prefix(lines, "b ") == 1, lines.size());
+
+    // 级别不够时不计数
+    for (int i = 0; i < 10; ++i)
+    {
+        SLTJ_LOG_EVERY_N(s_logger, sltj::LogLevel::DEBUG, 3) << "debug " << i;
+    }
+    CHECK(count_prefix(s_record->take(), "debug ") == 0, "debug filtered");
+}
+
+// 同一调用点
+static void rate_site(int i)
+{
+    SLTJ_LOG_RATE_LIMITED(s_logger, sltj::LogLevel::ERROR, 50) << "rate " << i;
+}
+
+void test_rate_limited()
+{
+    for (int i = 0; i < 10000; ++i)
+    {
+        rate_site(i);
+    }
+    // 一秒的突发, 粗粒度时钟下可能多放一两条
+    size_t n = count_prefix(s_record->take(), "rate ");
+    CHECK(n >= 50 && n <= 53, n);
+
+    // 令牌按速率恢复
+    usleep(200 * 1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        rate_site(i);
+    }
+    n = count_prefix(s_record->take(), "rate ");
+    CHECK(n >= 8 && n <= 13, n);
+}
+
+void test_report()
+{
+    SLTJ_LOG_INFO(g_logger) << "waiting for periodic summary";
+    for (int i = 0; i < 30; ++i)
+    {
+        SLTJ_LOG_EVERY_N(s_logger, sltj::LogLevel::ERROR, 10) << "report " << i;
+    }
+    s_record->take();
+    // 汇总线程间隔在main中设为100ms
+    usleep(300 * 1000);
+    std::vector<std::string> lines = s_record->take();
+    CHECK(count_prefix(lines, "suppressed 27 log lines at ") == 1, lines.size());
+
+    // 已汇总的不再重复输出
+    sltj::LogSite::ReportSuppressed();
+    CHECK(count_prefix(s_record->take(), "suppressed 27 ") == 0, "no repeat");
+    CHECK(sltj::Metrics::Lookup<sltj::Counter>("log.suppressed")->getValue() > 0, "metric");
+}
+
+// 被压制时的单次开销
+void bench()
+{
+    const int N = 10000000;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_RATE_LIMITED(s_logger, sltj::LogLevel::ERROR, 1) << "bench " << i;
+    }
+    double rate_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_EVERY_N(s_logger, sltj::LogLevel::ERROR, 1000000) << "bench " << i;
+    }
+    double every_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+    s_record->take();
+    SLTJ_LOG_INFO(g_logger) << "suppressed call ns rate_limited=" << rate_ns << " every_n=" << every_ns;
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    sltj::Config::Lookup<uint32_t>("log.rate_limit.report_interval")->setValue(100);
+    s_logger.reset(new sltj::Logger("limit_test"));
+    s_logger->setLevel(sltj::LogLevel::INFO);
+    s_logger->addAppender(s_record);
+
+    test_every_n();
+    test_rate_limited();
+    test_report();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
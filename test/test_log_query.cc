@@ -0,0 +1,235 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <random>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const std::string s_path = "/tmp/sltj_test_log_query.log";
+static const int N = 500000;
+static const uint32_t s_base = 1700000000;
+
+// 每条的时间与内容, 用来算期望结果
+struct Line
+{
+    uint32_t time;
+    sltj::LogLevel::Level level;
+    int logger;
+    int thread;
+};
+static std::vector<Line> s_lines;
+static const char *s_loggers[] = {"db", "http", "rpc"};
+static const int s_threads[] = {1001, 1002, 10011};
+
+// 每秒约50条; 每隔一段插入一条时钟回拨的记录, 块的时间范围因此不单调
+static void write_log()
+{
+    std::vector<sltj::Logger::ptr> loggers;
+    for (auto name : s_loggers)
+    {
+        loggers.push_back(sltj::Logger::ptr(new sltj::Logger(name)));
+    }
+    sltj::FileLogAppender::ptr appender(new sltj::FileLogAppender(s_path));
+    appender->setFormatter(sltj::LogFormatter::ptr(
+        new sltj::LogFormatter("%d{%Y-%m-%d %H:%M:%S} %T%t %T%F%T [%p] %T [%N] %T %f %l %T %m %n")));
+    appender->setIndexInterval(64 * 1024);
+    appender->reopen();
+    for (int i = 0; i < N; ++i)
+    {
+        Line l;
+        l.time = s_base + i / 50;
+        if (i % 50000 == 49999)
+        {
+            l.time -= 3000;
+        }
+        l.level = i % 20011 == 7 ? sltj::LogLevel::ERROR : (i % 3 ? sltj::LogLevel::INFO : sltj::LogLevel::DEBUG);
+        l.logger = i % 3;
+        l.thread = i % 3 == 2 ? 2 : i % 2;
+        s_lines.push_back(l);
+        sltj::LogEvent::ptr event(new sltj::LogEvent(loggers[l.logger], l.level, __FILE__, __LINE__, 0,
+                                                     s_threads[l.thread], 0, l.time, "query"));
+        event->getSS() << "request seq " << i << " end";
+        appender->log(l.level, event);
+    }
+    appender->flush();
+}
+
+template <class F>
+static size_t expect(F f)
+{
+    size_t n = 0;
+    for (auto &l : s_lines)
+    {
+        n += f(l) ? 1 : 0;
+    }
+    return n;
+}
+
+// 带索引与不带索引各查一次, 结果一致且等于期望; 返回带索引时扫描的字节数
+static uint64_t run_query(const char *name, const sltj::LogQuery::Filter &filter, size_t expected)
+{
+    sltj::LogQuery indexed, full;
+    CHECK(indexed.open(s_path) && full.open(s_path, false), name);
+    CHECK(indexed.getIndexEntries() > 0 && full.getIndexEntries() == 0, name);
+    std::vector<std::string> a, b;
+    auto begin = std::chrono::steady_clock::now();
+    size_t n1 = indexed.query(filter, [&a](const char *line, size_t len) {
+        a.push_back(std::string(line, len));
+        return true;
+    });
+    double indexed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    begin = std::chrono::steady_clock::now();
+    size_t n2 = full.query(filter, [&b](const char *line, size_t len) {
+        b.push_back(std::string(line, len));
+        return true;
+    });
+    double full_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    CHECK(n1 == expected && n2 == expected && a == b, name << " indexed=" << n1 << " full=" << n2 << " expected=" << expected);
+    CHECK(full.getScannedBytes() == full.getFileSize(), name);
+    SLTJ_LOG_INFO(g_logger) << name << ": matched=" << n1 << " indexed " << indexed_ms << "ms scanned="
+                            << indexed.getScannedBytes() << " / full " << full_ms << "ms scanned=" << full.getScannedBytes();
+    return indexed.getScannedBytes();
+}
+
+void test_query()
+{
+    sltj::LogQuery q;
+    q.open(s_path, false);
+    uint64_t size = q.getFileSize();
+
+    sltj::LogQuery::Filter range;
+    range.from = s_base + 3000;
+    range.to = s_base + 3099;
+    uint64_t scanned = run_query("time range", range,
+                                 expect([&](const Line &l) { return l.time >= range.from && l.time <= range.to; }));
+    CHECK(scanned * 20 < size, scanned << "/" << size);
+
+    sltj::LogQuery::Filter error;
+    error.level = sltj::LogLevel::ERROR;
+    scanned = run_query("level ERROR", error, expect([](const Line &l) { return l.level >= sltj::LogLevel::ERROR; }));
+    CHECK(scanned * 4 < size, scanned << "/" << size);
+
+    sltj::LogQuery::Filter info;
+    info.level = sltj::LogLevel::INFO;
+    info.from = s_base + 100;
+    info.to = s_base + 199;
+    run_query("level INFO + range", info, expect([&](const Line &l) {
+                  return l.level >= sltj::LogLevel::INFO && l.time >= info.from && l.time <= info.to;
+              }));
+
+    sltj::LogQuery::Filter logger;
+    logger.logger = "http";
+    logger.from = s_base + 2900;
+    logger.to = s_base + 3100;
+    run_query("logger + range", logger, expect([&](const Line &l) {
+                  return l.logger == 1 && l.time >= logger.from && l.time <= logger.to;
+              }));
+
+    // 10011不能命中1001
+    sltj::LogQuery::Filter thread;
+    thread.thread = "1001";
+    thread.to = s_base + 500;
+    run_query("thread", thread, expect([&](const Line &l) { return l.thread == 0 && l.time <= thread.to; }));
+
+    sltj::LogQuery::Filter text;
+    text.text = "request seq 123456 end";
+    run_query("text", text, 1);
+    text.text = "seq 49999 end";
+    run_query("text (clock skew)", text, 1);
+    text.text = "no such text";
+    run_query("text (none)", text, 0);
+
+    // 回调返回false时停止
+    sltj::LogQuery::Filter all;
+    size_t n = 0;
+    CHECK(q.query(all, [&n](const char *, size_t) { return ++n < 10; }) == 10 && n == 10, n);
+}
+
+// 与std::string::find对照, 覆盖needle跨16字节块、位于末尾、长度1/2的情况
+void test_find()
+{
+    std::mt19937 rng(42);
+    size_t bad = 0;
+    for (int iter = 0; iter < 20000; ++iter)
+    {
+        size_t len = rng() % 100;
+        std::string hay(len, 'a');
+        for (auto &c : hay)
+        {
+            c = "ab\n"[rng() % 3];
+        }
+        size_t k = 1 + rng() % 6;
+        std::string needle(k, 'a');
+        for (auto &c : needle)
+        {
+            c = "ab"[rng() % 2];
+        }
+        if (len >= k && rng() % 2)
+        {
+            hay.replace(len - k, k, needle);
+        }
+        // 放到堆上独立的缓冲区, 越界读能被ASan发现
+        std::vector<char> buf(hay.begin(), hay.end());
+        const char *data = buf.empty() ? nullptr : &buf[0];
+        const char *r = sltj::LogQuery::Find(data, data + buf.size(), needle);
+        size_t pos = hay.find(needle);
+        if ((pos == std::string::npos) != (r == nullptr) || (r && (size_t)(r - data) != pos))
+        {
+            ++bad;
+        }
+    }
+    CHECK(bad == 0, bad);
+    std::string s = "abc";
+    CHECK(sltj::LogQuery::Find(s.data(), s.data() + 3, "") == s.data(), "empty needle");
+    CHECK(sltj::LogQuery::Find(s.data(), s.data() + 3, "abcd") == nullptr, "needle longer");
+
+    sltj::LogQuery q;
+    uint32_t t = 0;
+    CHECK(q.parseTime("2023-11-14 22:13:20 x", 21, t), "parse");
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    strptime("2023-11-14 22:13:20", "%Y-%m-%d %H:%M:%S", &tm);
+    tm.tm_isdst = -1;
+    CHECK(t == (uint32_t)mktime(&tm), t);
+    CHECK(q.parseTime("2023-11-14 22:59:59", 19, t) && t == (uint32_t)mktime(&tm) + 46 * 60 + 39, t);
+    CHECK(!q.parseTime("2023-11-14 22:13", 16, t) && !q.parseTime("2023/11/14 22:13:20", 19, t), "bad time");
+}
+
+// 命令行工具与库结果一致
+void test_tool(const std::string &tool)
+{
+    FILE *fp = popen((tool + " -l error -f " + std::to_string(s_base) + " " + s_path + " 2>/dev/null").c_str(), "r");
+    CHECK(fp, "popen");
+    if (!fp)
+    {
+        return;
+    }
+    size_t lines = 0;
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), fp))
+    {
+        lines += strstr(buf, "[ERROR]") ? 1 : 0;
+    }
+    CHECK(pclose(fp) == 0, "exit status");
+    size_t expected = expect([](const Line &l) { return l.level >= sltj::LogLevel::ERROR && l.time >= s_base; });
+    CHECK(lines == expected, lines << " expected=" << expected);
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    std::string self = argv[0];
+    size_t pos = self.rfind('/');
+    std::string tool = (pos == std::string::npos ? std::string(".") : self.substr(0, pos)) + "/sltj_logquery";
+
+    write_log();
+    test_find();
+    test_query();
+    test_tool(tool);
+    unlink(s_path.c_str());
+    unlink((s_path + ".idx").c_str());
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
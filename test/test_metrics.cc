@@ -0,0 +1,186 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+void test_counter_gauge()
+{
+    sltj::Counter::ptr c = sltj::Metrics::Lookup<sltj::Counter>("test.requests", "requests");
+    CHECK(sltj::Metrics::Lookup<sltj::Counter>("test.requests") == c, "lookup same");
+
+    std::vector<sltj::Thread::ptr> threads;
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([c]() {
+            for (int j = 0; j < 100000; ++j)
+            {
+                c->inc();
+            }
+        }, "count_" + std::to_string(i))));
+    }
+    for (auto &t : threads)
+    {
+        t->join();
+    }
+    CHECK(c->getValue() == 800000, c->getValue());
+
+    sltj::Gauge::ptr g = sltj::Metrics::Lookup<sltj::Gauge>("test.conns", "connections");
+    g->inc();
+    g->inc();
+    g->dec();
+    CHECK(g->getValue() == 1, g->getValue());
+    g->set(10);
+    CHECK(g->getValue() == 10, g->getValue());
+    g->setCallback([]() { return (int64_t)42; });
+    CHECK(g->getValue() == 42, g->getValue());
+
+    bool thrown = false;
+    try
+    {
+        sltj::Metrics::Lookup<sltj::Gauge>("test.requests");
+    }
+    catch (std::invalid_argument &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown, "type mismatch");
+
+    thrown = false;
+    try
+    {
+        sltj::Metrics::Lookup<sltj::Counter>("bad name");
+    }
+    catch (std::invalid_argument &e)
+    {
+        thrown = true;
+    }
+    CHECK(thrown, "invalid name");
+}
+
+void test_histogram()
+{
+    // 桶边界连续且覆盖所有值
+    bool ok = true;
+    for (uint32_t i = 1; i < sltj::Histogram::BUCKET_COUNT; ++i)
+    {
+        ok = ok && sltj::Histogram::BucketLow(i) == sltj::Histogram::BucketHigh(i - 1) + 1;
+    }
+    CHECK(ok, "bucket bounds");
+    CHECK(sltj::Histogram::BucketHigh(sltj::Histogram::BUCKET_COUNT - 1) == sltj::Histogram::MAX_VALUE, "max bucket");
+    uint64_t vals[] = {0, 1, 31, 32, 33, 63, 64, 1000, 123456789, sltj::Histogram::MAX_VALUE};
+    for (uint64_t v : vals)
+    {
+        uint32_t idx = sltj::Histogram::ValueToBucket(v);
+        CHECK(sltj::Histogram::BucketLow(idx) <= v && v <= sltj::Histogram::BucketHigh(idx), v);
+    }
+
+    sltj::Histogram::ptr h = sltj::Metrics::Lookup<sltj::Histogram>("test.latency_us", "latency");
+    std::vector<sltj::Thread::ptr> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([h, i]() {
+            for (uint64_t v = i + 1; v <= 100000; v += 4)
+            {
+                h->record(v);
+            }
+        }, "hist_" + std::to_string(i))));
+    }
+    for (auto &t : threads)
+    {
+        t->join();
+    }
+    sltj::Histogram::Snapshot s = h->snapshot();
+    CHECK(s.count == 100000, s.count);
+    CHECK(s.min == 1 && s.max == 100000, s.min << " " << s.max);
+    CHECK(s.sum == 100000ull * 100001 / 2, s.sum);
+    // 误差不超过1/32
+    double qs[] = {0.5, 0.99, 0.999};
+    for (double q : qs)
+    {
+        double expect = q * 100000;
+        double got = s.percentile(q);
+        CHECK(got >= expect && got <= expect * (1 + 1.0 / 32), q << " " << got);
+    }
+    CHECK(s.percentile(1) == 100000, s.percentile(1));
+}
+
+void test_dump()
+{
+    SLTJ_LOG_INFO(g_logger) << "make sure log metrics exist";
+    uint64_t events = sltj::Metrics::Lookup<sltj::Counter>("log.events")->getValue();
+    uint64_t bytes = sltj::Metrics::Lookup<sltj::Counter>("log.bytes")->getValue();
+    SLTJ_LOG_INFO(g_logger) << "hello";
+    CHECK(sltj::Metrics::Lookup<sltj::Counter>("log.events")->getValue() == events + 1, "log events");
+    CHECK(sltj::Metrics::Lookup<sltj::Counter>("log.bytes")->getValue() > bytes, "log bytes");
+
+    std::string text = sltj::Metrics::ToString();
+    CHECK(text.find("test.requests counter 800000\n") != std::string::npos, text);
+    CHECK(text.find("test.latency_us histogram count=100000") != std::string::npos, text);
+
+    std::string prom = sltj::Metrics::ToPrometheus();
+    CHECK(prom.find("# TYPE test_requests counter\ntest_requests 800000\n") != std::string::npos, prom);
+    CHECK(prom.find("# TYPE test_conns gauge\ntest_conns 42\n") != std::string::npos, prom);
+    CHECK(prom.find("test_latency_us{quantile=\"0.99\"} ") != std::string::npos, prom);
+    CHECK(prom.find("test_latency_us_count 100000\n") != std::string::npos, prom);
+    CHECK(prom.find("# TYPE log_events counter\n") != std::string::npos, prom);
+    std::cout << text;
+}
+
+static const int THREADS = 32;
+static const int LOOPS = 1000000;
+
+template <class F>
+double run_bench(F f)
+{
+    std::vector<sltj::Thread::ptr> threads;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < THREADS; ++i)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([f]() {
+            for (int j = 0; j < LOOPS; ++j)
+            {
+                f();
+            }
+        }, "bench_" + std::to_string(i))));
+    }
+    for (auto &t : threads)
+    {
+        t->join();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1e6;
+}
+
+// 分片计数器与单个共享原子变量对比
+void bench()
+{
+    static std::atomic<uint64_t> s_shared{0};
+    sltj::Counter::ptr c = sltj::Metrics::Lookup<sltj::Counter>("test.bench", "bench");
+    sltj::Histogram::ptr h = sltj::Metrics::Lookup<sltj::Histogram>("test.bench_hist", "bench");
+    double ops = (double)THREADS * LOOPS;
+
+    double atomic_sec = run_bench([]() { s_shared.fetch_add(1, std::memory_order_relaxed); });
+    double counter_sec = run_bench([c]() { c->inc(); });
+    double hist_sec = run_bench([h]() { h->record(100); });
+    CHECK(c->getValue() == (uint64_t)ops, c->getValue());
+    CHECK(h->snapshot().count == (uint64_t)ops, h->snapshot().count);
+
+    SLTJ_LOG_INFO(g_logger) << "threads=" << THREADS
+                            << " shared atomic: " << (uint64_t)(ops / atomic_sec) << " inc/s"
+                            << " sharded counter: " << (uint64_t)(ops / counter_sec) << " inc/s"
+                            << " histogram: " << (uint64_t)(ops / hist_sec) << " record/s";
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_counter_gauge();
+    test_histogram();
+    test_dump();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
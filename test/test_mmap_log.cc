@@ -0,0 +1,227 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const std::string s_path = "/tmp/sltj_test_mmap_log.log";
+
+static void remove_segments()
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), ".%06d", i);
+        unlink((s_path + buf).c_str());
+    }
+}
+
+static std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+// 多线程写满多段, 每段截断到有效长度, 记录完整且每个线程内有序
+void test_segments()
+{
+    remove_segments();
+    const int kThreads = 4;
+    const int kLines = 5000;
+    // 小段切得很快, 写入者常要等后台打开下一段, 等待期间不丢日志
+    sltj::Counter::ptr dropped = sltj::Metrics::Lookup<sltj::Counter>("log.mmap.dropped");
+    uint64_t dropped_before = dropped->getValue();
+    {
+        sltj::MmapLogAppender::ptr mmap(new sltj::MmapLogAppender(s_path, 64 * 1024));
+        mmap->setFormatter(sltj::LogFormatter::ptr(new sltj::LogFormatter("%m%n")));
+        sltj::Logger::ptr logger(new sltj::Logger("mmap"));
+        logger->addAppender(mmap);
+        CHECK(mmap->getSegmentSize() == 64 * 1024, mmap->getSegmentSize());
+
+        std::vector<sltj::Thread::ptr> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.push_back(sltj::Thread::ptr(new sltj::Thread([logger, t]() {
+                for (int i = 0; i < kLines; ++i)
+                {
+                    SLTJ_LOG_INFO(logger) << "writer " << t << " seq " << i;
+                }
+            }, "mmap_w" + std::to_string(t))));
+        }
+        for (auto &i : threads)
+        {
+            i->join();
+        }
+        CHECK(mmap->getSegmentIndex() >= 3, mmap->getSegmentIndex());
+    }
+    CHECK(dropped->getValue() == dropped_before, dropped->getValue() - dropped_before);
+
+    std::vector<int> next(kThreads, 0);
+    size_t lines = 0;
+    size_t bad = 0;
+    int segments = 0;
+    struct stat st;
+    for (int i = 0; i < 1000; ++i)
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), ".%06d", i);
+        if (stat((s_path + buf).c_str(), &st))
+        {
+            break;
+        }
+        ++segments;
+        CHECK(st.st_size > 0 && st.st_size <= 64 * 1024, buf << " size=" << st.st_size);
+        std::string data = read_file(s_path + buf);
+        CHECK(data.find('\0') == std::string::npos, buf << " has zero padding");
+        std::stringstream ss(data);
+        std::string line;
+        while (std::getline(ss, line))
+        {
+            int t = -1, seq = -1;
+            if (sscanf(line.c_str(), "writer %d seq %d", &t, &seq) != 2 || t < 0 || t >= kThreads || seq != next[t])
+            {
+                ++bad;
+                continue;
+            }
+            ++next[t];
+            ++lines;
+        }
+    }
+    CHECK(segments >= 4, segments);
+    CHECK(lines == (size_t)kThreads * kLines && bad == 0, lines << " bad=" << bad);
+
+    // 已有的段不被覆盖, 从下一个段号开始
+    {
+        sltj::MmapLogAppender::ptr mmap(new sltj::MmapLogAppender(s_path, 64 * 1024));
+        CHECK(mmap->getSegmentIndex() == (uint64_t)segments, mmap->getSegmentIndex());
+    }
+    remove_segments();
+}
+
+// 同步策略下照常写入和切段
+void test_sync_policy()
+{
+    remove_segments();
+    {
+        sltj::MmapLogAppender::ptr mmap(new sltj::MmapLogAppender(s_path, 16 * 1024));
+        mmap->setSyncPolicy(sltj::MmapLogAppender::SYNC_SYNC);
+        mmap->setSyncInterval(10);
+        mmap->setFormatter(sltj::LogFormatter::ptr(new sltj::LogFormatter("%m%n")));
+        sltj::Logger::ptr logger(new sltj::Logger("mmap"));
+        logger->addAppender(mmap);
+        for (int i = 0; i < 1000; ++i)
+        {
+            SLTJ_LOG_INFO(logger) << "sync line " << i;
+            if (i % 100 == 0)
+            {
+                usleep(5 * 1000);
+            }
+        }
+        mmap->flush();
+    }
+    std::string all;
+    for (int i = 0; i < 1000; ++i)
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), ".%06d", i);
+        if (access((s_path + buf).c_str(), F_OK))
+        {
+            break;
+        }
+        all += read_file(s_path + buf);
+    }
+    CHECK(all.find("sync line 0\n") != std::string::npos && all.find("sync line 999\n") != std::string::npos, all.size());
+    remove_segments();
+}
+
+// FileLogAppender本身不加锁, 多线程写时由这里串行
+class LockedAppender : public sltj::LogAppender
+{
+public:
+    LockedAppender(sltj::LogAppender::ptr appender) : m_appender(appender) {}
+    void log(sltj::LogLevel::Level level, sltj::LogEvent::ptr event) override
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        m_appender->log(level, event);
+    }
+    void flush() override
+    {
+        sltj::Mutex::Lock lock(m_lock);
+        m_appender->flush();
+    }
+
+private:
+    sltj::LogAppender::ptr m_appender;
+    sltj::Mutex m_lock;
+};
+
+// threads个线程共写total条, 返回每条记录的墙钟时间(ns), 含最后的flush.
+// 每个线程复用一个事件直接交给输出器, 不计创建事件的开销
+static double run_bench(sltj::LogAppender::ptr appender, int threads, int total)
+{
+    sltj::Logger::ptr logger(new sltj::Logger("mmap_bench"));
+    int n = total / threads;
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<sltj::Thread::ptr> vec;
+    for (int t = 0; t < threads; ++t)
+    {
+        vec.push_back(sltj::Thread::ptr(new sltj::Thread([logger, appender, t, n]() {
+            sltj::LogEvent::ptr event = SLTJ_LOG_MAKE_EVENT(logger, sltj::LogLevel::INFO);
+            event->getSS() << "bench line from writer " << t;
+            for (int i = 0; i < n; ++i)
+            {
+                appender->log(sltj::LogLevel::INFO, event);
+            }
+        }, "bench_" + std::to_string(t))));
+    }
+    for (auto &i : vec)
+    {
+        i->join();
+    }
+    appender->flush();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / (n * threads);
+}
+
+// 每条记录的开销, 与写文件(多线程时加锁)比较; 格式只有内容, 突出输出器本身的差别.
+// 段取8MB, 过程中会切段
+void bench()
+{
+    const int N = 1000000;
+    sltj::LogFormatter::ptr fmt(new sltj::LogFormatter("%m%n"));
+    sltj::Counter::ptr waits = sltj::Metrics::Lookup<sltj::Counter>("log.mmap.roll_waits");
+    for (int threads : {1, 4, 16})
+    {
+        remove_segments();
+        uint64_t waits_before = waits->getValue();
+        sltj::MmapLogAppender::ptr mmap(new sltj::MmapLogAppender(s_path, 8 * 1024 * 1024));
+        mmap->setFormatter(fmt);
+        double mmap_ns = run_bench(mmap, threads, N);
+        uint64_t segments = mmap->getSegmentIndex() + 1;
+        mmap.reset();
+        remove_segments();
+
+        sltj::FileLogAppender::ptr file(new sltj::FileLogAppender(s_path + ".file"));
+        file->reopen();
+        file->setFormatter(fmt);
+        double file_ns = run_bench(sltj::LogAppender::ptr(new LockedAppender(file)), threads, N);
+        unlink((s_path + ".file").c_str());
+        SLTJ_LOG_INFO(g_logger) << threads << " writers ns per record mmap=" << mmap_ns << " file=" << file_ns
+                                << " (" << segments << " segments, " << waits->getValue() - waits_before
+                                << " rolls waited for the background open)";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_segments();
+    test_sync_policy();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
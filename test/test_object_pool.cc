@@ -0,0 +1,194 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <map>
+#include <stdlib.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+struct Obj
+{
+    Obj(int v) : value(v) { ++s_alive; }
+    ~Obj() { --s_alive; }
+    int value;
+    char pad[40];
+    static std::atomic<int> s_alive;
+};
+std::atomic<int> Obj::s_alive{0};
+
+void test_arena()
+{
+    sltj::Arena arena(1024);
+    char *a = (char *)arena.allocate(3, 1);
+    uint64_t *b = (uint64_t *)arena.allocate(sizeof(uint64_t), alignof(uint64_t));
+    CHECK(((uintptr_t)b % alignof(uint64_t)) == 0, "align");
+    CHECK((char *)b - a < 16, "bump");
+    void *big = arena.allocate(4000, 64);
+    CHECK(((uintptr_t)big % 64) == 0, "big align");
+    CHECK(arena.getBytesUsed() == 3 + 8 + 4000, arena.getBytesUsed());
+    CHECK(arena.getBytesReserved() >= 1024 + 4000, arena.getBytesReserved());
+
+    Obj *o = arena.create<Obj>(7);
+    CHECK(o->value == 7, "create");
+    o->~Obj();
+
+    arena.reset();
+    CHECK(arena.getBytesUsed() == 0 && arena.getBytesReserved() == 1024, arena.getBytesReserved());
+    // reset后复用同一块
+    CHECK(arena.allocate(3, 1) == a, "reuse");
+
+    std::vector<int, sltj::ArenaAllocator<int>> vec{sltj::ArenaAllocator<int>(&arena)};
+    for (int i = 0; i < 1000; ++i)
+    {
+        vec.push_back(i);
+    }
+    CHECK(vec[999] == 999, "arena vector");
+    CHECK(sltj::Arena::GetThis() != nullptr, "thread arena");
+}
+
+void test_object_pool()
+{
+    sltj::SlabAllocator::Stats s0 = sltj::SlabAllocator::GetStats();
+
+    std::vector<Obj *> objs;
+    for (int i = 0; i < 1000; ++i)
+    {
+        objs.push_back(sltj::ObjectPool<Obj>::New(i));
+    }
+    CHECK(Obj::s_alive == 1000, Obj::s_alive);
+    bool ok = true;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ok = ok && objs[i]->value == i;
+    }
+    CHECK(ok, "values");
+
+    sltj::SlabAllocator::Stats s1 = sltj::SlabAllocator::GetStats();
+    CHECK(s1.bytesInUse >= s0.bytesInUse + 1000 * sizeof(Obj), s1.bytesInUse << " " << s0.bytesInUse);
+
+    // 在另一个线程释放, 对象经全局链表回到池中
+    sltj::Thread t([&objs]() {
+        for (auto o : objs)
+        {
+            sltj::ObjectPool<Obj>::Delete(o);
+        }
+    }, "free");
+    t.join();
+    CHECK(Obj::s_alive == 0, Obj::s_alive);
+
+    // 重新分配应复用已有slab
+    uint64_t reserved = sltj::SlabAllocator::GetStats().bytesReserved;
+    for (int i = 0; i < 1000; ++i)
+    {
+        objs[i] = sltj::ObjectPool<Obj>::New(i);
+    }
+    CHECK(sltj::SlabAllocator::GetStats().bytesReserved == reserved, "slab reuse");
+    for (auto o : objs)
+    {
+        sltj::ObjectPool<Obj>::Delete(o);
+    }
+
+    {
+        std::shared_ptr<Obj> sp = sltj::ObjectPool<Obj>::MakeShared(42);
+        CHECK(sp->value == 42 && Obj::s_alive == 1, "make shared");
+
+        std::map<int, std::string, std::less<int>, sltj::PoolAllocator<std::pair<const int, std::string>>> m;
+        for (int i = 0; i < 100; ++i)
+        {
+            m[i] = std::to_string(i);
+        }
+        CHECK(m.size() == 100 && m[50] == "50", "pool map");
+    }
+    CHECK(Obj::s_alive == 0, Obj::s_alive);
+
+    sltj::SlabAllocator::Stats s2 = sltj::SlabAllocator::GetStats();
+    CHECK(s2.bytesInUse <= s0.bytesInUse + 1024, s2.bytesInUse << " " << s0.bytesInUse);
+
+    // 大对象转给malloc
+    void *p = sltj::SlabAllocator::Allocate(5000);
+    CHECK(sltj::SlabAllocator::GetStats().largeAllocs == s2.largeAllocs + 1, "large");
+    sltj::SlabAllocator::Deallocate(p, 5000);
+
+    // 每个请求大小落到不小于它的最小级别
+    for (size_t size = 1; size <= sltj::SlabAllocator::MAX_SIZE; ++size)
+    {
+        void *q = sltj::SlabAllocator::Allocate(size);
+        memset(q, 0xab, size);
+        sltj::SlabAllocator::Deallocate(q, size);
+    }
+}
+
+static const size_t THREADS = 32;
+static const size_t ROUNDS = 200;
+static const size_t BATCH = 1000;
+
+// 每轮分配BATCH个不同大小的对象再全部释放
+template <class Alloc, class Free>
+double run_bench(Alloc alloc, Free dealloc)
+{
+    std::vector<sltj::Thread::ptr> threads;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([alloc, dealloc, i]() {
+            std::vector<std::pair<void *, size_t>> ptrs(BATCH);
+            unsigned int seed = i;
+            for (size_t r = 0; r < ROUNDS; ++r)
+            {
+                for (size_t j = 0; j < BATCH; ++j)
+                {
+                    size_t size = 16 + rand_r(&seed) % 496;
+                    ptrs[j].first = alloc(size);
+                    ptrs[j].second = size;
+                    *(char *)ptrs[j].first = 1;
+                }
+                for (size_t j = 0; j < BATCH; ++j)
+                {
+                    dealloc(ptrs[j].first, ptrs[j].second);
+                }
+            }
+        }, "bench_" + std::to_string(i))));
+    }
+    for (auto &t : threads)
+    {
+        t->join();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1e6;
+}
+
+void bench()
+{
+    double ops = (double)THREADS * ROUNDS * BATCH;
+    double malloc_sec = run_bench([](size_t size) { return malloc(size); },
+                                  [](void *p, size_t) { free(p); });
+    double slab_sec = run_bench([](size_t size) { return sltj::SlabAllocator::Allocate(size); },
+                                [](void *p, size_t size) { sltj::SlabAllocator::Deallocate(p, size); });
+    SLTJ_LOG_INFO(g_logger) << "threads=" << THREADS
+                            << " malloc: " << (uint64_t)(ops / malloc_sec) << " alloc+free/s"
+                            << " slab: " << (uint64_t)(ops / slab_sec) << " alloc+free/s";
+
+    sltj::SlabAllocator::Stats s = sltj::SlabAllocator::GetStats();
+    std::stringstream ss;
+    for (auto &c : s.classes)
+    {
+        if (c.allocs)
+        {
+            ss << " " << c.size << ":" << (int)(c.hitRate() * 100) << "%";
+        }
+    }
+    SLTJ_LOG_INFO(g_logger) << "in_use=" << s.bytesInUse << " reserved=" << s.bytesReserved
+                            << " hit rate" << ss.str();
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_arena();
+    test_object_pool();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
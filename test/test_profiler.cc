@@ -0,0 +1,143 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <fstream>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const std::string s_path = "/tmp/sltj_test_profiler.folded";
+
+// 导出符号(-rdynamic), 不内联, 便于在结果中按名字查找
+__attribute__((noinline)) uint64_t burn_cpu(uint64_t ms)
+{
+    volatile uint64_t x = 0;
+    uint64_t loops = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        for (int i = 0; i < 10000; ++i)
+        {
+            x = x * 31 + i;
+        }
+        ++loops;
+    }
+    return loops;
+}
+
+static volatile uint64_t s_sink = 0;
+
+// 使用返回值, 避免尾调用优化掉本函数的栈帧
+__attribute__((noinline)) void burn_in_fiber()
+{
+    s_sink = s_sink + burn_cpu(200);
+}
+
+static bool has_line(const std::string &folded, const std::string &prefix, const std::string &frame)
+{
+    std::stringstream ss(folded);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        if (line.compare(0, prefix.size(), prefix) == 0 && line.find(frame) != std::string::npos)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void test_profile()
+{
+    CHECK(sltj::Profiler::Start(1000), "start");
+    CHECK(!sltj::Profiler::Start(1000), "start twice");
+    CHECK(sltj::Profiler::IsRunning(), "running");
+
+    sltj::Thread a([]() { burn_cpu(300); }, "burn_a");
+    sltj::Thread b([]() { burn_cpu(300); }, "burn_b");
+    a.join();
+    b.join();
+    {
+        sltj::IOManager iom(1, "prof_io");
+        iom.schedule(&burn_in_fiber);
+        iom.stop();
+    }
+    sltj::Profiler::Stop();
+    CHECK(!sltj::Profiler::IsRunning(), "stopped");
+
+    uint64_t samples = sltj::Profiler::GetSampleCount();
+    CHECK(samples >= 50, samples);
+    CHECK(sltj::Profiler::GetDroppedCount() == 0, sltj::Profiler::GetDroppedCount());
+    CHECK(sltj::Metrics::Lookup<sltj::Counter>("profiler.samples")->getValue() == samples, "metric");
+
+    std::string folded = sltj::Profiler::GetFolded();
+    CHECK(has_line(folded, "burn_a;", "burn_cpu"), folded);
+    CHECK(has_line(folded, "burn_b;", "burn_cpu"), folded);
+    CHECK(has_line(folded, "prof_io_0;", "burn_in_fiber"), folded);
+    CHECK(folded.find("ProfHandler") == std::string::npos, "handler frame");
+
+    // 每行以空格分隔的次数结尾, 总和等于样本数
+    std::stringstream ss(folded);
+    std::string line;
+    uint64_t total = 0;
+    while (std::getline(ss, line))
+    {
+        total += std::stoull(line.substr(line.rfind(' ') + 1));
+    }
+    CHECK(total == samples, total << " " << samples);
+
+    std::string by_fiber = sltj::Profiler::GetFolded(true);
+    CHECK(has_line(by_fiber, "burn_a;fiber_0;", "burn_cpu"), by_fiber);
+    bool in_fiber = false;
+    std::stringstream fs(by_fiber);
+    while (std::getline(fs, line))
+    {
+        if (line.compare(0, 16, "prof_io_0;fiber_") == 0 && line.compare(0, 18, "prof_io_0;fiber_0;") != 0 &&
+            line.find("burn_in_fiber") != std::string::npos)
+        {
+            in_fiber = true;
+        }
+    }
+    CHECK(in_fiber, "burn_in_fiber attributed to a fiber");
+    SLTJ_LOG_INFO(g_logger) << "samples=" << samples << "\n" << folded.substr(0, 2000);
+}
+
+void test_config()
+{
+    sltj::Config::Lookup<std::string>("profiler.output")->setValue(s_path);
+    sltj::ConfigVar<bool>::ptr enable = sltj::Config::Lookup<bool>("profiler.enable");
+    enable->setValue(true);
+    CHECK(sltj::Profiler::IsRunning(), "started by config");
+    burn_cpu(200);
+    enable->setValue(false);
+    CHECK(!sltj::Profiler::IsRunning(), "stopped by config");
+
+    std::ifstream ifs(s_path);
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    CHECK(data.find("burn_cpu") != std::string::npos, data);
+    unlink(s_path.c_str());
+}
+
+// 99Hz采样时的开销
+void bench()
+{
+    const uint64_t MS = 1000;
+    uint64_t off = burn_cpu(MS);
+    sltj::Profiler::Start(99);
+    uint64_t on = burn_cpu(MS);
+    sltj::Profiler::Stop();
+    SLTJ_LOG_INFO(g_logger) << "burn loops off=" << off << " on(99Hz)=" << on
+                            << " overhead=" << (off > on ? (off - on) * 100.0 / off : 0) << "%";
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_profile();
+    test_config();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
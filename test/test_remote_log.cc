@@ -0,0 +1,245 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static std::string s_collector;
+static const std::string s_sock_path = "/tmp/sltj_test_remote_log.sock";
+static const std::string s_stats_path = "/tmp/sltj_test_remote_log.stats";
+
+// 启动test_log_collector子进程, quiet时丢弃其标准输出
+struct Collector
+{
+    pid_t pid;
+    int fd;
+};
+
+static Collector start_collector(const std::string &uri, uint64_t count, bool quiet = false)
+{
+    int fds[2];
+    if (pipe(fds))
+    {
+        return Collector{-1, -1};
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int out = quiet ? open("/dev/null", O_WRONLY) : fds[1];
+        int err = open(s_stats_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(out, STDOUT_FILENO);
+        dup2(err, STDERR_FILENO);
+        close(fds[0]);
+        execl(s_collector.c_str(), s_collector.c_str(), uri.c_str(), std::to_string(count).c_str(), (char *)nullptr);
+        _exit(127);
+    }
+    close(fds[1]);
+    // 等它绑定好地址
+    usleep(100 * 1000);
+    return Collector{pid, fds[0]};
+}
+
+// 读完子进程输出, 超时则杀掉
+static std::string wait_collector(Collector c, int timeout_ms = 5000)
+{
+    std::string out;
+    uint64_t deadline = sltj::GetCurrentMS() + timeout_ms;
+    char buf[64 * 1024];
+    for (;;)
+    {
+        uint64_t now = sltj::GetCurrentMS();
+        pollfd pfd{c.fd, POLLIN, 0};
+        if (now >= deadline || poll(&pfd, 1, deadline - now) <= 0)
+        {
+            kill(c.pid, SIGKILL);
+            break;
+        }
+        ssize_t n = read(c.fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+        out.append(buf, n);
+    }
+    close(c.fd);
+    int status = 0;
+    waitpid(c.pid, &status, 0);
+    return out;
+}
+
+static uint64_t stat_value(const std::string &key)
+{
+    std::ifstream ifs(s_stats_path);
+    std::string str((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    size_t pos = str.find(key + "=");
+    return pos == std::string::npos ? 0 : strtoull(str.c_str() + pos + key.size() + 1, nullptr, 10);
+}
+
+static size_t count_lines(const std::string &out, const std::string &str)
+{
+    size_t n = 0;
+    for (size_t pos = out.find(str); pos != std::string::npos; pos = out.find(str, pos + 1))
+    {
+        ++n;
+    }
+    return n;
+}
+
+static sltj::Logger::ptr make_logger(sltj::LogAppender::ptr appender)
+{
+    sltj::Logger::ptr logger(new sltj::Logger("remote"));
+    logger->addAppender(appender);
+    return logger;
+}
+
+// 多条记录拼进一个数据报
+void test_udp()
+{
+    std::string uri = "udp://127.0.0.1:" + std::to_string(20000 + getpid() % 10000);
+    // 管道满时收集器阻塞, 数据报会被内核丢弃, 这里只看统计
+    Collector c = start_collector(uri, 2000, true);
+    sltj::RemoteLogAppender::ptr remote = sltj::RemoteLogAppender::Create(uri);
+    CHECK(remote && remote->getType() == sltj::RemoteLogAppender::UDP, uri);
+    if (!remote)
+    {
+        return;
+    }
+    sltj::Logger::ptr logger = make_logger(remote);
+    for (int i = 0; i < 2000; ++i)
+    {
+        SLTJ_LOG_INFO(logger) << "udp line " << i;
+    }
+    remote->flush();
+    wait_collector(c);
+    CHECK(stat_value("records") == 2000, stat_value("records"));
+    CHECK(remote->getSent() == 2000 && remote->getPendingBytes() == 0, remote->getSent());
+    uint64_t messages = stat_value("messages");
+    CHECK(messages > 0 && messages < 200, "datagrams=" << messages);
+}
+
+// 收集器不在时缓存, 上线后补发; 对端关闭后重连
+void test_unix_reconnect()
+{
+    std::string uri = "unix://" + s_sock_path;
+    unlink(s_sock_path.c_str());
+    sltj::RemoteLogAppender::ptr remote = sltj::RemoteLogAppender::Create(uri);
+    CHECK(remote && remote->getType() == sltj::RemoteLogAppender::UNIX_STREAM, uri);
+    if (!remote)
+    {
+        return;
+    }
+    remote->setReconnectBackoff(10, 50);
+    sltj::Logger::ptr logger = make_logger(remote);
+    for (int i = 0; i < 100; ++i)
+    {
+        SLTJ_LOG_INFO(logger) << "first " << i;
+    }
+    usleep(50 * 1000);
+    CHECK(!remote->isConnected() && remote->getPendingBytes() > 0, "buffered while collector down");
+
+    Collector c = start_collector(uri, 100);
+    std::string out = wait_collector(c);
+    CHECK(count_lines(out, "first ") == 100, count_lines(out, "first "));
+    CHECK(stat_value("messages") == 100, "framed records " << stat_value("messages"));
+
+    // 收集器已退出, 下一批发送失败后重连新的收集器, 不丢记录
+    for (int i = 0; i < 100; ++i)
+    {
+        SLTJ_LOG_INFO(logger) << "second " << i;
+    }
+    c = start_collector(uri, 100);
+    out = wait_collector(c);
+    CHECK(count_lines(out, "second ") == 100, count_lines(out, "second "));
+    CHECK(remote->getReconnects() >= 1, remote->getReconnects());
+    CHECK(remote->getDropped() == 0, remote->getDropped());
+    unlink(s_sock_path.c_str());
+}
+
+// 超过上限丢弃并计数, 内存有界
+void test_overflow()
+{
+    unlink(s_sock_path.c_str());
+    sltj::RemoteLogAppender::ptr remote = sltj::RemoteLogAppender::Create("unixgram://" + s_sock_path, 4096);
+    CHECK(remote && remote->getType() == sltj::RemoteLogAppender::UNIX_DGRAM, "unixgram");
+    if (!remote)
+    {
+        return;
+    }
+    sltj::Counter::ptr dropped = sltj::Metrics::Lookup<sltj::Counter>("log.remote.dropped");
+    uint64_t before = dropped->getValue();
+    sltj::Logger::ptr logger = make_logger(remote);
+    for (int i = 0; i < 1000; ++i)
+    {
+        SLTJ_LOG_INFO(logger) << "overflow " << i;
+    }
+    CHECK(remote->getPendingBytes() <= 4096, remote->getPendingBytes());
+    CHECK(remote->getDropped() > 900, remote->getDropped());
+    CHECK(dropped->getValue() - before == remote->getDropped(), dropped->getValue() - before);
+
+    CHECK(!sltj::RemoteLogAppender::Create("tcp://127.0.0.1:1"), "bad scheme");
+    CHECK(!sltj::RemoteLogAppender::Create("unix://"), "empty path");
+}
+
+static double thread_cpu_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// 调用线程每条记录的CPU开销, 与同步写文件比较; 发送线程与收集器的开销不计入
+void bench()
+{
+    const int N = 200000;
+    std::string uri = "unixgram://" + s_sock_path;
+    Collector c = start_collector(uri, N, true);
+    sltj::RemoteLogAppender::ptr remote = sltj::RemoteLogAppender::Create(uri, 64 * 1024 * 1024);
+    sltj::Logger::ptr logger = make_logger(remote);
+    double begin = thread_cpu_ns();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_INFO(logger) << "bench line " << i;
+    }
+    double remote_ns = (thread_cpu_ns() - begin) / N;
+    wait_collector(c, 30000);
+    CHECK(stat_value("records") == N, stat_value("records"));
+    double per_dgram = (double)stat_value("records") / std::max<uint64_t>(stat_value("messages"), 1);
+
+    std::string file_path = "/tmp/sltj_test_remote_log.file";
+    sltj::FileLogAppender::ptr file(new sltj::FileLogAppender(file_path));
+    file->reopen();
+    sltj::Logger::ptr file_logger = make_logger(file);
+    begin = thread_cpu_ns();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_INFO(file_logger) << "bench line " << i;
+    }
+    file->flush();
+    double file_ns = (thread_cpu_ns() - begin) / N;
+    unlink(file_path.c_str());
+    unlink(s_sock_path.c_str());
+    SLTJ_LOG_INFO(g_logger) << "ns per record remote=" << remote_ns << " file=" << file_ns
+                            << " records per datagram=" << per_dgram;
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    std::string self = argv[0];
+    size_t pos = self.rfind('/');
+    s_collector = (pos == std::string::npos ? std::string(".") : self.substr(0, pos)) + "/test_log_collector";
+
+    test_udp();
+    test_unix_reconnect();
+    test_overflow();
+    bench();
+
+    unlink(s_stats_path.c_str());
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
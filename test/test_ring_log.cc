@@ -0,0 +1,224 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <fstream>
+#include <signal.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const std::string s_path = "/tmp/sltj_test_ring_log.dump";
+
+static std::vector<std::string> read_lines()
+{
+    std::ifstream ifs(s_path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static size_t count(const std::vector<std::string> &lines, const std::string &str)
+{
+    size_t n = 0;
+    for (auto &i : lines)
+    {
+        if (i.find(str) != std::string::npos)
+        {
+            ++n;
+        }
+    }
+    return n;
+}
+
+// 只保留最近的记录, 不自动转储
+void test_overwrite()
+{
+    unlink(s_path.c_str());
+    sltj::Logger::ptr logger(new sltj::Logger("ring"));
+    sltj::RingBufferLogAppender::ptr ring(new sltj::RingBufferLogAppender(s_path, 8192));
+    ring->setDumpLevel(sltj::LogLevel::UNKNOW);
+    logger->addAppender(ring);
+    for (int i = 0; i < 1000; ++i)
+    {
+        SLTJ_LOG_DEBUG(logger) << "debug line " << i;
+    }
+    CHECK(read_lines().empty(), "no steady state io");
+    CHECK(ring->dump(), "dump");
+
+    std::vector<std::string> lines = read_lines();
+    CHECK(lines.size() > 20 && lines.size() < 200, lines.size());
+    CHECK(count(lines, "debug line 999") == 1, "newest kept");
+    CHECK(count(lines, "debug line 10") == 0, "oldest dropped");
+    CHECK(lines.front().find("==== flight recorder dump reason=api") == 0, lines.front());
+    CHECK(lines.back() == "==== end of dump ====", lines.back());
+    CHECK(count(lines, "[DEBUG]\t[ring]") == lines.size() - 2, "format");
+    CHECK(count(lines, "test_ring_log.cc:") == lines.size() - 2, "file:line");
+
+    // 写出的记录按顺序且连续
+    int prev = -1;
+    bool ordered = true;
+    for (size_t i = 1; i + 1 < lines.size(); ++i)
+    {
+        int n = atoi(lines[i].substr(lines[i].rfind(' ') + 1).c_str());
+        if (prev >= 0 && n != prev + 1)
+        {
+            ordered = false;
+        }
+        prev = n;
+    }
+    CHECK(ordered, "ordered");
+}
+
+// ERROR事件触发转储, 带上之前的DEBUG细节; 间隔内不重复转储
+void test_dump_on_error()
+{
+    unlink(s_path.c_str());
+    sltj::Logger::ptr logger(new sltj::Logger("ring"));
+    sltj::RingBufferLogAppender::ptr ring(new sltj::RingBufferLogAppender(s_path, 64 * 1024));
+    ring->setDumpInterval(60 * 1000);
+    logger->addAppender(ring);
+    SLTJ_LOG_DEBUG(logger) << "context before error";
+    SLTJ_LOG_INFO(logger) << "info before error";
+    CHECK(ring->getDumpCount() == 0, "no dump yet");
+    SLTJ_LOG_ERROR(logger) << "something failed";
+    CHECK(ring->getDumpCount() == 1, ring->getDumpCount());
+    SLTJ_LOG_ERROR(logger) << "failed again";
+    CHECK(ring->getDumpCount() == 1, "rate limited");
+
+    std::vector<std::string> lines = read_lines();
+    CHECK(count(lines, "reason=ERROR") == 1, "reason");
+    CHECK(count(lines, "context before error") == 1, "debug context");
+    CHECK(count(lines, "[ERROR]\t[ring]") == 1 && count(lines, "something failed") == 1, "error record");
+}
+
+// 多线程记录按时间合并; 转储与写入并发
+void test_threads()
+{
+    unlink(s_path.c_str());
+    sltj::Logger::ptr logger(new sltj::Logger("ring"));
+    sltj::RingBufferLogAppender::ptr ring(new sltj::RingBufferLogAppender(s_path, 16 * 1024));
+    ring->setDumpLevel(sltj::LogLevel::UNKNOW);
+    logger->addAppender(ring);
+
+    std::atomic<bool> stop{false};
+    std::vector<sltj::Thread::ptr> threads;
+    for (int t = 0; t < 3; ++t)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([logger, &stop, t]() {
+            for (int i = 0; !stop; ++i)
+            {
+                SLTJ_LOG_DEBUG(logger) << "writer " << t << " seq " << i;
+            }
+        }, "ring_w" + std::to_string(t))));
+    }
+    for (int i = 0; i < 50; ++i)
+    {
+        ring->dump("stress");
+        usleep(1000);
+    }
+    stop = true;
+    for (auto &i : threads)
+    {
+        i->join();
+    }
+    std::vector<std::string> lines = read_lines();
+    // 每条记录完整: 以日期开头, 线程名与内容对应
+    size_t bad = 0;
+    size_t records = 0;
+    for (auto &i : lines)
+    {
+        if (i.compare(0, 4, "====") == 0)
+        {
+            continue;
+        }
+        ++records;
+        size_t w = i.find("\tring_w");
+        size_t c = i.find("writer ");
+        if (i.size() < 27 || i[4] != '-' || w == std::string::npos || c == std::string::npos ||
+            i[w + 7] != i[c + 7])
+        {
+            ++bad;
+        }
+    }
+    CHECK(records > 0 && bad == 0, records << " " << bad);
+    CHECK(count(lines, "reason=stress") == 50, count(lines, "reason=stress"));
+
+    // 线程退出后缓冲保留, 转储仍包含三个线程的最后记录
+    unlink(s_path.c_str());
+    ring->dump("after exit");
+    lines = read_lines();
+    CHECK(count(lines, "\tring_w0\t") > 0 && count(lines, "\tring_w1\t") > 0 && count(lines, "\tring_w2\t") > 0, "all threads");
+
+    // 新线程复用退出线程的缓冲
+    sltj::Thread t([logger]() { SLTJ_LOG_DEBUG(logger) << "reused"; }, "ring_new");
+    t.join();
+    unlink(s_path.c_str());
+    ring->dump("reuse");
+    lines = read_lines();
+    CHECK(count(lines, "reused") == 1, "reused");
+}
+
+void test_signal()
+{
+    unlink(s_path.c_str());
+    sltj::Logger::ptr logger(new sltj::Logger("ring"));
+    sltj::RingBufferLogAppender::ptr ring(new sltj::RingBufferLogAppender(s_path, 8192));
+    logger->addAppender(ring);
+    SLTJ_LOG_INFO(logger) << "before signal";
+    CHECK(sltj::RingBufferLogAppender::SetDumpSignal(SIGUSR2), "set signal");
+    raise(SIGUSR2);
+    for (int i = 0; i < 100 && ring->getDumpCount() == 0; ++i)
+    {
+        usleep(10 * 1000);
+    }
+    std::vector<std::string> lines = read_lines();
+    CHECK(count(lines, "reason=signal 12") == 1 && count(lines, "before signal") == 1, lines.size());
+}
+
+// 每条记录的开销, 与同步写文件比较
+void bench()
+{
+    const int N = 1000000;
+    sltj::Logger::ptr logger(new sltj::Logger("ring_bench"));
+    sltj::RingBufferLogAppender::ptr ring(new sltj::RingBufferLogAppender(s_path, 4 * 1024 * 1024));
+    ring->setDumpLevel(sltj::LogLevel::UNKNOW);
+    logger->addAppender(ring);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_DEBUG(logger) << "bench line " << i;
+    }
+    double ring_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+
+    sltj::Logger::ptr file_logger(new sltj::Logger("file_bench"));
+    sltj::FileLogAppender::ptr file(new sltj::FileLogAppender(s_path + ".file"));
+    file->reopen();
+    file_logger->addAppender(file);
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_DEBUG(file_logger) << "bench line " << i;
+    }
+    double file_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+    unlink((s_path + ".file").c_str());
+    SLTJ_LOG_INFO(g_logger) << "ns per record ring=" << ring_ns << " file=" << file_ns;
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_overwrite();
+    test_dump_on_error();
+    test_threads();
+    test_signal();
+    bench();
+
+    unlink(s_path.c_str());
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
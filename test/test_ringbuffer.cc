@@ -0,0 +1,211 @@
+#include "../src/sltj.h"
+#include "../src/ringbuffer.h"
+#include <chrono>
+#include <deque>
+
+// 不同生产者数量下各队列的吞吐,并校验元素总和
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const uint64_t TOTAL = 1 << 21; // 每轮总元素数
+static const size_t CAPACITY = 4096;
+static const size_t BATCH = 32;
+
+// 互斥量+deque作为对照
+template <class T>
+class MutexQueue
+{
+public:
+    using value_type = T;
+    MutexQueue(size_t capacity) : m_capacity(capacity) {}
+    bool tryPush(T &&v)
+    {
+        sltj::Mutex::Lock lock(m_mutex);
+        if (m_queue.size() >= m_capacity)
+            return false;
+        m_queue.push_back(std::move(v));
+        return true;
+    }
+    bool tryPop(T &v)
+    {
+        sltj::Mutex::Lock lock(m_mutex);
+        if (m_queue.empty())
+            return false;
+        v = std::move(m_queue.front());
+        m_queue.pop_front();
+        return true;
+    }
+    size_t pushBatch(T *items, size_t count)
+    {
+        sltj::Mutex::Lock lock(m_mutex);
+        size_t n = 0;
+        while (n < count && m_queue.size() < m_capacity)
+            m_queue.push_back(std::move(items[n++]));
+        return n;
+    }
+    size_t popBatch(T *items, size_t count)
+    {
+        sltj::Mutex::Lock lock(m_mutex);
+        size_t n = 0;
+        while (n < count && !m_queue.empty())
+        {
+            items[n++] = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        return n;
+    }
+
+private:
+    size_t m_capacity;
+    std::deque<T> m_queue;
+    sltj::Mutex m_mutex;
+};
+
+template <class Queue>
+void produce(Queue &q, uint64_t begin, uint64_t end, bool batch)
+{
+    uint64_t buf[BATCH];
+    for (uint64_t i = begin; i < end;)
+    {
+        if (batch)
+        {
+            size_t n = 0;
+            while (n < BATCH && i + n < end)
+            {
+                buf[n] = i + n;
+                ++n;
+            }
+            size_t done = 0;
+            while (done < n)
+            {
+                size_t rt = q.pushBatch(buf + done, n - done);
+                if (!rt)
+                    sched_yield();
+                done += rt;
+            }
+            i += n;
+        }
+        else
+        {
+            uint64_t v = i;
+            while (!q.tryPush(std::move(v)))
+                sched_yield();
+            ++i;
+        }
+    }
+}
+
+template <class Queue>
+void consume(Queue &q, uint64_t count, std::atomic<uint64_t> &sum, bool batch)
+{
+    uint64_t buf[BATCH];
+    uint64_t local = 0;
+    uint64_t got = 0;
+    while (got < count)
+    {
+        if (batch)
+        {
+            size_t n = q.popBatch(buf, BATCH);
+            if (!n)
+            {
+                sched_yield();
+                continue;
+            }
+            for (size_t i = 0; i < n; ++i)
+                local += buf[i];
+            got += n;
+        }
+        else
+        {
+            uint64_t v;
+            if (!q.tryPop(v))
+            {
+                sched_yield();
+                continue;
+            }
+            local += v;
+            ++got;
+        }
+    }
+    sum += local;
+}
+
+// 阻塞队列只走阻塞接口
+template <class Q>
+void produce(sltj::BlockingQueue<Q> &q, uint64_t begin, uint64_t end, bool)
+{
+    for (uint64_t i = begin; i < end; ++i)
+        q.push(i);
+}
+
+template <class Q>
+void consume(sltj::BlockingQueue<Q> &q, uint64_t count, std::atomic<uint64_t> &sum, bool)
+{
+    uint64_t buf[BATCH];
+    uint64_t local = 0;
+    uint64_t got = 0;
+    while (got < count)
+    {
+        size_t n = q.popBatch(buf, std::min<uint64_t>(BATCH, count - got));
+        for (size_t i = 0; i < n; ++i)
+            local += buf[i];
+        got += n;
+    }
+    sum += local;
+}
+
+template <class Queue>
+bool run(const std::string &name, int producers, int consumers, bool batch)
+{
+    Queue q(CAPACITY);
+    std::atomic<uint64_t> sum{0};
+    uint64_t per_producer = TOTAL / producers;
+    uint64_t total = per_producer * producers;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<sltj::Thread::ptr> threads;
+    for (int i = 0; i < consumers; ++i)
+    {
+        uint64_t count = total / consumers + (i == 0 ? total % consumers : 0);
+        threads.emplace_back(new sltj::Thread([&q, count, &sum, batch]() { consume(q, count, sum, batch); },
+                                              "consumer_" + std::to_string(i)));
+    }
+    for (int i = 0; i < producers; ++i)
+    {
+        uint64_t begin = per_producer * i;
+        threads.emplace_back(new sltj::Thread([&q, begin, per_producer, batch]() { produce(q, begin, begin + per_producer, batch); },
+                                              "producer_" + std::to_string(i)));
+    }
+    for (auto &i : threads)
+        i->join();
+    auto end = std::chrono::steady_clock::now();
+
+    double sec = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1e6;
+    uint64_t expect = total * (total - 1) / 2;
+    SLTJ_LOG_INFO(g_logger) << name << (batch ? " batch" : " single") << " producers=" << producers
+                            << " consumers=" << consumers << " items=" << total
+                            << " Mops/s=" << total / sec / 1e6 << (sum == expect ? "" : " CHECKSUM MISMATCH");
+    return sum == expect;
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = true;
+    for (int b = 0; b < 2; ++b)
+    {
+        ok &= run<sltj::SPSCRingQueue<uint64_t>>("spsc", 1, 1, b);
+        ok &= run<MutexQueue<uint64_t>>("mutex_deque", 1, 1, b);
+    }
+    int producers[] = {1, 2, 4, 8};
+    for (int p : producers)
+    {
+        for (int b = 0; b < 2; ++b)
+        {
+            ok &= run<sltj::MPSCRingQueue<uint64_t>>("mpsc", p, 1, b);
+            ok &= run<sltj::MPMCRingQueue<uint64_t>>("mpmc", p, 2, b);
+            ok &= run<MutexQueue<uint64_t>>("mutex_deque", p, 1, b);
+        }
+        ok &= run<sltj::BlockingQueue<sltj::MPSCRingQueue<uint64_t>>>("blocking_mpsc", p, 1, false);
+    }
+    return ok ? 0 : 1;
+}
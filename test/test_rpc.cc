@@ -0,0 +1,326 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 协程内休眠, 不阻塞工作线程
+static void fiber_sleep(uint64_t ms)
+{
+    sltj::IOManager *iom = sltj::IOManager::GetThis();
+    sltj::Fiber::ptr fiber = sltj::Fiber::GetThis();
+    iom->addTimer(ms, [iom, fiber]() {
+        iom->schedule(fiber);
+    });
+    sltj::Fiber::YieldToHold();
+}
+
+// 在非协程线程中等待条件成立, 最多timeout_ms
+template <class Pred>
+static bool wait_until(Pred pred, uint64_t timeout_ms)
+{
+    uint64_t deadline = sltj::TimerManager::GetNowMS() + timeout_ms;
+    while (!pred())
+    {
+        if (sltj::TimerManager::GetNowMS() >= deadline)
+        {
+            return false;
+        }
+        usleep(1000);
+    }
+    return true;
+}
+
+static std::atomic<int> s_notified{0};
+
+static void add_methods(sltj::RpcServer::ptr server)
+{
+    server->registerMethod("echo", [](sltj::RpcRequest::ptr req, sltj::RpcResponse::ptr rsp) {
+        rsp->payload = req->payload.toString();
+    });
+    server->registerMethod("fail", [](sltj::RpcRequest::ptr req, sltj::RpcResponse::ptr rsp) {
+        throw std::runtime_error("boom");
+    });
+    server->registerMethod("status", [](sltj::RpcRequest::ptr req, sltj::RpcResponse::ptr rsp) {
+        rsp->status = 100;
+        rsp->payload = "custom";
+    });
+    // payload为休眠毫秒数
+    server->registerMethod("sleep", [](sltj::RpcRequest::ptr req, sltj::RpcResponse::ptr rsp) {
+        fiber_sleep(std::stoul(req->payload.toString()));
+        rsp->payload = req->payload.toString();
+    });
+    server->registerMethod("notify", [](sltj::RpcRequest::ptr req, sltj::RpcResponse::ptr rsp) {
+        ++s_notified;
+    });
+}
+
+// 帧头与varint的编解码
+void test_codec()
+{
+    char buf[16];
+    uint64_t values[] = {0, 1, 127, 128, 300, 16384, 0xffffffffull, ~0ull};
+    for (uint64_t v : values)
+    {
+        size_t n = sltj::RpcCodec::EncodeVarint(v, buf);
+        uint64_t out = 0;
+        CHECK(sltj::RpcCodec::DecodeVarint(buf, n, out) == n && out == v, v);
+        CHECK(n == 1 || sltj::RpcCodec::DecodeVarint(buf, n - 1, out) == 0, "incomplete varint " << v);
+    }
+
+    sltj::IOBuffer out;
+    sltj::RpcCodec::EncodeRequest(out, 0x01020304, true, "echo", "hello", 5);
+    CHECK(out.size() == sltj::RpcHeader::SIZE + 1 + 4 + 5, out.size());
+    sltj::RpcHeader hdr;
+    CHECK(hdr.decode(out.data()), "decode header");
+    CHECK(hdr.seq == 0x01020304 && hdr.length == 10 && hdr.flags == sltj::RpcHeader::ONEWAY, hdr.seq);
+    CHECK(out.data()[4] == 1 && out.data()[7] == 4, "big endian seq");
+    sltj::RpcRequest req;
+    CHECK(sltj::RpcCodec::DecodeRequest(out.slice(sltj::RpcHeader::SIZE, hdr.length), req), "decode request");
+    CHECK(req.method == "echo" && req.payload.toString() == "hello", req.method);
+
+    // method长度超出body
+    sltj::RpcRequest bad;
+    CHECK(!sltj::RpcCodec::DecodeRequest(out.slice(sltj::RpcHeader::SIZE, 3), bad), "truncated");
+    out.data()[0] = 'x';
+    CHECK(!hdr.decode(out.data()), "bad magic");
+}
+
+// 非协程线程中的同步调用
+void test_call(sltj::RpcClient::ptr client)
+{
+    sltj::RpcResult::ptr r = client->call("echo", "hello", 1000);
+    CHECK(r->result == sltj::RpcResult::Error::OK && r->status == 0 && r->payload.toString() == "hello", r->toString());
+
+    r = client->call("nope", "", 1000);
+    CHECK(r->result == sltj::RpcResult::Error::OK && r->status == (uint32_t)sltj::RpcStatus::METHOD_NOT_FOUND,
+          r->toString());
+
+    r = client->call("fail", "", 1000);
+    CHECK(r->status == (uint32_t)sltj::RpcStatus::HANDLER_ERROR && r->payload.toString() == "boom", r->toString());
+
+    r = client->call("status", "", 1000);
+    CHECK(r->status == 100 && r->payload.toString() == "custom", r->toString());
+
+    // 单向调用没有响应
+    int before = s_notified;
+    for (int i = 0; i < 10; ++i)
+    {
+        CHECK(client->notify("notify", ""), "notify");
+    }
+    CHECK(wait_until([before]() { return s_notified == before + 10; }, 1000), s_notified);
+    CHECK(client->getPendingCount() == 0, client->getPendingCount());
+}
+
+// 超时的调用不影响连接上的其他调用, 迟到的响应被丢弃
+void test_timeout(sltj::RpcClient::ptr client)
+{
+    uint64_t start = sltj::TimerManager::GetNowMS();
+    sltj::RpcResult::ptr r = client->call("sleep", "300", 50);
+    uint64_t used = sltj::TimerManager::GetNowMS() - start;
+    CHECK(r->result == sltj::RpcResult::Error::TIMEOUT, r->toString());
+    CHECK(used < 250, used);
+    CHECK(client->getPendingCount() == 0, client->getPendingCount());
+
+    r = client->call("echo", "after", 1000);
+    CHECK(r->result == sltj::RpcResult::Error::OK && r->payload.toString() == "after", r->toString());
+    usleep(400 * 1000);
+    r = client->call("echo", "late", 1000);
+    CHECK(r->result == sltj::RpcResult::Error::OK && r->payload.toString() == "late", r->toString());
+}
+
+// 64个协程共用一个连接, 响应按完成顺序返回
+void test_multiplex(sltj::RpcClient::ptr client, sltj::IOManager *iom)
+{
+    static const int kCalls = 64;
+    std::atomic<int> done{0};
+    std::atomic<int> ok{0};
+    sltj::Mutex mutex;
+    std::vector<int> order;
+    uint64_t start = sltj::TimerManager::GetNowMS();
+    for (int i = 0; i < kCalls; ++i)
+    {
+        iom->schedule([client, i, &done, &ok, &mutex, &order]() {
+            // 先发出的请求处理得更久
+            std::string ms = std::to_string((kCalls - i) * 2);
+            sltj::RpcResult::ptr r = client->call("sleep", ms, 2000);
+            if (r->result == sltj::RpcResult::Error::OK && r->payload.toString() == ms)
+            {
+                ++ok;
+            }
+            {
+                sltj::Mutex::Lock lock(mutex);
+                order.push_back(i);
+            }
+            ++done;
+        });
+    }
+    CHECK(wait_until([&done]() { return done == kCalls; }, 3000), done);
+    uint64_t used = sltj::TimerManager::GetNowMS() - start;
+    CHECK(ok == kCalls, ok);
+    // 串行执行需要约4秒
+    CHECK(used < kCalls * 2 * 2, used);
+    CHECK(order.size() == (size_t)kCalls && order.front() > order.back(), "not out of order");
+}
+
+// 连接断开或客户端关闭时, 等待中的调用以CONNECTION_CLOSED结束
+void test_close(sltj::IOManager *iom)
+{
+    sltj::Socket::ptr listener = sltj::Socket::CreateTCPSocket();
+    CHECK(listener->bind(sltj::Address::LookupAny("127.0.0.1:0")) && listener->listen(), "listen");
+    sltj::Address::ptr addr = listener->getLocalAddress();
+
+    sltj::RpcClient::ptr client(new sltj::RpcClient(iom));
+    CHECK(client->connect(addr, 1000), "connect");
+    sltj::Socket::ptr server = listener->accept();
+
+    sltj::Semaphore sem;
+    sltj::RpcResult::ptr result;
+    client->callAsync("echo", "x", 5000, [&sem, &result](sltj::RpcResult::ptr r) {
+        result = r;
+        sem.notify();
+    });
+    char buf[64];
+    CHECK(server->recv(buf, sizeof(buf)) > 0, "server recv");
+    server->close();
+    CHECK(sem.waitFor(1000), "not failed on close");
+    CHECK(result && result->result == sltj::RpcResult::Error::CONNECTION_CLOSED, (result ? result->toString() : ""));
+    CHECK(!client->isConnected(), "still connected");
+    sltj::RpcResult::ptr r = client->call("echo", "x", 100);
+    CHECK(r->result == sltj::RpcResult::Error::NOT_CONNECTED, r->toString());
+
+    // 客户端主动关闭
+    CHECK(client->connect(addr, 1000), "reconnect");
+    server = listener->accept();
+    result.reset();
+    client->callAsync("echo", "x", 5000, [&sem, &result](sltj::RpcResult::ptr r) {
+        result = r;
+        sem.notify();
+    });
+    client->close();
+    CHECK(sem.waitFor(1000), "not failed on client close");
+    CHECK(result && result->result == sltj::RpcResult::Error::CONNECTION_CLOSED, (result ? result->toString() : ""));
+    CHECK(server->recv(buf, sizeof(buf)) >= 0, "server recv");
+    CHECK(client->getPendingCount() == 0, client->getPendingCount());
+}
+
+// 同样的echo调用, RPC与HTTP连接池对比
+void bench(sltj::RpcClient::ptr client, sltj::IOManager *client_iom,
+           sltj::IOManager *io_worker, sltj::IOManager *accept_worker)
+{
+    static const int kFibers = 64;
+    static const int kCallsPerFiber = 300;
+    const std::string payload(100, 'p');
+    const int total = kFibers * kCallsPerFiber;
+
+    sltj::Counter::ptr frames = sltj::Metrics::Lookup<sltj::Counter>("rpc.frames_sent");
+    sltj::Counter::ptr writes = sltj::Metrics::Lookup<sltj::Counter>("rpc.writes");
+    uint64_t frames_before = frames->getValue();
+    uint64_t writes_before = writes->getValue();
+
+    std::atomic<int> done{0};
+    std::atomic<int> ok{0};
+    uint64_t start = sltj::TimerManager::GetNowMS();
+    for (int i = 0; i < kFibers; ++i)
+    {
+        client_iom->schedule([client, &payload, &done, &ok]() {
+            for (int j = 0; j < kCallsPerFiber; ++j)
+            {
+                sltj::RpcResult::ptr r = client->call("echo", payload, 5000);
+                ok += r->result == sltj::RpcResult::Error::OK && r->payload.size() == payload.size();
+            }
+            ++done;
+        });
+    }
+    CHECK(wait_until([&done]() { return done == kFibers; }, 60000), done);
+    uint64_t rpc_ms = sltj::TimerManager::GetNowMS() - start;
+    CHECK(ok == total, ok);
+    double frames_per_write = (double)(frames->getValue() - frames_before) / (writes->getValue() - writes_before);
+    // 请求: 帧头 + method(varint + "echo") + payload; 响应: 帧头 + status + payload
+    size_t rpc_bytes = sltj::RpcHeader::SIZE * 2 + 1 + 4 + 1 + payload.size() * 2;
+
+    sltj::HttpServer::ptr http(new sltj::HttpServer(true, io_worker, accept_worker));
+    http->getServletDispatch()->addServlet("/echo", [](sltj::HttpRequest::ptr req, sltj::HttpResponse::ptr rsp,
+                                                       sltj::HttpSession::ptr session) {
+        rsp->setBody(req->getBody());
+        return 0;
+    });
+    CHECK(http->bind(sltj::Address::LookupAny("127.0.0.1:0")) && http->start(), "http start");
+    uint16_t port = std::dynamic_pointer_cast<sltj::IPAddress>(http->getSocks()[0]->getLocalAddress())->getPort();
+    uint64_t http_ms = 0;
+    {
+        sltj::HttpConnectionPool::ptr pool(new sltj::HttpConnectionPool(
+            "127.0.0.1", "127.0.0.1", port, kFibers, 60000, 0, client_iom));
+        done = 0;
+        ok = 0;
+        start = sltj::TimerManager::GetNowMS();
+        for (int i = 0; i < kFibers; ++i)
+        {
+            client_iom->schedule([pool, &payload, &done, &ok]() {
+                for (int j = 0; j < kCallsPerFiber; ++j)
+                {
+                    sltj::HttpResult::ptr r = pool->doPost("/echo", 5000, {}, payload);
+                    ok += r->result == sltj::HttpResult::Error::OK && r->response->getBody().size() == payload.size();
+                }
+                ++done;
+            });
+        }
+        CHECK(wait_until([&done]() { return done == kFibers; }, 60000), done);
+        http_ms = sltj::TimerManager::GetNowMS() - start;
+        CHECK(ok == total, ok);
+    }
+    http->stop();
+
+    // 与连接池发出的请求和服务器返回的响应相同
+    sltj::HttpRequest::ptr req(new sltj::HttpRequest);
+    req->setMethod(sltj::HttpMethod::POST);
+    req->setPath("/echo");
+    req->setHeader("Host", "127.0.0.1");
+    req->setBody(payload);
+    sltj::HttpResponse::ptr rsp(new sltj::HttpResponse);
+    rsp->setHeader("Server", http->getName());
+    rsp->setBody(payload);
+    size_t http_bytes = req->toString().size() + rsp->toString().size();
+
+    SLTJ_LOG_INFO(g_logger) << "rpc: " << total * 1000.0 / (rpc_ms ? rpc_ms : 1) << " calls/s, "
+                            << rpc_bytes << " bytes/call, " << frames_per_write << " frames/write";
+    SLTJ_LOG_INFO(g_logger) << "http: " << total * 1000.0 / (http_ms ? http_ms : 1) << " calls/s, "
+                            << http_bytes << " bytes/call, " << kFibers << " connections";
+    CHECK(rpc_bytes < http_bytes, rpc_bytes << " " << http_bytes);
+    CHECK(frames_per_write >= 1, frames_per_write);
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    test_codec();
+
+    sltj::IOManager io_worker(2, "io");
+    sltj::IOManager accept_worker(1, "accept");
+    sltj::IOManager worker(2, "worker");
+    sltj::IOManager client_iom(2, "client");
+    {
+        sltj::RpcServer::ptr server(new sltj::RpcServer(&worker, &io_worker, &accept_worker));
+        add_methods(server);
+        CHECK(server->bind(sltj::Address::LookupAny("127.0.0.1:0")), "bind");
+        CHECK(server->start(), "start");
+        sltj::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+        sltj::RpcClient::ptr client(new sltj::RpcClient(&client_iom));
+        CHECK(client->connect(addr, 1000), "connect");
+        test_call(client);
+        test_timeout(client);
+        test_multiplex(client, &client_iom);
+        test_close(&client_iom);
+        bench(client, &client_iom, &io_worker, &accept_worker);
+        client->close();
+        server->stop();
+    }
+    client_iom.stop();
+    worker.stop();
+    accept_worker.stop();
+    io_worker.stop();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
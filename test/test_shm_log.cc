@@ -0,0 +1,305 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static std::string s_logd;
+static const std::string s_out_dir = "/tmp/sltj_test_shm_log";
+
+static std::string read_file(const std::string &path)
+{
+    std::ifstream ifs(path);
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+static size_t count(const std::string &str, const std::string &sub)
+{
+    size_t n = 0;
+    for (size_t pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1))
+    {
+        ++n;
+    }
+    return n;
+}
+
+// /dev/shm下名字以prefix开头的环
+static size_t count_rings(const std::string &prefix)
+{
+    size_t n = 0;
+    DIR *dir = opendir("/dev/shm");
+    while (struct dirent *ent = dir ? readdir(dir) : nullptr)
+    {
+        if (std::string(ent->d_name).compare(0, prefix.size(), prefix) == 0)
+        {
+            ++n;
+        }
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+    return n;
+}
+
+static int run_logd(const std::vector<std::string> &args)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        std::vector<char *> argv;
+        argv.push_back((char *)s_logd.c_str());
+        for (auto &i : args)
+        {
+            argv.push_back((char *)i.c_str());
+        }
+        argv.push_back(nullptr);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        execv(s_logd.c_str(), &argv[0]);
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// 进程内多个写线程, 读者并发读出; 每个线程的记录按顺序, 收到+丢弃=写入
+void test_ring()
+{
+    const int kThreads = 3;
+    const int kLines = 2000;
+    sltj::ShmLogAppender::ptr shm(new sltj::ShmLogAppender("shmtest", 256 * 1024));
+    CHECK(shm->getRing(), "create ring");
+    if (!shm->getRing())
+    {
+        return;
+    }
+    sltj::Logger::ptr logger(new sltj::Logger("shm"));
+    logger->addAppender(shm);
+    sltj::ShmLogRing::ptr reader = sltj::ShmLogRing::Open(shm->getRing()->getShmName());
+    CHECK(reader && reader->getApp() == "shmtest" && reader->getPid() == getpid(), "open ring");
+    if (!reader)
+    {
+        return;
+    }
+
+    std::vector<sltj::Thread::ptr> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.push_back(sltj::Thread::ptr(new sltj::Thread([logger, t]() {
+            for (int i = 0; i < kLines; ++i)
+            {
+                SLTJ_LOG_INFO(logger) << "writer " << t << " seq " << i;
+            }
+        }, "shm_w" + std::to_string(t))));
+    }
+    std::vector<int> last(kThreads, -1);
+    size_t received = 0;
+    size_t bad = 0;
+    auto on_record = [&](const sltj::ShmLogRing::Record &r) {
+        int t = -1, seq = -1;
+        std::string content(r.content, r.contentLen);
+        if (sscanf(content.c_str(), "writer %d seq %d", &t, &seq) != 2 || t < 0 || t >= kThreads ||
+            seq <= last[t] || r.name != "shm" || r.threadName != "shm_w" + std::to_string(t) ||
+            r.level != sltj::LogLevel::INFO || r.file.find("test_shm_log.cc") == std::string::npos)
+        {
+            ++bad;
+            return;
+        }
+        last[t] = seq;
+        ++received;
+    };
+    uint64_t deadline = sltj::GetCurrentMS() + 10000;
+    while (received + reader->getDropped() < (size_t)kThreads * kLines && sltj::GetCurrentMS() < deadline)
+    {
+        if (!reader->read(on_record))
+        {
+            usleep(100);
+        }
+    }
+    for (auto &i : threads)
+    {
+        i->join();
+    }
+    reader->read(on_record);
+    CHECK(received + reader->getDropped() == (size_t)kThreads * kLines && bad == 0,
+          received << " dropped=" << reader->getDropped() << " bad=" << bad);
+    CHECK(!reader->hasPending(), "drained");
+
+    CHECK(!reader->isClosed() && !reader->isAbandoned(), "writer alive");
+    logger.reset();
+    shm.reset();
+    CHECK(reader->isClosed() && reader->isAbandoned(), "writer closed");
+    reader->unlink();
+}
+
+// 没有读者时写满即丢弃, 不阻塞
+void test_overflow()
+{
+    sltj::ShmLogAppender::ptr shm(new sltj::ShmLogAppender("shmfull", 4096));
+    sltj::Logger::ptr logger(new sltj::Logger("shm"));
+    logger->addAppender(shm);
+    sltj::Counter::ptr dropped = sltj::Metrics::Lookup<sltj::Counter>("log.shm.dropped");
+    uint64_t before = dropped->getValue();
+    for (int i = 0; i < 1000; ++i)
+    {
+        SLTJ_LOG_INFO(logger) << "overflow " << i;
+    }
+    CHECK(shm->getDropped() > 900, shm->getDropped());
+    CHECK(dropped->getValue() - before == shm->getDropped(), dropped->getValue() - before);
+    shm->getRing()->unlink();
+}
+
+// 子进程写完后崩溃, sltj_logd仍读出全部记录, 按大小滚动, 并删除环
+void test_crash_and_logd()
+{
+    const int kLines = 12000;
+    system(("rm -rf " + s_out_dir).c_str());
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        sltj::ShmLogAppender::ptr shm(new sltj::ShmLogAppender("shmcrash", 8 * 1024 * 1024));
+        sltj::Logger::ptr logger(new sltj::Logger("child"));
+        logger->addAppender(shm);
+        for (int i = 0; i < kLines; ++i)
+        {
+            SLTJ_LOG_WARN(logger) << "crash line " << i << " padding to make the record a bit longer";
+        }
+        signal(SIGABRT, SIG_DFL);
+        abort();
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT, status);
+    std::string prefix = std::string(sltj::ShmLogRing::kPrefix) + "shmcrash." + std::to_string(pid) + ".";
+    CHECK(count_rings(prefix) == 1, "ring survives crash");
+
+    CHECK(run_logd({"-1", "-o", s_out_dir, "-s", "1", "-n", "3"}) == 0, "sltj_logd");
+    std::string all = read_file(s_out_dir + "/shmcrash.log.1") + read_file(s_out_dir + "/shmcrash.log");
+    CHECK(count(all, "crash line ") == (size_t)kLines, count(all, "crash line "));
+    CHECK(count(all, "crash line 11999 padding") == 1, "last line");
+    CHECK(count(all, "[WARN]") == (size_t)kLines && count(all, "[child]") == (size_t)kLines, "formatted");
+    CHECK(access((s_out_dir + "/shmcrash.log.1").c_str(), F_OK) == 0, "rotated");
+    CHECK(count_rings(prefix) == 0, "ring removed");
+    system(("rm -rf " + s_out_dir).c_str());
+}
+
+static sem_t s_stuck;
+
+// 模拟写线程死在预留之后、提交之前: 出错的线程挂起不再返回
+static void stuck_handler(int)
+{
+    sem_post(&s_stuck);
+    for (;;)
+    {
+        pause();
+    }
+}
+
+// 一个写线程预留空间后死掉, 其他线程之后提交的记录仍由sltj_logd读出
+void test_stuck_writer()
+{
+    const int kAfter = 100;
+    system(("rm -rf " + s_out_dir).c_str());
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        sltj::ShmLogAppender::ptr shm(new sltj::ShmLogAppender("shmstuck", 1024 * 1024));
+        sltj::Logger::ptr logger(new sltj::Logger("child"));
+        logger->addAppender(shm);
+        SLTJ_LOG_INFO(logger) << "stuck before";
+
+        sem_init(&s_stuck, 0, 0);
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = &stuck_handler;
+        sigaction(SIGSEGV, &sa, nullptr);
+        // 线程名足够长, 内容单独mmap; 设为不可读后, 写入在预留之后拷贝线程名时出错
+        sltj::LogEvent::ptr event(new sltj::LogEvent(logger, sltj::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0,
+                                                     time(0), std::string(256 * 1024, 't')));
+        event->getSS() << "stuck record";
+        uintptr_t page = (uintptr_t)event->getThreadName().data() & ~(uintptr_t)(getpagesize() - 1);
+        sltj::Thread t([shm, event, page]() {
+            mprotect((void *)page, getpagesize() * 2, PROT_NONE);
+            sltj::LogEvent::ptr e = event;
+            shm->getRing()->write(sltj::LogLevel::INFO, e);
+        }, "shm_stuck");
+        sem_wait(&s_stuck);
+        for (int i = 0; i < kAfter; ++i)
+        {
+            SLTJ_LOG_INFO(logger) << "stuck after " << i;
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, status);
+    std::string prefix = std::string(sltj::ShmLogRing::kPrefix) + "shmstuck." + std::to_string(pid) + ".";
+    CHECK(count_rings(prefix) == 1, "ring survives");
+
+    CHECK(run_logd({"-1", "-o", s_out_dir}) == 0, "sltj_logd");
+    std::string all = read_file(s_out_dir + "/shmstuck.log");
+    CHECK(count(all, "stuck before") == 1, all);
+    CHECK(count(all, "stuck after ") == (size_t)kAfter, count(all, "stuck after "));
+    CHECK(count(all, "stuck record") == 0, "uncommitted record");
+    CHECK(count_rings(prefix) == 0, "ring removed");
+    system(("rm -rf " + s_out_dir).c_str());
+}
+
+// 每条记录的开销, 与同步写文件比较
+void bench()
+{
+    const int N = 200000;
+    sltj::ShmLogAppender::ptr shm(new sltj::ShmLogAppender("shmbench", 64 * 1024 * 1024));
+    sltj::Logger::ptr logger(new sltj::Logger("shm_bench"));
+    logger->addAppender(shm);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_INFO(logger) << "bench line " << i;
+    }
+    double shm_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+    CHECK(shm->getDropped() == 0, shm->getDropped());
+    shm->getRing()->unlink();
+
+    std::string path = "/tmp/sltj_test_shm_log.file";
+    sltj::FileLogAppender::ptr file(new sltj::FileLogAppender(path));
+    file->reopen();
+    sltj::Logger::ptr file_logger(new sltj::Logger("file_bench"));
+    file_logger->addAppender(file);
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        SLTJ_LOG_INFO(file_logger) << "bench line " << i;
+    }
+    file->flush();
+    double file_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / N;
+    unlink(path.c_str());
+    SLTJ_LOG_INFO(g_logger) << "ns per record shm=" << shm_ns << " file=" << file_ns << " (file formats in process)";
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    std::string self = argv[0];
+    size_t pos = self.rfind('/');
+    s_logd = (pos == std::string::npos ? std::string(".") : self.substr(0, pos)) + "/sltj_logd";
+
+    test_ring();
+    test_overflow();
+    test_crash_and_logd();
+    test_stuck_writer();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
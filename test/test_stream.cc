@@ -0,0 +1,288 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const std::string s_dir = "/tmp/sltj_test_stream";
+
+static std::string random_data(size_t len)
+{
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        data[i] = (char)(rand() & 0xff);
+    }
+    return data;
+}
+
+static bool write_file(const std::string &path, const std::string &data)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = ::write(fd, data.data(), data.size()) == (ssize_t)data.size();
+    ::close(fd);
+    return ok;
+}
+
+// 建立一对回环连接
+static bool socket_pair(sltj::SocketStream::ptr &a, sltj::SocketStream::ptr &b)
+{
+    sltj::Socket::ptr listener = sltj::Socket::CreateTCPSocket();
+    if (!listener->bind(sltj::Address::LookupAny("127.0.0.1:0")) || !listener->listen())
+    {
+        return false;
+    }
+    sltj::Socket::ptr client = sltj::Socket::CreateTCPSocket();
+    if (!client->connect(listener->getLocalAddress(), 3000))
+    {
+        return false;
+    }
+    listener->setRecvTimeout(3000);
+    sltj::Socket::ptr server = listener->accept();
+    if (!server)
+    {
+        return false;
+    }
+    a.reset(new sltj::SocketStream(client));
+    b.reset(new sltj::SocketStream(server));
+    return true;
+}
+
+void test_bytearray_stream()
+{
+    sltj::SocketStream::ptr a, b;
+    CHECK(socket_pair(a, b), "socket pair");
+    if (!a)
+    {
+        return;
+    }
+
+    const size_t N = 100000;
+    sltj::ByteArray::ptr out(new sltj::ByteArray(1000));
+    for (size_t i = 0; i < N; ++i)
+    {
+        out->writeFuint32(i);
+    }
+    out->setPosition(0);
+    size_t total = out->getReadSize();
+
+    // 写端在另一个线程, 避免双方都阻塞在socket缓冲区上
+    sltj::Thread writer([a, out, total]() {
+        CHECK(a->writeFixSize(out, total) == (int)total, "write");
+    }, "writer");
+
+    sltj::ByteArray::ptr in(new sltj::ByteArray(777));
+    CHECK(b->readFixSize(in, total) == (int)total, "read");
+    writer.join();
+
+    in->setPosition(0);
+    bool same = true;
+    for (size_t i = 0; i < N && same; ++i)
+    {
+        same = in->readFuint32() == i;
+    }
+    CHECK(same, "bytearray content");
+    CHECK(out->getReadSize() == 0, out->getReadSize());
+
+    // 没有数据可发、长度为0时不构造iovec, 直接返回0
+    CHECK(a->write(out, 100) == 0, "write empty");
+    CHECK(b->read(in, 0) == 0, "read 0");
+
+    a->close();
+    char c;
+    CHECK(b->read(&c, 1) == 0, "peer closed");
+}
+
+void test_sendfile()
+{
+    std::string data = random_data(1 << 20);
+    std::string path = s_dir + "/sendfile.bin";
+    CHECK(write_file(path, data), path);
+
+    sltj::SocketStream::ptr a, b;
+    CHECK(socket_pair(a, b), "socket pair");
+    if (!a)
+    {
+        return;
+    }
+
+    const uint64_t off = 1000;
+    const uint64_t len = 500000;
+    sltj::Thread sender([a, path, off, len]() {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        CHECK(a->sendFile(fd, off, len) == (int64_t)len, "sendfile");
+        ::close(fd);
+    }, "sender");
+
+    std::string recv(len, '\0');
+    CHECK(b->readFixSize(&recv[0], len) == (int)len, "read");
+    sender.join();
+    CHECK(recv == data.substr(off, len), "sendfile content");
+}
+
+void test_static_file()
+{
+    std::string data = random_data(300000);
+    CHECK(write_file(s_dir + "/a.txt", data), "write a.txt");
+    CHECK(write_file(s_dir + "/index.html", "<html></html>"), "write index");
+
+    sltj::IOManager io_worker(2, "io");
+    sltj::IOManager accept_worker(1, "accept");
+    {
+        sltj::HttpServer::ptr server(new sltj::HttpServer(true, &io_worker, &accept_worker));
+        server->getServletDispatch()->addGlobServlet(
+            "/static/*", sltj::Servlet::ptr(new sltj::StaticFileServlet(s_dir, "/static")));
+        CHECK(server->bind(sltj::Address::LookupAny("127.0.0.1:0")), "bind");
+        CHECK(server->start(), "start");
+        uint16_t port = std::dynamic_pointer_cast<sltj::IPAddress>(
+                            server->getSocks()[0]->getLocalAddress())->getPort();
+
+        sltj::IOManager iom(1, "client");
+        iom.schedule([port, data]() {
+            sltj::HttpConnectionPool::ptr pool(new sltj::HttpConnectionPool(
+                "127.0.0.1", "", port, 1, 60000, 0));
+            sltj::HttpResult::ptr r = pool->doGet("/static/a.txt", 3000);
+            CHECK(r->response && r->response->getBody() == data, r->error);
+            CHECK(r->response && r->response->getHeader("content-type") == "text/plain", "content-type");
+
+            // 同一连接上继续请求, 文件body之后连接状态正常
+            r = pool->doGet("/static/", 3000);
+            CHECK(r->response && r->response->getBody() == "<html></html>", r->error);
+            CHECK(pool->getStats().miss == 1, pool->getStats().miss);
+
+            r = pool->doGet("/static/none.txt", 3000);
+            CHECK(r->response && r->response->getStatus() == sltj::HttpStatus::NOT_FOUND, "404");
+            r = pool->doGet("/static/../etc/passwd", 3000);
+            CHECK(r->response && r->response->getStatus() == sltj::HttpStatus::FORBIDDEN, "403");
+        });
+        iom.stop();
+        server->stop();
+    }
+    accept_worker.stop();
+    io_worker.stop();
+}
+
+// 文件服务: 客户端发1字节选择方式, 服务端把整个文件发回
+class FileServer : public sltj::TcpServer
+{
+public:
+    FileServer(sltj::IOManager *io_worker, sltj::IOManager *accept_worker, const std::string &path)
+        : sltj::TcpServer(io_worker, accept_worker), m_path(path)
+    {
+    }
+
+protected:
+    void handleClient(sltj::Socket::ptr client) override
+    {
+        sltj::SocketStream stream(client);
+        char mode;
+        while (stream.read(&mode, 1) == 1)
+        {
+            int fd = ::open(m_path.c_str(), O_RDONLY);
+            off_t size = lseek(fd, 0, SEEK_END);
+            if (mode == 's')
+            {
+                stream.sendFile(fd, 0, size);
+            }
+            else
+            {
+                // read+write: 经用户态缓冲区拷贝
+                std::vector<char> buf(64 * 1024);
+                lseek(fd, 0, SEEK_SET);
+                ssize_t n;
+                while ((n = ::read(fd, &buf[0], buf.size())) > 0)
+                {
+                    if (stream.writeFixSize(&buf[0], n) != n)
+                    {
+                        break;
+                    }
+                }
+            }
+            ::close(fd);
+        }
+    }
+
+private:
+    std::string m_path;
+};
+
+void bench()
+{
+    const size_t FILE_SIZE = 64 << 20;
+    const int ROUNDS = 4;
+    std::string path = s_dir + "/bench.bin";
+    CHECK(write_file(path, random_data(FILE_SIZE)), path);
+
+    sltj::IOManager io_worker(1, "io");
+    sltj::IOManager accept_worker(1, "accept");
+    {
+        std::shared_ptr<FileServer> server(new FileServer(&io_worker, &accept_worker, path));
+        CHECK(server->bind(sltj::Address::LookupAny("127.0.0.1:0")), "bind");
+        CHECK(server->start(), "start");
+        sltj::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+        const char modes[] = {'c', 's'};
+        for (char mode : modes)
+        {
+            sltj::Socket::ptr sock = sltj::Socket::CreateTCP(addr);
+            CHECK(sock->connect(addr, 3000), "connect");
+            sock->setRecvTimeout(10000);
+            std::vector<char> buf(256 * 1024);
+
+            auto t0 = std::chrono::steady_clock::now();
+            size_t total = 0;
+            for (int r = 0; r < ROUNDS; ++r)
+            {
+                sock->send(&mode, 1);
+                size_t got = 0;
+                while (got < FILE_SIZE)
+                {
+                    int n = sock->recv(&buf[0], std::min(buf.size(), FILE_SIZE - got));
+                    if (n <= 0)
+                    {
+                        break;
+                    }
+                    got += n;
+                }
+                CHECK(got == FILE_SIZE, got);
+                total += got;
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            double sec = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1e6;
+            SLTJ_LOG_INFO(g_logger) << (mode == 's' ? "sendfile" : "read+write")
+                                    << " " << (uint64_t)(total / sec / (1 << 20)) << " MB/s";
+            sock->close();
+        }
+        server->stop();
+    }
+    accept_worker.stop();
+    io_worker.stop();
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+    mkdir(s_dir.c_str(), 0755);
+
+    test_bytearray_stream();
+    test_sendfile();
+    test_static_file();
+    bench();
+
+    const char *files[] = {"sendfile.bin", "a.txt", "index.html", "bench.bin"};
+    for (auto f : files)
+    {
+        unlink((s_dir + "/" + f).c_str());
+    }
+    rmdir(s_dir.c_str());
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+// 回显服务: 收到什么发回什么, 对端关闭时退出
+class EchoServer : public sltj::TcpServer
+{
+public:
+    EchoServer(sltj::IOManager *io_worker, sltj::IOManager *accept_worker)
+        : sltj::TcpServer(io_worker, accept_worker)
+    {
+    }
+
+protected:
+    void handleClient(sltj::Socket::ptr client) override
+    {
+        char buf[4096];
+        while (true)
+        {
+            int n = client->recv(buf, sizeof(buf));
+            if (n <= 0)
+            {
+                break;
+            }
+            int off = 0;
+            while (off < n)
+            {
+                int rt = client->send(buf + off, n - off);
+                if (rt <= 0)
+                {
+                    client->close();
+                    return;
+                }
+                off += rt;
+            }
+        }
+        client->close();
+    }
+};
+
+static const size_t CLIENTS = 8;
+static const size_t CONNECTS_PER_CLIENT = 200;
+static const size_t REQUESTS_PER_CLIENT = 2000;
+static const size_t MSG_SIZE = 64;
+
+static std::atomic<uint64_t> s_connects{0};
+static std::atomic<uint64_t> s_requests{0};
+static std::atomic<uint64_t> s_errors{0};
+
+// 短连接: connect后立即close
+void connect_client(sltj::Address::ptr addr)
+{
+    for (size_t i = 0; i < CONNECTS_PER_CLIENT; ++i)
+    {
+        sltj::Socket::ptr sock = sltj::Socket::CreateTCP(addr);
+        if (!sock->connect(addr, 3000))
+        {
+            ++s_errors;
+            continue;
+        }
+        ++s_connects;
+        sock->close();
+    }
+}
+
+// 长连接: 一来一回的请求
+void request_client(sltj::Address::ptr addr)
+{
+    sltj::Socket::ptr sock = sltj::Socket::CreateTCP(addr);
+    if (!sock->connect(addr, 3000))
+    {
+        ++s_errors;
+        return;
+    }
+    sock->setTcpNoDelay(true);
+    sock->setRecvTimeout(3000);
+
+    char req[MSG_SIZE];
+    char rsp[MSG_SIZE];
+    memset(req, 'x', sizeof(req));
+    for (size_t i = 0; i < REQUESTS_PER_CLIENT; ++i)
+    {
+        if (sock->send(req, sizeof(req)) != (int)sizeof(req))
+        {
+            ++s_errors;
+            break;
+        }
+        size_t got = 0;
+        while (got < sizeof(rsp))
+        {
+            int n = sock->recv(rsp + got, sizeof(rsp) - got);
+            if (n <= 0)
+            {
+                break;
+            }
+            got += n;
+        }
+        if (got != sizeof(rsp) || memcmp(req, rsp, sizeof(req)))
+        {
+            ++s_errors;
+            break;
+        }
+        ++s_requests;
+    }
+    sock->close();
+}
+
+// 在客户端调度器上跑CLIENTS个协程, 返回耗时(秒)
+double run_clients(void (*fun)(sltj::Address::ptr), sltj::Address::ptr addr)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        sltj::IOManager client_iom(2, "client");
+        for (size_t i = 0; i < CLIENTS; ++i)
+        {
+            client_iom.schedule(std::bind(fun, addr));
+        }
+        client_iom.stop();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1e6;
+}
+
+void bench(size_t io_threads)
+{
+    s_connects = 0;
+    s_requests = 0;
+    s_errors = 0;
+
+    sltj::IOManager io_worker(io_threads, "io");
+    sltj::IOManager accept_worker(2, "accept");
+    {
+        std::shared_ptr<EchoServer> server(new EchoServer(&io_worker, &accept_worker));
+        CHECK(server->bind(sltj::Address::LookupAny("127.0.0.1:0")), "bind");
+        // 每个accept线程一个SO_REUSEPORT监听socket
+        CHECK(server->getSocks().size() == 2, server->getSocks().size());
+        CHECK(server->start(), "start");
+
+        sltj::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+        double conn_sec = run_clients(&connect_client, addr);
+        double req_sec = run_clients(&request_client, addr);
+
+        CHECK(s_connects == CLIENTS * CONNECTS_PER_CLIENT, s_connects);
+        CHECK(s_requests == CLIENTS * REQUESTS_PER_CLIENT, s_requests);
+        CHECK(s_errors == 0, s_errors);
+
+        SLTJ_LOG_INFO(g_logger) << "io_threads=" << io_threads
+                                << " connections/s=" << (uint64_t)(s_connects / conn_sec)
+                                << " req/s=" << (uint64_t)(s_requests / req_sec);
+        server->stop();
+    }
+    accept_worker.stop();
+    io_worker.stop();
+}
+
+void test_config_bind()
+{
+    // 按配置项绑定, 端口0由内核分配
+    sltj::Config::Lookup<std::string>("tcp_server.address")->setValue("127.0.0.1:0");
+    sltj::IOManager io_worker(1, "io");
+    sltj::IOManager accept_worker(1, "accept");
+    {
+        std::shared_ptr<EchoServer> server(new EchoServer(&io_worker, &accept_worker));
+        CHECK(server->bind(), "config bind");
+        CHECK(server->getSocks().size() == 1, server->getSocks().size());
+        CHECK(server->getRecvTimeout() == sltj::Config::Lookup<uint64_t>("tcp_server.read_timeout")->getValue(),
+              server->getRecvTimeout());
+        server->start();
+        server->stop();
+    }
+    accept_worker.stop();
+    io_worker.stop();
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_config_bind();
+    size_t threads[] = {1, 2, 4};
+    for (size_t n : threads)
+    {
+        bench(n);
+    }
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
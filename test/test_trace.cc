@@ -0,0 +1,189 @@
+#include "../src/sltj.h"
+#include "test_check.h"
+#include <chrono>
+#include <fstream>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static const std::string s_path = "/tmp/sltj_test_trace.json";
+
+static uint64_t counter(const std::string &name)
+{
+    return sltj::Metrics::Lookup<sltj::Counter>(name)->getValue();
+}
+
+static size_t count(const std::string &str, const std::string &sub)
+{
+    size_t n = 0;
+    for (size_t pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1))
+    {
+        ++n;
+    }
+    return n;
+}
+
+void work()
+{
+    SLTJ_TRACE_SCOPE("test.work");
+    usleep(100);
+    {
+        SLTJ_TRACE_SCOPE("test.inner");
+    }
+}
+
+void test_trace_file()
+{
+    CHECK(!sltj::Tracer::IsEnabled(), "default off");
+    // 关闭时不记录
+    work();
+    CHECK(counter("trace.events") == 0 && counter("trace.dropped") == 0, "recorded while off");
+
+    CHECK(sltj::Tracer::Start(s_path), s_path);
+    CHECK(!sltj::Tracer::Start(s_path), "start twice");
+    sltj::Tracer::SetEnabled(true);
+    {
+        sltj::IOManager iom(2, "trace_io");
+        for (int i = 0; i < 100; ++i)
+        {
+            iom.schedule(&work);
+        }
+        iom.schedule([]() { SLTJ_LOG_INFO(g_logger) << "log inside trace"; });
+        iom.addTimer(10, []() {});
+        usleep(50 * 1000);
+        iom.stop();
+    }
+    sltj::Tracer::SetEnabled(false);
+    sltj::Tracer::Stop();
+
+    std::ifstream ifs(s_path);
+    std::string json((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    CHECK(json.compare(0, 2, "[\n") == 0 && json.compare(json.size() - 3, 3, "\n]\n") == 0, "array format");
+    CHECK(count(json, "{") == count(json, "}"), "braces");
+    CHECK(count(json, "\"name\":\"test.work\"") == 100, count(json, "\"name\":\"test.work\""));
+    CHECK(count(json, "\"name\":\"test.inner\"") == 100, "inner");
+    CHECK(count(json, "\"name\":\"Scheduler::callback\"") >= 101, "scheduler");
+    CHECK(json.find("\"name\":\"IOManager::epoll_wait\"") != std::string::npos, "epoll_wait");
+    CHECK(json.find("\"name\":\"IOManager::timers\"") != std::string::npos, "timers");
+    CHECK(json.find("\"name\":\"Logger::log\"") != std::string::npos, "logger");
+    CHECK(json.find("\"args\":{\"name\":\"trace_io_0\"}") != std::string::npos, "thread name");
+    CHECK(counter("trace.events") == count(json, "\"ph\":\"X\""), counter("trace.events"));
+
+    // 关闭后不再记录
+    uint64_t events = counter("trace.events");
+    work();
+    sltj::Tracer::Flush();
+    CHECK(counter("trace.events") == events, "recorded after disable");
+    unlink(s_path.c_str());
+}
+
+void test_config_toggle()
+{
+    sltj::ConfigVar<bool>::ptr enable = sltj::Config::Lookup<bool>("trace.enable");
+    CHECK(enable && !enable->getValue(), "config");
+    CHECK(sltj::Tracer::Start(s_path), s_path);
+    // 配置变化时立即生效
+    enable->setValue(true);
+    CHECK(sltj::Tracer::IsEnabled(), "enabled by config");
+    enable->setValue(false);
+    CHECK(!sltj::Tracer::IsEnabled(), "disabled by config");
+    // SetEnabled不写回配置, 后台线程也不会按配置改回去
+    sltj::Tracer::SetEnabled(true);
+    usleep(300 * 1000);
+    CHECK(sltj::Tracer::IsEnabled() && !enable->getValue(), "SetEnabled kept");
+    sltj::Tracer::SetEnabled(false);
+    sltj::Tracer::Stop();
+    unlink(s_path.c_str());
+}
+
+// 打开开关但未启动时, 已退出线程的缓冲不会一直留着
+void test_unstarted()
+{
+    sltj::Gauge::ptr buffers = sltj::Metrics::Lookup<sltj::Gauge>("trace.buffers");
+    int64_t before = buffers->getValue();
+    sltj::Tracer::SetEnabled(true);
+    for (int i = 0; i < 50; ++i)
+    {
+        sltj::Thread t([]() { SLTJ_TRACE_SCOPE("test.unstarted"); }, "unstarted");
+        t.join();
+    }
+    CHECK(buffers->getValue() == before, buffers->getValue() << " before=" << before);
+    // 当前线程的缓冲仍在, Flush丢弃其中的事件
+    {
+        SLTJ_TRACE_SCOPE("test.unstarted");
+    }
+    uint64_t dropped = counter("trace.dropped");
+    sltj::Tracer::Flush();
+    CHECK(counter("trace.dropped") - dropped == 1, counter("trace.dropped") - dropped);
+    sltj::Tracer::SetEnabled(false);
+}
+
+void test_dropped()
+{
+    // 未启动后台线程时队列写满即丢弃
+    sltj::Config::Lookup<uint32_t>("trace.buffer_size")->setValue(16);
+    sltj::Tracer::SetEnabled(true);
+    uint64_t dropped = counter("trace.dropped");
+    uint64_t full = 0;
+    sltj::Thread t([&full, dropped]() {
+        for (int i = 0; i < 100; ++i)
+        {
+            SLTJ_TRACE_SCOPE("test.drop");
+        }
+        full = counter("trace.dropped") - dropped;
+    }, "drop");
+    t.join();
+    sltj::Tracer::SetEnabled(false);
+    CHECK(full == 100 - 16, full);
+    // 线程退出时队列中剩下的事件也随缓冲一起丢弃
+    CHECK(counter("trace.dropped") - dropped == 100, counter("trace.dropped") - dropped);
+    sltj::Config::Lookup<uint32_t>("trace.buffer_size")->setValue(16384);
+}
+
+static double bench_scope(int loops)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < loops; ++i)
+    {
+        SLTJ_TRACE_SCOPE("test.bench");
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)loops;
+}
+
+void bench()
+{
+    const int LOOPS = 10000000;
+    double off = bench_scope(LOOPS);
+
+    CHECK(sltj::Tracer::Start(s_path), s_path);
+    sltj::Tracer::SetEnabled(true);
+    // 每次不超过队列容量, 之间等后台线程取走
+    double on = 0;
+    const int BATCH = 8192;
+    for (int i = 0; i < 20; ++i)
+    {
+        on += bench_scope(BATCH);
+        sltj::Tracer::Flush();
+    }
+    on /= 20;
+    sltj::Tracer::SetEnabled(false);
+    sltj::Tracer::Stop();
+    unlink(s_path.c_str());
+
+    SLTJ_LOG_INFO(g_logger) << "SLTJ_TRACE_SCOPE off: " << off << " ns, on: " << on << " ns";
+}
+
+int main(int argc, char **argv)
+{
+    g_logger->setLevel(sltj::LogLevel::INFO);
+
+    test_trace_file();
+    test_config_toggle();
+    test_unstarted();
+    test_dropped();
+    bench();
+
+    SLTJ_LOG_INFO(g_logger) << (s_ok ? "all passed" : "FAILED");
+    return s_ok ? 0 : 1;
+}
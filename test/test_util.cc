@@ -0,0 +1,62 @@
+#include "../src/sltj.h"
+#include <chrono>
+
+// 对比每次gettid系统调用与thread_local缓存的开销,
+// 以及一条被appender等级过滤掉的日志在两种取值方式下的单次耗时
+
+static const int N = 1000000;
+
+// 旧版宏:每条日志都发起gettid系统调用
+#define OLD_LOG_LEVEL(logger, level)                                                                 \
+    if (logger->getLevel() <= level)                                                                 \
+    sltj::LogEventWrap(sltj::LogEvent::ptr(new sltj::LogEvent(logger, level, __FILE__, __LINE__, 0,  \
+                                                              syscall(SYS_gettid), 0, time(0),       \
+                                                              std::string("UNKNOW"))))               \
+        .getSS()
+
+template <class F>
+static double bench(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i)
+    {
+        f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (double)N;
+}
+
+static volatile pid_t s_sink = 0;
+
+void run()
+{
+    sltj::Logger::ptr logger(new sltj::Logger("bench"));
+    sltj::LogAppender::ptr appender(new sltj::StdoutLogAppender());
+    appender->setLevel(sltj::LogLevel::ERROR); // 事件全部在appender处被过滤
+    logger->addAppender(appender);
+
+    double syscall_ns = bench([](int) { s_sink = syscall(SYS_gettid); });
+    double cached_ns = bench([](int) { s_sink = sltj::GetThreadId(); });
+    double old_log_ns = bench([&](int i) { OLD_LOG_LEVEL(logger, sltj::LogLevel::DEBUG) << i; });
+    double new_log_ns = bench([&](int i) { SLTJ_LOG_DEBUG(logger) << i; });
+
+    SLTJ_LOG_INFO(SLTJ_LOG_ROOT()) << "thread=" << sltj::Thread::GetName() << " id=" << sltj::GetThreadId()
+                                   << " syscall(SYS_gettid)=" << syscall_ns << "ns GetThreadId()=" << cached_ns << "ns";
+    SLTJ_LOG_INFO(SLTJ_LOG_ROOT()) << "thread=" << sltj::Thread::GetName()
+                                   << " filtered log: old=" << old_log_ns << "ns new=" << new_log_ns
+                                   << "ns saved=" << old_log_ns - new_log_ns << "ns/call";
+}
+
+int main(int argc, char **argv)
+{
+    if (sltj::GetThreadId() != syscall(SYS_gettid))
+    {
+        SLTJ_LOG_ERROR(SLTJ_LOG_ROOT()) << "cached thread id mismatch";
+        return 1;
+    }
+    run();
+
+    sltj::Thread::ptr thr(new sltj::Thread(run, "bench_thread"));
+    thr->join();
+    return 0;
+}
@@ -0,0 +1,227 @@
+// 日志守护进程: 读取各应用进程的共享内存日志环(ShmLogAppender), 格式化后写到 <dir>/<app>.log 并按大小滚动
+//   sltj_logd [-o dir] [-p pattern] [-s max_size_mb] [-n max_files] [-i interval_ms] [-1]
+// -1 只读一轮就退出, 用于测试和手工补收崩溃进程留下的环
+#include "../src/sltj.h"
+#include <dirent.h>
+#include <fstream>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static sltj::Logger::ptr g_logger = SLTJ_LOG_ROOT();
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void OnStop(int)
+{
+    s_stop = 1;
+}
+
+class LogDaemon
+{
+public:
+    LogDaemon(const std::string &dir, const std::string &pattern, uint64_t max_size, int max_files)
+        : m_dir(dir), m_maxSize(max_size), m_maxFiles(max_files),
+          m_formatter(new sltj::LogFormatter(pattern))
+    {
+    }
+
+    // 发现新的环
+    void scan()
+    {
+        DIR *dir = opendir("/dev/shm");
+        if (!dir)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "opendir /dev/shm errno=" << errno << " errstr=" << strerror(errno);
+            return;
+        }
+        size_t prefix = strlen(sltj::ShmLogRing::kPrefix);
+        while (struct dirent *ent = readdir(dir))
+        {
+            std::string name = ent->d_name;
+            if (name.compare(0, prefix, sltj::ShmLogRing::kPrefix) || m_rings.count(name))
+            {
+                continue;
+            }
+            sltj::ShmLogRing::ptr ring = sltj::ShmLogRing::Open(name);
+            if (ring)
+            {
+                SLTJ_LOG_INFO(g_logger) << "attach " << name << " app=" << ring->getApp() << " pid=" << ring->getPid()
+                                        << " capacity=" << ring->getCapacity();
+                m_rings[name] = ring;
+            }
+        }
+        closedir(dir);
+    }
+
+    // 读出所有环中的记录, 返回条数; 写者已退出的环读完后删除
+    size_t drain()
+    {
+        size_t total = 0;
+        for (auto it = m_rings.begin(); it != m_rings.end();)
+        {
+            sltj::ShmLogRing::ptr ring = it->second;
+            Output &out = getOutput(ring->getApp());
+            total += ring->read([this, &out](const sltj::ShmLogRing::Record &r) { write(out, r); });
+            // 先判断再读一次, 写者退出前提交的记录不会漏掉; 写者已退出时read跳过未提交的记录
+            if (ring->isAbandoned())
+            {
+                total += ring->read([this, &out](const sltj::ShmLogRing::Record &r) { write(out, r); });
+                SLTJ_LOG_INFO(g_logger) << "detach " << it->first << " dropped=" << ring->getDropped()
+                                        << (ring->hasPending() ? " (incomplete record lost)" : "");
+                ring->unlink();
+                it = m_rings.erase(it);
+                continue;
+            }
+            ++it;
+        }
+        for (auto &i : m_outputs)
+        {
+            i.second.ofs.flush();
+        }
+        return total;
+    }
+
+private:
+    struct Output
+    {
+        std::string path;
+        std::ofstream ofs;
+        uint64_t size = 0;
+    };
+
+    Output &getOutput(const std::string &app)
+    {
+        Output &out = m_outputs[app];
+        if (out.path.empty())
+        {
+            out.path = m_dir + "/" + (app.empty() ? "unknown" : app) + ".log";
+            open(out);
+        }
+        return out;
+    }
+
+    void open(Output &out)
+    {
+        out.ofs.open(out.path, std::ios::app);
+        if (!out.ofs)
+        {
+            SLTJ_LOG_ERROR(g_logger) << "open " << out.path << " failed errno=" << errno << " errstr=" << strerror(errno);
+        }
+        struct stat st;
+        out.size = stat(out.path.c_str(), &st) ? 0 : st.st_size;
+    }
+
+    // app.log -> app.log.1 -> ... -> app.log.N
+    void rotate(Output &out)
+    {
+        out.ofs.close();
+        for (int i = m_maxFiles - 1; i >= 1; --i)
+        {
+            rename((out.path + "." + std::to_string(i)).c_str(), (out.path + "." + std::to_string(i + 1)).c_str());
+        }
+        if (m_maxFiles > 0)
+        {
+            rename(out.path.c_str(), (out.path + ".1").c_str());
+        }
+        else
+        {
+            unlink(out.path.c_str());
+        }
+        open(out);
+    }
+
+    void write(Output &out, const sltj::ShmLogRing::Record &r)
+    {
+        sltj::Logger::ptr &logger = m_loggers[r.name];
+        if (!logger)
+        {
+            logger.reset(new sltj::Logger(r.name));
+        }
+        sltj::LogEvent::ptr event(new sltj::LogEvent(logger, r.level, r.file.c_str(), r.line, r.elapse,
+                                                     r.threadId, r.fiberId, r.time, r.threadName));
+        std::stringstream &&ss = event->getSS();
+        ss.write(r.content, r.contentLen);
+        std::string str = m_formatter->format(r.level, event);
+        if (m_maxSize && out.size && out.size + str.size() > m_maxSize)
+        {
+            rotate(out);
+        }
+        out.ofs << str;
+        out.size += str.size();
+    }
+
+private:
+    std::string m_dir;
+    uint64_t m_maxSize;
+    int m_maxFiles;
+    sltj::LogFormatter::ptr m_formatter;
+    std::map<std::string, sltj::ShmLogRing::ptr> m_rings;
+    std::map<std::string, Output> m_outputs;
+    std::map<std::string, sltj::Logger::ptr> m_loggers;
+};
+
+int main(int argc, char **argv)
+{
+    std::string dir = ".";
+    std::string pattern = "%d{%Y-%m-%d %H:%M:%S} %T%t %T%F%T [%p] %T [%N] %T %f %l %T %m %n";
+    uint64_t max_size = 100;
+    int max_files = 10;
+    uint64_t interval = 10;
+    bool once = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:p:s:n:i:1h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'o':
+            dir = optarg;
+            break;
+        case 'p':
+            pattern = optarg;
+            break;
+        case 's':
+            max_size = strtoull(optarg, nullptr, 10);
+            break;
+        case 'n':
+            max_files = atoi(optarg);
+            break;
+        case 'i':
+            interval = strtoull(optarg, nullptr, 10);
+            break;
+        case '1':
+            once = true;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-o dir] [-p pattern] [-s max_size_mb] [-n max_files] [-i interval_ms] [-1]" << std::endl;
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    mkdir(dir.c_str(), 0755);
+    signal(SIGINT, OnStop);
+    signal(SIGTERM, OnStop);
+
+    LogDaemon daemon(dir, pattern, max_size * 1024 * 1024, max_files);
+    uint64_t last_scan = 0;
+    while (!s_stop)
+    {
+        uint64_t now = sltj::GetCurrentMS();
+        if (once || now - last_scan >= 1000)
+        {
+            daemon.scan();
+            last_scan = now;
+        }
+        size_t n = daemon.drain();
+        if (once)
+        {
+            break;
+        }
+        if (!n)
+        {
+            usleep(interval * 1000);
+        }
+    }
+    daemon.drain();
+    return 0;
+}
@@ -0,0 +1,104 @@
+// 日志查询: 用FileLogAppender写的稀疏索引(<file>.idx)定位时间范围, 再按条件过滤行
+//   sltj_logquery [-f from] [-t to] [-l level] [-c logger] [-T thread] [-g text] [-m max] [-N] [-v] file
+// from/to为"YYYY-mm-dd HH:MM:SS"或秒级时间戳; -N不用索引整文件扫描; -v在标准错误输出统计
+#include "../src/sltj.h"
+#include <chrono>
+#include <getopt.h>
+
+static bool ParseTimeArg(sltj::LogQuery &query, const char *arg, uint32_t &t)
+{
+    char *end = nullptr;
+    unsigned long v = strtoul(arg, &end, 10);
+    if (end && *end == '\0')
+    {
+        t = v;
+        return true;
+    }
+    return query.parseTime(arg, strlen(arg), t);
+}
+
+int main(int argc, char **argv)
+{
+    sltj::LogQuery query;
+    sltj::LogQuery::Filter filter;
+    uint64_t max = UINT64_MAX;
+    bool use_index = true;
+    bool verbose = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:t:l:c:T:g:m:Nvh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            if (!ParseTimeArg(query, optarg, filter.from))
+            {
+                std::cerr << "invalid time: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 't':
+            if (!ParseTimeArg(query, optarg, filter.to))
+            {
+                std::cerr << "invalid time: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'l':
+            filter.level = sltj::LogLevel::FromString(optarg);
+            if (filter.level == sltj::LogLevel::UNKNOW)
+            {
+                std::cerr << "invalid level: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'c':
+            filter.logger = optarg;
+            break;
+        case 'T':
+            filter.thread = optarg;
+            break;
+        case 'g':
+            filter.text = optarg;
+            break;
+        case 'm':
+            max = strtoull(optarg, nullptr, 10);
+            break;
+        case 'N':
+            use_index = false;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-f from] [-t to] [-l level] [-c logger] [-T thread]"
+                      << " [-g text] [-m max] [-N] [-v] file" << std::endl;
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        std::cerr << "missing log file" << std::endl;
+        return 1;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    if (!query.open(argv[optind], use_index))
+    {
+        std::cerr << "open " << argv[optind] << " failed" << std::endl;
+        return 1;
+    }
+    uint64_t printed = 0;
+    size_t matched = query.query(filter, [&printed, max](const char *line, size_t len) {
+        fwrite(line, 1, len, stdout);
+        fputc('\n', stdout);
+        return ++printed < max;
+    });
+    fflush(stdout);
+    if (verbose)
+    {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::cerr << "matched=" << matched << " scanned=" << query.getScannedBytes() << "/" << query.getFileSize()
+                  << " index_entries=" << query.getIndexEntries() << " ms=" << ms << std::endl;
+    }
+    return 0;
+}